@@ -0,0 +1,241 @@
+/*	File: ArbitraryFFT.c
+
+	Description:
+		Complex FFTs of any length.
+
+		A length of F * 2**n, with F one, three, or five, is done by the
+		matching vDSP FFT.  Any other length N uses Bluestein's
+		algorithm.  Since 2*j*k = j*j + k*k - (k-j)*(k-j), the DFT
+
+			X[k] = sum x[j] * exp(-2*pi*i*j*k/N) for 0 <= j < N
+
+		equals
+
+			X[k] = w[k] * sum (x[j] * w[j]) * conj(w[k-j]),
+
+		with w[n] = exp(-pi*i*n*n/N).  The sum is a convolution of the
+		chirped input with the chirp conj(w), and a circular convolution
+		of length L >= 2*N - 1 computes it exactly, so it can be done
+		with radix-2 FFTs of L elements:  transform the chirped input,
+		multiply by the transform of the chirp, and transform back.
+
+		The setup computes the chirp and the transform of the chirp, so
+		a transform costs two FFTs of L elements plus three passes of
+		complex multiplications.  An inverse transform is a forward
+		transform with the input and output conjugated.
+
+		Only the vDSP interfaces are used, so this works with both
+		Accelerate and the portable routines.
+*/
+
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "ArbitraryFFT.h"
+#include "FFTSetupRegistry.h"
+
+
+static const double Pi = 0x3.243f6a8885a308d313198a2e03707344ap0;
+
+
+struct ArbitraryFFTSetupStruct
+{
+	vDSP_Length N;
+
+	/*	For a direct transform, Factor is 1, 3, or 5 and N is Factor *
+		2**Log2N.  For Bluestein's algorithm, Factor is 0 and the
+		convolution length is 2**Log2N.
+	*/
+	vDSP_Length Factor, Log2N;
+	FFTSetup Setup;
+
+	/*	For Bluestein's algorithm, the N elements of the chirp w, the
+		2**Log2N elements of the transform of its conjugate (divided by
+		2**Log2N, the scale of the inverse transform), and a workspace
+		of 2**Log2N elements.
+	*/
+	DSPSplitComplex Chirp, Kernel, Work;
+	float *Memory;
+};
+
+
+// Allocate a split-complex vector of N elements from *Memory.
+static DSPSplitComplex TakeSplit(float **Memory, vDSP_Length N)
+{
+	DSPSplitComplex Result = { *Memory, *Memory + N };
+	*Memory += 2 * N;
+	return Result;
+}
+
+
+ArbitraryFFTSetup CreateArbitraryFFTSetup(vDSP_Length N)
+{
+	if (N == 0)
+		return NULL;
+
+	ArbitraryFFTSetup Setup = malloc(sizeof *Setup);
+	if (Setup == NULL)
+		return NULL;
+
+	Setup->N = N;
+	Setup->Memory = NULL;
+
+	// Use a vDSP FFT directly if the length is one it supports.
+	vDSP_Length Odd = N, Log2N = 0;
+	while (Odd % 2 == 0)
+	{
+		Odd /= 2;
+		++Log2N;
+	}
+
+	if (Odd == 1 || Odd == 3 || Odd == 5)
+	{
+		Setup->Factor = Odd;
+		Setup->Log2N = Log2N;
+		Setup->Setup = AcquireFFTSetup(Log2N,
+			Odd == 1 ? FFT_RADIX2 : Odd == 3 ? FFT_RADIX3 : FFT_RADIX5);
+		return Setup;
+	}
+
+	// Otherwise, prepare for Bluestein's algorithm.
+	Log2N = 0;
+	while (((vDSP_Length) 1 << Log2N) < 2*N - 1)
+		++Log2N;
+	const vDSP_Length L = (vDSP_Length) 1 << Log2N;
+
+	Setup->Factor = 0;
+	Setup->Log2N = Log2N;
+	Setup->Memory = malloc(2 * (N + 2*L) * sizeof *Setup->Memory);
+	if (Setup->Memory == NULL)
+	{
+		free(Setup);
+		return NULL;
+	}
+	Setup->Setup = AcquireFFTSetup(Log2N, FFT_RADIX2);
+
+	float *Memory = Setup->Memory;
+	Setup->Chirp  = TakeSplit(&Memory, N);
+	Setup->Kernel = TakeSplit(&Memory, L);
+	Setup->Work   = TakeSplit(&Memory, L);
+
+	/*	Compute the chirp in double precision.  n*n is reduced modulo
+		2*N first, since exp(-pi*i*n*n/N) has that period and the
+		angle would otherwise lose precision as n grows.
+	*/
+	for (vDSP_Length n = 0; n < N; ++n)
+	{
+		const double Angle = Pi * (double) (n * n % (2*N)) / N;
+		Setup->Chirp.realp[n] =  cos(Angle);
+		Setup->Chirp.imagp[n] = -sin(Angle);
+	}
+
+	/*	Lay out conj(w[n]) for -N < n < N circularly in L elements, with
+		zeros between, and transform it.
+	*/
+	const DSPSplitComplex *K = &Setup->Kernel;
+	for (vDSP_Length n = 0; n < L; ++n)
+		K->realp[n] = K->imagp[n] = 0;
+	for (vDSP_Length n = 0; n < N; ++n)
+	{
+		K->realp[n] =  Setup->Chirp.realp[n];
+		K->imagp[n] = -Setup->Chirp.imagp[n];
+		if (0 < n)
+		{
+			K->realp[L-n] = K->realp[n];
+			K->imagp[L-n] = K->imagp[n];
+		}
+	}
+	vDSP_fft_zip(Setup->Setup, K, 1, Log2N, FFT_FORWARD);
+
+	const float Scale = 1. / L;
+	for (vDSP_Length n = 0; n < L; ++n)
+	{
+		K->realp[n] *= Scale;
+		K->imagp[n] *= Scale;
+	}
+
+	return Setup;
+}
+
+
+void DestroyArbitraryFFTSetup(ArbitraryFFTSetup Setup)
+{
+	if (Setup == NULL)
+		return;
+	ReleaseFFTSetup(Setup->Setup);
+	free(Setup->Memory);
+	free(Setup);
+}
+
+
+const char *ArbitraryFFTMethod(ArbitraryFFTSetup Setup)
+{
+	switch (Setup->Factor)
+	{
+		case 1:  return "radix 2";
+		case 3:  return "radix 3";
+		case 5:  return "radix 5";
+		default: return "Bluestein";
+	}
+}
+
+
+void ArbitraryFFT_zop(ArbitraryFFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA,
+	const DSPSplitComplex *C, vDSP_Stride IC, FFTDirection Direction)
+{
+	switch (Setup->Factor)
+	{
+		case 1:
+			vDSP_fft_zop(Setup->Setup, A, IA, C, IC, Setup->Log2N,
+				Direction);
+			return;
+		case 3:
+			vDSP_fft3_zop(Setup->Setup, A, IA, C, IC, Setup->Log2N,
+				Direction);
+			return;
+		case 5:
+			vDSP_fft5_zop(Setup->Setup, A, IA, C, IC, Setup->Log2N,
+				Direction);
+			return;
+	}
+
+	const vDSP_Length N = Setup->N, L = (vDSP_Length) 1 << Setup->Log2N;
+	const float *wr = Setup->Chirp.realp, *wi = Setup->Chirp.imagp;
+	const float *kr = Setup->Kernel.realp, *ki = Setup->Kernel.imagp;
+	float *re = Setup->Work.realp, *im = Setup->Work.imagp;
+
+	/*	For the inverse transform, conjugate the input and output, which
+		is done by multiplying their imaginary parts by Sign.
+	*/
+	const float Sign = Direction == FFT_FORWARD ? 1 : -1;
+
+	// Multiply the input by the chirp and pad it with zeros.
+	for (vDSP_Length n = 0; n < N; ++n)
+	{
+		const float xr = A->realp[n*IA], xi = Sign * A->imagp[n*IA];
+		re[n] = xr * wr[n] - xi * wi[n];
+		im[n] = xr * wi[n] + xi * wr[n];
+	}
+	for (vDSP_Length n = N; n < L; ++n)
+		re[n] = im[n] = 0;
+
+	// Convolve with the conjugate chirp.
+	vDSP_fft_zip(Setup->Setup, &Setup->Work, 1, Setup->Log2N, FFT_FORWARD);
+	for (vDSP_Length n = 0; n < L; ++n)
+	{
+		const float xr = re[n], xi = im[n];
+		re[n] = xr * kr[n] - xi * ki[n];
+		im[n] = xr * ki[n] + xi * kr[n];
+	}
+	vDSP_fft_zip(Setup->Setup, &Setup->Work, 1, Setup->Log2N, FFT_INVERSE);
+
+	// Multiply by the chirp again to get the results.
+	for (vDSP_Length n = 0; n < N; ++n)
+	{
+		const float yr = re[n], yi = im[n];
+		C->realp[n*IC] =         yr * wr[n] - yi * wi[n];
+		C->imagp[n*IC] = Sign * (yr * wi[n] + yi * wr[n]);
+	}
+}
@@ -0,0 +1,65 @@
+/*	File: ArbitraryFFT.h
+
+	Description:
+		Declarations for complex FFTs of any length, using the radix-2,
+		radix-3, and radix-5 FFTs where the length allows and Bluestein's
+		algorithm otherwise.
+*/
+#ifndef __ARBITRARYFFT__
+#define __ARBITRARYFFT__
+
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	vDSP's FFTs handle lengths of 2**n, 3 * 2**n, and 5 * 2**n.  These
+	routines handle any length N, with the same division of work as
+	vDSP:  creating a setup does everything that depends only on N, and
+	performing a transform does only the arithmetic on the data.
+
+	When N is 2**n, 3 * 2**n, or 5 * 2**n, the transform calls the vDSP
+	FFT for that length directly.  Otherwise it uses Bluestein's
+	algorithm, which rewrites the transform as a circular convolution
+	of length 2**m >= 2*N - 1 and does that with two radix-2 FFTs of
+	2**m elements.  The results differ from a direct transform by
+	rounding error.
+
+	A setup holds the workspace used by Bluestein's algorithm, so,
+	unlike a vDSP setup, one setup must not be used by several threads
+	at the same time.
+*/
+typedef struct ArbitraryFFTSetupStruct *ArbitraryFFTSetup;
+
+/*	Create a setup for transforms of N elements, or return NULL if N is
+	zero or memory cannot be allocated.
+*/
+ArbitraryFFTSetup CreateArbitraryFFTSetup(vDSP_Length N);
+
+// Destroy a setup.
+void DestroyArbitraryFFTSetup(ArbitraryFFTSetup Setup);
+
+/*	Perform a complex FFT of N elements from A to C, where N is the length
+	the setup was created for.  As with vDSP, neither direction is
+	scaled.
+*/
+void ArbitraryFFT_zop(ArbitraryFFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA,
+	const DSPSplitComplex *C, vDSP_Stride IC, FFTDirection Direction);
+
+/*	Describe the method a setup uses, such as "radix 3" or "Bluestein",
+	for reports.
+*/
+const char *ArbitraryFFTMethod(ArbitraryFFTSetup Setup);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
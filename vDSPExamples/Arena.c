@@ -0,0 +1,221 @@
+/*	File: Arena.c
+
+	Description:
+		An arena allocator for DSP work buffers.  See Arena.h.
+
+		Each block is obtained with mmap, so it starts on a page boundary
+		and is returned to the system when the arena is destroyed.  The
+		blocks form a list, which the arena keeps when it is reset:
+		resetting moves the allocation point back to the start of the
+		first block, and each later block is emptied only when
+		allocation reaches it, so resetting takes constant time no
+		matter how many blocks there are.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Arena.h"
+
+
+/*	A block starts with this header, padded to ArenaAlignment bytes,
+	followed by the memory handed out.
+*/
+typedef struct Block
+{
+	struct Block *Next;
+	size_t Size;	// Bytes available after the header.
+	size_t Used;	// Bytes handed out since the block was last emptied.
+	size_t Mapped;	// Bytes obtained from the system, for munmap.
+	void *Base;		// Address obtained from the system, for munmap.
+} Block;
+
+static const size_t HeaderSize =
+	(sizeof(Block) + ArenaAlignment - 1) / ArenaAlignment * ArenaAlignment;
+
+
+struct Arena
+{
+	Block *First, *Current;
+	size_t BlockSize;	// Minimum size for new blocks.
+	unsigned Flags;
+	size_t InUse;		// Bytes handed out since the last reset.
+	ArenaStatistics Statistics;
+};
+
+
+// Size of huge pages requested with ArenaHugePages.
+static const size_t HugePageSize = 2 << 20;
+
+
+// Round Size up to a multiple of Unit, which must be a power of two.
+static size_t RoundUp(size_t Size, size_t Unit)
+{
+	return (Size + Unit - 1) & ~(Unit - 1);
+}
+
+
+// Map memory or exit with a message.
+static void *Map(size_t Size)
+{
+	void *p = mmap(NULL, Size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (p == MAP_FAILED)
+	{
+		fprintf(stderr, "Error, failed to map %lu bytes of memory.\n",
+			(unsigned long) Size);
+		exit(EXIT_FAILURE);
+	}
+	return p;
+}
+
+
+// Obtain a block with room for at least Size bytes from the system.
+static Block *CreateBlock(Arena *A, size_t Size)
+{
+	const size_t Page = sysconf(_SC_PAGESIZE);
+	size_t Mapped = RoundUp(HeaderSize + Size, Page);
+	char *Base, *Start;
+
+	#if defined MADV_HUGEPAGE
+		if (A->Flags & ArenaHugePages)
+		{
+			/*	Huge pages must start on a huge-page boundary, so map an
+				extra huge page and unmap the parts before and after a
+				boundary.
+			*/
+			Mapped = RoundUp(Mapped, HugePageSize);
+			Base = Map(Mapped + HugePageSize);
+			Start = (char *) RoundUp((size_t) Base, HugePageSize);
+			if (Base < Start)
+				munmap(Base, Start - Base);
+			munmap(Start + Mapped, Base + HugePageSize - Start);
+			Base = Start;
+
+			// Failure only means ordinary pages are used.
+			madvise(Base, Mapped, MADV_HUGEPAGE);
+		}
+		else
+	#endif
+			Base = Map(Mapped);
+
+	if (A->Flags & ArenaFirstTouch)
+		memset(Base, 0, Mapped);
+
+	Block *B = (Block *) Base;
+	B->Next = NULL;
+	B->Size = Mapped - HeaderSize;
+	B->Used = 0;
+	B->Mapped = Mapped;
+	B->Base = Base;
+
+	A->Statistics.Blocks += 1;
+	A->Statistics.BlockBytes += Mapped;
+
+	return B;
+}
+
+
+Arena *CreateArena(size_t Size, unsigned Flags)
+{
+	Arena *A = malloc(sizeof *A);
+	if (A == NULL)
+	{
+		fprintf(stderr, "Error, failed to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	A->BlockSize = Size;
+	A->Flags = Flags;
+	A->InUse = 0;
+	A->Statistics = (ArenaStatistics) { 0, 0, 0, 0 };
+	A->First = A->Current = CreateBlock(A, Size);
+
+	return A;
+}
+
+
+void DestroyArena(Arena *A)
+{
+	if (A == NULL)
+		return;
+
+	for (Block *B = A->First, *Next; B != NULL; B = Next)
+	{
+		Next = B->Next;
+		munmap(B->Base, B->Mapped);
+	}
+
+	free(A);
+}
+
+
+void *ArenaAllocate(Arena *A, size_t Size)
+{
+	Size = RoundUp(Size, ArenaAlignment);
+
+	/*	Move to the next block until one has room, emptying each block as
+		it is reached, and add a block at the end of the list if none
+		does.  Space left at the end of a block is not used again until
+		the arena is reset.
+	*/
+	Block *B = A->Current;
+	while (B->Size - B->Used < Size)
+	{
+		if (B->Next == NULL)
+			B->Next = CreateBlock(A,
+				Size < A->BlockSize ? A->BlockSize : Size);
+		B = B->Next;
+		B->Used = 0;
+	}
+	A->Current = B;
+
+	void *p = (char *) B + HeaderSize + B->Used;
+	B->Used += Size;
+
+	A->InUse += Size;
+	if (A->Statistics.HighWater < A->InUse)
+		A->Statistics.HighWater = A->InUse;
+	A->Statistics.Allocations += 1;
+
+	return p;
+}
+
+
+DSPSplitComplex ArenaAllocateSplit(Arena *A, vDSP_Length N)
+{
+	/*	Keep corresponding elements at least Skew bytes from any multiple
+		of 4096 bytes apart.  Four cache lines is more than the distance
+		between the loads and stores of a vectorized butterfly.
+	*/
+	static const size_t Page = 4096, Skew = 4 * ArenaAlignment;
+
+	size_t Distance = RoundUp(N * sizeof(float), ArenaAlignment);
+	const size_t r = Distance % Page;
+	if (r < Skew)
+		Distance += Skew - r;
+	else if (Page - Skew < r)
+		Distance += Page - r + Skew;
+
+	float *p = ArenaAllocate(A, Distance + N * sizeof(float));
+	DSPSplitComplex C = { p, (float *) ((char *) p + Distance) };
+	return C;
+}
+
+
+void ResetArena(Arena *A)
+{
+	A->Current = A->First;
+	A->First->Used = 0;
+	A->InUse = 0;
+}
+
+
+ArenaStatistics GetArenaStatistics(const Arena *A)
+{
+	return A->Statistics;
+}
@@ -0,0 +1,106 @@
+/*	File: Arena.h
+
+	Description:
+		Declarations for an arena that hands out aligned work buffers
+		for DSP routines.
+*/
+#ifndef __ARENA__
+#define __ARENA__
+
+
+#include <stddef.h>
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	Code that processes a stream frame by frame needs the same work
+	buffers for every frame.  Getting them from malloc and returning
+	them with free costs time in each frame, and malloc promises only
+	16-byte alignment, less than a cache line or an AVX vector.
+
+	An arena instead takes large blocks of memory from the system once
+	and hands out pieces of them by advancing an offset.  Pieces are not
+	freed individually; instead, the whole arena is reset, typically at
+	the start of each frame, which takes constant time.  After the first
+	frame, the blocks the arena holds are large enough for every frame
+	that allocates the same buffers, so no more memory is requested from
+	the system.
+
+	An arena is not safe to use from several threads at once; give each
+	thread its own.
+*/
+typedef struct Arena Arena;
+
+
+// Every buffer an arena hands out is aligned to this many bytes.
+enum { ArenaAlignment = 64 };
+
+
+/*	Flags for CreateArena.  ArenaHugePages asks the system to back the
+	arena with huge pages (2 MiB on x86-64), which reduces TLB misses
+	on large buffers.  It is a hint; systems that do not support it use
+	ordinary pages.
+
+	ArenaFirstTouch has the thread that obtains each block touch all of
+	its pages at once.  The system places a page on the NUMA node of the
+	thread that first touches it (see NUMA.h), so a worker that creates
+	its own arena gets its buffers in its own node's memory, and takes
+	no page faults later while using them.
+*/
+enum { ArenaHugePages = 1, ArenaFirstTouch = 2 };
+
+
+/*	Create an arena whose first block holds Size bytes.  Later blocks
+	are at least this large, so Size should cover a frame's buffers.
+	Exit with an error message if the memory cannot be obtained.
+*/
+Arena *CreateArena(size_t Size, unsigned Flags);
+
+// Release an arena and all the memory it holds.
+void DestroyArena(Arena *A);
+
+/*	Return Size bytes aligned to ArenaAlignment, valid until the arena
+	is reset or destroyed.  The contents are not initialized.  Exit with
+	an error message if the memory cannot be obtained.
+*/
+void *ArenaAllocate(Arena *A, size_t Size);
+
+/*	Return a split-complex vector of N elements, with its real and
+	imaginary arrays in one allocation.  The arrays are separated by
+	enough padding that corresponding elements never lie a multiple of
+	4096 bytes apart, since a processor can mistake a load from one for
+	a load depending on a store to the other ("4K aliasing"), which
+	stalls loops that read and write both.
+*/
+DSPSplitComplex ArenaAllocateSplit(Arena *A, vDSP_Length N);
+
+/*	Make all the memory of an arena available again.  Buffers handed out
+	before must not be used after this.  This takes constant time.
+*/
+void ResetArena(Arena *A);
+
+
+/*	Describe an arena's use of memory:  the number of buffers it has
+	handed out, the number of blocks it has obtained from the system
+	and their total size, and the most memory in use at once.
+*/
+typedef struct
+{
+	unsigned long Allocations, Blocks;
+	size_t BlockBytes, HighWater;
+} ArenaStatistics;
+
+ArenaStatistics GetArenaStatistics(const Arena *A);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -0,0 +1,422 @@
+/*	File: Benchmark.c
+
+	Description:
+		A harness for timing routines.
+
+		A benchmark proceeds in three steps.  First, calibration:  the
+		routine is timed for 1, 2, 4, ... calls until a batch takes at
+		least SampleTime, so that the clock's resolution and latency
+		are small compared to a sample.  Second, warmup:  batches are
+		run and discarded for at least WarmupTime, long enough for
+		caches, branch predictors, and the processor's clock to settle
+		rather than just one batch.  Third, measurement:  enough
+		batches to fill about TotalTime are timed individually, but no
+		fewer than MinimumSamples nor more than MaximumSamples.
+
+		Reporting the minimum, median, maximum, and standard deviation
+		of the samples, rather than a single mean, shows how much the
+		measurement can be trusted:  the minimum is closest to the
+		routine's intrinsic speed, the median is typical, and a large
+		maximum or deviation shows interference from other work,
+		interrupts, or frequency changes.  (With at most
+		MaximumSamples samples, a high percentile such as the 99th would
+		be the maximum anyway, so the maximum is reported as such.)
+
+		If hardware counters are in use, they are read before and after
+		the measured samples, and the events are averaged over all calls
+		in them.
+*/
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Benchmark.h"
+#include "CPUFeatures.h"
+#include "Demonstrate.h"
+
+
+// Least time for one sample, in seconds.
+static const double SampleTime = .002;
+
+// Time to spend warming up and measuring each benchmark, in seconds.
+static const double WarmupTime = .05, TotalTime = .2;
+
+// Bounds on the number of samples.
+enum { MinimumSamples = 3, MaximumSamples = 101 };
+
+
+// Whether hardware events are counted.
+static int CountersInUse;
+
+
+// Machine-readable output files, if open.
+static FILE *JSONFile, *CSVFile;
+
+// Whether a result has been written to the JSON file yet.
+static int JSONStarted;
+
+
+// Time Iterations calls of a routine and return the time in seconds.
+static double TimeBatch(BenchmarkRoutine *Routine, void *Context,
+	unsigned long Iterations)
+{
+	ClockData t0 = Clock();
+	for (unsigned long i = 0; i < Iterations; ++i)
+		Routine(Context);
+	ClockData t1 = Clock();
+
+	return ClockToSeconds(t1, t0);
+}
+
+
+// Compare two doubles for qsort.
+static int CompareDoubles(const void *a, const void *b)
+{
+	const double x = * (const double *) a, y = * (const double *) b;
+	return (x > y) - (x < y);
+}
+
+
+// Divide an event count by the number of calls, unless it was not counted.
+static double PerCall(double Count, double Calls)
+{
+	return Count < 0 ? Count : Count / Calls;
+}
+
+
+BenchmarkResult Benchmark(const char *Name, BenchmarkRoutine *Routine,
+	void *Context, double Flops, double Bytes, double Elements)
+{
+	BenchmarkResult R;
+	double Times[MaximumSamples];
+	CounterReading c0, c1;
+
+	snprintf(R.Name, sizeof R.Name, "%s", Name);
+	R.Flops = Flops;
+	R.Bytes = Bytes;
+	R.Elements = Elements;
+
+	// Calibrate.
+	unsigned long Iterations = 1;
+	double Time;
+	while ((Time = TimeBatch(Routine, Context, Iterations)) < SampleTime)
+		Iterations *= 2;
+	R.Iterations = Iterations;
+
+	/*	Warm up, keeping the time of the last batch to estimate the
+		number of samples to take.
+	*/
+	for (double Warmup = 0; Warmup < WarmupTime; Warmup += Time)
+		Time = TimeBatch(Routine, Context, Iterations);
+
+	// Measure.
+	unsigned Samples = TotalTime / Time;
+	if (Samples < MinimumSamples)
+		Samples = MinimumSamples;
+	if (MaximumSamples < Samples)
+		Samples = MaximumSamples;
+	R.Samples = Samples;
+
+	if (CountersInUse)
+		ReadCounters(&c0);
+	for (unsigned s = 0; s < Samples; ++s)
+		Times[s] = TimeBatch(Routine, Context, Iterations) / Iterations;
+	if (CountersInUse)
+		ReadCounters(&c1);
+
+	R.Counted = CountersInUse;
+	if (CountersInUse)
+	{
+		const double Calls = (double) Samples * Iterations;
+		R.Counters = SubtractCounters(&c1, &c0);
+		R.Counters.Cycles       = PerCall(R.Counters.Cycles, Calls);
+		R.Counters.Instructions = PerCall(R.Counters.Instructions, Calls);
+		R.Counters.L1Misses     = PerCall(R.Counters.L1Misses, Calls);
+		R.Counters.LLCMisses    = PerCall(R.Counters.LLCMisses, Calls);
+		R.Counters.BranchMisses = PerCall(R.Counters.BranchMisses, Calls);
+	}
+
+	qsort(Times, Samples, sizeof *Times, CompareDoubles);
+
+	double Sum = 0, SumOfSquares = 0;
+	for (unsigned s = 0; s < Samples; ++s)
+		Sum += Times[s];
+	R.Mean = Sum / Samples;
+	for (unsigned s = 0; s < Samples; ++s)
+		SumOfSquares += (Times[s] - R.Mean) * (Times[s] - R.Mean);
+
+	R.Minimum = Times[0];
+	R.Median = Samples % 2
+		? Times[Samples/2]
+		: (Times[Samples/2 - 1] + Times[Samples/2]) / 2;
+	R.Maximum = Times[Samples - 1];
+	R.StandardDeviation = 1 < Samples
+		? sqrt(SumOfSquares / (Samples - 1))
+		: 0;
+
+	return R;
+}
+
+
+// Write a string in JSON, escaping the characters that require it.
+static void WriteJSONString(FILE *File, const char *s)
+{
+	putc('"', File);
+	for (; *s; ++s)
+		if (*s == '"' || *s == '\\')
+			fprintf(File, "\\%c", *s);
+		else if ((unsigned char) *s < ' ')
+			fprintf(File, "\\u%04x", *s);
+		else
+			putc(*s, File);
+	putc('"', File);
+}
+
+
+/*	Write an event count as a JSON member, or null if it was not
+	counted.
+*/
+static void WriteJSONCount(FILE *File, const char *Key, double Count)
+{
+	if (Count < 0)
+		fprintf(File, ", \"%s\": null", Key);
+	else
+		fprintf(File, ", \"%s\": %.6e", Key, Count);
+}
+
+
+// Write an event count as a CSV field, or an empty field.
+static void WriteCSVCount(FILE *File, double Count)
+{
+	if (Count < 0)
+		fprintf(File, ",");
+	else
+		fprintf(File, ",%.6e", Count);
+}
+
+
+void RecordBenchmark(const BenchmarkResult *R)
+{
+	// Uncounted events are written as missing.
+	const CounterValues None = { -1, -1, -1, -1, -1 },
+		*C = R->Counted ? &R->Counters : &None;
+
+	// Rates are computed from the median time.
+	const double
+		Gigaflops = R->Flops / R->Median * 1e-9,
+		BytesPerSecond = R->Bytes / R->Median;
+
+	if (JSONFile)
+	{
+		fprintf(JSONFile, "%s\n\t{ \"name\": ", JSONStarted ? "," : "");
+		WriteJSONString(JSONFile, R->Name);
+		fprintf(JSONFile, ", \"iterations\": %lu, \"samples\": %u,"
+			" \"minimum\": %.6e, \"median\": %.6e, \"maximum\": %.6e,"
+			" \"mean\": %.6e, \"stddev\": %.6e,"
+			" \"gflops\": %.6e, \"bytes_per_second\": %.6e,"
+			" \"elements\": %.6e",
+			R->Iterations, R->Samples, R->Minimum, R->Median, R->Maximum,
+			R->Mean, R->StandardDeviation, Gigaflops, BytesPerSecond,
+			R->Elements);
+		WriteJSONCount(JSONFile, "cycles", C->Cycles);
+		WriteJSONCount(JSONFile, "instructions", C->Instructions);
+		WriteJSONCount(JSONFile, "l1_misses", C->L1Misses);
+		WriteJSONCount(JSONFile, "llc_misses", C->LLCMisses);
+		WriteJSONCount(JSONFile, "branch_misses", C->BranchMisses);
+		fprintf(JSONFile, " }");
+		JSONStarted = 1;
+	}
+
+	if (CSVFile)
+	{
+		// Quote the name, doubling any quotation marks in it.
+		putc('"', CSVFile);
+		for (const char *s = R->Name; *s; ++s)
+		{
+			if (*s == '"')
+				putc('"', CSVFile);
+			putc(*s, CSVFile);
+		}
+		fprintf(CSVFile,
+			"\",%lu,%u,%.6e,%.6e,%.6e,%.6e,%.6e,%.6e,%.6e,%.6e",
+			R->Iterations, R->Samples, R->Minimum, R->Median, R->Maximum,
+			R->Mean, R->StandardDeviation, Gigaflops, BytesPerSecond,
+			R->Elements);
+		WriteCSVCount(CSVFile, C->Cycles);
+		WriteCSVCount(CSVFile, C->Instructions);
+		WriteCSVCount(CSVFile, C->L1Misses);
+		WriteCSVCount(CSVFile, C->LLCMisses);
+		WriteCSVCount(CSVFile, C->BranchMisses);
+		putc('\n', CSVFile);
+	}
+}
+
+
+/*	Format Count / Divisor in Buffer, or "n/a" if the count is
+	missing or the divisor is not positive, and return Buffer.
+*/
+static const char *FormatRatio(char *Buffer, size_t Size, double Count,
+	double Divisor)
+{
+	if (Count < 0 || Divisor <= 0)
+		snprintf(Buffer, Size, "n/a");
+	else
+		snprintf(Buffer, Size, "%.3g", Count / Divisor);
+	return Buffer;
+}
+
+
+void ReportBenchmark(const BenchmarkResult *R)
+{
+	// Show times in microseconds, or in milliseconds if they are long.
+	const int Long = 1e-3 <= R->Median;
+	const double Scale = Long ? 1e3 : 1e6;
+
+	printf("\t\t(min %.4g, median %.4g, max %.4g, stddev %.2g %s",
+		R->Minimum * Scale, R->Median * Scale, R->Maximum * Scale,
+		R->StandardDeviation * Scale, Long ? "milliseconds" : "microseconds");
+	if (R->Flops)
+		printf(", %.3g gigaflops", R->Flops / R->Median * 1e-9);
+	if (R->Bytes)
+		printf(", %.3g GB/s", R->Bytes / R->Median * 1e-9);
+	printf(".)\n");
+
+	// Show the hardware events, marking those not counted as "n/a".
+	if (R->Counted)
+	{
+		const CounterValues *C = &R->Counters;
+		char IPC[16], L1[16], LLC[16], Branch[16];
+		printf("\t\t(IPC %s; per element, %s L1 misses, %s LLC misses, "
+			"%s branch misses.)\n",
+			FormatRatio(IPC, sizeof IPC, C->Instructions, C->Cycles),
+			FormatRatio(L1, sizeof L1, C->L1Misses, R->Elements),
+			FormatRatio(LLC, sizeof LLC, C->LLCMisses, R->Elements),
+			FormatRatio(Branch, sizeof Branch, C->BranchMisses,
+				R->Elements));
+	}
+
+	RecordBenchmark(R);
+}
+
+
+/*	Run Routine for about a millisecond, long enough for the processor to
+	settle into whatever clock its instructions allow, and then estimate
+	the frequency.
+*/
+static double FrequencyAfter(BenchmarkRoutine *Routine, void *Context)
+{
+	const ClockData t0 = Clock();
+	do
+		Routine(Context);
+	while (ClockToSeconds(Clock(), t0) < .001);
+
+	return EstimateProcessorFrequency();
+}
+
+
+void ReportAVX2Comparison(const BenchmarkResult *Result,
+	BenchmarkRoutine *Routine, void *Context)
+{
+	/*	Accelerate chooses its own kernels, so there is nothing to compare
+		on Mac OS X.
+	*/
+	#if !defined __APPLE__
+
+		if ((CPUFeatures() & CPUAVX512) == 0)
+			return;
+
+		const double Wide = FrequencyAfter(Routine, Context);
+
+		const unsigned Previous = LimitCPUFeatures(~CPUAVX512);
+
+		/*	Shorten the base name if necessary so the suffix fits in the
+			result's name.
+		*/
+		static const char Suffix[] = " AVX2";
+		char Name[sizeof Result->Name];
+		snprintf(Name, sizeof Name, "%.*s%s",
+			(int) (sizeof Name - sizeof Suffix), Result->Name, Suffix);
+		BenchmarkResult R = Benchmark(Name, Routine, Context,
+			Result->Flops, Result->Bytes, Result->Elements);
+		const double Narrow = FrequencyAfter(Routine, Context);
+
+		LimitCPUFeatures(Previous);
+
+		printf("\tWith AVX2 kernels, it takes %g microseconds, so the "
+				"AVX-512 kernels\n"
+			"\tare %.2f times as fast.  The processor ran at about %.2f "
+				"GHz after\n"
+			"\tthe AVX-512 kernels and %.2f GHz after the AVX2 kernels.\n",
+			R.Median * 1e6, R.Median / Result->Median,
+			Wide * 1e-9, Narrow * 1e-9);
+		RecordBenchmark(&R);
+
+	#endif
+}
+
+
+void UseBenchmarkCounters(void)
+{
+	CountersInUse = 0 < OpenCounters();
+	if (!CountersInUse)
+		printf("Hardware performance counters are unavailable, "
+			"so only times are reported.\n");
+}
+
+
+// Open a file for writing, or exit with an error message.
+static FILE *OpenOutput(const char *Name)
+{
+	FILE *File = fopen(Name, "w");
+	if (File == NULL)
+	{
+		fprintf(stderr, "Error, unable to open %s.\n", Name);
+		exit(EXIT_FAILURE);
+	}
+	return File;
+}
+
+
+void OpenBenchmarkOutput(const char *JSONName, const char *CSVName)
+{
+	if (JSONName)
+	{
+		JSONFile = OpenOutput(JSONName);
+		fprintf(JSONFile, "[");
+		JSONStarted = 0;
+	}
+
+	if (CSVName)
+	{
+		CSVFile = OpenOutput(CSVName);
+		fprintf(CSVFile, "name,iterations,samples,minimum,median,maximum,"
+			"mean,stddev,gflops,bytes_per_second,elements,cycles,"
+			"instructions,l1_misses,llc_misses,branch_misses\n");
+	}
+}
+
+
+void CloseBenchmarkOutput(void)
+{
+	if (CountersInUse)
+	{
+		CloseCounters();
+		CountersInUse = 0;
+	}
+
+	if (JSONFile)
+	{
+		fprintf(JSONFile, "\n]\n");
+		fclose(JSONFile);
+		JSONFile = NULL;
+	}
+
+	if (CSVFile)
+	{
+		fclose(CSVFile);
+		CSVFile = NULL;
+	}
+}
@@ -0,0 +1,104 @@
+/*	File: Benchmark.h
+
+	Description:
+		Declarations for a harness that times a routine with the Clock
+		routine, reports statistics of the times, and records them in
+		machine-readable form.
+*/
+#ifndef __BENCHMARK__
+#define __BENCHMARK__
+
+
+#include "Counters.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+// A routine to be timed.  It is called with the context given to Benchmark.
+typedef void BenchmarkRoutine(void *Context);
+
+
+// Describe the measurements of one benchmark.
+typedef struct
+{
+	char Name[64];		// Name used in machine-readable output.
+	unsigned long Iterations;	// Calls timed together in each sample.
+	unsigned Samples;	// Number of samples taken.
+
+	// Statistics of the samples, in seconds per call.
+	double Minimum, Median, Maximum, Mean, StandardDeviation;
+
+	// Work done by each call, as given to Benchmark.
+	double Flops, Bytes, Elements;
+
+	/*	Hardware events per call, averaged over the samples, if
+		counters are in use (see UseBenchmarkCounters).  Events that
+		were not counted are negative.
+	*/
+	int Counted;
+	CounterValues Counters;
+} BenchmarkResult;
+
+
+/*	Time Routine and return the measurements.  Flops and Bytes are the
+	floating-point operations and the bytes of memory traffic in one call,
+	used to report rates; either may be zero if it is not meaningful.
+	Elements is the number of data elements one call processes, used to
+	report hardware events per element.
+
+	The number of calls in each sample is chosen so that a sample takes
+	long enough for the clock to measure it accurately.  Some samples
+	are run and discarded first, so that caches, branch predictors, and
+	the processor's clock speed have settled.
+*/
+BenchmarkResult Benchmark(const char *Name, BenchmarkRoutine *Routine,
+	void *Context, double Flops, double Bytes, double Elements);
+
+/*	Print the statistics of a result on a line after the line in which
+	the caller reports the time, and record the result in any
+	machine-readable output that is open.
+*/
+void ReportBenchmark(const BenchmarkResult *Result);
+
+/*	Record a result in any machine-readable output that is open, without
+	printing it, for results the caller prints in a table.
+*/
+void RecordBenchmark(const BenchmarkResult *Result);
+
+/*	If the portable routines are using AVX-512 kernels, time Routine
+	again with the kernels limited to AVX2, record that result under
+	Result's name with " AVX2" appended, and print how much faster the
+	AVX-512 kernels are.  Also print the processor's frequency just
+	after each set of kernels runs, since some processors lower their
+	clock while running 512-bit instructions, which takes back part of
+	the gain from the wider vectors.  Otherwise, do nothing.
+*/
+void ReportAVX2Comparison(const BenchmarkResult *Result,
+	BenchmarkRoutine *Routine, void *Context);
+
+/*	Count hardware events during the samples of later benchmarks, and
+	report instructions per cycle and cache and branch misses per
+	element.  If the system provides no counters, say so and report
+	times only.  This should be called before creating threads whose
+	work is to be counted.
+*/
+void UseBenchmarkCounters(void);
+
+/*	Start recording results in a JSON file and a CSV file.  Either name
+	may be null to omit that file.
+*/
+void OpenBenchmarkOutput(const char *JSONName, const char *CSVName);
+
+// Finish and close the machine-readable output.
+void CloseBenchmarkOutput(void);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
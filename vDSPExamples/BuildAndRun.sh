@@ -1,15 +1,57 @@
 #!/bin/csh -e
 
-echo ""
-echo "Building examples."
-xcodebuild -configuration Default \
-    -project vDSPExamples.xcodeproj \
-    -target "All Examples"
+if (`uname` == Darwin) then
+    echo ""
+    echo "Building examples."
+    xcodebuild -configuration Default \
+        -project vDSPExamples.xcodeproj \
+        -target "All Examples"
+else
+    # Without Xcode and Accelerate, use the portable vDSP routines.
+    echo ""
+    echo "Building examples with the portable vDSP routines."
+    mkdir -p build/Default
+    cc -std=gnu99 -O3 -o build/Default/Demonstrate \
+        Demonstrate.c ArbitraryFFT.c Arena.c Clock.c CPUFeatures.c \
+        DemonstrateConvolution.c DemonstrateFFT.c DemonstrateFFT2D.c \
+        DemonstrateNUMA.c DemonstrateSubnormals.c Benchmark.c Counters.c \
+        FastConvolution.c FFTSetupRegistry.c MathMode.c \
+        MultichannelConvolution.c NUMA.c OutOfCoreFFT2D.c \
+        ParallelConvolution.c ParallelFFT2D.c ThreadPool.c PortableFFT.c \
+        PortableConvolution.c -lm -lpthread -ldl
+    cc -std=gnu99 -O3 -o build/Default/DTMF \
+        DTMF.c Arena.c CPUFeatures.c DTMFStream.c FFTSetupRegistry.c \
+        Goertzel.c NUMA.c Oscillator.c Philox.c PortableFFT.c \
+        -lm -lpthread -ldl
+endif
 
 echo ""
 echo "Running Demonstrate."
-./build/Default/Demonstrate
+./build/Default/Demonstrate -counters -json build/Default/Benchmarks.json \
+    -csv build/Default/Benchmarks.csv
 
 echo ""
 echo "Running DTMF."
 ./build/Default/DTMF "159#"
+
+echo ""
+echo "Running DTMF on a generated stream of 1000 channels."
+./build/Default/DTMF -generate 1000 10 build/Default/Stream.pcm \
+    > build/Default/Dialed.txt
+./build/Default/DTMF -stream 1000 build/Default/Stream.pcm \
+    > build/Default/Decoded.txt
+if ({ cmp -s build/Default/Dialed.txt build/Default/Decoded.txt }) then
+    echo "The keys decoded on every channel match the keys dialed."
+else
+    echo "The keys decoded differ from the keys dialed:"
+    diff build/Default/Dialed.txt build/Default/Decoded.txt | head
+endif
+rm -f build/Default/Stream.pcm
+
+echo ""
+echo "Comparing tone generators."
+./build/Default/DTMF -oscillators
+
+echo ""
+echo "Comparing noise generators."
+./build/Default/DTMF -noise
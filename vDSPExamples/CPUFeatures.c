@@ -0,0 +1,266 @@
+/*	File: CPUFeatures.c
+
+	Description:
+		Run-time detection of vector instruction sets.  See
+		CPUFeatures.h.
+
+		On Intel processors, cpuid reports what the processor supports
+		and xgetbv reports which register states the operating system
+		saves, which AVX and AVX-512 also need.  On ARM processors
+		running Linux, the kernel reports the features in the auxiliary
+		vector, read with getauxval.  On PowerPC Mac OS X, sysctl
+		reports whether AltiVec is present.
+
+		Detection runs once, on first use, and its results are kept.
+*/
+
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined __i386__ || defined __x86_64__
+	#include <cpuid.h>
+	#define	IntelProcessor	1
+#elif defined __aarch64__ && defined __linux__
+	#include <sys/auxv.h>
+#elif defined __APPLE__ && (defined __ppc__ || defined __ppc64__)
+	#include <sys/sysctl.h>
+#endif
+
+#include "CPUFeatures.h"
+
+
+// Name each feature, in the order of the bits.
+static const struct { unsigned Feature; const char *Name; } FeatureNames[] =
+{
+	{ CPUSSE2,    "SSE2"    },
+	{ CPUAVX,     "AVX"     },
+	{ CPUAVX2,    "AVX2"    },
+	{ CPUFMA,     "FMA"     },
+	{ CPUAVX512,  "AVX-512" },
+	{ CPUNEON,    "NEON"    },
+	{ CPUSVE,     "SVE"     },
+	{ CPUAltiVec, "AltiVec" },
+};
+
+
+/*	For each VDSP_ISA setting, the features it allows.  Each instruction
+	set includes the ones below it.
+*/
+static const struct { const char *Setting; unsigned Allowed; } Ceilings[] =
+{
+	{ "scalar", 0 },
+	{ "sse2",   CPUSSE2 },
+	{ "avx",    CPUSSE2 | CPUAVX },
+	{ "avx2",   CPUSSE2 | CPUAVX | CPUAVX2 | CPUFMA },
+	{ "avx512", CPUSSE2 | CPUAVX | CPUAVX2 | CPUFMA | CPUAVX512 },
+	{ "neon",   CPUNEON },
+	{ "sve",    CPUNEON | CPUSVE },
+};
+
+
+static unsigned Detected, Allowed;
+static pthread_once_t DetectOnce = PTHREAD_ONCE_INIT;
+
+/*	The limit set by LimitCPUFeatures.  It may change while other threads
+	call CPUFeatures, so it is only read and written atomically.
+*/
+static unsigned Limit = ~0u;
+
+
+#if defined IntelProcessor
+
+	// Return the register states the operating system saves (XCR0).
+	static unsigned long long GetXCR0(void)
+	{
+		unsigned int Low, High;
+		__asm__ __volatile__("xgetbv" : "=a" (Low), "=d" (High) : "c" (0));
+		return (unsigned long long) High << 32 | Low;
+	}
+
+	static unsigned DetectFeatures(void)
+	{
+		unsigned int a, b, c, d;
+		unsigned Features = 0;
+
+		if (!__get_cpuid(1, &a, &b, &c, &d))
+			return 0;
+		if (d >> 26 & 1)
+			Features |= CPUSSE2;
+
+		// AVX needs the system to save the XMM and YMM states.
+		const int OSXSAVE = c >> 27 & 1;
+		const unsigned long long XCR0 = OSXSAVE ? GetXCR0() : 0;
+		const int SavesYMM = (XCR0 & 0x6) == 0x6;
+		const int SavesZMM = (XCR0 & 0xe6) == 0xe6;
+
+		if (SavesYMM && (c >> 28 & 1))
+			Features |= CPUAVX;
+		if (SavesYMM && (c >> 12 & 1))
+			Features |= CPUFMA;
+
+		if (__get_cpuid_max(0, NULL) < 7)
+			return Features;
+		__cpuid_count(7, 0, a, b, c, d);
+
+		if ((Features & CPUAVX) && (b >> 5 & 1))
+			Features |= CPUAVX2;
+
+		// Require AVX-512 F, DQ, BW, and VL (bits 16, 17, 30, and 31).
+		const unsigned int AVX512Bits = 1u << 16 | 1u << 17 | 1u << 30
+			| 1u << 31;
+		if (SavesZMM && (b & AVX512Bits) == AVX512Bits)
+			Features |= CPUAVX512;
+
+		return Features;
+	}
+
+#elif defined __aarch64__
+
+	static unsigned DetectFeatures(void)
+	{
+		// Advanced SIMD (NEON) is part of every 64-bit ARM processor.
+		unsigned Features = CPUNEON;
+
+		#if defined __linux__
+			// These are HWCAP_ASIMD and HWCAP_SVE.
+			const unsigned long HWCap = getauxval(AT_HWCAP);
+			if (!(HWCap >> 1 & 1))
+				Features &= ~CPUNEON;
+			if (HWCap >> 22 & 1)
+				Features |= CPUSVE;
+		#endif
+
+		return Features;
+	}
+
+#elif defined __APPLE__ && (defined __ppc__ || defined __ppc64__)
+
+	static unsigned DetectFeatures(void)
+	{
+		unsigned int HasAltiVec = 0;
+		size_t Size = sizeof HasAltiVec;
+		if (0 != sysctlbyname("hw.optional.altivec", &HasAltiVec, &Size,
+				NULL, 0))
+			return 0;
+		return HasAltiVec ? CPUAltiVec : 0;
+	}
+
+#else
+
+	static unsigned DetectFeatures(void)
+	{
+		return 0;
+	}
+
+#endif
+
+
+static void Detect(void)
+{
+	Detected = Allowed = DetectFeatures();
+
+	const char *Setting = getenv("VDSP_ISA");
+	if (Setting == NULL || Setting[0] == '\0')
+		return;
+
+	for (size_t i = 0; i < sizeof Ceilings / sizeof *Ceilings; ++i)
+		if (strcmp(Setting, Ceilings[i].Setting) == 0)
+		{
+			/*	AltiVec is not ordered with the others; keep it unless
+				all vectors are turned off.
+			*/
+			unsigned Ceiling = Ceilings[i].Allowed;
+			if (Ceiling != 0)
+				Ceiling |= CPUAltiVec;
+			Allowed &= Ceiling;
+			return;
+		}
+
+	fprintf(stderr, "Warning, VDSP_ISA=\"%s\" is not recognized and is "
+		"ignored.\n", Setting);
+}
+
+
+unsigned CPUFeatures(void)
+{
+	pthread_once(&DetectOnce, Detect);
+	return Allowed & __atomic_load_n(&Limit, __ATOMIC_ACQUIRE);
+}
+
+
+unsigned DetectedCPUFeatures(void)
+{
+	pthread_once(&DetectOnce, Detect);
+	return Detected;
+}
+
+
+unsigned LimitCPUFeatures(unsigned Features)
+{
+	return __atomic_exchange_n(&Limit, Features, __ATOMIC_ACQ_REL);
+}
+
+
+char *DescribeCPUFeatures(unsigned Features, char *Buffer, size_t Size)
+{
+	if (Size == 0)
+		return Buffer;
+	Buffer[0] = '\0';
+
+	size_t Used = 0;
+	for (size_t i = 0; i < sizeof FeatureNames / sizeof *FeatureNames; ++i)
+		if (Features & FeatureNames[i].Feature)
+		{
+			int n = snprintf(Buffer + Used, Size - Used, "%s%s",
+				Used ? " " : "", FeatureNames[i].Name);
+			if (n < 0 || Size - Used <= (size_t) n)
+				break;
+			Used += n;
+		}
+
+	if (Used == 0)
+		snprintf(Buffer, Size, "none");
+
+	return Buffer;
+}
+
+
+// The kernel choices noted so far.
+enum { MaximumNotes = 16 };
+static struct { const char *Routines, *Variant; } Notes[MaximumNotes];
+static unsigned NoteCount;
+static pthread_mutex_t NoteLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+void NoteKernelVariant(const char *Routines, const char *Variant)
+{
+	pthread_mutex_lock(&NoteLock);
+
+	unsigned i;
+	for (i = 0; i < NoteCount; ++i)
+		if (strcmp(Notes[i].Routines, Routines) == 0)
+			break;
+	if (i < MaximumNotes)
+	{
+		Notes[i].Routines = Routines;
+		Notes[i].Variant = Variant;
+		if (i == NoteCount)
+			++NoteCount;
+	}
+
+	pthread_mutex_unlock(&NoteLock);
+}
+
+
+void PrintKernelVariants(void)
+{
+	pthread_mutex_lock(&NoteLock);
+	for (unsigned i = 0; i < NoteCount; ++i)
+		printf("\t%s:  %s.\n", Notes[i].Routines, Notes[i].Variant);
+	if (NoteCount == 0)
+		printf("\tNone were noted.\n");
+	pthread_mutex_unlock(&NoteLock);
+}
@@ -0,0 +1,85 @@
+/*	File: CPUFeatures.h
+
+	Description:
+		Declarations for detecting the vector instruction sets of the
+		processor at run time, and for reporting which kernel variants
+		the portable routines chose.
+*/
+#ifndef __CPUFEATURES__
+#define __CPUFEATURES__
+
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	One binary may run on processors from several generations, so the
+	portable routines compile kernels for several instruction sets and
+	choose among them when first used, according to CPUFeatures.
+
+	A feature is reported only if both the processor and the operating
+	system support it; for example, AVX needs the system to save the
+	wider registers on a context switch.  AVX512 means the F, VL, BW, and
+	DQ subsets, which every processor with AVX-512 since Skylake-X has.
+*/
+enum
+{
+	CPUSSE2    = 1 << 0,
+	CPUAVX     = 1 << 1,
+	CPUAVX2    = 1 << 2,
+	CPUFMA     = 1 << 3,
+	CPUAVX512  = 1 << 4,
+	CPUNEON    = 1 << 5,
+	CPUSVE     = 1 << 6,
+	CPUAltiVec = 1 << 7
+};
+
+
+/*	Return the features kernels may use.  These are the features
+	detected, unless the environment variable VDSP_ISA names a lower
+	instruction set, in which case features above it are removed, so the
+	kernels for different instruction sets can be compared on one
+	machine.  VDSP_ISA may be "scalar", "sse2", "avx", "avx2" (which
+	includes FMA), "avx512", "neon", or "sve"; other values are
+	reported once on the standard error stream and ignored.
+*/
+unsigned CPUFeatures(void);
+
+// Return the features detected, ignoring VDSP_ISA.
+unsigned DetectedCPUFeatures(void);
+
+/*	Limit the features CPUFeatures returns to those in Features, as well
+	as by VDSP_ISA, so a program can time the kernels for two instruction
+	sets in one run, and return the previous limit.  Pass ~0u to remove
+	the limit.  The limit may be changed while other threads are running
+	the portable routines.  The portable FFT and vDSP_conv choose their
+	kernels again on their next call after the limit changes; the other
+	routines keep their first choice.
+*/
+unsigned LimitCPUFeatures(unsigned Features);
+
+/*	Write the names of Features, separated by spaces, to Buffer, which
+	has room for Size characters, and return Buffer.  With no features,
+	write "none".
+*/
+char *DescribeCPUFeatures(unsigned Features, char *Buffer, size_t Size);
+
+/*	Kernel choices are recorded so a program can report which variants
+	ran.  NoteKernelVariant records that Routines use Variant, replacing
+	any earlier note for the same Routines.  PrintKernelVariants prints
+	the notes, one per line, indented by a tab, or says there are none.
+*/
+void NoteKernelVariant(const char *Routines, const char *Variant);
+void PrintKernelVariants(void);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -0,0 +1,290 @@
+/*	File: Clock.c
+
+	Description:
+		Clock sources for timing the vDSP examples.
+
+		On Mac OS X, mach_absolute_time is used.  Elsewhere, the
+		candidates are the POSIX monotonic clock and, on Intel
+		processors, the time-stamp counter.  The monotonic clock is
+		always available, but reading it costs tens of nanoseconds, and
+		its resolution may be coarser than that, which matters when a
+		routine takes well under a microsecond.  The time-stamp counter
+		counts at a fixed rate and is read in a few nanoseconds, but it
+		is usable only when the processor reports an invariant counter
+		(one whose rate does not change with power states), and its rate
+		must be measured.
+
+		Each source's readings are converted to seconds by multiplying
+		by SecondsPerTick, and the average cost of reading it, measured
+		when it is initialized, is subtracted from each interval.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined __APPLE__
+	#include <mach/mach_time.h>	// Declare mach_absolute_time.
+#else
+	#include <time.h>
+	#if defined __i386__ || defined __x86_64__
+		#include <cpuid.h>
+		#include <x86intrin.h>
+		#define	HasTimeStampCounter	1
+	#endif
+#endif
+
+#include "Clock.h"
+
+
+// Identify the clock sources.
+typedef enum { SourceMach, SourceMonotonic, SourceTSC } ClockSource;
+
+static const char *SourceNames[] = { "mach", "monotonic", "tsc" };
+
+
+// Define static data for Clock routine.
+static ClockSource Source;
+static double SecondsPerTick;
+ClockData ClockLatency;	// Average latency of clock routine, in clock ticks.
+
+
+#if !defined __APPLE__
+
+
+/*	The POSIX clock to use:  CLOCK_MONOTONIC_RAW where it exists, since
+	it is not slewed by NTP adjustments, and CLOCK_MONOTONIC otherwise.
+*/
+static clockid_t MonotonicClock = CLOCK_MONOTONIC;
+
+
+// Return the monotonic clock's time in nanoseconds.
+static ClockData ReadMonotonic(void)
+{
+	struct timespec t;
+	clock_gettime(MonotonicClock, &t);
+	return (ClockData) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+
+#endif	// !defined __APPLE__
+
+
+#if defined HasTimeStampCounter
+
+
+// Whether the processor has the rdtscp instruction.
+static int HasRDTSCP;
+
+
+/*	Read the time-stamp counter, after all earlier instructions have
+	finished and before any later ones start, so the reading brackets
+	exactly the code between two calls.  rdtscp waits for earlier
+	instructions itself; rdtsc needs a fence before it.
+*/
+static ClockData ReadTSC(void)
+{
+	ClockData t;
+	if (HasRDTSCP)
+	{
+		unsigned int Processor;
+		t = __rdtscp(&Processor);
+	}
+	else
+	{
+		_mm_lfence();
+		t = __rdtsc();
+	}
+	_mm_lfence();
+	return t;
+}
+
+
+// Return whether the time-stamp counter runs at a constant rate.
+static int HasInvariantTSC(void)
+{
+	unsigned int a, b, c, d;
+
+	if (!__get_cpuid(0x80000001, &a, &b, &c, &d))
+		return 0;
+	HasRDTSCP = d >> 27 & 1;
+
+	if (!__get_cpuid(0x80000007, &a, &b, &c, &d))
+		return 0;
+	return d >> 8 & 1;
+}
+
+
+/*	Return the seconds per tick of the time-stamp counter, measured
+	against the monotonic clock over CalibrationTime seconds.  Each
+	monotonic reading is bracketed by counter readings, and the
+	midpoints are used, so the cost of reading the monotonic clock does
+	not bias the result.
+*/
+static double CalibrateTSC(void)
+{
+	static const double CalibrationTime = .05;
+
+	ClockData c0 = ReadTSC(), m0 = ReadMonotonic(), c1 = ReadTSC();
+	ClockData c2, m1, c3;
+	do
+	{
+		c2 = ReadTSC();
+		m1 = ReadMonotonic();
+		c3 = ReadTSC();
+	} while ((m1 - m0) * 1e-9 < CalibrationTime);
+
+	return (m1 - m0) * 1e-9 / ((c2 + c3) / 2. - (c0 + c1) / 2.);
+}
+
+
+#endif	// defined HasTimeStampCounter
+
+
+#if defined __APPLE__
+	static mach_timebase_info_data_t MachClockInfo;
+#endif
+
+
+// Return the current time.
+ClockData Clock(void)
+{
+	#if defined __APPLE__
+		return mach_absolute_time();
+	#else
+		#if defined HasTimeStampCounter
+			if (Source == SourceTSC)
+				return ReadTSC();
+		#endif
+		return ReadMonotonic();
+	#endif
+}
+
+
+/*	Subtract two clock measurements and convert difference to seconds,
+	excluding measurement time.
+*/
+double ClockToSeconds(ClockData t1, ClockData t0)
+{
+	return ((double) (t1 - t0) - ClockLatency) * SecondsPerTick;
+}
+
+
+const char *ClockName(void)
+{
+	return SourceNames[Source];
+}
+
+
+// Choose the clock source and prepare to convert its ticks to seconds.
+static void InitializeClockSource(void)
+{
+	#if defined __APPLE__
+
+		/*	Get ratio of mach_absolute_time ticks to nanoseconds.  (One
+			tick is numer/denom nanoseconds.)
+		*/
+		mach_timebase_info(&MachClockInfo);
+		Source = SourceMach;
+		SecondsPerTick = 1e-9 * MachClockInfo.numer / MachClockInfo.denom;
+
+	#else
+
+		#if defined CLOCK_MONOTONIC_RAW
+		{
+			struct timespec t;
+			if (clock_gettime(CLOCK_MONOTONIC_RAW, &t) == 0)
+				MonotonicClock = CLOCK_MONOTONIC_RAW;
+		}
+		#endif
+
+		Source = SourceMonotonic;
+		SecondsPerTick = 1e-9;
+
+		const char *Request = getenv("VDSP_CLOCK");
+		if (Request != NULL && strcmp(Request, "monotonic") != 0
+			&& strcmp(Request, "tsc") != 0)
+		{
+			fprintf(stderr,
+				"Error, VDSP_CLOCK must be \"tsc\" or \"monotonic\".\n");
+			exit(EXIT_FAILURE);
+		}
+
+		#if defined HasTimeStampCounter
+			/*	Use the time-stamp counter if it is invariant, unless
+				the monotonic clock is requested, or if it is requested.
+			*/
+			const int Invariant = HasInvariantTSC();
+			if (Request == NULL ? Invariant : strcmp(Request, "tsc") == 0)
+			{
+				Source = SourceTSC;
+				SecondsPerTick = CalibrateTSC();
+			}
+		#else
+			if (Request != NULL && strcmp(Request, "tsc") == 0)
+				fprintf(stderr, "Warning, there is no time-stamp counter; "
+					"using the monotonic clock.\n");
+		#endif
+
+	#endif
+}
+
+
+// Initialize static data for Clock routine.
+void InitializeClock(void)
+{
+	static const int Iterations = 1000000;
+
+	int i;
+
+	InitializeClockSource();
+
+	// Measure latency of Clock routine.
+	ClockData t0 = Clock(), t1 = t0;
+	for (i = 0; i < Iterations; ++i)
+		t1 = Clock();
+
+	// Record average latency (rounded down).
+	ClockLatency = (t1 - t0) / Iterations;
+}
+
+
+double EstimateProcessorFrequency(void)
+{
+	// Each trial executes 8 * Iterations additions.
+	static const int Iterations = 1 << 12, Trials = 4;
+
+	double Best = 0;
+	for (int Trial = 0; Trial < Trials; ++Trial)
+	{
+		/*	Hide y's value from the compiler, so it adds a register
+			rather than a constant, which some processors can combine
+			with the previous addition.
+		*/
+		uint64_t x = 0, y = 1;
+		__asm__ __volatile__("" : "+r" (y));
+
+		ClockData t0 = Clock();
+		for (int i = 0; i < Iterations; ++i)
+		{
+			/*	The empty assembly statements keep the compiler from
+				combining the additions, so each depends on the one
+				before it.
+			*/
+			#define	Add	x += y; __asm__ __volatile__("" : "+r" (x));
+			Add Add Add Add Add Add Add Add
+			#undef	Add
+		}
+		ClockData t1 = Clock();
+
+		/*	Keep the fastest trial, since an interruption can only make a
+			trial slower.
+		*/
+		double Frequency = 8. * Iterations / ClockToSeconds(t1, t0);
+		if (Best < Frequency)
+			Best = Frequency;
+	}
+
+	return Best;
+}
@@ -0,0 +1,66 @@
+/*	File: Clock.h
+
+	Description:
+		Declarations for the clock used to time the vDSP examples.
+*/
+#ifndef __CLOCK__
+#define __CLOCK__
+
+
+#include <stdint.h>		// Declare uint64_t.
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	The Clock routine reports the current time, but the format it uses
+	should not be manipulated by the user.  The routine ClockToSeconds
+	takes two times reported by Clock and returns their difference in
+	seconds.  (It also subtracts the average latency of the Clock routine
+	from the difference.)
+
+	InitializeClock must be called before the others.  It chooses the
+	clock source, at run time, from those the system offers:
+
+		mach		mach_absolute_time, on Mac OS X.
+
+		tsc		The processor's time-stamp counter, read with
+				rdtscp (or rdtsc after a fence), on Intel
+				processors whose counter runs at a constant rate
+				in all power states.  Its rate is calibrated
+				against the monotonic clock.  Reading it takes
+				a few nanoseconds, so it is the best choice for
+				timing short routines.
+
+		monotonic	clock_gettime with CLOCK_MONOTONIC_RAW, which is
+				not slewed by time adjustments, or with
+				CLOCK_MONOTONIC if that is unavailable.
+
+	Except on Mac OS X, the choice may be overridden by setting the
+	environment variable VDSP_CLOCK to "tsc" or "monotonic".
+*/
+typedef uint64_t ClockData;	// Define type for clock data.
+void InitializeClock(void);	// Choose and calibrate the clock.
+const char *ClockName(void);	// Return the name of the clock in use.
+ClockData Clock(void);		// Declare clock routine.
+double ClockToSeconds(ClockData t1, ClockData t0);
+				// Return number of seconds between two times.
+
+/*	Estimate the frequency the processor is running at now, in hertz, by
+	timing a chain of dependent integer additions, which take one cycle
+	each.  It takes about a tenth of a millisecond.  Processors that
+	lower their clock while running wide vector instructions keep the
+	lower clock for a while afterward, so calling this just after such
+	code shows the reduction.
+*/
+double EstimateProcessorFrequency(void);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
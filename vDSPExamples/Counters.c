@@ -0,0 +1,156 @@
+/*	File: Counters.c
+
+	Description:
+		Hardware performance counters, read with the Linux
+		perf_event_open interface.
+
+		Wall time alone does not show why a routine takes the time it
+		does.  Instructions per cycle near the processor's issue width
+		mean a routine is bound by computation; a low rate together with
+		many cache misses per element means it is waiting on memory; and
+		many branch misses point at unpredictable control flow.
+
+		Each event is opened as a separate counter, not as a group, so
+		that the kernel may multiplex events when the processor has too
+		few counters for all of them at once, and so that events the
+		processor lacks do not prevent counting the others.  The
+		counters count only user-mode events (which is all an
+		unprivileged process may count) and are inherited by threads
+		created after they are opened, so work done by a thread pool is
+		counted too.
+
+		On other systems, or when the kernel refuses, no events are
+		counted, and the callers report times only.
+*/
+
+
+#include <string.h>
+
+#if defined __linux__
+	#include <linux/perf_event.h>
+	#include <sys/ioctl.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+#include "Counters.h"
+
+
+#if defined __linux__
+
+
+// Describe the events, in the order of the CounterValues fields.
+static const struct { __u32 Type; __u64 Configuration; } Events[] =
+{
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+		| PERF_COUNT_HW_CACHE_OP_READ << 8
+		| PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+
+// File descriptors of the counters, or -1 for events not counted.
+static int Descriptors[NumberOfCounters] = { -1, -1, -1, -1, -1 };
+
+
+int OpenCounters(void)
+{
+	int Opened = 0;
+
+	for (int e = 0; e < NumberOfCounters; ++e)
+	{
+		struct perf_event_attr Attributes;
+		memset(&Attributes, 0, sizeof Attributes);
+		Attributes.size           = sizeof Attributes;
+		Attributes.type           = Events[e].Type;
+		Attributes.config         = Events[e].Configuration;
+		Attributes.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED
+		                          | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		Attributes.inherit        = 1;
+		Attributes.exclude_kernel = 1;
+		Attributes.exclude_hv     = 1;
+
+		// Count events of this process on any processor.
+		Descriptors[e] = syscall(SYS_perf_event_open, &Attributes, 0, -1,
+			-1, 0);
+		if (0 <= Descriptors[e])
+			++Opened;
+	}
+
+	return Opened;
+}
+
+
+void ReadCounters(CounterReading *Reading)
+{
+	for (int e = 0; e < NumberOfCounters; ++e)
+	{
+		__u64 Data[3] = { 0, 0, 0 };
+		if (0 <= Descriptors[e])
+			if (read(Descriptors[e], Data, sizeof Data) != sizeof Data)
+				Data[0] = Data[1] = Data[2] = 0;
+		Reading->Count[e]   = Data[0];
+		Reading->Enabled[e] = Data[1];
+		Reading->Running[e] = Data[2];
+	}
+}
+
+
+void CloseCounters(void)
+{
+	for (int e = 0; e < NumberOfCounters; ++e)
+		if (0 <= Descriptors[e])
+		{
+			close(Descriptors[e]);
+			Descriptors[e] = -1;
+		}
+}
+
+
+#else	// defined __linux__
+
+
+// Without perf_event_open, there are no counters.
+int OpenCounters(void)
+{
+	return 0;
+}
+
+
+void ReadCounters(CounterReading *Reading)
+{
+	memset(Reading, 0, sizeof *Reading);
+}
+
+
+void CloseCounters(void)
+{
+}
+
+
+#endif	// defined __linux__
+
+
+CounterValues SubtractCounters(const CounterReading *t1,
+	const CounterReading *t0)
+{
+	double Counts[NumberOfCounters];
+
+	for (int e = 0; e < NumberOfCounters; ++e)
+	{
+		const unsigned long long
+			Count   = t1->Count[e]   - t0->Count[e],
+			Enabled = t1->Enabled[e] - t0->Enabled[e],
+			Running = t1->Running[e] - t0->Running[e];
+
+		// An event never counted in the interval has no count.
+		Counts[e] = Running == 0 ? -1 : (double) Count * Enabled / Running;
+	}
+
+	CounterValues Values =
+		{ Counts[0], Counts[1], Counts[2], Counts[3], Counts[4] };
+	return Values;
+}
@@ -0,0 +1,70 @@
+/*	File: Counters.h
+
+	Description:
+		Declarations for reading the processor's hardware performance
+		counters around timed code.
+*/
+#ifndef __COUNTERS__
+#define __COUNTERS__
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	Counts of events.  A count is negative if the event could not be
+	counted.
+*/
+typedef struct
+{
+	double Cycles, Instructions;
+	double L1Misses;	// Level-one data cache read misses.
+	double LLCMisses;	// Last-level cache misses.
+	double BranchMisses;	// Mispredicted branches.
+} CounterValues;
+
+
+/*	Start counting events in this thread and in threads it creates
+	afterward, and return the number of events that can be counted.
+	This is zero if the system provides no counters (as on systems other
+	than Linux, or when the kernel does not permit counting or the
+	processor's counters are not available, as in many virtual
+	machines).  It should be called before creating any threads whose
+	work is to be counted.
+*/
+int OpenCounters(void);
+
+// Number of events counted.
+enum { NumberOfCounters = 5 };
+
+/*	A reading of the counters:  each event's count, and the times for
+	which the system has been asked to count it and has counted it.
+*/
+typedef struct
+{
+	unsigned long long Count[NumberOfCounters],
+		Enabled[NumberOfCounters], Running[NumberOfCounters];
+} CounterReading;
+
+// Read the counters.
+void ReadCounters(CounterReading *Reading);
+
+/*	Return the events counted between readings t0 and t1.  A count is
+	scaled up if the system counted the event only part of the time, as
+	it does when more events are requested than the processor has
+	counters for.
+*/
+CounterValues SubtractCounters(const CounterReading *t1,
+	const CounterReading *t0);
+
+// Stop counting.
+void CloseCounters(void);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
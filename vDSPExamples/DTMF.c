@@ -17,6 +17,31 @@
 	than .08 seconds sampled at 3266 Hz (twice the highest DTMF tone), yet
 	the program finds the correct key almost all the time.
 
+	An FFT computes every frequency, but DTMF detection needs only eight.
+	Started with the -goertzel option, the program instead uses a bank of
+	Goertzel filters, which compute just those eight frequencies, sample
+	by sample.  With the -fused option, it uses RealPowerSpectrum, which
+	computes the powers of just those eight frequencies in the same call
+	as the FFT, rather than calling vDSP_ctoz, vDSP_fft_zrip, and a loop
+	over the results in turn.  Whichever method is chosen, the program
+	finishes by measuring the time it takes per frame and how many
+	channels one processor core could decode in real time with it.  (For
+	the plain FFT, it measures the fused routine as well, to compare.)
+
+	The program can also decode continuous streams.  With
+	"-generate Channels Seconds File", it writes a test stream of 16-bit
+	PCM at 8 kHz, with each channel dialing random keys separated by
+	silence, and prints the keys dialed on each channel.  With
+	"-stream Channels [File]", it decodes such a stream from the file
+	(or standard input) and prints the keys found on each channel, in
+	the same form, so the two outputs can be compared.
+
+	The tones are generated by a bank of oscillators rather than by
+	calling sin for each sample.  With "-oscillators", the program
+	compares the speed and accuracy of the two.  Noise comes from a
+	counter-based generator, Philox, which fills buffers several numbers
+	at a time; "-noise" compares its speed with a conventional generator.
+
 	Copyright (C) 2007 Apple Inc.  All rights reserved.
 */
 
@@ -32,8 +57,19 @@
 #include <string.h>
 #include <time.h>
 
-// Including the Accelerate headers is of course needed to use vDSP.
-#include <Accelerate/Accelerate.h>
+/*	Including the Accelerate headers is of course needed to use vDSP.
+	PortableDSP.h includes them on Mac OS X and declares the portable
+	vDSP subset elsewhere.
+*/
+#include "PortableDSP.h"
+
+#include "Arena.h"
+#include "DTMFStream.h"
+#include "FFTSetupRegistry.h"
+#include "Goertzel.h"
+#include "Oscillator.h"
+#include "Philox.h"
+#include "PowerSpectrum.h"
 
 
 // Calculate the number of elements in an array.
@@ -52,8 +88,15 @@ static const double_t TwoPi = 0x3.243f6a8885a308d313198a2e03707344ap1;
 #define	SamplingFrequency	3266	// Hz at which signal is sampled.
 
 
-// Define the state for the pseudo-random number generator.
-static uint32_t Seed;
+/*	Pseudo-random numbers come from the counter-based generator in
+	Philox.c.  Stream 0 of the seed supplies Random(), and other streams
+	supply noise in bulk.
+*/
+static uint64_t Seed;
+static PhiloxStream Generator;
+
+// Streams of the seed used for noise.
+enum { SignalNoiseStream = 1, StreamNoiseStream = 2 };
 
 
 // Initialize the pseudo-random number generator.
@@ -65,22 +108,16 @@ void InitializeRandom(void)
 		high-quality pseudo-random numbers are needed.
 	*/
 	Seed = time(NULL);
+	InitializePhilox(&Generator, Seed, 0);
 }
 
 
 // Return a pseudo-random number in [0, 1).
 float Random(void)
 {
-	/*	Use a very fast but low quality pseudo-random number generator,
-		An Even Quicker Generator from William H. Preuss, Saul A.
-		Teukolsky, William T. Vetterling, and Brian P. Flannery,
-		_Numerical Recipes in C: The Art of Scientific Computer_ second
-		edition (Cambridge University Press: 1992), pages 284-285.
-	*/
-	Seed = 1664525 * Seed + 1013904223;
-
-	// Convert the high 24 bits to a float in [0, 1).
-	return (Seed >> 8) * (1.f/16777216);
+	float x;
+	FillPhilox(&Generator, &x, 1);
+	return x;
 }
 
 
@@ -115,6 +152,25 @@ FrequencyPair ConvertKeyToFrequencies(const char Key)
 }
 
 
+// Return the index of the DFT bin nearest a frequency.
+int FindBin(float Frequency)
+{
+	return Frequency / SamplingFrequency * SampleLength + .5;
+}
+
+
+/*	Set Bins to the DFT bins of DTMF0 followed by DTMF1.  main does this
+	once, before any detection starts, so the detectors only read them.
+*/
+void InitializeBins(vDSP_Length Bins[GoertzelTones])
+{
+	for (size_t i = 0; i < NumberOf(DTMF0); ++i)
+		Bins[i] = FindBin(DTMF0[i]);
+	for (size_t i = 0; i < NumberOf(DTMF1); ++i)
+		Bins[NumberOf(DTMF0) + i] = FindBin(DTMF1[i]);
+}
+
+
 /*	Find a frequency in DFT results.
 
 	Buffer is the output of a real-to-complex DFT.
@@ -139,8 +195,7 @@ int FindTone(const DSPSplitComplex Buffer, const float Frequencies[], int N)
 		/*	Find the index into the DFT results corresponding to
 			the frequency.
 		*/
-		int index = Frequencies[i] / SamplingFrequency
-			* SampleLength + .5;
+		int index = FindBin(Frequencies[i]);
 
 		// Get the real and imaginary parts.
 		float re = Buffer.realp[index];
@@ -162,71 +217,837 @@ int FindTone(const DSPSplitComplex Buffer, const float Frequencies[], int N)
 }
 
 
-/*	Demonstrate using an FFT to detect telephone keys.
+// Declare the methods of detecting tones.
+typedef enum { MethodFFT, MethodFusedFFT, MethodGoertzel } Method;
+
+
+/*	Fill Signal with noise and the two tones of F.
+
+	The tones are made by a bank of two oscillators rather than by
+	calling sin for each sample, and the noise is generated a buffer at
+	a time.  The bank is created on the first call and kept, so
+	generating a signal allocates nothing.
+*/
+void GenerateSignal(float *Signal, FrequencyPair F)
+{
+	static OscillatorBank *Bank;
+	static PhiloxStream Noise;
+	if (Bank == 0)
+	{
+		Bank = CreateOscillatorBank(2);
+		InitializePhilox(&Noise, Seed, SignalNoiseStream);
+	}
+
+	// Initialize the signal with noise.
+	FillPhilox(&Noise, Signal, SampleLength);
+	for (int i = 0; i < SampleLength; ++i)
+		Signal[i] *= 4;
+
+	/*	Add the two tones to the signal, each starting at a pseudo-random
+		time.
+	*/
+	for (int i = 0; i < 2; ++i)
+		SetOscillator(Bank, i, F.Frequency[i] / SamplingFrequency, Random(),
+			1);
+	RunOscillators(Bank, Signal, 1, SampleLength);
+}
+
+
+/*	Detect the tones in Signal with an FFT, setting *Tone0 and *Tone1 to
+	their indices in DTMF0 and DTMF1.
 
-	Setup is the result of creating an FFT setup.
+	Buffer must have room for SampleLength elements.
+*/
+void DetectWithFFT(FFTSetup Setup, const float *Signal,
+	DSPSplitComplex Buffer, int *Tone0, int *Tone1)
+{
+	// Copy (and rearrange) the data to the buffer.
+	vDSP_ctoz((const DSPComplex *) Signal, 2, &Buffer, 1, SampleLength / 2);
+
+	// Compute the DFT of the signal.
+	vDSP_fft_zrip(Setup, &Buffer, 1, Log2SampleLength, FFT_FORWARD);
+
+	// Use the DFT results to identify the tones in the signal.
+	*Tone0 = FindTone(Buffer, DTMF0, NumberOf(DTMF0));
+	*Tone1 = FindTone(Buffer, DTMF1, NumberOf(DTMF1));
+}
+
+
+/*	Find the strongest of N tones in Power, the output of GoertzelPower
+	or RealPowerSpectrum, and return its index.
+*/
+int FindStrongest(const float Power[], int N)
+{
+	int MaximumIndex = 0;
+	for (int i = 1; i < N; ++i)
+		if (Power[MaximumIndex] < Power[i])
+			MaximumIndex = i;
+	return MaximumIndex;
+}
+
+
+/*	Detect the tones in Signal as DetectWithFFT does, but with
+	RealPowerSpectrum, which computes the powers of just the eight DTMF
+	bins in the same call as the FFT, instead of with vDSP_ctoz,
+	vDSP_fft_zrip, and FindTone in turn.  The powers are the same, so
+	the tones found are too.
+
+	Bins must contain the bins of DTMF0 followed by DTMF1, as
+	InitializeBins sets them.
+*/
+void DetectWithFusedFFT(FFTSetup Setup, const vDSP_Length Bins[],
+	const float *Signal, DSPSplitComplex Buffer, int *Tone0, int *Tone1)
+{
+	float Power[GoertzelTones];
+	RealPowerSpectrum(Setup, Signal, &Buffer, Log2SampleLength,
+		Bins, Power, GoertzelTones);
+
+	*Tone0 = FindStrongest(Power, NumberOf(DTMF0));
+	*Tone1 = FindStrongest(Power + NumberOf(DTMF0), NumberOf(DTMF1));
+}
+
+
+/*	Detect the tones in Signal with Goertzel filters, setting *Tone0 and
+	*Tone1 as DetectWithFFT does.
+
+	Bank must be initialized with DTMF0 followed by DTMF1.
+*/
+void DetectWithGoertzel(const GoertzelBank *Bank, const float *Signal,
+	int *Tone0, int *Tone1)
+{
+	GoertzelState State;
+	float Power[GoertzelTones];
+
+	ResetGoertzelStates(&State, 1);
+	UpdateGoertzelStates(Bank, &State, Signal, 0, 1, SampleLength);
+	GoertzelPower(Bank, &State, 1, Power);
+
+	*Tone0 = FindStrongest(Power, NumberOf(DTMF0));
+	*Tone1 = FindStrongest(Power + NumberOf(DTMF0), NumberOf(DTMF1));
+}
+
+
+/*	Get the work buffer for one frame from Work, resetting the arena
+	first.  Resetting takes constant time and reuses the arena's memory,
+	so a loop over frames allocates nothing.
+*/
+DSPSplitComplex GetFrameBuffer(Arena *Work)
+{
+	ResetArena(Work);
+	return ArenaAllocateSplit(Work, SampleLength / 2);
+}
+
+
+/*	Demonstrate detecting telephone keys.
+
+	Setup is the result of creating an FFT setup, and Bank is a Goertzel
+	bank for the DTMF frequencies.  Bins are their DFT bins, from
+	InitializeBins.  M selects the method to use.  Work is an arena for
+	the frame's buffers.
 
 	F contains a pair of frequencies to inject into a signal.
 */
-void Demonstrate(FFTSetup Setup, FrequencyPair F)
+void Demonstrate(FFTSetup Setup, const GoertzelBank *Bank,
+	const vDSP_Length Bins[], Method M, Arena *Work, FrequencyPair F)
+{
+	// Get the buffer for the FFT, and the signal, from the arena.
+	DSPSplitComplex Buffer = GetFrameBuffer(Work);
+	float *Signal = ArenaAllocate(Work, SampleLength * sizeof *Signal);
+
+	printf("\tGenerating signal with noise and DTMF tones...\n");
+
+	GenerateSignal(Signal, F);
+
+	printf("\tAnalyzing signal...\n");
+
+	int Tone0, Tone1;
+	if (M == MethodFFT)
+		DetectWithFFT(Setup, Signal, Buffer, &Tone0, &Tone1);
+	else if (M == MethodFusedFFT)
+		DetectWithFusedFFT(Setup, Bins, Signal, Buffer, &Tone0, &Tone1);
+	else
+		DetectWithGoertzel(Bank, Signal, &Tone0, &Tone1);
+
+	printf("\tFound frequencies %g and %g for key %c.\n",
+		DTMF0[Tone0], DTMF1[Tone1], Keys[Tone1*4 + Tone0]);
+}
+
+
+/*	Measure the time method M takes to decode a frame, and from that,
+	how many channels one processor core could decode as fast as their
+	samples arrive.
+
+	Two times are reported.  The latency is the time to decode one frame
+	of one channel by itself.  The throughput time is the time per frame
+	when a frame of each of many channels is decoded together, which
+	lets the Goertzel bank work on several channels at once.
+
+	The FFT methods get their buffer for each frame from Work, as a
+	frame loop in an application might, so the times include resetting
+	the arena.
+*/
+void Measure(FFTSetup Setup, const GoertzelBank *Bank,
+	const vDSP_Length Bins[], Method M, Arena *Work)
 {
-	float *Signal = malloc(SampleLength * sizeof *Signal);
-	if (Signal == 0)
+	// Number of channels decoded together.
+	enum { Channels = 1024 };
+
+	// Run each timing loop for at least this many seconds.
+	static const double MinimumTime = .25;
+
+	float *Signals = malloc(Channels * SampleLength * sizeof *Signals);
+	GoertzelState *States = malloc(Channels * sizeof *States);
+	float *Power = malloc(Channels * GoertzelTones * sizeof *Power);
+	int *Expected = malloc(Channels * sizeof *Expected);
+	if (Signals == 0 || States == 0 || Power == 0 || Expected == 0)
 	{
 		fprintf(stderr, "Error, unable to allocate memory.\n");
 		exit(EXIT_FAILURE);
 	}
 
-	printf("\tGenerating signal with noise and DTMF tones...\n");
+	// Give each channel a random key.
+	for (int c = 0; c < Channels; ++c)
+	{
+		Expected[c] = Random() * 16;
+		GenerateSignal(Signals + c*SampleLength,
+			ConvertKeyToFrequencies(Keys[Expected[c]]));
+	}
 
-	// Initialize the signal with noise.
-	for (int i = 0; i < SampleLength; ++i)
-		Signal[i] = 4 * Random();
+	int Tone0, Tone1, Correct = 0;
+	long Repetitions, r;
+	clock_t t0, t1;
 
-	// Add one of the tones to the signal.
-	float Phase = Random();	// Start the tone at a pseudo-random time.
-	for (int i = 0; i < SampleLength; ++i)
-		Signal[i] += sin((i*F.Frequency[0] / SamplingFrequency + Phase)
-			* TwoPi);
+	// Time single frames.
+	Repetitions = 0;
+	t0 = clock();
+	do
+	{
+		for (r = 0; r < 1000; ++r)
+			if (M == MethodFFT)
+				DetectWithFFT(Setup, Signals, GetFrameBuffer(Work),
+					&Tone0, &Tone1);
+			else if (M == MethodFusedFFT)
+				DetectWithFusedFFT(Setup, Bins, Signals,
+					GetFrameBuffer(Work), &Tone0, &Tone1);
+			else
+				DetectWithGoertzel(Bank, Signals, &Tone0, &Tone1);
+		Repetitions += r;
+		t1 = clock();
+	} while (t1 - t0 < MinimumTime * CLOCKS_PER_SEC);
+	const double Latency =
+		(double) (t1 - t0) / CLOCKS_PER_SEC / Repetitions;
+
+	// Time frames of all the channels.
+	Repetitions = 0;
+	t0 = clock();
+	do
+	{
+		Correct = 0;
+		if (M == MethodFFT)
+			for (int c = 0; c < Channels; ++c)
+			{
+				DetectWithFFT(Setup, Signals + c*SampleLength,
+					GetFrameBuffer(Work), &Tone0, &Tone1);
+				Correct += Keys[Tone1*4 + Tone0] == Keys[Expected[c]];
+			}
+		else if (M == MethodFusedFFT)
+			for (int c = 0; c < Channels; ++c)
+			{
+				DetectWithFusedFFT(Setup, Bins, Signals + c*SampleLength,
+					GetFrameBuffer(Work), &Tone0, &Tone1);
+				Correct += Keys[Tone1*4 + Tone0] == Keys[Expected[c]];
+			}
+		else
+		{
+			ResetGoertzelStates(States, Channels);
+			UpdateGoertzelStates(Bank, States, Signals, SampleLength,
+				Channels, SampleLength);
+			GoertzelPower(Bank, States, Channels, Power);
+			for (int c = 0; c < Channels; ++c)
+			{
+				const float *p = Power + c*GoertzelTones;
+				Tone0 = FindStrongest(p, NumberOf(DTMF0));
+				Tone1 = FindStrongest(p + NumberOf(DTMF0),
+					NumberOf(DTMF1));
+				Correct += Keys[Tone1*4 + Tone0] == Keys[Expected[c]];
+			}
+		}
+		++Repetitions;
+		t1 = clock();
+	} while (t1 - t0 < MinimumTime * CLOCKS_PER_SEC);
+	const double Throughput =
+		(double) (t1 - t0) / CLOCKS_PER_SEC / Repetitions / Channels;
+
+	// Each channel delivers this many frames per second.
+	const double FrameRate = (double) SamplingFrequency / SampleLength;
+
+	static const char *Names[] = { "FFT", "Fused FFT", "Goertzel" };
+	printf("\n%s method:\n", Names[M]);
+	printf("\tDecoded %d of %d random keys correctly.\n",
+		Correct, Channels);
+	printf("\tLatency is %g microseconds per frame.\n", Latency * 1e6);
+	printf("\tWith %d channels, time is %g microseconds per frame,\n"
+		"\tso one core can decode %.0f channels in real time.\n",
+		Channels, Throughput * 1e6, 1 / (Throughput * FrameRate));
+
+	free(Expected);
+	free(Power);
+	free(States);
+	free(Signals);
+}
 
-	// Add the other tone.
-	Phase = Random();	// Start the tone at a pseudo-random time.
-	for (int i = 0; i < SampleLength; ++i)
-		Signal[i] += sin((i*F.Frequency[1]/SamplingFrequency + Phase)
-			* TwoPi);
 
-	// Rearrange the signal for vDSP_fft_zrip, using an auxiliary buffer.
+/*	Streams are 16-bit PCM sampled at StreamSamplingFrequency Hz, with
+	the samples of all channels interleaved.
+*/
+#define	StreamSamplingFrequency	8000
+
+
+// Hold the keys found on each channel of a stream.
+typedef struct
+{
+	char **Keys;		// A string of keys for each channel.
+	size_t *Lengths;	// Length of each string.
+	size_t *Sizes;		// Space allocated for each string.
+} KeyLog;
 
-	// Get enough memory for two halves.
-	float *BufferMemory = malloc(SampleLength * sizeof *BufferMemory);
-	if (BufferMemory == 0)
+
+// Create a log of keys for Channels channels.
+void InitializeKeyLog(KeyLog *Log, vDSP_Length Channels)
+{
+	Log->Keys    = malloc(Channels * sizeof *Log->Keys);
+	Log->Lengths = calloc(Channels, sizeof *Log->Lengths);
+	Log->Sizes   = malloc(Channels * sizeof *Log->Sizes);
+	if (Log->Keys == 0 || Log->Lengths == 0 || Log->Sizes == 0)
 	{
 		fprintf(stderr, "Error, unable to allocate memory.\n");
 		exit(EXIT_FAILURE);
 	}
 
-	// Assign half the memory to reals and half to imaginaries.
-	DSPSplitComplex Buffer
-		= { BufferMemory, BufferMemory + SampleLength/2 };
+	for (vDSP_Length c = 0; c < Channels; ++c)
+	{
+		Log->Sizes[c] = 16;
+		Log->Keys[c] = malloc(Log->Sizes[c]);
+		if (Log->Keys[c] == 0)
+		{
+			fprintf(stderr, "Error, unable to allocate memory.\n");
+			exit(EXIT_FAILURE);
+		}
+		Log->Keys[c][0] = '\0';
+	}
+}
 
-	// Copy (and rearrange) the data to the buffer.
-	vDSP_ctoz((DSPComplex *) Signal, 2, &Buffer, 1, SampleLength / 2);
 
-	printf("\tAnalyzing signal...\n");
+// Append a key to a channel's log.  This is also a DTMFKeyHandler.
+void LogKey(void *Context, vDSP_Length Channel, char Key, uint64_t Sample)
+{
+	KeyLog *Log = Context;
+	(void) Sample;
 
-	// Compute the DFT of the signal.
-	vDSP_fft_zrip(Setup, &Buffer, 1, Log2SampleLength, FFT_FORWARD);
+	if (Log->Sizes[Channel] <= Log->Lengths[Channel] + 1)
+	{
+		Log->Sizes[Channel] *= 2;
+		Log->Keys[Channel] = realloc(Log->Keys[Channel], Log->Sizes[Channel]);
+		if (Log->Keys[Channel] == 0)
+		{
+			fprintf(stderr, "Error, unable to allocate memory.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
 
-	// Use the DFT results to identify the tones in the signal.
-	int Tone0 = FindTone(Buffer, DTMF0, NumberOf(DTMF0));
-	int Tone1 = FindTone(Buffer, DTMF1, NumberOf(DTMF1));
+	Log->Keys[Channel][Log->Lengths[Channel]++] = Key;
+	Log->Keys[Channel][Log->Lengths[Channel]] = '\0';
+}
 
-	printf("\tFound frequencies %g and %g for key %c.\n",
-		DTMF0[Tone0], DTMF1[Tone1], Keys[Tone1*4 + Tone0]);
 
-	// Release resources.
-	free(BufferMemory);
-	free(Signal);
+// Print the keys of each channel and release the log.
+void PrintKeyLog(KeyLog *Log, vDSP_Length Channels)
+{
+	for (vDSP_Length c = 0; c < Channels; ++c)
+	{
+		printf("Channel %lu: %s\n", (unsigned long) c, Log->Keys[c]);
+		free(Log->Keys[c]);
+	}
+	free(Log->Keys);
+	free(Log->Lengths);
+	free(Log->Sizes);
+}
+
+
+/*	Write a test stream of Seconds seconds for Channels channels to the
+	file named Name, and print the keys dialed on each channel.
+
+	Each channel alternates between silence (80 to 250 ms) and a random
+	key (60 to 150 ms), with a little noise throughout.  Every channel
+	ends with enough silence that its last key is complete.
+
+	The tones are made by a bank of oscillators, two for each channel,
+	which generates a block of samples for all the channels at once.
+	Segments are whole numbers of blocks, so a channel changes what it
+	is doing only at the start of a block.
+*/
+void GenerateStream(vDSP_Length Channels, double Seconds, const char *Name)
+{
+	// Generate this many sample times at once.
+	enum { Block = 64 };
+
+	const double Rate = StreamSamplingFrequency;
+	const uint64_t Total = Seconds * Rate;
+
+	// Describe what each channel is doing.
+	typedef struct
+	{
+		uint64_t Remaining;	// Blocks left in the current segment.
+		int Key;		// Key being sent, or -1 for silence.
+	} Channel;
+
+	FILE *File = fopen(Name, "wb");
+	Channel *State = malloc(Channels * sizeof *State);
+	float *Mix = malloc(Block * Channels * sizeof *Mix);
+	int16_t *Samples = malloc(Block * Channels * sizeof *Samples);
+	if (File == 0)
+	{
+		fprintf(stderr, "Error, unable to open %s.\n", Name);
+		exit(EXIT_FAILURE);
+	}
+	if (State == 0 || Mix == 0 || Samples == 0)
+	{
+		fprintf(stderr, "Error, unable to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/*	Oscillators c and c+Channels make the two tones of channel c,
+		and both add to channel c in the interleaved Mix.
+	*/
+	OscillatorBank *Bank = CreateOscillatorBank(2 * Channels);
+
+	PhiloxStream Noise;
+	InitializePhilox(&Noise, Seed, StreamNoiseStream);
+
+	KeyLog Log;
+	InitializeKeyLog(&Log, Channels);
+
+	for (vDSP_Length c = 0; c < Channels; ++c)
+	{
+		State[c].Remaining = 0;
+		State[c].Key = 0;	// So the first segment is silence.
+	}
+
+	for (uint64_t t0 = 0; t0 < Total; t0 += Block)
+	{
+		const vDSP_Length n = Total - t0 < Block ? Total - t0 : Block;
+
+		// Start a new segment on each channel whose segment has ended.
+		for (vDSP_Length c = 0; c < Channels; ++c)
+		{
+			Channel *S = &State[c];
+			if (S->Remaining == 0)
+			{
+				const uint64_t Tone
+					= ((.06 + .09 * Random()) * Rate + Block - 1) / Block;
+				const uint64_t Quiet
+					= ((.08 + .17 * Random()) * Rate + Block - 1) / Block;
+				if (S->Key < 0 && t0 + Tone*Block + .25 * Rate < Total)
+				{
+					S->Key = Random() * 16;
+					S->Remaining = Tone;
+					LogKey(&Log, c, Keys[S->Key], t0);
+
+					FrequencyPair F = ConvertKeyToFrequencies(Keys[S->Key]);
+					SetOscillator(Bank, c, F.Frequency[0] / Rate, 0, .25f);
+					SetOscillator(Bank, c + Channels, F.Frequency[1] / Rate,
+						0, .25f);
+				}
+				else
+				{
+					S->Key = -1;
+					S->Remaining = Quiet;
+					SetOscillator(Bank, c, 0, 0, 0);
+					SetOscillator(Bank, c + Channels, 0, 0, 0);
+				}
+			}
+			--S->Remaining;
+		}
+
+		/*	Start with noise, and add the tones.  Noise sample i of the
+			stream is number i of its generator stream, so any part of
+			the noise could be generated separately.
+		*/
+		FillPhilox(&Noise, Mix, n * Channels);
+		for (vDSP_Length i = 0; i < n * Channels; ++i)
+			Mix[i] = .02f * (2 * Mix[i] - 1);
+		RunOscillators(Bank, Mix, Channels, n);
+
+		for (vDSP_Length i = 0; i < n * Channels; ++i)
+			Samples[i] = Mix[i] * 32767;
+
+		if (fwrite(Samples, Channels * sizeof *Samples, n, File) != n)
+		{
+			fprintf(stderr, "Error, unable to write %s.\n", Name);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	fclose(File);
+	DestroyOscillatorBank(Bank);
+	free(Samples);
+	free(Mix);
+	free(State);
+
+	PrintKeyLog(&Log, Channels);
+}
+
+
+/*	Decode a stream for Channels channels from the file named Name (or
+	from standard input if Name is null), print the keys found on each
+	channel, and report the processor time taken.
+
+	Setup must support FFTs of SampleLength elements.
+*/
+void DecodeStream(FFTSetup Setup, vDSP_Length Channels, const char *Name)
+{
+	// Read this many sample times at once.
+	enum { Block = 1024 };
+
+	FILE *File = Name ? fopen(Name, "rb") : stdin;
+	if (File == 0)
+	{
+		fprintf(stderr, "Error, unable to open %s.\n", Name);
+		exit(EXIT_FAILURE);
+	}
+
+	int16_t *Samples = malloc(Block * Channels * sizeof *Samples);
+	if (Samples == 0)
+	{
+		fprintf(stderr, "Error, unable to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	DTMFDecoder *Decoder = CreateDTMFDecoder(Setup, Log2SampleLength,
+		Channels, StreamSamplingFrequency);
+
+	KeyLog Log;
+	InitializeKeyLog(&Log, Channels);
+
+	uint64_t Total = 0;
+	clock_t Time = 0;
+
+	size_t n;
+	while (0 < (n = fread(Samples, Channels * sizeof *Samples, Block, File)))
+	{
+		clock_t t0 = clock();
+		DecodeDTMF(Decoder, Samples, n, LogKey, &Log);
+		Time += clock() - t0;
+		Total += n;
+	}
+
+	if (ferror(File))
+	{
+		fprintf(stderr, "Error, unable to read %s.\n",
+			Name ? Name : "standard input");
+		exit(EXIT_FAILURE);
+	}
+	if (Name)
+		fclose(File);
+
+	DestroyDTMFDecoder(Decoder);
+	free(Samples);
+
+	PrintKeyLog(&Log, Channels);
+
+	// Report the speed on standard error, to keep standard output clean.
+	const double Seconds = (double) Total / StreamSamplingFrequency;
+	const double ProcessorSeconds = (double) Time / CLOCKS_PER_SEC;
+	fprintf(stderr, "Decoded %g seconds of %lu channels in %g seconds of "
+		"processor time, %.1f times real time.\n",
+		Seconds, (unsigned long) Channels, ProcessorSeconds,
+		Seconds / ProcessorSeconds);
+}
+
+
+/*	Compare ways of generating the tone pairs of many channels:  calling
+	sin for each sample of each tone, running a bank of oscillators, and
+	evaluating PolynomialSine on the phases.  Print the samples generated
+	per second by each and their errors.
+*/
+void MeasureOscillators(void)
+{
+	// Generate this many sample times of this many channels at once.
+	enum { Channels = 1024, Length = 1024 };
+
+	// Run each timing loop for at least this many seconds.
+	static const double MinimumTime = .25;
+
+	const double Rate = StreamSamplingFrequency;
+
+	// Frequencies (cycles per sample) and starting phases of the tones.
+	double *Frequency = malloc(2 * Channels * sizeof *Frequency);
+	double *Start = malloc(2 * Channels * sizeof *Start);
+	double *Phase = malloc(2 * Channels * sizeof *Phase);
+	float *PhaseRow = malloc(2 * Channels * sizeof *PhaseRow);
+	float *SineRow = malloc(2 * Channels * sizeof *SineRow);
+	float *Mix = malloc(Length * Channels * sizeof *Mix);
+	if (Frequency == 0 || Start == 0 || Phase == 0 || PhaseRow == 0
+		|| SineRow == 0 || Mix == 0)
+	{
+		fprintf(stderr, "Error, unable to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	// Give each channel a random key, and each tone a random phase.
+	for (vDSP_Length c = 0; c < Channels; ++c)
+	{
+		FrequencyPair F = ConvertKeyToFrequencies(Keys[(int) (Random() * 16)]);
+		for (int i = 0; i < 2; ++i)
+		{
+			Frequency[c + i*Channels] = F.Frequency[i] / Rate;
+			Start[c + i*Channels] = Random();
+		}
+	}
+
+	OscillatorBank *Bank = CreateOscillatorBank(2 * Channels);
+
+	long Repetitions;
+	clock_t t0, t1;
+	double Error;
+
+	/*	Call sin for each sample, as GenerateSignal once did, computing
+		each phase from the sample index.
+	*/
+	Repetitions = 0;
+	t0 = clock();
+	do
+	{
+		for (vDSP_Length t = 0; t < Length; ++t)
+			for (vDSP_Length c = 0; c < Channels; ++c)
+				Mix[t*Channels + c] =
+					.5f * sin((t*Frequency[c] + Start[c]) * TwoPi)
+				  + .5f * sin((t*Frequency[c + Channels] + Start[c + Channels])
+						* TwoPi);
+		++Repetitions;
+		t1 = clock();
+	} while (t1 - t0 < MinimumTime * CLOCKS_PER_SEC);
+	const double LibmRate =
+		(double) Repetitions * Length * Channels * CLOCKS_PER_SEC / (t1 - t0);
+
+	// Run the oscillators, restarting them for each repetition.
+	Repetitions = 0;
+	t0 = clock();
+	do
+	{
+		for (vDSP_Length i = 0; i < 2 * Channels; ++i)
+			SetOscillator(Bank, i, Frequency[i], Start[i], .5f);
+		memset(Mix, 0, Length * Channels * sizeof *Mix);
+		RunOscillators(Bank, Mix, Channels, Length);
+		++Repetitions;
+		t1 = clock();
+	} while (t1 - t0 < MinimumTime * CLOCKS_PER_SEC);
+	const double OscillatorRate =
+		(double) Repetitions * Length * Channels * CLOCKS_PER_SEC / (t1 - t0);
+
+	// Measure the oscillators' error over the last run.
+	Error = 0;
+	for (vDSP_Length t = 0; t < Length; ++t)
+		for (vDSP_Length c = 0; c < Channels; ++c)
+		{
+			const double e = fabs(Mix[t*Channels + c]
+				- .5 * sin((t*Frequency[c] + Start[c]) * TwoPi)
+				- .5 * sin((t*Frequency[c + Channels] + Start[c + Channels])
+					* TwoPi));
+			if (Error < e)
+				Error = e;
+		}
+	const double OscillatorError = Error;
+
+	/*	Evaluate PolynomialSine on a row of phases for each sample time,
+		advancing the phases in double precision and reducing them to
+		[0, 1).
+	*/
+	Repetitions = 0;
+	t0 = clock();
+	do
+	{
+		memcpy(Phase, Start, 2 * Channels * sizeof *Phase);
+		for (vDSP_Length t = 0; t < Length; ++t)
+		{
+			for (vDSP_Length i = 0; i < 2 * Channels; ++i)
+			{
+				PhaseRow[i] = Phase[i];
+				Phase[i] += Frequency[i];
+				Phase[i] -= 1 <= Phase[i];
+			}
+			PolynomialSine(PhaseRow, SineRow, 2 * Channels);
+			for (vDSP_Length c = 0; c < Channels; ++c)
+				Mix[t*Channels + c] =
+					.5f * SineRow[c] + .5f * SineRow[c + Channels];
+		}
+		++Repetitions;
+		t1 = clock();
+	} while (t1 - t0 < MinimumTime * CLOCKS_PER_SEC);
+	const double PolynomialRate =
+		(double) Repetitions * Length * Channels * CLOCKS_PER_SEC / (t1 - t0);
+
+	/*	Measure PolynomialSine's own error, on phases that are exactly
+		representable, so only the sine routine is measured.
+	*/
+	Error = 0;
+	for (vDSP_Length i = 0; i < Length * Channels; i += 2 * Channels)
+	{
+		for (vDSP_Length j = 0; j < 2 * Channels; ++j)
+			PhaseRow[j] = (float) (i + j) / (Length * Channels);
+		PolynomialSine(PhaseRow, SineRow, 2 * Channels);
+		for (vDSP_Length j = 0; j < 2 * Channels; ++j)
+		{
+			const double e = fabs(SineRow[j] - sin(PhaseRow[j] * TwoPi));
+			if (Error < e)
+				Error = e;
+		}
+	}
+	const double PolynomialError = Error;
+
+	printf("\nGenerating tone pairs for %d channels, %d samples at a time:\n",
+		Channels, Length);
+	printf("\tsin for each sample:  %.3g samples per second.\n", LibmRate);
+	printf("\tOscillator bank:      %.3g samples per second, %.1f times as "
+		"fast,\n\t\tgreatest error %.2g.\n",
+		OscillatorRate, OscillatorRate / LibmRate, OscillatorError);
+	printf("\tPolynomialSine:       %.3g samples per second, %.1f times as "
+		"fast,\n\t\tgreatest error %.2g.\n",
+		PolynomialRate, PolynomialRate / LibmRate, PolynomialError);
+
+	/*	Show how the oscillators' error grows over a long run, in which
+		the renormalization keeps the amplitude right but the phase
+		drifts.  Run one tone pair for a thousand seconds.
+	*/
+	printf("\tOscillator error over time, for one tone pair:\n");
+	OscillatorBank *Pair = CreateOscillatorBank(2);
+	for (int i = 0; i < 2; ++i)
+		SetOscillator(Pair, i, Frequency[i * Channels], Start[i * Channels],
+			.5f);
+	Error = 0;
+	for (uint64_t t0 = 0, Next = Rate; t0 < 1000 * Rate; t0 += Length)
+	{
+		memset(Mix, 0, Length * sizeof *Mix);
+		RunOscillators(Pair, Mix, 1, Length);
+		for (vDSP_Length t = 0; t < Length; ++t)
+		{
+			/*	Reduce the phases in double precision before taking
+				sines, to keep the reference accurate.
+			*/
+			double p0 = (t0 + t) * Frequency[0]        + Start[0];
+			double p1 = (t0 + t) * Frequency[Channels] + Start[Channels];
+			p0 -= floor(p0);
+			p1 -= floor(p1);
+			const double e = fabs(Mix[t]
+				- .5 * sin(p0 * TwoPi) - .5 * sin(p1 * TwoPi));
+			if (Error < e)
+				Error = e;
+		}
+		if (Next <= t0 + Length)
+		{
+			printf("\t\tafter %4.0f seconds, greatest error %.2g.\n",
+				Next / Rate, Error);
+			Next *= 10;
+		}
+	}
+	DestroyOscillatorBank(Pair);
+
+	DestroyOscillatorBank(Bank);
+	free(Mix);
+	free(SineRow);
+	free(PhaseRow);
+	free(Phase);
+	free(Start);
+	free(Frequency);
+}
+
+
+/*	Compare the speed of generating noise with the linear congruential
+	generator this program once used, one number at a time, and with
+	FillPhilox, and show that a stream generated in pieces, as separate
+	threads might, matches the stream generated in order.
+*/
+void MeasureNoise(void)
+{
+	// Generate this many numbers at once.
+	enum { Length = 1 << 16, Pieces = 8 };
+
+	// Run each timing loop for at least this many seconds.
+	static const double MinimumTime = .25;
+
+	float *Buffer = malloc(Length * sizeof *Buffer);
+	float *Pieced = malloc(Length * sizeof *Pieced);
+	if (Buffer == 0 || Pieced == 0)
+	{
+		fprintf(stderr, "Error, unable to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	long Repetitions;
+	clock_t t0, t1;
+
+	/*	The generator is An Even Quicker Generator, from William H. Press,
+		Saul A. Teukolsky, William T. Vetterling, and Brian P. Flannery,
+		_Numerical Recipes in C: The Art of Scientific Computing_ second
+		edition (Cambridge University Press: 1992), pages 284-285.  Each
+		number depends on the previous one.
+	*/
+	uint32_t State = Seed;
+	Repetitions = 0;
+	t0 = clock();
+	do
+	{
+		for (vDSP_Length i = 0; i < Length; ++i)
+		{
+			State = 1664525 * State + 1013904223;
+			Buffer[i] = (State >> 8) * (1.f/16777216);
+		}
+		++Repetitions;
+		t1 = clock();
+	} while (t1 - t0 < MinimumTime * CLOCKS_PER_SEC);
+	const double LCGRate =
+		(double) Repetitions * Length * CLOCKS_PER_SEC / (t1 - t0);
+
+	PhiloxStream S;
+	InitializePhilox(&S, Seed, 0);
+	Repetitions = 0;
+	t0 = clock();
+	do
+	{
+		FillPhilox(&S, Buffer, Length);
+		++Repetitions;
+		t1 = clock();
+	} while (t1 - t0 < MinimumTime * CLOCKS_PER_SEC);
+	const double PhiloxRate =
+		(double) Repetitions * Length * CLOCKS_PER_SEC / (t1 - t0);
+
+	/*	Generate the stream in order, and again in pieces taken last to
+		first, each starting from a copy of the stream skipped ahead to
+		the piece.  Uneven pieces exercise partial blocks.
+	*/
+	InitializePhilox(&S, Seed, 0);
+	FillPhilox(&S, Buffer, Length);
+	for (int p = Pieces-1; 0 <= p; --p)
+	{
+		const vDSP_Length
+			Begin = (vDSP_Length) p * Length / Pieces + (0 < p),
+			End = (vDSP_Length) (p+1) * Length / Pieces + (p+1 < Pieces);
+		PhiloxStream Piece;
+		InitializePhilox(&Piece, Seed, 0);
+		SkipPhilox(&Piece, Begin);
+		FillPhilox(&Piece, Pieced + Begin, End - Begin);
+	}
+	const int Same = memcmp(Buffer, Pieced, Length * sizeof *Buffer) == 0;
+
+	printf("\nGenerating uniform noise, %d numbers at a time:\n", Length);
+	printf("\tLinear congruential:  %.3g numbers per second.\n", LCGRate);
+	printf("\tPhilox4x32-10:        %.3g numbers per second, %.1f times as "
+		"fast.\n", PhiloxRate, PhiloxRate / LCGRate);
+	printf("\tGenerated in %d pieces out of order, the stream %s.\n",
+		Pieces, Same ? "is identical" : "DIFFERS");
+
+	free(Pieced);
+	free(Buffer);
 }
 
 
@@ -235,14 +1056,89 @@ int main(int argc, char *argv[])
 	// Initialize the pseudo-random number generator.
 	InitializeRandom();
 
+	// Generate a test stream if requested.
+	if (1 < argc && strcmp(argv[1], "-generate") == 0)
+	{
+		if (argc != 5 || atol(argv[2]) <= 0)
+		{
+			fprintf(stderr,
+				"Usage:  %s -generate Channels Seconds File\n",
+				argv[0]);
+			exit(EXIT_FAILURE);
+		}
+		GenerateStream(atol(argv[2]), atof(argv[3]), argv[4]);
+		return 0;
+	}
+
+	// Measure the tone generators if requested.
+	if (1 < argc && strcmp(argv[1], "-oscillators") == 0)
+	{
+		MeasureOscillators();
+		return 0;
+	}
+
+	// Measure the noise generators if requested.
+	if (1 < argc && strcmp(argv[1], "-noise") == 0)
+	{
+		MeasureNoise();
+		return 0;
+	}
+
+	// Select the FFT unless an option selects the Goertzel bank.
+	Method M = MethodFFT;
+	if (1 < argc && argv[1][0] == '-' && strcmp(argv[1], "-stream") != 0)
+	{
+		if (strcmp(argv[1], "-goertzel") == 0)
+			M = MethodGoertzel;
+		else if (strcmp(argv[1], "-fused") == 0)
+			M = MethodFusedFFT;
+		else if (strcmp(argv[1], "-fft") != 0)
+		{
+			fprintf(stderr, "Error, option %s not recognized.\n",
+				argv[1]);
+			exit(EXIT_FAILURE);
+		}
+		--argc;
+		++argv;
+	}
+
+	// Initialize the Goertzel bank with DTMF0 followed by DTMF1.
+	float Frequencies[GoertzelTones];
+	for (int i = 0; i < 4; ++i)
+	{
+		Frequencies[i    ] = DTMF0[i];
+		Frequencies[i + 4] = DTMF1[i];
+	}
+	GoertzelBank Bank;
+	InitializeGoertzelBank(&Bank, Frequencies, SamplingFrequency);
+
+	// Find the DFT bins of the same frequencies for the fused FFT method.
+	vDSP_Length Bins[GoertzelTones];
+	InitializeBins(Bins);
+
 	// Initialize FFT data.
-	FFTSetup Setup = vDSP_create_fftsetup(Log2SampleLength, FFT_RADIX2);
-	if (Setup == 0)
+	FFTSetup Setup = AcquireFFTSetup(Log2SampleLength, FFT_RADIX2);
+
+	// Decode a stream if requested.
+	if (1 < argc && strcmp(argv[1], "-stream") == 0)
 	{
-		fprintf(stderr, "Error, unable to create FFT setup.\n");
-		exit(EXIT_FAILURE);
+		if (argc < 3 || 4 < argc || atol(argv[2]) <= 0)
+		{
+			fprintf(stderr, "Usage:  %s -stream Channels [File]\n",
+				argv[0]);
+			exit(EXIT_FAILURE);
+		}
+		DecodeStream(Setup, atol(argv[2]), argc == 4 ? argv[3] : 0);
+		ReleaseFFTSetup(Setup);
+		return 0;
 	}
 
+	/*	Create an arena for the buffers of each frame, with room for the
+		buffer and signal of one frame.
+	*/
+	Arena *Work = CreateArena(4 * SampleLength * sizeof(float),
+		ArenaFirstTouch);
+
 	/*	If there are no command-line arguments, prompt for keys
 		interactively.
 	*/
@@ -270,7 +1166,7 @@ int main(int argc, char *argv[])
 
 			// If it is a valid key, demonstrate the FFT.
 			if (F.Frequency[0] != 0)
-				Demonstrate(Setup, F);
+				Demonstrate(Setup, &Bank, Bins, M, Work, F);
 
 			// Skip anything else on the line.
 			do
@@ -299,7 +1195,7 @@ int main(int argc, char *argv[])
 			if (F.Frequency[0] != 0)
 			{
 				printf("Simulating key %c.\n", *p);
-				Demonstrate(Setup, F);
+				Demonstrate(Setup, &Bank, Bins, M, Work, F);
 			}
 			else
 				fprintf(stderr,
@@ -311,13 +1207,32 @@ int main(int argc, char *argv[])
 	else
 	{
 		fprintf(stderr,
-			"Usage:  %s [telephone keys 0-9, #, *, or A-D]\n",
+			"Usage:  %s [-fft | -fused | -goertzel] "
+				"[telephone keys 0-9, #, *, or A-D]\n",
 			argv[0]);
 		exit(EXIT_FAILURE);
 	}
 
+	// Report the speed of the method.
+	Measure(Setup, &Bank, Bins, M, Work);
+
+	/*	For the FFT, also report the speed of the fused routine, which
+		does the same work in one pass over the signal, for comparison.
+	*/
+	if (M == MethodFFT)
+		Measure(Setup, &Bank, Bins, MethodFusedFFT, Work);
+
+	/*	Every frame above took its buffers from the arena, which got its
+		memory from the system only when it was created.
+	*/
+	const ArenaStatistics Statistics = GetArenaStatistics(Work);
+	printf("\nWork arena:  %lu allocations from %lu blocks of memory "
+		"(%lu bytes).\n", Statistics.Allocations, Statistics.Blocks,
+		(unsigned long) Statistics.BlockBytes);
+
 	// Release resources.
-	vDSP_destroy_fftsetup(Setup);
+	DestroyArena(Work);
+	ReleaseFFTSetup(Setup);
 
 	return 0;
 }
@@ -0,0 +1,303 @@
+/*	File: DTMFStream.c
+
+	Description:
+		A streaming DTMF decoder for many channels.
+
+		Each channel's most recent samples are kept in a ring buffer one
+		frame long.  Every half frame, the frame ending at the newest
+		sample is copied out of each ring, in the even-odd arrangement
+		vDSP_fft_zrip wants, into one batch buffer, and all channels are
+		transformed with a single vDSP_fftm_zrip call.  All memory is
+		allocated when the decoder is created; decoding allocates
+		nothing.
+
+		Each frame is classified as a key or as no key.  A key requires
+		the strongest row tone and the strongest column tone to hold
+		most of the frame's energy, to stand well above the other tones
+		in their groups, and to be within a range of each other in
+		strength, and the frame must not be nearly silent.  Each tone's
+		power is taken from the two bins around its frequency, so a tone
+		falling between bins is not missed.
+
+		A classification must repeat in DebounceFrames consecutive frames
+		to be accepted.  A key is reported when it is accepted, and it
+		must be released (no key accepted) before it is reported again,
+		so one press produces one report however long it lasts.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "DTMFStream.h"
+
+
+// Number of consecutive frames that must agree.
+#define	DebounceFrames	2
+
+/*	Thresholds for recognizing a key:  the fraction of the frame's
+	energy the two tones must hold, the factor by which each tone must
+	exceed the others in its group, the greatest ratio between the two
+	tones' powers, and the least mean square of the signal (relative to
+	full scale).
+*/
+static const float
+	MinimumToneFraction = .5f,
+	MinimumToneMargin   = 4,
+	MaximumTwist        = 8,
+	MinimumMeanSquare   = 1e-4f;
+
+
+// Define the DTMF keys and frequencies, rows first.
+static const char Keys[] = "123A456B789C*0#D";
+static const float Frequencies[8] =
+	{ 697, 770, 852, 941, 1209, 1336, 1477, 1633 };
+
+
+// Track the debouncing of one channel.
+typedef struct
+{
+	signed char Candidate;	// Most recent classification, or -1.
+	signed char Held;	// Accepted key, or -1.
+	unsigned char Count;	// Consecutive frames with Candidate.
+} KeyState;
+
+
+struct DTMFDecoder
+{
+	FFTSetup Setup;
+	vDSP_Length Log2FrameLength, FrameLength, Channels;
+
+	// Ring buffers, FrameLength samples for each channel.
+	float *Rings;
+
+	// Index in every ring of the next sample to be written.
+	vDSP_Length Position;
+
+	// Number of sample times decoded so far.
+	uint64_t Time;
+
+	// Frames of all channels, FrameLength/2 complex elements apart.
+	float *BatchMemory;
+	DSPSplitComplex Batch;
+
+	// First of the two bins used for each tone.
+	vDSP_Length Bins[8];
+
+	// Least energy of a key in the units of the FFT output.
+	float MinimumEnergy;
+
+	KeyState *States;
+};
+
+
+DTMFDecoder *CreateDTMFDecoder(FFTSetup Setup, vDSP_Length Log2FrameLength,
+	vDSP_Length Channels, float SamplingFrequency)
+{
+	const vDSP_Length FrameLength = (vDSP_Length) 1 << Log2FrameLength;
+
+	DTMFDecoder *D = malloc(sizeof *D);
+	if (D == NULL)
+	{
+		fprintf(stderr, "Error, unable to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	D->Setup           = Setup;
+	D->Log2FrameLength = Log2FrameLength;
+	D->FrameLength     = FrameLength;
+	D->Channels        = Channels;
+	D->Position        = 0;
+	D->Time            = 0;
+
+	D->Rings       = calloc(Channels * FrameLength, sizeof *D->Rings);
+	D->BatchMemory = malloc(Channels * FrameLength * sizeof *D->BatchMemory);
+	D->States      = malloc(Channels * sizeof *D->States);
+	if (D->Rings == NULL || D->BatchMemory == NULL || D->States == NULL)
+	{
+		fprintf(stderr, "Error, unable to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	D->Batch.realp = D->BatchMemory;
+	D->Batch.imagp = D->BatchMemory + Channels * FrameLength/2;
+
+	for (vDSP_Length c = 0; c < Channels; ++c)
+	{
+		D->States[c].Candidate = -1;
+		D->States[c].Held      = -1;
+		D->States[c].Count     = 0;
+	}
+
+	/*	Use the bin below each frequency and the bin above it, keeping
+		both within the bins that hold complex values.
+	*/
+	for (int t = 0; t < 8; ++t)
+	{
+		vDSP_Length k = Frequencies[t] / SamplingFrequency * FrameLength;
+		if (k < 1)
+			k = 1;
+		if (FrameLength/2 - 2 < k)
+			k = FrameLength/2 - 2;
+		D->Bins[t] = k;
+	}
+
+	/*	A signal with mean square m has about 2 * FrameLength**2 * m of
+		energy in the bins, since vDSP_fft_zrip scales by two and the
+		bins hold half of the energy.
+	*/
+	D->MinimumEnergy = 2.f * FrameLength * FrameLength * MinimumMeanSquare;
+
+	return D;
+}
+
+
+void DestroyDTMFDecoder(DTMFDecoder *D)
+{
+	free(D->States);
+	free(D->BatchMemory);
+	free(D->Rings);
+	free(D);
+}
+
+
+/*	Classify one frame's spectrum, in vDSP's packed real-to-complex
+	format, and return the index of its key in Keys, or -1 for no key.
+*/
+static int Classify(const DTMFDecoder *D, const float *re, const float *im)
+{
+	const vDSP_Length H = D->FrameLength/2;
+
+	// Total the energy, omitting element 0, which holds DC and Nyquist.
+	float Energy = 0;
+	for (vDSP_Length k = 1; k < H; ++k)
+		Energy += re[k]*re[k] + im[k]*im[k];
+
+	if (Energy < D->MinimumEnergy)
+		return -1;
+
+	float Power[8];
+	for (int t = 0; t < 8; ++t)
+	{
+		const vDSP_Length k = D->Bins[t];
+		Power[t] = re[k  ]*re[k  ] + im[k  ]*im[k  ]
+		         + re[k+1]*re[k+1] + im[k+1]*im[k+1];
+	}
+
+	// Find the strongest tone and the runner-up in each group.
+	int Best[2];
+	float Second[2];
+	for (int g = 0; g < 2; ++g)
+	{
+		const float *p = Power + 4*g;
+		int b = 0;
+		for (int i = 1; i < 4; ++i)
+			if (p[b] < p[i])
+				b = i;
+		float s = 0;
+		for (int i = 0; i < 4; ++i)
+			if (i != b && s < p[i])
+				s = p[i];
+		Best[g] = b;
+		Second[g] = s;
+	}
+
+	const float Row = Power[Best[0]], Column = Power[4 + Best[1]];
+
+	if (Row + Column < MinimumToneFraction * Energy)
+		return -1;
+	if (Row < MinimumToneMargin * Second[0]
+		|| Column < MinimumToneMargin * Second[1])
+		return -1;
+	if (MaximumTwist * Column < Row || MaximumTwist * Row < Column)
+		return -1;
+
+	return Best[0]*4 + Best[1];
+}
+
+
+// Analyze the frame ending at the newest sample of every channel.
+static void Analyze(DTMFDecoder *D, DTMFKeyHandler *Handler, void *Context)
+{
+	const vDSP_Length
+		L = D->FrameLength,
+		P = D->Position,	// Oldest sample in each ring.
+		H = L/2;
+
+	/*	Copy each frame out of its ring in two pieces, oldest first,
+		splitting even and odd samples as vDSP_fft_zrip expects.  P is
+		a multiple of half a frame, so each piece has an even length.
+	*/
+	for (vDSP_Length c = 0; c < D->Channels; ++c)
+	{
+		const float *Ring = D->Rings + c*L;
+		DSPSplitComplex
+			Older = { D->Batch.realp + c*H, D->Batch.imagp + c*H },
+			Newer = { Older.realp + (L-P)/2, Older.imagp + (L-P)/2 };
+		vDSP_ctoz((const DSPComplex *) (Ring + P), 2, &Older, 1, (L-P)/2);
+		vDSP_ctoz((const DSPComplex *) Ring, 2, &Newer, 1, P/2);
+	}
+
+	vDSP_fftm_zrip(D->Setup, &D->Batch, 1, H, D->Log2FrameLength,
+		D->Channels, FFT_FORWARD);
+
+	for (vDSP_Length c = 0; c < D->Channels; ++c)
+	{
+		const int Key = Classify(D,
+			D->Batch.realp + c*H, D->Batch.imagp + c*H);
+
+		KeyState *S = &D->States[c];
+		if (Key == S->Candidate)
+		{
+			if (S->Count < DebounceFrames)
+				++S->Count;
+		}
+		else
+		{
+			S->Candidate = Key;
+			S->Count = 1;
+		}
+
+		if (S->Count == DebounceFrames && S->Candidate != S->Held)
+		{
+			S->Held = S->Candidate;
+			if (0 <= S->Held)
+				Handler(Context, c, Keys[S->Held], D->Time);
+		}
+	}
+}
+
+
+void DecodeDTMF(DTMFDecoder *D, const int16_t *Samples, vDSP_Length Length,
+	DTMFKeyHandler *Handler, void *Context)
+{
+	const vDSP_Length L = D->FrameLength, H = L/2, C = D->Channels;
+	const float Scale = 1.f / 32768;
+
+	while (0 < Length)
+	{
+		/*	Take samples up to the end of the current half frame.
+			Channels are copied one at a time, so the writes to each
+			ring are sequential.
+		*/
+		vDSP_Length n = H - D->Position % H;
+		if (Length < n)
+			n = Length;
+
+		for (vDSP_Length c = 0; c < C; ++c)
+		{
+			float *Ring = D->Rings + c*L + D->Position;
+			for (vDSP_Length t = 0; t < n; ++t)
+				Ring[t] = Samples[t*C + c] * Scale;
+		}
+
+		Samples += n*C;
+		Length -= n;
+		D->Time += n;
+		D->Position = (D->Position + n) & (L-1);
+
+		// At each half frame, once a full frame has arrived, analyze.
+		if (D->Position % H == 0 && L <= D->Time)
+			Analyze(D, Handler, Context);
+	}
+}
@@ -0,0 +1,58 @@
+/*	File: DTMFStream.h
+
+	Description:
+		Declarations for a streaming DTMF decoder that follows many
+		channels of a continuous signal and reports the keys pressed on
+		each.
+*/
+#ifndef __DTMFSTREAM__
+#define __DTMFSTREAM__
+
+
+#include <stdint.h>
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+typedef struct DTMFDecoder DTMFDecoder;
+
+/*	A key handler is called once for each key press detected.  Channel
+	is the channel it was pressed on, Key is one of "0123456789*#ABCD",
+	and Sample is the index (counting from zero at the start of the
+	stream) of the sample at which the press was recognized.
+*/
+typedef void DTMFKeyHandler(void *Context, vDSP_Length Channel, char Key,
+	uint64_t Sample);
+
+
+/*	Create a decoder for Channels channels sampled at SamplingFrequency
+	Hz.  Frames of 2**Log2FrameLength samples are analyzed with Setup
+	(which must support that length), each starting half a frame after
+	the previous.  All memory the decoder needs is allocated here.
+*/
+DTMFDecoder *CreateDTMFDecoder(FFTSetup Setup, vDSP_Length Log2FrameLength,
+	vDSP_Length Channels, float SamplingFrequency);
+
+// Release a decoder.
+void DestroyDTMFDecoder(DTMFDecoder *Decoder);
+
+/*	Decode Length sample times of 16-bit PCM, with the samples of all
+	channels interleaved (Samples[t*Channels + c] is channel c at time
+	t).  The stream may be delivered in pieces of any length, and
+	Handler is called for keys as they are recognized.
+*/
+void DecodeDTMF(DTMFDecoder *Decoder, const int16_t *Samples,
+	vDSP_Length Length, DTMFKeyHandler *Handler, void *Context);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -53,17 +53,18 @@
 */
 
 
-#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include <sys/param.h>
-#include <sys/sysctl.h>
-
-#include <Accelerate/Accelerate.h>
+#include "PortableDSP.h"	// Accelerate, or the portable vDSP subset.
 
+#include "Benchmark.h"
+#include "CPUFeatures.h"
+#include "Clock.h"
 #include "Demonstrate.h"
+#include "FFTSetupRegistry.h"
+#include "FastConvolution.h"
 
 
 /*	Here we define some minor subroutines.  If this were a larger
@@ -72,65 +73,22 @@
 */
 
 
-#if defined __ppc__ || defined __ppc64__
-
-	/*	Some PowerPC processors have AltiVec (including those in G4 and
-		G5 systems) and some do not (including those in G3 systems).
-		If you want to write code that uses AltiVec features to run
-		quickly on G4 or G5 systems but still works (more slowly) on G3
-		systems, you may need to test for the presence of AltiVec
-		features at run time.
-
-		To start, we will define a Boolean value that we will set to
-		indicate whether AltiVec is available or not.
-	*/
-	static _Bool HasVector;
-
-	/*	This routine initializes the HasVector object above by asking
-		the operating system whether AltiVec features are present.
-	*/
-	static void InitializeHasVector(void)
-	{
-		unsigned int HasAltiVec;
-		size_t SizeOfHasAltiVec = sizeof HasAltiVec;
-
-		// Ask sysctlbyname for the value of "hw.optional.altivec".
-		if (0 != sysctlbyname("hw.optional.altivec",
-			&HasAltiVec, &SizeOfHasAltiVec, NULL, 0))
-		{
-			/*	sysctlbyname failed.  That should not happen on
-				a PowerPC, although of course an Intel system
-				will report there is no value for
-				"hw.optional.altivec".
-			*/
-			fprintf(stderr,
-"Error, sysctlbyname(\"hw.optional.altivec\") failed with\n"
-"errno %d:  %s.\n",
-				errno, strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-
-		HasVector = HasAltiVec;
-
-		/*	Now code can tell whether AltiVec is available by
-			checking the value of HasVector.
-		*/
-	}
-
-#else	// defined __ppc__ || defined __ppc64__
-
-	// If we are not on a PowerPC, define InitializeHasVector to do nothing.
-	#define InitializeHasVector()
-
-	/*	Since this is not being compiled for a PowerPC, we will assume
-		it is being compiled for an Intel system that has vector
-		features, since all Apple systems have SSE2 at least.  (If you
-		are writing code for other systems, you may need additional
-		tests here.)
-	*/
-	#define HasVector	1
-
-#endif	// defined __ppc__ || defined __ppc64__
+/*	Some processors have vector features that others lack:  some
+	PowerPC processors have AltiVec (including those in G4 and G5
+	systems) and some do not (including those in G3 systems), and Intel
+	and AMD processors have added SSE2, AVX, AVX2, FMA, and AVX-512 over
+	the years, as ARM processors have added NEON and SVE.  If you want
+	to write code that uses vector features to run quickly where they
+	exist but still works (more slowly) where they do not, you need to
+	test for them at run time.
+
+	CPUFeatures, in CPUFeatures.h, asks the processor (with cpuid on
+	Intel) or the operating system (with getauxval on Linux and sysctl
+	on Mac OS X) which features are present, once, and returns a set of
+	bits.  The portable vDSP routines use it to choose their kernels,
+	and the code below uses it to decide whether AltiVec can be used.
+*/
+#define	HasVector	((CPUFeatures() & CPUAltiVec) != 0)
 
 
 /*	This next section defines some things to change the floating-point
@@ -259,7 +217,7 @@
 		}
 	#endif	// defined _AltiVecPIMLanguageExtensionsAreEnabled
 
-#elif defined __i386__ || defined __x86_64__
+#elif defined __APPLE__ && (defined __i386__ || defined __x86_64__)
 
 	#include <fenv.h>
 	#if !defined __GNUC__
@@ -297,78 +255,130 @@
 
 #else
 
-	/*	On an unknown architecture, we have no control over the
-		environment.
+	/*	On other systems, fenv.h does not provide an environment with
+		subnormals disabled, so use the routines in MathMode.h, which
+		set the control register directly:  the FTZ and DAZ bits of the
+		MXCSR on Intel processors and the FZ bit of the FPCR on 64-bit
+		ARM processors.  On an unknown architecture, they do nothing.
+		Unlike the environments above, these set only the subnormal
+		handling.
 	*/
-	typedef _Bool MathEnvironment;
-	static const MathEnvironment FastMathEnvironment = 0;
+	#include "MathMode.h"
+
+	typedef MathMode MathEnvironment;
+	#define	FastMathEnvironment	MathModeFast
+
 	MathEnvironment SetMathEnvironment(MathEnvironment New)
 	{
-		return 0;
+		MathEnvironment Old = CurrentMathMode();
+		EnterMathMode(New);
+		return Old;
 	}
 
 #endif
 
 
-// Define static data for Clock routine.
-static mach_timebase_info_data_t MachClockInfo;
-ClockData ClockLatency;	// Average latency of clock routine, in clock ticks.
-
-
-// Return mach clock's time.
-ClockData Clock(void)
-{
-	return mach_absolute_time();
-}
-
-
-/*	Subtract two clock measurements and convert difference to seconds,
-	excluding measurement time.
+/*	Bounds on the base-two logarithms of the sizes in a sweep.  Each
+	dimension of a two-dimensional FFT must have at least two elements,
+	and the largest sizes use a few hundred megabytes.
 */
-double ClockToSeconds(ClockData t1, ClockData t0)
-{
-	return (t1 - t0 - ClockLatency) * 1e-9
-		* MachClockInfo.numer / MachClockInfo.denom;
-}
+enum { MinimumSweepLog2 = 2, MaximumSweepLog2 = 24 };
 
 
-// Initialize static data for Clock routine.
-static void InitializeClock()
+int main(int argc, char *argv[])
 {
-	static const int Iterations = 1000000;
-
-	int i;
-
-	/*	Get ratio of mach_absolute_time ticks to nanoseconds.  (One
-		tick is numer/denom nanoseconds.)
+	/*	With "-json File" or "-csv File", record the timings in
+		machine-readable form as well as printing them.  With
+		"-counters", also count hardware events such as cache misses.
+
+		With "-sweep Minimum Maximum", instead of running the
+		demonstrations, time the FFT routines at each size from
+		2**Minimum to 2**Maximum elements.  With "-numa", instead time
+		FFTs with the data in local and in remote NUMA memory.
 	*/
-	mach_timebase_info(&MachClockInfo);
-
-	// Measure latency of Clock routine.
-	ClockData t0 = Clock(), t1;
-	for (i = 0; i < Iterations; ++i)
-		t1 = Clock();
-
-	// Record average latency (rounded down).
-	ClockLatency = (t1 - t0) / Iterations;
-}
-
+	const char *JSONName = NULL, *CSVName = NULL;
+	int Counters = 0, NUMA = 0;
+	unsigned SweepMinimum = 0, SweepMaximum = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (i + 1 < argc && strcmp(argv[i], "-json") == 0)
+			JSONName = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "-csv") == 0)
+			CSVName = argv[++i];
+		else if (strcmp(argv[i], "-counters") == 0)
+			Counters = 1;
+		else if (strcmp(argv[i], "-numa") == 0)
+			NUMA = 1;
+		else if (i + 2 < argc && strcmp(argv[i], "-sweep") == 0)
+		{
+			SweepMinimum = strtoul(argv[++i], NULL, 0);
+			SweepMaximum = strtoul(argv[++i], NULL, 0);
+			if (SweepMinimum < MinimumSweepLog2
+				|| SweepMaximum < SweepMinimum
+				|| MaximumSweepLog2 < SweepMaximum)
+			{
+				fprintf(stderr, "Error, sweep sizes must satisfy "
+					"%u <= Minimum <= Maximum <= %u.\n",
+					MinimumSweepLog2, MaximumSweepLog2);
+				exit(EXIT_FAILURE);
+			}
+		}
+		else
+		{
+			fprintf(stderr, "Usage:  %s [-json File] [-csv File] "
+				"[-counters] [-sweep Minimum Maximum | -numa]\n",
+				argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
 
-int main(void)
-{
 	/*	Initialize various things.  These are typically done only once,
 		at the start of a program.
 	*/
 	InitializeClock();
-	InitializeHasVector();
+	OpenBenchmarkOutput(JSONName, CSVName);
+
+	printf("Timing with the %s clock.\n", ClockName());
+
+	/*	Report the processor's vector features, and those the kernels
+		may use if the VDSP_ISA environment variable limits them.
+	*/
+	char Features[128];
+	printf("Processor features:  %s.\n", DescribeCPUFeatures(
+		DetectedCPUFeatures(), Features, sizeof Features));
+	if (CPUFeatures() != DetectedCPUFeatures())
+		printf("Limited by VDSP_ISA to:  %s.\n", DescribeCPUFeatures(
+			CPUFeatures(), Features, sizeof Features));
+	if (Counters)
+		UseBenchmarkCounters();
+
+	/*	Create the FFT setup for the largest size the demonstrations
+		use, or the largest size in the sweep, before anything is timed.
+		Every smaller FFT shares it.
+	*/
+	PrewarmFFTSetup(SweepMaximum ? SweepMaximum : 12, FFT_RADIX2);
+
+	// Measure where convolution by FFT becomes faster than direct.
+	InitializeFastConvolution();
 
 	// Set the floating-point math environment for fast execution.
 	MathEnvironment OldMathEnvironment
 		= SetMathEnvironment(FastMathEnvironment);
 
-	DemonstrateConvolution();
-	DemonstrateFFT();
-	DemonstrateFFT2D();
+	if (SweepMaximum)
+	{
+		SweepFFT(SweepMinimum, SweepMaximum);
+		SweepFFT2D(SweepMinimum, SweepMaximum);
+	}
+	else if (NUMA)
+		DemonstrateNUMA();
+	else
+	{
+		DemonstrateConvolution();
+		DemonstrateFFT();
+		DemonstrateFFT2D();
+		DemonstrateSubnormals();
+	}
 
 	/*	Restore the original math environment.  This is not necessary
 		at the end of a program, but this is how you might do it in an
@@ -377,5 +387,21 @@ int main(void)
 	*/
 	SetMathEnvironment(OldMathEnvironment);
 
+	CloseBenchmarkOutput();
+
+	/*	Report which kernels the portable vDSP routines chose.  (With
+		Accelerate, it makes its own choices, and none are reported.)
+	*/
+	printf("Kernel variants used:\n");
+	PrintKernelVariants();
+
+	FFTSetupStatistics Statistics = GetFFTSetupStatistics();
+	printf("FFT setups:  %lu requests shared a setup, %lu created one;\n"
+		"%u setups with %lu bytes of tables are resident "
+		"on %u NUMA node%s.\n",
+		Statistics.Hits, Statistics.Misses, Statistics.Resident,
+		(unsigned long) Statistics.TwiddleBytes, Statistics.Nodes,
+		Statistics.Nodes == 1 ? "" : "s");
+
 	return 0;
 }
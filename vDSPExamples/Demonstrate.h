@@ -55,6 +55,9 @@
 #define __MAIN__
 
 
+#include "Clock.h"	// Declare the clock used to time the examples.
+
+
 #ifdef __cplusplus
 	extern "C" {
 		/*	This tells a C++ compiler that the following routines
@@ -72,18 +75,22 @@ void DemonstrateConvolution(void);
 void DemonstrateFFT(void);
 void DemonstrateFFT2D(void);
 
+/*	Time the one- and two-dimensional FFT routines at every size from
+	2**Minimum to 2**Maximum elements, and print tables of throughput.
+*/
+void SweepFFT(unsigned Minimum, unsigned Maximum);
+void SweepFFT2D(unsigned Minimum, unsigned Maximum);
+
+/*	Time FFTs by a thread bound to each NUMA node with the data in the
+	memory of each node, and print a table of local and remote
+	throughput.
+*/
+void DemonstrateNUMA(void);
 
-/*	The Clock routine reports the current time, but the format it uses
-	should not be manipulated by the user.  The routine ClockToSeconds
-	takes two times reported by Clock and returns their difference in
-	seconds.  (It also subtracts the average latency of the Clock routine
-	from the difference.)
+/*	Time convolution and FFTs of ordinary and subnormal data in
+	conformant and fast math modes.
 */
-#include <mach/mach_time.h>	// Declare mach_absolute_time.
-typedef uint64_t ClockData;	// Define type for clock data.
-ClockData Clock(void);		// Declare clock routine.
-double ClockToSeconds(ClockData t1, ClockData t0);
-				// Return number of seconds between two times.
+void DemonstrateSubnormals(void);
 
 
 #ifdef __cplusplus
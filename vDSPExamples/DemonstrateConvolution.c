@@ -4,15 +4,389 @@
 	Copyright (C) 2007 Apple Inc.  All rights reserved.
 */
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
-#include <Accelerate/Accelerate.h>
+#include "PortableDSP.h"	// Accelerate, or the portable vDSP subset.
 
+#include "Benchmark.h"
 #include "Demonstrate.h"
+#include "FastConvolution.h"
+#include "MultichannelConvolution.h"
+#include "ParallelConvolution.h"
 
 
-#define Iterations 1000	// How many iterations to use in the timer loop.
+// Hold the arguments of a convolution to be timed.
+typedef struct
+{
+	const float *Signal, *Filter;
+	vDSP_Stride FilterStride;
+	float *Result;
+	vDSP_Length ResultLength, FilterLength;
+	ThreadPool *Pool;	// For ParallelConvolution.
+} ConvolutionArguments;
+
+
+// Call vDSP_conv, for Benchmark.
+static void TimeConv(void *Context)
+{
+	const ConvolutionArguments *a = Context;
+	vDSP_conv(a->Signal, 1, a->Filter, a->FilterStride, a->Result, 1,
+		a->ResultLength, a->FilterLength);
+}
+
+
+// Call FastConvolution, for Benchmark.
+static void TimeFastConvolution(void *Context)
+{
+	const ConvolutionArguments *a = Context;
+	FastConvolution(a->Signal, 1, a->Filter, a->FilterStride, a->Result, 1,
+		a->ResultLength, a->FilterLength);
+}
+
+
+// Call ParallelConvolution, for Benchmark.
+static void TimeParallelConvolution(void *Context)
+{
+	const ConvolutionArguments *a = Context;
+	ParallelConvolution(a->Pool, a->Signal, 1, a->Filter, a->FilterStride,
+		a->Result, 1, a->ResultLength, a->FilterLength);
+}
+
+
+/*	Return the bytes of memory a convolution reads and writes:  the
+	signal, the filter, and the result, each once.
+*/
+static double ConvolutionBytes(vDSP_Length ResultLength,
+	vDSP_Length FilterLength)
+{
+	return sizeof(float) * (2. * ResultLength + 2. * FilterLength - 1);
+}
+
+
+/*	Compare FastConvolution with vDSP_conv over a range of filter lengths.
+
+	For each filter length, we report which method FastConvolution chose
+	and its performance in "gigaflops-equivalent":  the number of
+	operations the direct method would perform, ResultLength * (2 *
+	FilterLength - 1), divided by the time taken.  This lets the two
+	methods be compared on one scale even though the FFT method performs
+	far fewer operations for long filters.
+*/
+static void SweepFilterLengths(void)
+{
+	const vDSP_Length
+		MinimumFilterLength = 8,
+		MaximumFilterLength = 65536,
+		ResultLength = 16384,
+		SignalLength = ResultLength + MaximumFilterLength;
+
+	vDSP_Length i, FilterLength;
+
+	printf("\tSweep of filter lengths for %u results.\n",
+		(unsigned int) ResultLength);
+	printf("\tFastConvolution uses the FFT from filter length %u.\n\n",
+		(unsigned int) FastConvolutionCrossover(ResultLength));
+
+	float *Signal = malloc(SignalLength * sizeof *Signal);
+	float *Filter = malloc(MaximumFilterLength * sizeof *Filter);
+	float *Result = malloc(ResultLength * sizeof *Result);
+
+	if (Signal == NULL || Filter == NULL || Result == NULL)
+	{
+		fprintf(stderr, "Error, failed to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < SignalLength; ++i)
+		Signal[i] = 1;
+	for (i = 0; i < MaximumFilterLength; ++i)
+		Filter[i] = 1;
+
+	printf("\t%12s  %-6s  %12s  %9s  %16s\n",
+		"FilterLength", "Method", "Microseconds", "Gigaflops",
+		"Direct gigaflops");
+
+	for (FilterLength = MinimumFilterLength;
+		FilterLength <= MaximumFilterLength; FilterLength *= 2)
+	{
+		const double Flops = ResultLength * (2. * FilterLength - 1);
+		const double Bytes = ConvolutionBytes(ResultLength, FilterLength);
+		ConvolutionArguments Arguments =
+		{
+			.Signal = Signal, .Filter = Filter, .FilterStride = 1,
+			.Result = Result, .ResultLength = ResultLength,
+			.FilterLength = FilterLength
+		};
+		char Name[64];
+
+		snprintf(Name, sizeof Name, "FastConvolution %u*%u",
+			(unsigned int) ResultLength, (unsigned int) FilterLength);
+		BenchmarkResult Fast = Benchmark(Name, TimeFastConvolution,
+			&Arguments, Flops, Bytes, ResultLength);
+		RecordBenchmark(&Fast);
+
+		snprintf(Name, sizeof Name, "vDSP_conv %u*%u",
+			(unsigned int) ResultLength, (unsigned int) FilterLength);
+		BenchmarkResult Direct = Benchmark(Name, TimeConv, &Arguments,
+			Flops, Bytes, ResultLength);
+		RecordBenchmark(&Direct);
+
+		// Report the median times.
+		const double Time = Fast.Median, DirectTime = Direct.Median;
+
+		printf("\t%12u  %-6s  %12.2f  %9.3g  %16.3g\n",
+			(unsigned int) FilterLength,
+			FastConvolutionUsesFFT(ResultLength, FilterLength)
+				? "FFT" : "direct",
+			Time * 1e6, Flops / Time * 1e-9, Flops / DirectTime * 1e-9);
+	}
+
+	printf("\n");
+
+	free(Signal);
+	free(Filter);
+	free(Result);
+}
+
+
+// Hold the arguments of a convolution of many channels to be timed.
+typedef struct
+{
+	const float *Signal, *Filter;
+	float *Result;
+	vDSP_Stride SignalChannelStride, ResultChannelStride;
+	vDSP_Length ResultLength, FilterLength, Channels;
+} MultichannelArguments;
+
+
+// Call vDSP_conv once for each channel, for Benchmark.
+static void TimeChannelLoop(void *Context)
+{
+	const MultichannelArguments *a = Context;
+	for (vDSP_Length m = 0; m < a->Channels; ++m)
+		vDSP_conv(a->Signal + m * a->SignalChannelStride, 1, a->Filter, 1,
+			a->Result + m * a->ResultChannelStride, 1, a->ResultLength,
+			a->FilterLength);
+}
+
+
+// Call MultichannelConvolution, for Benchmark.
+static void TimeMultichannelConvolution(void *Context)
+{
+	const MultichannelArguments *a = Context;
+	MultichannelConvolution(a->Signal, 1, a->SignalChannelStride,
+		a->Filter, 1, a->Result, 1, a->ResultChannelStride,
+		a->ResultLength, a->FilterLength, a->Channels);
+}
+
+
+/*	Compare MultichannelConvolution with a loop calling vDSP_conv for
+	each channel, for one tick of audio:  a short block of results in
+	each of many channels, all filtered by the same filter.
+*/
+static void CompareMultichannel(void)
+{
+	enum { Counts = 3 };
+	const vDSP_Length
+		ChannelCounts[Counts] = { 64, 256, 1024 },
+		MaximumChannels = 1024,
+		ResultLength = 64,
+		FilterLength = 128,
+		SignalLength = ResultLength + FilterLength - 1;
+
+	vDSP_Length i;
+
+	printf("\tComparison of one filter applied to many channels, "
+		"%u results\n\tper channel and %u filter elements.\n\n",
+		(unsigned int) ResultLength, (unsigned int) FilterLength);
+
+	float *Signal = malloc(MaximumChannels * SignalLength * sizeof *Signal);
+	float *Filter = malloc(FilterLength * sizeof *Filter);
+	float *Expected = malloc(MaximumChannels * ResultLength
+		* sizeof *Expected);
+	float *Result = malloc(MaximumChannels * ResultLength * sizeof *Result);
+
+	if (Signal == NULL || Filter == NULL || Expected == NULL
+		|| Result == NULL)
+	{
+		fprintf(stderr, "Error, failed to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < MaximumChannels * SignalLength; ++i)
+		Signal[i] = sin(i * .01) + i % 5 * .001;
+	for (i = 0; i < FilterLength; ++i)
+		Filter[i] = cos(i * .02) / FilterLength;
+
+	// Check the results against vDSP_conv's.
+	MultichannelArguments Arguments = { Signal, Filter, Expected,
+		SignalLength, ResultLength, ResultLength, FilterLength,
+		MaximumChannels };
+	TimeChannelLoop(&Arguments);
+	Arguments.Result = Result;
+	TimeMultichannelConvolution(&Arguments);
+
+	double Error = 0;
+	for (i = 0; i < MaximumChannels * ResultLength; ++i)
+		Error = fmax(Error, fabs(Result[i] - Expected[i]));
+	printf("\tLargest difference from vDSP_conv is %g.\n\n", Error);
+
+	printf("\t%8s  %18s  %18s  %7s\n",
+		"Channels", "Loop microseconds", "Multi microseconds",
+		"Speedup");
+
+	for (int l = 0; l < Counts; ++l)
+	{
+		const vDSP_Length Channels = ChannelCounts[l];
+		const double
+			Flops = Channels * ResultLength * (2. * FilterLength - 1),
+			Bytes = Channels * ConvolutionBytes(ResultLength, FilterLength);
+		char Name[64];
+
+		Arguments.Channels = Channels;
+
+		snprintf(Name, sizeof Name, "vDSP_conv loop %u*%u*%u",
+			(unsigned int) Channels, (unsigned int) ResultLength,
+			(unsigned int) FilterLength);
+		BenchmarkResult Loop = Benchmark(Name, TimeChannelLoop,
+			&Arguments, Flops, Bytes, Channels * ResultLength);
+		RecordBenchmark(&Loop);
+
+		snprintf(Name, sizeof Name, "MultichannelConvolution %u*%u*%u",
+			(unsigned int) Channels, (unsigned int) ResultLength,
+			(unsigned int) FilterLength);
+		BenchmarkResult Multi = Benchmark(Name,
+			TimeMultichannelConvolution, &Arguments, Flops, Bytes,
+			Channels * ResultLength);
+		RecordBenchmark(&Multi);
+
+		// Report the median times.
+		printf("\t%8u  %18.2f  %18.2f  %7.2f\n", (unsigned int) Channels,
+			Loop.Median * 1e6, Multi.Median * 1e6,
+			Loop.Median / Multi.Median);
+	}
+
+	printf("\n");
+
+	free(Signal);
+	free(Filter);
+	free(Expected);
+	free(Result);
+}
+
+
+/*	Time ParallelConvolution with 1, 2, 4, ... threads, up to the number
+	of processors, for several result lengths, and print the times and
+	the speedups over one thread.  Before timing, check that the results
+	with each number of threads are identical to those of vDSP_conv.
+*/
+static void SweepThreads(void)
+{
+	enum { Lengths = 3 };
+	const vDSP_Length
+		ResultLengths[Lengths] = { 16384, 131072, 1048576 },
+		MaximumResultLength = 1048576,
+		FilterLength = 1024,
+		SignalLength = MaximumResultLength + FilterLength - 1;
+
+	vDSP_Length i;
+
+	printf("\tSweep of threads for a %u-element filter.\n\n",
+		(unsigned int) FilterLength);
+
+	float *Signal = malloc(SignalLength * sizeof *Signal);
+	float *Filter = malloc(FilterLength * sizeof *Filter);
+	float *Expected = malloc(MaximumResultLength * sizeof *Expected);
+	float *Result = malloc(MaximumResultLength * sizeof *Result);
+
+	if (Signal == NULL || Filter == NULL || Expected == NULL
+		|| Result == NULL)
+	{
+		fprintf(stderr, "Error, failed to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/*	Use varied data, so that a result computed in a different order
+		would likely differ in its last bits.
+	*/
+	for (i = 0; i < SignalLength; ++i)
+		Signal[i] = sin(i * .01) + i % 7 * .001;
+	for (i = 0; i < FilterLength; ++i)
+		Filter[i] = cos(i * .003) / FilterLength;
+
+	vDSP_conv(Signal, 1, Filter, 1, Expected, 1, MaximumResultLength,
+		FilterLength);
+
+	printf("\t%7s", "Threads");
+	for (int l = 0; l < Lengths; ++l)
+		printf("  %9u ms  Speedup", (unsigned int) ResultLengths[l]);
+	printf("\n");
+
+	const long Processors = sysconf(_SC_NPROCESSORS_ONLN);
+	double Time1[Lengths] = { 0 };
+
+	for (long Threads = 1; Threads <= Processors; )
+	{
+		ConvolutionArguments Arguments =
+		{
+			.Signal = Signal, .Filter = Filter, .FilterStride = 1,
+			.Result = Result, .ResultLength = 0, .FilterLength = FilterLength,
+			.Pool = CreateThreadPool((unsigned) Threads)
+		};
+
+		// Check the results.
+		Arguments.ResultLength = MaximumResultLength;
+		TimeParallelConvolution(&Arguments);
+		if (memcmp(Result, Expected, MaximumResultLength * sizeof *Result)
+			!= 0)
+			printf("\tWith %ld threads, results differ from vDSP_conv.\n",
+				Threads);
+
+		printf("\t%7ld", Threads);
+		for (int l = 0; l < Lengths; ++l)
+		{
+			const vDSP_Length ResultLength = ResultLengths[l];
+			const double Flops = ResultLength * (2. * FilterLength - 1);
+			char Name[64];
+
+			Arguments.ResultLength = ResultLength;
+			snprintf(Name, sizeof Name, "ParallelConvolution %u*%u %ld",
+				(unsigned int) ResultLength, (unsigned int) FilterLength,
+				Threads);
+			BenchmarkResult R = Benchmark(Name, TimeParallelConvolution,
+				&Arguments, Flops,
+				ConvolutionBytes(ResultLength, FilterLength), ResultLength);
+			RecordBenchmark(&R);
+
+			// Report the median times.
+			if (Threads == 1)
+				Time1[l] = R.Median;
+			printf("  %12.3f  %7.2f", R.Median * 1e3, Time1[l] / R.Median);
+		}
+		printf("\n");
+
+		DestroyThreadPool(Arguments.Pool);
+
+		// Go to the next power of two, or to the number of processors.
+		if (Threads < 16 && Processors < 2*Threads && Threads < Processors)
+			Threads = Processors;
+		else if (Threads < 16)
+			Threads *= 2;
+		else
+			break;
+	}
+
+	printf("\n");
+
+	free(Signal);
+	free(Filter);
+	free(Expected);
+	free(Result);
+}
 
 
 // Demonstrate vDSP_conv.
@@ -59,8 +433,8 @@ void DemonstrateConvolution(void)
 	vDSP_Length i;
 
 	// Define some variables used to time the routine.
-	ClockData t0, t1;
-	float Time, Gigaflops;
+	BenchmarkResult R;
+	double Time, Gigaflops;
 
 	printf("Begin %s.\n\n", __func__);
 
@@ -104,17 +478,6 @@ void DemonstrateConvolution(void)
 		will see how fast it is.
 	*/
 
-	t0 = Clock();
-
-	for (i = 0; i < Iterations; i++)
-		vDSP_conv(Signal, SignalStride, Filter, FilterStride,
-			Result, ResultStride, ResultLength, FilterLength);
-
-	t1 = Clock();
-
-	// Average the time over all the loop iterations.
-	Time = ClockToSeconds(t1, t0) / Iterations;
-
 	/*	For each result element, a convolution takes a multiply for
 		each filter element and an addition for each element after the
 		first.  So there are ResultLength * (2 * FilterLength - 1)
@@ -123,17 +486,71 @@ void DemonstrateConvolution(void)
 		floating-point operations per second and then scale by 1e-9 to
 		get gigaflops.
 	*/
-	Gigaflops = ResultLength * (2 * FilterLength - 1) / Time * 1e-9;
+	const double Flops = ResultLength * (2. * FilterLength - 1);
+	const double Bytes = ConvolutionBytes(ResultLength, FilterLength);
+
+	/*	Benchmark calls the routine repeatedly and reports statistics
+		of the times.  We report the median time.
+	*/
+	ConvolutionArguments Forward =
+	{
+		.Signal = Signal, .Filter = Filter, .FilterStride = FilterStride,
+		.Result = Result, .ResultLength = ResultLength,
+		.FilterLength = FilterLength
+	};
+	R = Benchmark("vDSP_conv 2048*256", TimeConv, &Forward, Flops, Bytes,
+		ResultLength);
+	Time = R.Median;
+	Gigaflops = Flops / Time * 1e-9;
 
 	printf("\tA %u * %u convolution takes %g microseconds,\n"
-		"\twhich is a performance of %g gigaflops.\n\n",
+		"\twhich is a performance of %g gigaflops.\n",
 		(unsigned int) ResultLength, (unsigned int) FilterLength,
 		Time * 1e6, Gigaflops);
+	ReportBenchmark(&R);
+	ReportAVX2Comparison(&R, TimeConv, &Forward);
+	printf("\n");
+
+	/*	Time the convolution with the filter used backward, too.  An
+		implementation should not need to gather the filter elements
+		for a stride of -1, so this should take about the same time as
+		the forward case.
+	*/
+	ConvolutionArguments Backward =
+	{
+		.Signal = Signal, .Filter = Filter + FilterLength - 1,
+		.FilterStride = -1, .Result = Result, .ResultLength = ResultLength,
+		.FilterLength = FilterLength
+	};
+	R = Benchmark("vDSP_conv 2048*256 backward", TimeConv, &Backward, Flops,
+		Bytes, ResultLength);
+	Time = R.Median;
+	Gigaflops = Flops / Time * 1e-9;
+
+	printf("\tWith a filter stride of -1, it takes %g microseconds,\n"
+		"\twhich is a performance of %g gigaflops.\n",
+		Time * 1e6, Gigaflops);
+	ReportBenchmark(&R);
+	printf("\n");
+
+	/*	For comparison, Convolution.c reports 3.69 gigaflops for a
+		2048 * 256 convolution on a 500 MHz G4, computed with the same
+		formula.
+	*/
 
 	// Free allocated memory.
 	free(Signal);
 	free(Filter);
 	free(Result);
 
+	// Show where convolution by FFT becomes faster.
+	SweepFilterLengths();
+
+	// Show how convolution of one long signal scales with threads.
+	SweepThreads();
+
+	// Show the gain from filtering many channels together.
+	CompareMultichannel();
+
 	printf("End %s.\n\n\n", __func__);
 }
@@ -10,13 +10,17 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include <Accelerate/Accelerate.h>
+#include "PortableDSP.h"	// Accelerate, or the portable vDSP subset.
 
+#include "ArbitraryFFT.h"
+#include "Arena.h"
+#include "Benchmark.h"
 #include "Demonstrate.h"
+#include "FFTSetupRegistry.h"
+#include "InterleavedFFT.h"
+#include "PowerSpectrum.h"
 
 
-#define Iterations	10000	// Number of iterations used in the timing loop.
-
 #define Log2N	10u		// Base-two logarithm of number of elements.
 #define	N	(1u<<Log2N)	// Number of elements.
 
@@ -24,6 +28,132 @@
 static const float_t TwoPi = 0x3.243f6a8885a308d313198a2e03707344ap1;
 
 
+/*	Hold the arguments of an FFT to be timed.  Benchmark calls a routine
+	with a single pointer, so each routine timed below takes its
+	arguments from one of these.
+*/
+typedef struct
+{
+	FFTSetup Setup;
+	DSPSplitComplex *Signal, *Observed;
+	vDSP_Stride SignalStride, ObservedStride;
+	float *Interleaved;	// Real signal for vDSP_ctoz and vDSP_ztoc.
+	vDSP_Length Log2Length;
+	vDSP_Length Frames, FrameStride;	// For multiple FFTs.
+} FFTArguments;
+
+
+static void TimeZrip(void *Context)
+{
+	const FFTArguments *a = Context;
+	vDSP_fft_zrip(a->Setup, a->Signal, a->SignalStride, a->Log2Length,
+		FFT_FORWARD);
+}
+
+
+static void TimeZripWithConversion(void *Context)
+{
+	const FFTArguments *a = Context;
+	const vDSP_Length H = (vDSP_Length) 1 << (a->Log2Length - 1);
+	vDSP_ctoz((DSPComplex *) a->Interleaved, 2, a->Signal, 1, H);
+	vDSP_fft_zrip(a->Setup, a->Signal, 1, a->Log2Length, FFT_FORWARD);
+	vDSP_ztoc(a->Signal, 1, (DSPComplex *) a->Interleaved, 2, H);
+}
+
+
+// Transform the interleaved real signal in place, without conversions.
+static void TimeInterleavedZrop(void *Context)
+{
+	const FFTArguments *a = Context;
+	InterleavedFFT_zrop(a->Setup, (DSPComplex *) a->Interleaved,
+		(DSPComplex *) a->Interleaved, a->Log2Length, FFT_FORWARD);
+}
+
+
+static void TimeZrop(void *Context)
+{
+	const FFTArguments *a = Context;
+	vDSP_fft_zrop(a->Setup, a->Signal, a->SignalStride,
+		a->Observed, a->ObservedStride, a->Log2Length, FFT_FORWARD);
+}
+
+
+static void TimeZip(void *Context)
+{
+	const FFTArguments *a = Context;
+	vDSP_fft_zip(a->Setup, a->Signal, a->SignalStride, a->Log2Length,
+		FFT_FORWARD);
+}
+
+
+static void TimeZop(void *Context)
+{
+	const FFTArguments *a = Context;
+	vDSP_fft_zop(a->Setup, a->Signal, a->SignalStride,
+		a->Observed, a->ObservedStride, a->Log2Length, FFT_FORWARD);
+}
+
+
+static void TimeInterleavedZop(void *Context)
+{
+	const FFTArguments *a = Context;
+	InterleavedFFT_zop(a->Setup, (DSPComplex *) a->Interleaved,
+		(DSPComplex *) a->Interleaved, a->Log2Length, FFT_FORWARD);
+}
+
+
+// Transform each of a batch of frames with its own vDSP_fft_zrip call.
+static void TimeZripLoop(void *Context)
+{
+	const FFTArguments *a = Context;
+	for (vDSP_Length i = 0; i < a->Frames; ++i)
+	{
+		DSPSplitComplex Frame = { a->Signal->realp + i*a->FrameStride,
+			a->Signal->imagp + i*a->FrameStride };
+		vDSP_fft_zrip(a->Setup, &Frame, 1, a->Log2Length, FFT_FORWARD);
+	}
+}
+
+
+static void TimeFftmZrip(void *Context)
+{
+	const FFTArguments *a = Context;
+	vDSP_fftm_zrip(a->Setup, a->Signal, 1, a->FrameStride, a->Log2Length,
+		a->Frames, FFT_FORWARD);
+}
+
+
+// Hold the arguments of a transform by ArbitraryFFT_zop to be timed.
+typedef struct
+{
+	ArbitraryFFTSetup Setup;
+	DSPSplitComplex *Signal, *Observed;
+} ArbitraryFFTArguments;
+
+
+static void TimeArbitraryZop(void *Context)
+{
+	const ArbitraryFFTArguments *a = Context;
+	ArbitraryFFT_zop(a->Setup, a->Signal, 1, a->Observed, 1, FFT_FORWARD);
+}
+
+
+/*	Return the conventional operation counts of FFTs of 2**Log2Length
+	elements, 5 * Length * Log2Length for a complex FFT and half that
+	for a real FFT.  They are used to compute "gigaflops" rates that are
+	comparable across FFT algorithms.
+*/
+static double ComplexFFTFlops(vDSP_Length Log2Length)
+{
+	return 5. * ((vDSP_Length) 1 << Log2Length) * Log2Length;
+}
+
+static double RealFFTFlops(vDSP_Length Log2Length)
+{
+	return ComplexFFTFlops(Log2Length) / 2;
+}
+
+
 /*	Compare two complex vectors and report the relative error between them.
 	(The vectors must have unit strides; other strides are not supported.)
 */
@@ -71,9 +201,9 @@ static void CompareComplexVectors(
 	components of the complex data.
 
 	(It is possible to improve this situation by implementing
-	interleaved-data complex format.  If you would benefit from such
-	routines, please enter an enhancement request at
-	http://developer.apple.com/bugreporter.)
+	interleaved-data complex format.  InterleavedFFT_zrop, in
+	InterleavedFFT.h, is such a routine; it is demonstrated and timed
+	below.)
 
 	If an application's real data is stored sequentially in an array (as is
 	common) and the design cannot be altered to provide data in the
@@ -93,7 +223,7 @@ static void CompareComplexVectors(
 	See the vDSP Library manual for illustration and additional
 	information.
 */
-static void DemonstratevDSP_fft_zrip(FFTSetup Setup)
+static void DemonstratevDSP_fft_zrip(FFTSetup Setup, Arena *Work)
 {
 	/*	Define a stride for the array be passed to the FFT.  In many
 		applications, the stride is one and is passed to the vDSP
@@ -105,23 +235,17 @@ static void DemonstratevDSP_fft_zrip(FFTSetup Setup)
 	vDSP_Length i;
 
 	// Define some variables used to time the routine.
-	ClockData t0, t1;
+	BenchmarkResult R;
 	double Time;
 
 	printf("\n\tOne-dimensional real FFT of %u elements.\n", (unsigned int) N);
 
-	// Allocate memory for the arrays.
-	float *Signal = malloc(N * Stride * sizeof Signal);
-	float *ObservedMemory = malloc(N * sizeof *ObservedMemory);
-
-	if (ObservedMemory == NULL || Signal == NULL)
-	{
-		fprintf(stderr, "Error, failed to allocate memory.\n");
-		exit(EXIT_FAILURE);
-	}
-
-	// Assign half of ObservedMemory to reals and half to imaginaries.
-	DSPSplitComplex Observed = { ObservedMemory, ObservedMemory + N/2 };
+	/*	Allocate memory for the arrays from the work arena (see Arena.h),
+		which aligns them for vector loads and places the real and
+		imaginary parts of a separated-data vector so they do not alias.
+	*/
+	float *Signal = ArenaAllocate(Work, N * Stride * sizeof *Signal);
+	DSPSplitComplex Observed = ArenaAllocateSplit(Work, N/2);
 
 	/*	Generate an input signal.  In a real application, data would of
 		course be provided from an image file, sensors, or other source.
@@ -159,15 +283,7 @@ static void DemonstratevDSP_fft_zrip(FFTSetup Setup)
 	/*	Prepare expected results based on analytical transformation of
 		the input signal.
 	*/
-	float *ExpectedMemory = malloc(N * sizeof *ExpectedMemory);
-	if (ExpectedMemory == NULL)
-	{
-		fprintf(stderr, "Error, failed to allocate memory.\n");
-		exit(EXIT_FAILURE);
-	}
-
-	// Assign half of ExpectedMemory to reals and half to imaginaries.
-	DSPSplitComplex Expected = { ExpectedMemory, ExpectedMemory + N/2 };
+	DSPSplitComplex Expected = ArenaAllocateSplit(Work, N/2);
 
 	for (i = 0; i < N/2; ++i)
 		Expected.realp[i] = Expected.imagp[i] = 0;
@@ -185,8 +301,45 @@ static void DemonstratevDSP_fft_zrip(FFTSetup Setup)
 	// Compare the observed results to the expected results.
 	CompareComplexVectors(Expected, Observed, N/2);
 
-	// Release memory.
-	free(ExpectedMemory);
+	/*	InterleavedFFT_zrop computes the same spectrum from the real
+		signal directly, without vDSP_ctoz, and writes it with real and
+		imaginary parts interleaved, as vDSP_ztoc would.  Move it to
+		separated-data form to compare it too.
+	*/
+	float *Spectrum = ArenaAllocate(Work, N * sizeof *Spectrum);
+	InterleavedFFT_zrop(Setup, (DSPComplex *) Signal, (DSPComplex *) Spectrum,
+		Log2N, FFT_FORWARD);
+	vDSP_ctoz((DSPComplex *) Spectrum, 2, &Observed, 1, N/2);
+	CompareComplexVectors(Expected, Observed, N/2);
+
+	/*	RealPowerSpectrum computes the squared magnitudes of the bins
+		vDSP_fft_zrip produces, without writing out the spectrum, and
+		they should be exactly the same.  Ask for every bin (passing
+		NULL for the list of bins), so the bins the fused routine treats
+		specially, 0 and N/4, where it pairs a bin with itself, are
+		checked along with the rest.  The signal above has power in
+		only three bins, so use a scrambled ramp, which has power in
+		every bin.
+	*/
+	float *Noise = ArenaAllocate(Work, N * sizeof *Noise);
+	for (i = 0; i < N; ++i)
+		Noise[i] = (float) (i * 7919 % 1009) / 1009 - .5f;
+
+	float *Power = ArenaAllocate(Work, N/2 * sizeof *Power);
+	DSPSplitComplex Buffer = ArenaAllocateSplit(Work, N/2);
+	RealPowerSpectrum(Setup, Noise, &Buffer, Log2N, NULL, Power, N/2);
+
+	vDSP_ctoz((DSPComplex *) Noise, 2, &Observed, 1, N/2);
+	vDSP_fft_zrip(Setup, &Observed, 1, Log2N, FFT_FORWARD);
+
+	vDSP_Length Differences = 0;
+	for (i = 0; i < N/2; ++i)
+	{
+		const float re = Observed.realp[i], im = Observed.imagp[i];
+		Differences += Power[i] != re*re + im*im;
+	}
+	printf("\tRealPowerSpectrum differs from vDSP_fft_zrip in %lu of %u "
+		"bins.\n", (unsigned long) Differences, N/2);
 
 	/*	The above shows how to use the vDSP_fft_zrip routine.  Now we
 		will see how fast it is.
@@ -199,44 +352,57 @@ static void DemonstratevDSP_fft_zrip(FFTSetup Setup)
 	for (i = 0; i < N; ++i)
 		Signal[i] = 0;
 
-	// Time vDSP_fft_zrip by itself.
-
-	t0 = Clock();
-
-	for (i = 0; i < Iterations; ++i)
-		vDSP_fft_zrip(Setup, &Observed, 1, Log2N, FFT_FORWARD);
-
-	t1 = Clock();
+	FFTArguments Arguments =
+	{
+		.Setup = Setup, .Signal = &Observed, .SignalStride = 1,
+		.ObservedStride = 1, .Interleaved = Signal, .Log2Length = Log2N
+	};
 
-	// Average the time over all the loop iterations.
-	Time = ClockToSeconds(t1, t0) / Iterations;
+	/*	Time vDSP_fft_zrip by itself.  Benchmark calls the routine
+		repeatedly and reports statistics of the times; we report the
+		median.  It reads and writes N floats.
+	*/
+	R = Benchmark("vDSP_fft_zrip 1024", TimeZrip, &Arguments,
+		RealFFTFlops(Log2N), 2. * N * sizeof(float), N);
+	Time = R.Median;
 
 	printf("\tvDSP_fft_zrip on %u elements takes %g microseconds.\n",
 		(unsigned int) N, Time * 1e6);
+	ReportBenchmark(&R);
+	ReportAVX2Comparison(&R, TimeZrip, &Arguments);
 
-	// Time vDSP_fft_zrip with the vDSP_ctoz and vDSP_ztoc transformations.
-
-	t0 = Clock();
-
-	for (i = 0; i < Iterations; ++i)
-	{
-		vDSP_ctoz((DSPComplex *) Signal, 2*Stride, &Observed, 1, N/2);
-		vDSP_fft_zrip(Setup, &Observed, 1, Log2N, FFT_FORWARD);
-		vDSP_ztoc(&Observed, 1, (DSPComplex *) Signal, 2*Stride, N/2);
-	}
-
-	t1 = Clock();
-
-	// Average the time over all the loop iterations.
-	Time = ClockToSeconds(t1, t0) / Iterations;
+	/*	Time vDSP_fft_zrip with the vDSP_ctoz and vDSP_ztoc
+		transformations, which read and write N floats each too.
+	*/
+	R = Benchmark("vDSP_fft_zrip 1024 with ctoz and ztoc",
+		TimeZripWithConversion, &Arguments,
+		RealFFTFlops(Log2N), 6. * N * sizeof(float), N);
+	Time = R.Median;
 
 	printf(
 "\tvDSP_fft_zrip with vDSP_ctoz and vDSP_ztoc takes %g microseconds.\n",
 		Time * 1e6);
+	ReportBenchmark(&R);
+	ReportAVX2Comparison(&R, TimeZripWithConversion, &Arguments);
 
-	// Release resources.
-	free(ObservedMemory);
-	free(Signal);
+	/*	Time InterleavedFFT_zrop on the same interleaved signal, in
+		place.  Like vDSP_fft_zrip alone, it reads and writes N floats;
+		the difference from the time above is what folding the
+		conversions into the transform saves.
+	*/
+	const double ConversionTime = Time;
+	R = Benchmark("InterleavedFFT_zrop 1024", TimeInterleavedZrop,
+		&Arguments, RealFFTFlops(Log2N), 2. * N * sizeof(float), N);
+	Time = R.Median;
+
+	printf("\tInterleavedFFT_zrop takes %g microseconds, "
+		"saving %.0f%% of that time.\n",
+		Time * 1e6, (1 - Time / ConversionTime) * 100);
+	ReportBenchmark(&R);
+	ReportAVX2Comparison(&R, TimeInterleavedZrop, &Arguments);
+
+	// Release the arrays.
+	ResetArena(Work);
 }
 
 
@@ -250,7 +416,7 @@ static void DemonstratevDSP_fft_zrip(FFTSetup Setup)
 	incoming data arrives in the format used by vDSP_fft_zrop, and you want
 	to simultaneously perform an FFT and store the results in another array.
 */
-static void DemonstratevDSP_fft_zrop(FFTSetup Setup)
+static void DemonstratevDSP_fft_zrop(FFTSetup Setup, Arena *Work)
 {
 	/*	Define a stride for the array be passed to the FFT.  In many
 		applications, the stride is one and is passed to the vDSP
@@ -262,28 +428,16 @@ static void DemonstratevDSP_fft_zrop(FFTSetup Setup)
 	vDSP_Length i;
 
 	// Define some variables used to time the routine.
-	ClockData t0, t1;
+	BenchmarkResult R;
 	double Time;
 
 	printf("\n\tOne-dimensional real FFT of %u elements.\n",
 		(unsigned int) N);
 
-	// Allocate memory for the arrays.
-	float *Signal = malloc(N * Stride * sizeof Signal);
-	float *BufferMemory = malloc(N * sizeof *BufferMemory);
-	float *ObservedMemory = malloc(N * sizeof *ObservedMemory);
-
-	if (ObservedMemory == NULL || BufferMemory == NULL || Signal == NULL)
-	{
-		fprintf(stderr, "Error, failed to allocate memory.\n");
-		exit(EXIT_FAILURE);
-	}
-
-	// Assign half of BufferMemory to reals and half to imaginaries.
-	DSPSplitComplex Buffer = { BufferMemory, BufferMemory + N/2 };
-
-	// Assign half of ObservedMemory to reals and half to imaginaries.
-	DSPSplitComplex Observed = { ObservedMemory, ObservedMemory + N/2 };
+	// Allocate memory for the arrays from the work arena.
+	float *Signal = ArenaAllocate(Work, N * Stride * sizeof *Signal);
+	DSPSplitComplex Buffer = ArenaAllocateSplit(Work, N/2);
+	DSPSplitComplex Observed = ArenaAllocateSplit(Work, N/2);
 
 	/*	Generate an input signal.  In a real application, data would of
 		course be provided from an image file, sensors, or other source.
@@ -321,15 +475,7 @@ static void DemonstratevDSP_fft_zrop(FFTSetup Setup)
 	/*	Prepare expected results based on analytical transformation of
 		the input signal.
 	*/
-	float *ExpectedMemory = malloc(N * sizeof *ExpectedMemory);
-	if (ExpectedMemory == NULL)
-	{
-		fprintf(stderr, "Error, failed to allocate memory.\n");
-		exit(EXIT_FAILURE);
-	}
-
-	// Assign half of ExpectedMemory to reals and half to imaginaries.
-	DSPSplitComplex Expected = { ExpectedMemory, ExpectedMemory + N/2 };
+	DSPSplitComplex Expected = ArenaAllocateSplit(Work, N/2);
 
 	for (i = 0; i < N/2; ++i)
 		Expected.realp[i] = Expected.imagp[i] = 0;
@@ -347,9 +493,6 @@ static void DemonstratevDSP_fft_zrop(FFTSetup Setup)
 	// Compare the observed results to the expected results.
 	CompareComplexVectors(Expected, Observed, N/2);
 
-	// Release memory.
-	free(ExpectedMemory);
-
 	/*	The above shows how to use the vDSP_fft_zrop routine.  Now we
 		will see how fast it is.
 	*/
@@ -361,21 +504,19 @@ static void DemonstratevDSP_fft_zrop(FFTSetup Setup)
 	for (i = 0; i < N; ++i)
 		Signal[i] = 0;
 
-	// Time vDSP_fft_zrop by itself.
-
-	t0 = Clock();
-
-	for (i = 0; i < Iterations; ++i)
-		vDSP_fft_zrop(Setup, &Buffer, 1, &Observed, 1, Log2N,
-			FFT_FORWARD);
-
-	t1 = Clock();
-
-	// Average the time over all the loop iterations.
-	Time = ClockToSeconds(t1, t0) / Iterations;
+	// Time vDSP_fft_zrop by itself.  It reads and writes N floats.
+	FFTArguments Arguments =
+	{
+		.Setup = Setup, .Signal = &Buffer, .Observed = &Observed,
+		.SignalStride = 1, .ObservedStride = 1, .Log2Length = Log2N
+	};
+	R = Benchmark("vDSP_fft_zrop 1024", TimeZrop, &Arguments,
+		RealFFTFlops(Log2N), 2. * N * sizeof(float), N);
+	Time = R.Median;
 
 	printf("\tvDSP_fft_zrop on %u elements takes %g microseconds.\n",
 		(unsigned int) N, Time * 1e6);
+	ReportBenchmark(&R);
 
 	/*	Unlike the vDSP_fft_zrip example, we do not time vDSP_fft_zrop
 		in conjunction with vDSP_ctoz and vDSP_ztoc.  If your data
@@ -385,10 +526,8 @@ static void DemonstratevDSP_fft_zrop(FFTSetup Setup)
 		vDSP_fft_zrop.
 	*/
 
-	// Release resources.
-	free(ObservedMemory);
-	free(BufferMemory);
-	free(Signal);
+	// Release the arrays.
+	ResetArena(Work);
 }
 
 
@@ -399,7 +538,7 @@ static void DemonstratevDSP_fft_zrop(FFTSetup Setup)
 	uses less memory (so there is less data to load from memory and a
 	greater chance of keeping data in cache).
 */
-static void DemonstratevDSP_fft_zip(FFTSetup Setup)
+static void DemonstratevDSP_fft_zip(FFTSetup Setup, Arena *Work)
 {
 	/*	Define a stride for the array be passed to the FFT.  In many
 		applications, the stride is one and is passed to the vDSP
@@ -411,22 +550,14 @@ static void DemonstratevDSP_fft_zip(FFTSetup Setup)
 	vDSP_Length i;
 
 	// Define some variables used to time the routine.
-	ClockData t0, t1;
+	BenchmarkResult R;
 	double Time;
 
 	printf("\n\tOne-dimensional complex FFT of %u elements.\n",
 		(unsigned int) N);
 
-	// Allocate memory for the arrays.
-	DSPSplitComplex Signal;
-	Signal.realp = malloc(N * SignalStride * sizeof Signal.realp);
-	Signal.imagp = malloc(N * SignalStride * sizeof Signal.imagp);
-
-	if (Signal.realp == NULL || Signal.imagp == NULL)
-	{
-		fprintf(stderr, "Error, failed to allocate memory.\n");
-		exit(EXIT_FAILURE);
-	}
+	// Allocate memory for the arrays from the work arena.
+	DSPSplitComplex Signal = ArenaAllocateSplit(Work, N * SignalStride);
 
 	/*	Generate an input signal.  In a real application, data would of
 		course be provided from an image file, sensors, or other source.
@@ -451,17 +582,9 @@ static void DemonstratevDSP_fft_zip(FFTSetup Setup)
 	/*	Prepare expected results based on analytical transformation of
 		the input signal.
 	*/
-	DSPSplitComplex Expected;
-	Expected.realp = malloc(N * sizeof Expected.realp);
-	Expected.imagp = malloc(N * sizeof Expected.imagp);
-
-	if (Expected.realp == NULL || Expected.imagp == NULL)
-	{
-		fprintf(stderr, "Error, failed to allocate memory.\n");
-		exit(EXIT_FAILURE);
-	}
+	DSPSplitComplex Expected = ArenaAllocateSplit(Work, N);
 
-	for (i = 0; i < N/2; ++i)
+	for (i = 0; i < N; ++i)
 		Expected.realp[i] = Expected.imagp[i] = 0;
 
 	// Add the frequencies in the signal to the expected results.
@@ -477,10 +600,6 @@ static void DemonstratevDSP_fft_zip(FFTSetup Setup)
 	// Compare the observed results to the expected results.
 	CompareComplexVectors(Expected, Signal, N);
 
-	// Release memory.
-	free(Expected.realp);
-	free(Expected.imagp);
-
 	/*	The above shows how to use the vDSP_fft_zip routine.  Now we
 		will see how fast it is.
 	*/
@@ -492,24 +611,25 @@ static void DemonstratevDSP_fft_zip(FFTSetup Setup)
 	for (i = 0; i < N; ++i)
 		Signal.realp[i] = Signal.imagp[i] = 0;
 
-	// Time vDSP_fft_zip by itself.
-
-	t0 = Clock();
-
-	for (i = 0; i < Iterations; ++i)
-		vDSP_fft_zip(Setup, &Signal, SignalStride, Log2N, FFT_FORWARD);
-
-	t1 = Clock();
-
-	// Average the time over all the loop iterations.
-	Time = ClockToSeconds(t1, t0) / Iterations;
+	/*	Time vDSP_fft_zip by itself.  It reads and writes N complex
+		elements.
+	*/
+	FFTArguments Arguments =
+	{
+		.Setup = Setup, .Signal = &Signal, .SignalStride = SignalStride,
+		.ObservedStride = 1, .Log2Length = Log2N
+	};
+	R = Benchmark("vDSP_fft_zip 1024", TimeZip, &Arguments,
+		ComplexFFTFlops(Log2N), 4. * N * sizeof(float), N);
+	Time = R.Median;
 
 	printf("\tvDSP_fft_zip on %u elements takes %g microseconds.\n",
 		(unsigned int) N, Time * 1e6);
+	ReportBenchmark(&R);
+	ReportAVX2Comparison(&R, TimeZip, &Arguments);
 
-	// Release resources.
-	free(Signal.realp);
-	free(Signal.imagp);
+	// Release the arrays.
+	ResetArena(Work);
 }
 
 
@@ -518,7 +638,7 @@ static void DemonstratevDSP_fft_zip(FFTSetup Setup)
 	The out-of-place FFT writes results into a different array than the
 	input.
 */
-static void DemonstratevDSP_fft_zop(FFTSetup Setup)
+static void DemonstratevDSP_fft_zop(FFTSetup Setup, Arena *Work)
 {
 	/*	Define strides for the arrays be passed to the FFT.  In many
 		applications, the strides are one and are passed to the vDSP
@@ -530,25 +650,15 @@ static void DemonstratevDSP_fft_zop(FFTSetup Setup)
 	vDSP_Length i;
 
 	// Define some variables used to time the routine.
-	ClockData t0, t1;
+	BenchmarkResult R;
 	double Time;
 
 	printf("\n\tOne-dimensional complex FFT of %u elements.\n",
 		(unsigned int) N);
 
-	// Allocate memory for the arrays.
-	DSPSplitComplex Signal, Observed;
-	Signal.realp = malloc(N * SignalStride * sizeof Signal.realp);
-	Signal.imagp = malloc(N * SignalStride * sizeof Signal.imagp);
-	Observed.realp = malloc(N * ObservedStride * sizeof Observed.realp);
-	Observed.imagp = malloc(N * ObservedStride * sizeof Observed.imagp);
-
-	if (Signal.realp == NULL || Signal.imagp == NULL
-		|| Observed.realp == NULL || Observed.imagp == NULL)
-	{
-		fprintf(stderr, "Error, failed to allocate memory.\n");
-		exit(EXIT_FAILURE);
-	}
+	// Allocate memory for the arrays from the work arena.
+	DSPSplitComplex Signal = ArenaAllocateSplit(Work, N * SignalStride);
+	DSPSplitComplex Observed = ArenaAllocateSplit(Work, N * ObservedStride);
 
 	/*	Generate an input signal.  In a real application, data would of
 		course be provided from an image file, sensors, or other source.
@@ -574,17 +684,9 @@ static void DemonstratevDSP_fft_zop(FFTSetup Setup)
 	/*	Prepare expected results based on analytical transformation of
 		the input signal.
 	*/
-	DSPSplitComplex Expected;
-	Expected.realp = malloc(N * sizeof Expected.realp);
-	Expected.imagp = malloc(N * sizeof Expected.imagp);
-
-	if (Expected.realp == NULL || Expected.imagp == NULL)
-	{
-		fprintf(stderr, "Error, failed to allocate memory.\n");
-		exit(EXIT_FAILURE);
-	}
+	DSPSplitComplex Expected = ArenaAllocateSplit(Work, N);
 
-	for (i = 0; i < N/2; ++i)
+	for (i = 0; i < N; ++i)
 		Expected.realp[i] = Expected.imagp[i] = 0;
 
 	// Add the frequencies in the signal to the expected results.
@@ -600,57 +702,379 @@ static void DemonstratevDSP_fft_zop(FFTSetup Setup)
 	// Compare the observed results to the expected results.
 	CompareComplexVectors(Expected, Observed, N);
 
-	// Release memory.
-	free(Expected.realp);
-	free(Expected.imagp);
-
 	/*	The above shows how to use the vDSP_fft_zop routine.  Now we
 		will see how fast it is.
 	*/
 
-	// Time vDSP_fft_zop by itself.
+	/*	Time vDSP_fft_zop by itself.  It reads and writes N complex
+		elements.
+	*/
+	FFTArguments Arguments =
+	{
+		.Setup = Setup, .Signal = &Signal, .Observed = &Observed,
+		.SignalStride = SignalStride, .ObservedStride = ObservedStride,
+		.Log2Length = Log2N
+	};
+	R = Benchmark("vDSP_fft_zop 1024", TimeZop, &Arguments,
+		ComplexFFTFlops(Log2N), 4. * N * sizeof(float), N);
+	Time = R.Median;
+
+	printf("\tvDSP_fft_zop on %u elements takes %g microseconds.\n",
+		(unsigned int) N, Time * 1e6);
+	ReportBenchmark(&R);
+	ReportAVX2Comparison(&R, TimeZop, &Arguments);
+
+	// Release the arrays.
+	ResetArena(Work);
+}
+
 
-	t0 = Clock();
+/*	Demonstrate the multiple-signal real-to-complex FFT, vDSP_fftm_zrip,
+	and compare it with a loop of vDSP_fft_zrip calls.
 
-	for (i = 0; i < Iterations; ++i)
-		vDSP_fft_zop(Setup, &Signal, SignalStride, &Observed, ObservedStride,
-			Log2N, FFT_FORWARD);
+	Applications that process many channels at once, such as a bank of
+	DTMF decoders, transform many short frames of the same length.  With
+	short frames, the time of each vDSP_fft_zrip call is dominated by
+	overhead rather than arithmetic.  vDSP_fftm_zrip transforms all the
+	frames in one call, with the frames a fixed stride apart, and can
+	work on several frames at once.
+*/
+static void DemonstratevDSP_fftm_zrip(Arena *Work)
+{
+	// Use the frame length of the DTMF example.
+	const vDSP_Length
+		Log2FrameLength = 8,
+		FrameLength = 1u << Log2FrameLength,
+		Frames = 1024,
+		FrameStride = FrameLength/2,	// In complex elements.
+		Length = Frames * FrameStride;
 
-	t1 = Clock();
+	vDSP_Length i;
 
-	// Average the time over all the loop iterations.
-	Time = ClockToSeconds(t1, t0) / Iterations;
+	printf("\n\tMultiple real FFTs of %u frames of %u elements.\n",
+		(unsigned int) Frames, (unsigned int) FrameLength);
 
-	printf("\tvDSP_fft_zop on %u elements takes %g microseconds.\n",
-		(unsigned int) N, Time * 1e6);
+	FFTSetup Setup = AcquireFFTSetup(Log2FrameLength, FFT_RADIX2);
 
-	// Release resources.
-	free(Signal.realp);
-	free(Signal.imagp);
-	free(Observed.realp);
-	free(Observed.imagp);
+	DSPSplitComplex
+		Signal   = ArenaAllocateSplit(Work, Length),
+		Expected = ArenaAllocateSplit(Work, Length);
+
+	// Check vDSP_fftm_zrip against vDSP_fft_zrip on each frame.
+	for (i = 0; i < Length; ++i)
+	{
+		Signal.realp[i] = Expected.realp[i] = (float) (i * 7919 % 1009);
+		Signal.imagp[i] = Expected.imagp[i] =
+			(float) ((Length + i) * 7919 % 1009);
+	}
+
+	for (i = 0; i < Frames; ++i)
+	{
+		DSPSplitComplex Frame = { Expected.realp + i*FrameStride,
+			Expected.imagp + i*FrameStride };
+		vDSP_fft_zrip(Setup, &Frame, 1, Log2FrameLength, FFT_FORWARD);
+	}
+	vDSP_fftm_zrip(Setup, &Signal, 1, FrameStride, Log2FrameLength, Frames,
+		FFT_FORWARD);
+	CompareComplexVectors(Expected, Signal, Length);
+
+	// Zero the signal before timing, as in the other demonstrations.
+	for (i = 0; i < Length; ++i)
+		Signal.realp[i] = Signal.imagp[i] = 0;
+
+	FFTArguments Arguments =
+	{
+		.Setup = Setup, .Signal = &Signal, .SignalStride = 1,
+		.ObservedStride = 1, .Log2Length = Log2FrameLength, .Frames = Frames,
+		.FrameStride = FrameStride
+	};
+	const double
+		Flops = RealFFTFlops(Log2FrameLength) * Frames,
+		Bytes = 2. * FrameLength * Frames * sizeof(float),
+		Elements = (double) FrameLength * Frames;
+
+	// Time a loop of single-frame calls, and the batched call.
+	BenchmarkResult Loop = Benchmark("vDSP_fft_zrip 256 loop of 1024",
+		TimeZripLoop, &Arguments, Flops, Bytes, Elements);
+	BenchmarkResult Batch = Benchmark("vDSP_fftm_zrip 256 by 1024",
+		TimeFftmZrip, &Arguments, Flops, Bytes, Elements);
+
+	const double
+		LoopTime  = Loop.Median  / Frames,
+		BatchTime = Batch.Median / Frames;
+
+	printf("\tvDSP_fft_zrip in a loop takes %g microseconds per frame.\n",
+		LoopTime * 1e6);
+	ReportBenchmark(&Loop);
+	printf("\tvDSP_fftm_zrip takes %g microseconds per frame, "
+		"%.2f times as fast.\n", BatchTime * 1e6, LoopTime / BatchTime);
+	ReportBenchmark(&Batch);
+
+	ResetArena(Work);
+
+	ReleaseFFTSetup(Setup);
 }
 
 
-// Demonstrate vDSP FFT functions.
-void DemonstrateFFT(void)
+/*	Demonstrate complex FFTs of lengths that are not powers of two, with
+	ArbitraryFFT_zop, and compare their times with those of the padded
+	power-of-two FFTs an application might use instead.
+
+	Padding a signal with zeros to the next power of two is the usual way
+	to use a radix-2 FFT on other lengths, but it changes the result:  the
+	spectrum is sampled at different frequencies, and the padding costs
+	up to twice the work.  Lengths of 3 * 2**n and 5 * 2**n are handled
+	exactly by the radix-3 and radix-5 FFTs, at a cost close to that of a
+	radix-2 FFT of the same length.  Other lengths use Bluestein's
+	algorithm, which is exact too, but does two FFTs of at least twice
+	the padded length, so it is several times slower than padding; it is
+	for when the exact spectrum of an awkward length is needed.
+*/
+static void DemonstrateArbitraryFFT(Arena *Work)
+{
+	static const vDSP_Length Lengths[] =
+		{ 768, 1000, 1280, 1536, 1999, 3000, 3072, 5120 };
+	const vDSP_Length MaximumLength = 8192;
+
+	printf("\n\tComplex FFTs of lengths that are not powers of two.\n");
+
+	DSPSplitComplex Signal   = ArenaAllocateSplit(Work, MaximumLength);
+	DSPSplitComplex Observed = ArenaAllocateSplit(Work, MaximumLength);
+	DSPSplitComplex Expected = ArenaAllocateSplit(Work, MaximumLength);
+
+	printf("\n\t%6s  %-9s  %14s  %12s  %6s  %12s\n", "Length", "Method",
+		"Relative error", "Microseconds", "Padded", "Microseconds");
+
+	for (size_t l = 0; l < sizeof Lengths / sizeof *Lengths; ++l)
+	{
+		const vDSP_Length Length = Lengths[l];
+
+		ArbitraryFFTSetup Setup = CreateArbitraryFFTSetup(Length);
+		if (Setup == NULL)
+		{
+			fprintf(stderr, "Error, failed to create FFT setup.\n");
+			exit(EXIT_FAILURE);
+		}
+
+		/*	Generate a signal of three complex exponentials at whole
+			frequencies, whose spectrum is known exactly.
+		*/
+		const vDSP_Length Frequency[3] =
+			{ Length * 3 / 10, Length * 9 / 20, Length * 31 / 40 };
+		const float Phase[3] = { .3, .45f, .775f };
+
+		for (vDSP_Length i = 0; i < Length; ++i)
+		{
+			Signal.realp[i] = Signal.imagp[i] = 0;
+			Expected.realp[i] = Expected.imagp[i] = 0;
+		}
+		for (int f = 0; f < 3; ++f)
+		{
+			for (vDSP_Length i = 0; i < Length; ++i)
+			{
+				const double Angle = TwoPi *
+					((double) (i * Frequency[f] % Length) / Length + Phase[f]);
+				Signal.realp[i] += cos(Angle);
+				Signal.imagp[i] += sin(Angle);
+			}
+			Expected.realp[Frequency[f]] = Length * cos(Phase[f] * TwoPi);
+			Expected.imagp[Frequency[f]] = Length * sin(Phase[f] * TwoPi);
+		}
+
+		ArbitraryFFT_zop(Setup, &Signal, 1, &Observed, 1, FFT_FORWARD);
+
+		double Error = 0, Magnitude = 0;
+		for (vDSP_Length i = 0; i < Length; ++i)
+		{
+			const double re = Observed.realp[i] - Expected.realp[i];
+			const double im = Observed.imagp[i] - Expected.imagp[i];
+			Error += re*re + im*im;
+			Magnitude += Expected.realp[i] * Expected.realp[i]
+				+ Expected.imagp[i] * Expected.imagp[i];
+		}
+
+		// Time the transform and the padded power-of-two transform.
+		char Name[64];
+
+		ArbitraryFFTArguments Arguments = { Setup, &Signal, &Observed };
+		snprintf(Name, sizeof Name, "ArbitraryFFT_zop %lu",
+			(unsigned long) Length);
+		BenchmarkResult Exact = Benchmark(Name, TimeArbitraryZop,
+			&Arguments, 5. * Length * log2(Length),
+			4. * Length * sizeof(float), Length);
+		RecordBenchmark(&Exact);
+
+		vDSP_Length Log2Padded = 0;
+		while (((vDSP_Length) 1 << Log2Padded) < Length)
+			++Log2Padded;
+		const vDSP_Length Padded = (vDSP_Length) 1 << Log2Padded;
+
+		FFTSetup PaddedSetup = AcquireFFTSetup(Log2Padded, FFT_RADIX2);
+		FFTArguments PaddedArguments =
+		{
+			.Setup = PaddedSetup, .Signal = &Signal, .Observed = &Observed,
+			.SignalStride = 1, .ObservedStride = 1, .Log2Length = Log2Padded
+		};
+		snprintf(Name, sizeof Name, "vDSP_fft_zop %lu padded from %lu",
+			(unsigned long) Padded, (unsigned long) Length);
+		BenchmarkResult Pad = Benchmark(Name, TimeZop, &PaddedArguments,
+			ComplexFFTFlops(Log2Padded), 4. * Padded * sizeof(float),
+			Padded);
+		RecordBenchmark(&Pad);
+		ReleaseFFTSetup(PaddedSetup);
+
+		printf("\t%6lu  %-9s  %14.3g  %12.3f  %6lu  %12.3f\n",
+			(unsigned long) Length, ArbitraryFFTMethod(Setup),
+			sqrt(Error / Magnitude), Exact.Median * 1e6,
+			(unsigned long) Padded, Pad.Median * 1e6);
+
+		DestroyArbitraryFFTSetup(Setup);
+	}
+
+	ResetArena(Work);
+}
+
+
+/*	Time each one-dimensional FFT routine demonstrated above at every
+	length from 2**Minimum to 2**Maximum, and print a table of the times
+	per element and the rates in gigaflops.  Throughput steps down where
+	the data outgrow each level of cache, so a sweep shows where those
+	cliffs are on the machine it runs on.
+
+	A single setup, created for the greatest length, serves all lengths,
+	as a setup may be used for any length up to the one it was created
+	for.  The buffers are likewise allocated once, at the greatest
+	length, and zeroed, as in the demonstrations.
+*/
+void SweepFFT(unsigned Minimum, unsigned Maximum)
 {
 	printf("Begin %s.\n", __func__);
 
-	// Initialize data for the FFT routines.
-	FFTSetup Setup = vDSP_create_fftsetup(Log2N, FFT_RADIX2);
-	if (Setup == NULL)
+	FFTSetup Setup = AcquireFFTSetup(Maximum, FFT_RADIX2);
+
+	/*	Allocate room for complex signals of the greatest length, which
+		also hold real signals of that length, in both separated-data
+		and interleaved-data forms.  The largest buffers span many
+		pages, so ask for huge pages to spare the TLB.
+	*/
+	const vDSP_Length MaximumLength = (vDSP_Length) 1 << Maximum;
+	const size_t Bytes = MaximumLength * sizeof(float);
+	Arena *Work = CreateArena(8 * Bytes, ArenaHugePages);
+	DSPSplitComplex
+		Signal   = ArenaAllocateSplit(Work, MaximumLength),
+		Observed = ArenaAllocateSplit(Work, MaximumLength);
+	float *Interleaved = ArenaAllocate(Work, 2 * Bytes);
+
+	memset(Signal.realp,   0, Bytes); memset(Signal.imagp,   0, Bytes);
+	memset(Observed.realp, 0, Bytes); memset(Observed.imagp, 0, Bytes);
+	memset(Interleaved, 0, 2 * Bytes);
+
+	/*	Describe each routine:  its name, the routine that times it,
+		whether its data are complex, and how many floats it reads and
+		writes per element.
+	*/
+	static const struct
+	{
+		const char *Name;
+		BenchmarkRoutine *Routine;
+		int Complex;
+		double FloatsPerElement;
+	} Routines[] =
 	{
-		fprintf(stderr, "Error, vDSP_create_fftsetup failed.\n");
-		exit (EXIT_FAILURE);
+		{ "vDSP_fft_zrip",           TimeZrip,               0, 2 },
+		{ "vDSP_fft_zrip with ctoz", TimeZripWithConversion, 0, 6 },
+		{ "vDSP_fft_zrop",           TimeZrop,               0, 2 },
+		{ "vDSP_fft_zip",            TimeZip,                1, 4 },
+		{ "vDSP_fft_zop",            TimeZop,                1, 4 },
+		{ "InterleavedFFT_zrop",     TimeInterleavedZrop,    0, 2 },
+		{ "InterleavedFFT_zop",      TimeInterleavedZop,     1, 4 },
+	};
+
+	printf("\n\t%6s  %-23s  %12s  %9s\n",
+		"Log2N", "Routine", "ns/element", "Gigaflops");
+
+	for (vDSP_Length Log2Length = Minimum; Log2Length <= Maximum;
+		++Log2Length)
+	{
+		const vDSP_Length Length = (vDSP_Length) 1 << Log2Length;
+
+		// The Signal and Observed buffers are wide enough for any length.
+		FFTArguments Arguments =
+		{
+			.Setup = Setup, .Signal = &Signal, .Observed = &Observed,
+			.SignalStride = 1, .ObservedStride = 1, .Interleaved = Interleaved,
+			.Log2Length = Log2Length
+		};
+
+		for (size_t r = 0; r < sizeof Routines / sizeof *Routines; ++r)
+		{
+			/*	Use the conventional operation counts, 5 N log2 N for
+				complex FFTs and half that for real FFTs, so rates are
+				comparable across lengths and algorithms.
+			*/
+			const double Flops = Routines[r].Complex
+				? ComplexFFTFlops(Log2Length) : RealFFTFlops(Log2Length);
+
+			char Name[64];
+			snprintf(Name, sizeof Name, "%s %lu", Routines[r].Name,
+				(unsigned long) Length);
+			BenchmarkResult Result = Benchmark(Name, Routines[r].Routine,
+				&Arguments, Flops,
+				Routines[r].FloatsPerElement * Length * sizeof(float), Length);
+			RecordBenchmark(&Result);
+
+			printf("\t%6u  %-23s  %12.3f  %9.3g\n",
+				(unsigned int) Log2Length, Routines[r].Name,
+				Result.Median / Length * 1e9, Flops / Result.Median * 1e-9);
+		}
 	}
 
-	DemonstratevDSP_fft_zrip(Setup);
-	DemonstratevDSP_fft_zrop(Setup);
-	DemonstratevDSP_fft_zip(Setup);
-	DemonstratevDSP_fft_zop(Setup);
+	DestroyArena(Work);
+
+	ReleaseFFTSetup(Setup);
 
-	vDSP_destroy_fftsetup(Setup);
+	printf("\nEnd %s.\n\n\n", __func__);
+}
+
+
+// Demonstrate vDSP FFT functions.
+void DemonstrateFFT(void)
+{
+	printf("Begin %s.\n", __func__);
+
+	/*	Initialize data for the FFT routines.  An application that
+		uses one FFT size can simply call vDSP_create_fftsetup and
+		vDSP_destroy_fftsetup.  These examples use several sizes, so
+		they share setups through a registry (see FFTSetupRegistry.h),
+		which calls vDSP_create_fftsetup once for each setup it needs.
+	*/
+	FFTSetup Setup = AcquireFFTSetup(Log2N, FFT_RADIX2);
+
+	/*	Each demonstration takes its arrays from one arena and resets it
+		when done, so the memory is obtained from the system once, when
+		the arena is created, and reused from then on.  Neither the
+		demonstrations nor the timing loops allocate.
+	*/
+	Arena *Work = CreateArena((size_t) 4 << 20,
+		ArenaHugePages | ArenaFirstTouch);
+
+	DemonstratevDSP_fft_zrip(Setup, Work);
+	DemonstratevDSP_fft_zrop(Setup, Work);
+	DemonstratevDSP_fft_zip(Setup, Work);
+	DemonstratevDSP_fft_zop(Setup, Work);
+
+	ReleaseFFTSetup(Setup);
+
+	DemonstratevDSP_fftm_zrip(Work);
+	DemonstrateArbitraryFFT(Work);
+
+	const ArenaStatistics Statistics = GetArenaStatistics(Work);
+	printf("\n\tWork arena:  %lu allocations from %lu blocks of memory "
+		"(%lu bytes);\n\tat most %lu bytes were in use at once.\n",
+		Statistics.Allocations, Statistics.Blocks,
+		(unsigned long) Statistics.BlockBytes,
+		(unsigned long) Statistics.HighWater);
+	DestroyArena(Work);
 
 	printf("\nEnd %s.\n\n\n", __func__);
 }
@@ -9,14 +9,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
-#include <Accelerate/Accelerate.h>
+#include "PortableDSP.h"	// Accelerate, or the portable vDSP subset.
 
+#include "Benchmark.h"
 #include "Demonstrate.h"
+#include "FFTSetupRegistry.h"
+#include "OutOfCoreFFT2D.h"
+#include "ParallelFFT2D.h"
 
 
-#define Iterations	10000	// Number of iterations used in the timing loop.
-
 #define Log2R	5u		// Base-two logarithm of number of rows.
 #define Log2C	6u		// Base-two logarithm of number of columns.
 #define	R	(1u<<Log2R)	// Number of rows.
@@ -31,6 +34,97 @@ static const float_t TwoPi = 0x3.243f6a8885a308d313198a2e03707344ap1;
 #define	max(a, b)	((a) < (b) ? (b) : (a))
 
 
+/*	Hold the arguments of a two-dimensional FFT to be timed.  Benchmark
+	calls a routine with a single pointer, so each routine timed below
+	takes its arguments from one of these.
+*/
+typedef struct
+{
+	FFTSetup Setup;
+	DSPSplitComplex *Signal, *Observed;
+	vDSP_Stride SignalStride, ObservedStride;
+	float *Interleaved;	// Real signal for vDSP_ctoz and vDSP_ztoc.
+	vDSP_Length Log2Columns, Log2Rows;
+	ThreadPool *Pool;	// For the parallel routines.
+} FFT2DArguments;
+
+
+static void TimeZrip(void *Context)
+{
+	const FFT2DArguments *a = Context;
+	vDSP_fft2d_zrip(a->Setup, a->Signal, a->SignalStride, 0,
+		a->Log2Columns, a->Log2Rows, FFT_FORWARD);
+}
+
+
+static void TimeZripWithConversion(void *Context)
+{
+	const FFT2DArguments *a = Context;
+	const vDSP_Length H = (vDSP_Length) 1 << (a->Log2Columns + a->Log2Rows - 1);
+	vDSP_ctoz((DSPComplex *) a->Interleaved, 2, a->Signal, 1, H);
+	vDSP_fft2d_zrip(a->Setup, a->Signal, 1, 0, a->Log2Columns, a->Log2Rows,
+		FFT_FORWARD);
+	vDSP_ztoc(a->Signal, 1, (DSPComplex *) a->Interleaved, 2, H);
+}
+
+
+static void TimeZrop(void *Context)
+{
+	const FFT2DArguments *a = Context;
+	vDSP_fft2d_zrop(a->Setup, a->Signal, a->SignalStride, 0,
+		a->Observed, a->ObservedStride, 0, a->Log2Columns, a->Log2Rows,
+		FFT_FORWARD);
+}
+
+
+static void TimeZip(void *Context)
+{
+	const FFT2DArguments *a = Context;
+	vDSP_fft2d_zip(a->Setup, a->Signal, a->SignalStride, 0,
+		a->Log2Columns, a->Log2Rows, FFT_FORWARD);
+}
+
+
+static void TimeZop(void *Context)
+{
+	const FFT2DArguments *a = Context;
+	vDSP_fft2d_zop(a->Setup, a->Signal, a->SignalStride, 0,
+		a->Observed, a->ObservedStride, 0, a->Log2Columns, a->Log2Rows,
+		FFT_FORWARD);
+}
+
+
+static void TimeParallelZip(void *Context)
+{
+	const FFT2DArguments *a = Context;
+	ParallelFFT2D_zip(a->Pool, a->Setup, a->Signal, a->SignalStride, 0,
+		a->Log2Columns, a->Log2Rows, FFT_FORWARD);
+}
+
+
+static void TimeParallelZrip(void *Context)
+{
+	const FFT2DArguments *a = Context;
+	ParallelFFT2D_zrip(a->Pool, a->Setup, a->Signal, a->SignalStride, 0,
+		a->Log2Columns, a->Log2Rows, FFT_FORWARD);
+}
+
+
+/*	Return the conventional operation counts of two-dimensional FFTs of
+	2**Log2Elements elements, 5 * Elements * Log2Elements for a complex
+	FFT and half that for a real FFT.
+*/
+static double ComplexFFTFlops(vDSP_Length Log2Elements)
+{
+	return 5. * ((vDSP_Length) 1 << Log2Elements) * Log2Elements;
+}
+
+static double RealFFTFlops(vDSP_Length Log2Elements)
+{
+	return ComplexFFTFlops(Log2Elements) / 2;
+}
+
+
 /*	Compare two complex vectors and report the relative error between them.
 	(The vectors must have unit strides; other strides are not supported.)
 */
@@ -115,10 +209,10 @@ static void DemonstratevDSP_fft2d_zrip(FFTSetup Setup)
 	const vDSP_Stride Stride = 1;
 
 	// Define variables for loop iterators.
-	vDSP_Length i, r, c;
+	vDSP_Length r, c;
 
 	// Define some variables used to time the routine.
-	ClockData t0, t1;
+	BenchmarkResult Measured;
 	double Time;
 
 	printf("\n\tTwo-dimensional real FFT of %u*%u elements.\n",
@@ -259,45 +353,38 @@ static void DemonstratevDSP_fft2d_zrip(FFTSetup Setup)
 		for (c = 0; c < C; ++c)
 			Signal[r*C + c] = 0;
 
-	// Time vDSP_fft2d_zrip by itself.
-
-	t0 = Clock();
-
-	for (i = 0; i < Iterations; ++i)
-		vDSP_fft2d_zrip(Setup, &Observed, 1, 0, Log2C, Log2R,
-			FFT_FORWARD);
-
-	t1 = Clock();
-
-	// Average the time over all the loop iterations.
-	Time = ClockToSeconds(t1, t0) / Iterations;
+	FFT2DArguments Arguments =
+	{
+		.Setup = Setup, .Signal = &Observed, .SignalStride = 1,
+		.ObservedStride = 1, .Interleaved = Signal, .Log2Columns = Log2C,
+		.Log2Rows = Log2R
+	};
+
+	/*	Time vDSP_fft2d_zrip by itself.  Benchmark calls the routine
+		repeatedly and reports statistics of the times; we report the
+		median.  It reads and writes N floats.
+	*/
+	Measured = Benchmark("vDSP_fft2d_zrip 32*64", TimeZrip, &Arguments,
+		RealFFTFlops(Log2R + Log2C), 2. * N * sizeof(float), N);
+	Time = Measured.Median;
 
 	printf("\tvDSP_fft2d_zrip on %u*%u elements takes %g microseconds.\n",
 		(unsigned int) R, (unsigned int) C, Time * 1e6);
+	ReportBenchmark(&Measured);
 
 	/*	Time vDSP_fft2d_zrip with the vDSP_ctoz and vDSP_ztoc
-		transformations.
+		transformations, which read and write N floats each too.
 	*/
-
-	t0 = Clock();
-
-	for (i = 0; i < Iterations; ++i)
-	{
-		vDSP_ctoz((DSPComplex *) Signal, 2*Stride, &Observed, 1, N/2);
-		vDSP_fft2d_zrip(Setup, &Observed, 1, 0, Log2C, Log2R,
-			FFT_FORWARD);
-		vDSP_ztoc(&Observed, 1, (DSPComplex *) Signal, 2*Stride, N/2);
-	}
-
-	t1 = Clock();
-
-	// Average the time over all the loop iterations.
-	Time = ClockToSeconds(t1, t0) / Iterations;
+	Measured = Benchmark("vDSP_fft2d_zrip 32*64 with ctoz and ztoc",
+		TimeZripWithConversion, &Arguments,
+		RealFFTFlops(Log2R + Log2C), 6. * N * sizeof(float), N);
+	Time = Measured.Median;
 
 	printf(
 		"\tvDSP_fft2d_zrip with vDSP_ctoz and vDSP_ztoc takes "
 		"%g microseconds.\n",
 		Time * 1e6);
+	ReportBenchmark(&Measured);
 
 	// Release resources.
 	free(ObservedMemory);
@@ -325,10 +412,10 @@ static void DemonstratevDSP_fft2d_zrop(FFTSetup Setup)
 	const vDSP_Stride Stride = 1;
 
 	// Define variables for loop iterators.
-	vDSP_Length i, r, c;
+	vDSP_Length r, c;
 
 	// Define some variables used to time the routine.
-	ClockData t0, t1;
+	BenchmarkResult Measured;
 	double Time;
 
 	printf("\n\tTwo-dimensional real FFT of %u*%u elements.\n",
@@ -474,21 +561,20 @@ static void DemonstratevDSP_fft2d_zrop(FFTSetup Setup)
 		for (c = 0; c < C; ++c)
 			Signal[r*C + c] = 0;
 
-	// Time vDSP_fft2d_zrop by itself.
-
-	t0 = Clock();
-
-	for (i = 0; i < Iterations; ++i)
-		vDSP_fft2d_zrop(Setup, &Buffer, 1, 0, &Observed, 1, 0,
-			Log2C, Log2R, FFT_FORWARD);
-
-	t1 = Clock();
-
-	// Average the time over all the loop iterations.
-	Time = ClockToSeconds(t1, t0) / Iterations;
+	// Time vDSP_fft2d_zrop by itself.  It reads and writes N floats.
+	FFT2DArguments Arguments =
+	{
+		.Setup = Setup, .Signal = &Buffer, .Observed = &Observed,
+		.SignalStride = 1, .ObservedStride = 1, .Log2Columns = Log2C,
+		.Log2Rows = Log2R
+	};
+	Measured = Benchmark("vDSP_fft2d_zrop 32*64", TimeZrop, &Arguments,
+		RealFFTFlops(Log2R + Log2C), 2. * N * sizeof(float), N);
+	Time = Measured.Median;
 
 	printf("\tvDSP_fft2d_zrop on %u*%u elements takes %g microseconds.\n",
 		(unsigned int) R, (unsigned int) C, Time * 1e6);
+	ReportBenchmark(&Measured);
 
 	/*	Unlike the vDSP_fft2d_zrip example, we do not time
 		vDSP_fft2d_zrop in conjunction with vDSP_ctoz and vDSP_ztoc.
@@ -524,7 +610,7 @@ static void DemonstratevDSP_fft2d_zip(FFTSetup Setup)
 	vDSP_Length i, r, c;
 
 	// Define some variables used to time the routine.
-	ClockData t0, t1;
+	BenchmarkResult Measured;
 	double Time;
 
 	printf("\n\tTwo-dimensional complex FFT of %u*%u elements.\n",
@@ -612,21 +698,21 @@ static void DemonstratevDSP_fft2d_zip(FFTSetup Setup)
 	for (i = 0; i < N; ++i)
 		Signal.realp[i] = Signal.imagp[i] = 0;
 
-	// Time vDSP_fft2d_zip by itself.
-
-	t0 = Clock();
-
-	for (i = 0; i < Iterations; ++i)
-		vDSP_fft2d_zip(Setup, &Signal, SignalStride, 0,
-			Log2C, Log2R, FFT_FORWARD);
-
-	t1 = Clock();
-
-	// Average the time over all the loop iterations.
-	Time = ClockToSeconds(t1, t0) / Iterations;
+	/*	Time vDSP_fft2d_zip by itself.  It reads and writes N complex
+		elements.
+	*/
+	FFT2DArguments Arguments =
+	{
+		.Setup = Setup, .Signal = &Signal, .SignalStride = SignalStride,
+		.ObservedStride = 1, .Log2Columns = Log2C, .Log2Rows = Log2R
+	};
+	Measured = Benchmark("vDSP_fft2d_zip 32*64", TimeZip, &Arguments,
+		ComplexFFTFlops(Log2R + Log2C), 4. * N * sizeof(float), N);
+	Time = Measured.Median;
 
 	printf("\tvDSP_fft2d_zip on %u*%u elements takes %g microseconds.\n",
 		(unsigned int) R, (unsigned int) C, Time * 1e6);
+	ReportBenchmark(&Measured);
 
 	// Release resources.
 	free(Signal.realp);
@@ -652,7 +738,7 @@ static void DemonstratevDSP_fft2d_zop(FFTSetup Setup)
 	vDSP_Length i, r, c;
 
 	// Define some variables used to time the routine.
-	ClockData t0, t1;
+	BenchmarkResult Measured;
 	double Time;
 
 	printf("\n\tTwo-dimensional complex FFT of %u*%u elements.\n",
@@ -736,22 +822,22 @@ static void DemonstratevDSP_fft2d_zop(FFTSetup Setup)
 		will see how fast it is.
 	*/
 
-	// Time vDSP_fft2d_zop by itself.
-
-	t0 = Clock();
-
-	for (i = 0; i < Iterations; ++i)
-		vDSP_fft2d_zop(Setup, &Signal, SignalStride, 0,
-			&Observed, ObservedStride, 0, Log2C, Log2R,
-			FFT_FORWARD);
-
-	t1 = Clock();
-
-	// Average the time over all the loop iterations.
-	Time = ClockToSeconds(t1, t0) / Iterations;
+	/*	Time vDSP_fft2d_zop by itself.  It reads and writes N complex
+		elements.
+	*/
+	FFT2DArguments Arguments =
+	{
+		.Setup = Setup, .Signal = &Signal, .Observed = &Observed,
+		.SignalStride = SignalStride, .ObservedStride = ObservedStride,
+		.Log2Columns = Log2C, .Log2Rows = Log2R
+	};
+	Measured = Benchmark("vDSP_fft2d_zop 32*64", TimeZop, &Arguments,
+		ComplexFFTFlops(Log2R + Log2C), 4. * N * sizeof(float), N);
+	Time = Measured.Median;
 
 	printf("\tvDSP_fft2d_zop on %u*%u elements takes %g microseconds.\n",
 		(unsigned int) R, (unsigned int) C, Time * 1e6);
+	ReportBenchmark(&Measured);
 
 	// Release resources.
 	free(Signal.realp);
@@ -761,6 +847,375 @@ static void DemonstratevDSP_fft2d_zop(FFTSetup Setup)
 }
 
 
+/*	Measure how ParallelFFT2D_zip and ParallelFFT2D_zrip scale with the
+	number of threads on an image of the size used in imaging
+	applications.
+
+	For each thread count, a pool of that many threads is created and
+	each routine is timed on it.  Speedup is relative to the same routine
+	on one thread.  vDSP_fft2d_zip and vDSP_fft2d_zrip are timed too, for
+	reference.  Thread counts are powers of two up to 16 (and the number
+	of processors, if that is not a power of two), limited to the number
+	of processors, since more threads than processors cannot help.
+*/
+static void DemonstrateParallelFFT2D(void)
+{
+	const vDSP_Length
+		Log2Rows = 12, Log2Columns = 12,
+		Rows = 1u << Log2Rows, Columns = 1u << Log2Columns,
+		Elements = Rows * Columns;
+
+	vDSP_Length i;
+
+	printf("\n\tScaling of two-dimensional FFTs of %u*%u elements.\n",
+		(unsigned int) Rows, (unsigned int) Columns);
+
+	FFTSetup Setup = AcquireFFTSetup(max(Log2Rows, Log2Columns),
+		FFT_RADIX2);
+
+	float *SignalMemory   = malloc(2 * Elements * sizeof *SignalMemory);
+	float *ExpectedMemory = malloc(2 * Elements * sizeof *ExpectedMemory);
+	if (SignalMemory == NULL || ExpectedMemory == NULL)
+	{
+		fprintf(stderr, "Error, failed to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+	DSPSplitComplex
+		Signal   = { SignalMemory,   SignalMemory   + Elements },
+		Expected = { ExpectedMemory, ExpectedMemory + Elements };
+
+	/*	Check that the parallel routine gives the same results as the
+		vDSP routine on arbitrary data.
+	*/
+	for (i = 0; i < 2 * Elements; ++i)
+		SignalMemory[i] = ExpectedMemory[i] = (float) (i * 7919 % 1009);
+
+	vDSP_fft2d_zip(Setup, &Expected, 1, 0, Log2Columns, Log2Rows,
+		FFT_FORWARD);
+	ParallelFFT2D_zip(NULL, Setup, &Signal, 1, 0, Log2Columns, Log2Rows,
+		FFT_FORWARD);
+	CompareComplexVectors(Expected, Signal, Elements);
+
+	/*	Check the real-to-complex routine the same way, in both
+		directions.  The Elements real elements are stored as
+		Elements/2 complex elements.  The inverse transforms start from
+		the same data, vDSP's forward results.
+	*/
+	DSPSplitComplex
+		RealSignal   = { SignalMemory,   SignalMemory   + Elements/2 },
+		RealExpected = { ExpectedMemory, ExpectedMemory + Elements/2 };
+
+	for (i = 0; i < Elements; ++i)
+		SignalMemory[i] = ExpectedMemory[i] = (float) (i * 7919 % 1009);
+
+	vDSP_fft2d_zrip(Setup, &RealExpected, 1, 0, Log2Columns, Log2Rows,
+		FFT_FORWARD);
+	ParallelFFT2D_zrip(NULL, Setup, &RealSignal, 1, 0, Log2Columns,
+		Log2Rows, FFT_FORWARD);
+	CompareComplexVectors(RealExpected, RealSignal, Elements/2);
+
+	for (i = 0; i < Elements; ++i)
+		SignalMemory[i] = ExpectedMemory[i];
+
+	vDSP_fft2d_zrip(Setup, &RealExpected, 1, 0, Log2Columns, Log2Rows,
+		FFT_INVERSE);
+	ParallelFFT2D_zrip(NULL, Setup, &RealSignal, 1, 0, Log2Columns,
+		Log2Rows, FFT_INVERSE);
+	CompareComplexVectors(RealExpected, RealSignal, Elements/2);
+
+	free(ExpectedMemory);
+
+	// Zero the signal before timing, as above.
+	for (i = 0; i < 2 * Elements; ++i)
+		SignalMemory[i] = 0;
+
+	/*	Each transform reads and writes every element, for the complex
+		transform, or half of them, for the real one.
+	*/
+	const double
+		ComplexFlops = ComplexFFTFlops(Log2Rows + Log2Columns),
+		RealFlops = RealFFTFlops(Log2Rows + Log2Columns),
+		ComplexBytes = 4. * Elements * sizeof(float),
+		RealBytes = 2. * Elements * sizeof(float);
+
+	FFT2DArguments Arguments =
+	{
+		.Setup = Setup, .Signal = &Signal, .SignalStride = 1,
+		.ObservedStride = 1, .Log2Columns = Log2Columns, .Log2Rows = Log2Rows
+	};
+
+	BenchmarkResult
+		vDSPComplex = Benchmark("vDSP_fft2d_zip 4096*4096", TimeZip,
+			&Arguments, ComplexFlops, ComplexBytes, Elements),
+		vDSPReal = Benchmark("vDSP_fft2d_zrip 4096*4096", TimeZrip,
+			&Arguments, RealFlops, RealBytes, Elements);
+
+	printf("\tvDSP_fft2d_zip takes %g milliseconds, "
+		"vDSP_fft2d_zrip takes %g.\n",
+		vDSPComplex.Median * 1e3, vDSPReal.Median * 1e3);
+	ReportBenchmark(&vDSPComplex);
+	ReportBenchmark(&vDSPReal);
+	printf("\n");
+
+	printf("\t%7s  %16s  %7s  %17s  %7s\n",
+		"Threads", "zip milliseconds", "Speedup",
+		"zrip milliseconds", "Speedup");
+
+	const long Processors = sysconf(_SC_NPROCESSORS_ONLN);
+	double ComplexTime1 = 0, RealTime1 = 0;
+
+	for (long Threads = 1; Threads <= Processors; )
+	{
+		Arguments.Pool = CreateThreadPool((unsigned) Threads);
+
+		char Name[64];
+		snprintf(Name, sizeof Name, "ParallelFFT2D_zip 4096*4096 %ld",
+			Threads);
+		BenchmarkResult Complex = Benchmark(Name, TimeParallelZip,
+			&Arguments, ComplexFlops, ComplexBytes, Elements);
+		RecordBenchmark(&Complex);
+		snprintf(Name, sizeof Name, "ParallelFFT2D_zrip 4096*4096 %ld",
+			Threads);
+		BenchmarkResult Real = Benchmark(Name, TimeParallelZrip,
+			&Arguments, RealFlops, RealBytes, Elements);
+		RecordBenchmark(&Real);
+
+		DestroyThreadPool(Arguments.Pool);
+
+		// Report the median times.
+		const double ComplexTime = Complex.Median, RealTime = Real.Median;
+
+		if (Threads == 1)
+		{
+			ComplexTime1 = ComplexTime;
+			RealTime1 = RealTime;
+		}
+
+		printf("\t%7ld  %16.3f  %7.2f  %17.3f  %7.2f\n", Threads,
+			ComplexTime * 1e3, ComplexTime1 / ComplexTime,
+			RealTime * 1e3, RealTime1 / RealTime);
+
+		// Go to the next power of two, or to the number of processors.
+		if (Threads < 16 && Processors < 2*Threads && Threads < Processors)
+			Threads = Processors;
+		else if (Threads < 16)
+			Threads *= 2;
+		else
+			break;
+	}
+
+	free(SignalMemory);
+
+	ReleaseFFTSetup(Setup);
+}
+
+
+/*	Demonstrate OutOfCoreFFT2D_zop, which transforms an array in a file,
+	for arrays too large for memory, and compare it with vDSP_fft2d_zop
+	on arrays that fit.
+
+	The out-of-core routine is told it may use only an eighth of the
+	array's size in memory, so it works on eight or more panels and
+	strips, as it would on a larger array.  Each file is written, and
+	then read while it is still in the system's cache, so the rates
+	show the routine's own costs rather than the disk's; on an array
+	larger than memory, the disk's sequential rate bounds them.
+*/
+static void DemonstrateOutOfCoreFFT2D(void)
+{
+	printf("\n\tOut-of-core two-dimensional FFTs.\n");
+	printf("\t%11s  %10s  %12s  %12s  %12s\n", "Size", "MiB",
+		"In memory ms", "Files ms", "Files MB/s");
+
+	// Put the files in the temporary directory.
+	const char *Directory = getenv("TMPDIR");
+	if (Directory == NULL)
+		Directory = "/tmp";
+	char Input[256], Scratch[256], Output[256];
+	snprintf(Input,   sizeof Input,   "%s/vDSPExamples.%d.input",
+		Directory, (int) getpid());
+	snprintf(Scratch, sizeof Scratch, "%s/vDSPExamples.%d.scratch",
+		Directory, (int) getpid());
+	snprintf(Output,  sizeof Output,  "%s/vDSPExamples.%d.output",
+		Directory, (int) getpid());
+
+	for (vDSP_Length Log2Side = 10; Log2Side <= 11; ++Log2Side)
+	{
+		const vDSP_Length
+			Side = (vDSP_Length) 1 << Log2Side,
+			Elements = Side * Side;
+		const size_t Size = 2 * Elements * sizeof(float);
+		vDSP_Length i;
+
+		FFTSetup Setup = AcquireFFTSetup(Log2Side, FFT_RADIX2);
+
+		float *SignalMemory   = malloc(Size);
+		float *ExpectedMemory = malloc(Size);
+		if (SignalMemory == NULL || ExpectedMemory == NULL)
+		{
+			fprintf(stderr, "Error, failed to allocate memory.\n");
+			exit(EXIT_FAILURE);
+		}
+		DSPSplitComplex
+			Signal   = { SignalMemory,   SignalMemory   + Elements },
+			Expected = { ExpectedMemory, ExpectedMemory + Elements };
+
+		for (i = 0; i < 2 * Elements; ++i)
+			SignalMemory[i] = (float) (i * 7919 % 1009);
+
+		// Write the signal to the input file.
+		FILE *File = fopen(Input, "wb");
+		if (File == NULL || fwrite(SignalMemory, 1, Size, File) != Size
+			|| fclose(File) != 0)
+		{
+			fprintf(stderr, "Error, unable to write %s.\n", Input);
+			exit(EXIT_FAILURE);
+		}
+
+		// Time the transform in memory.
+		ClockData t0 = Clock();
+		vDSP_fft2d_zop(Setup, &Signal, 1, 0, &Expected, 1, 0,
+			Log2Side, Log2Side, FFT_FORWARD);
+		ClockData t1 = Clock();
+		const double MemoryTime = ClockToSeconds(t1, t0);
+
+		// Time the transform from file to file.
+		t0 = Clock();
+		OutOfCoreFFT2D_zop(Setup, Input, Scratch, Output,
+			Log2Side, Log2Side, FFT_FORWARD, Size / 8);
+		t1 = Clock();
+		const double FileTime = ClockToSeconds(t1, t0);
+
+		// The routine reads and writes six times the array's size.
+		char Dimensions[32];
+		snprintf(Dimensions, sizeof Dimensions, "%lu*%lu",
+			(unsigned long) Side, (unsigned long) Side);
+		printf("\t%11s  %10.0f  %12.3f  %12.3f  %12.0f\n",
+			Dimensions, Size / 1048576., MemoryTime * 1e3, FileTime * 1e3,
+			6. * Size / FileTime * 1e-6);
+
+		// Read the output file and compare it with the in-memory result.
+		File = fopen(Output, "rb");
+		if (File == NULL || fread(SignalMemory, 1, Size, File) != Size)
+		{
+			fprintf(stderr, "Error, unable to read %s.\n", Output);
+			exit(EXIT_FAILURE);
+		}
+		fclose(File);
+		CompareComplexVectors(Expected, Signal, Elements);
+
+		free(ExpectedMemory);
+		free(SignalMemory);
+
+		ReleaseFFTSetup(Setup);
+	}
+
+	remove(Input);
+	remove(Scratch);
+	remove(Output);
+}
+
+
+/*	Time each two-dimensional FFT routine demonstrated above at every
+	size from 2**Minimum to 2**Maximum elements, and print a table of the
+	times per element and the rates in gigaflops.  Each size is split
+	between the dimensions as evenly as possible, with any extra factor
+	of two in the columns.
+
+	As in SweepFFT, one setup, created for the longest dimension, and one
+	set of buffers serve all sizes.
+*/
+void SweepFFT2D(unsigned Minimum, unsigned Maximum)
+{
+	printf("Begin %s.\n", __func__);
+
+	FFTSetup Setup = AcquireFFTSetup((Maximum + 1) / 2, FFT_RADIX2);
+
+	const vDSP_Length MaximumElements = (vDSP_Length) 1 << Maximum;
+	float *SignalMemory   = calloc(2 * MaximumElements, sizeof *SignalMemory);
+	float *ObservedMemory = calloc(2 * MaximumElements,
+		sizeof *ObservedMemory);
+	float *Interleaved    = calloc(MaximumElements, sizeof *Interleaved);
+	if (SignalMemory == NULL || ObservedMemory == NULL || Interleaved == NULL)
+	{
+		fprintf(stderr, "Error, failed to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+	DSPSplitComplex
+		Signal   = { SignalMemory,   SignalMemory   + MaximumElements },
+		Observed = { ObservedMemory, ObservedMemory + MaximumElements };
+
+	/*	Describe each routine:  its name, the routine that times it,
+		whether its data are complex, and how many floats it reads and
+		writes per element.
+	*/
+	static const struct
+	{
+		const char *Name;
+		BenchmarkRoutine *Routine;
+		int Complex;
+		double FloatsPerElement;
+	} Routines[] =
+	{
+		{ "vDSP_fft2d_zrip",           TimeZrip,               0, 2 },
+		{ "vDSP_fft2d_zrip with ctoz", TimeZripWithConversion, 0, 6 },
+		{ "vDSP_fft2d_zrop",           TimeZrop,               0, 2 },
+		{ "vDSP_fft2d_zip",            TimeZip,                1, 4 },
+		{ "vDSP_fft2d_zop",            TimeZop,                1, 4 },
+	};
+
+	printf("\n\t%11s  %-25s  %12s  %9s\n",
+		"Size", "Routine", "ns/element", "Gigaflops");
+
+	for (vDSP_Length Log2Elements = Minimum; Log2Elements <= Maximum;
+		++Log2Elements)
+	{
+		const vDSP_Length
+			Log2Columns = (Log2Elements + 1) / 2,
+			Log2Rows = Log2Elements / 2,
+			Elements = (vDSP_Length) 1 << Log2Elements;
+
+		FFT2DArguments Arguments =
+		{
+			.Setup = Setup, .Signal = &Signal, .Observed = &Observed,
+			.SignalStride = 1, .ObservedStride = 1, .Interleaved = Interleaved,
+			.Log2Columns = Log2Columns, .Log2Rows = Log2Rows
+		};
+
+		for (size_t r = 0; r < sizeof Routines / sizeof *Routines; ++r)
+		{
+			// Use the conventional operation counts, as in SweepFFT.
+			const double Flops = Routines[r].Complex
+				? ComplexFFTFlops(Log2Elements)
+				: RealFFTFlops(Log2Elements);
+
+			char Name[64], Size[48];
+			snprintf(Size, sizeof Size, "%lu*%lu",
+				(unsigned long) 1 << Log2Rows,
+				(unsigned long) 1 << Log2Columns);
+			snprintf(Name, sizeof Name, "%s %s", Routines[r].Name, Size);
+			BenchmarkResult Result = Benchmark(Name, Routines[r].Routine,
+				&Arguments, Flops,
+				Routines[r].FloatsPerElement * Elements * sizeof(float),
+				Elements);
+			RecordBenchmark(&Result);
+
+			printf("\t%11s  %-25s  %12.3f  %9.3g\n",
+				Size, Routines[r].Name,
+				Result.Median / Elements * 1e9, Flops / Result.Median * 1e-9);
+		}
+	}
+
+	free(Interleaved);
+	free(ObservedMemory);
+	free(SignalMemory);
+
+	ReleaseFFTSetup(Setup);
+
+	printf("\nEnd %s.\n\n\n", __func__);
+}
+
+
 // Demonstrate vDSP FFT functions.
 void DemonstrateFFT2D(void)
 {
@@ -770,19 +1225,18 @@ void DemonstrateFFT2D(void)
 		length we will use, in either dimension, is passed to the
 		setup.
 	*/
-	FFTSetup Setup = vDSP_create_fftsetup(max(Log2R, Log2C), FFT_RADIX2);
-	if (Setup == NULL)
-	{
-		fprintf(stderr, "Error, vDSP_create_fftsetup failed.\n");
-		exit (EXIT_FAILURE);
-	}
+	FFTSetup Setup = AcquireFFTSetup(max(Log2R, Log2C), FFT_RADIX2);
 
 	DemonstratevDSP_fft2d_zrip(Setup);
 	DemonstratevDSP_fft2d_zrop(Setup);
 	DemonstratevDSP_fft2d_zip(Setup);
 	DemonstratevDSP_fft2d_zop(Setup);
 
-	vDSP_destroy_fftsetup(Setup);
+	ReleaseFFTSetup(Setup);
+
+	DemonstrateParallelFFT2D();
+
+	DemonstrateOutOfCoreFFT2D();
 
 	printf("\nEnd %s.\n\n\n", __func__);
 }
@@ -0,0 +1,121 @@
+/*	This module measures how the placement of FFT data on the nodes of a
+	NUMA machine affects the speed of the FFT.
+
+	A worker thread is bound to each node in turn, and for each, the FFT
+	setup and signal are placed on each node in turn, so the table shows
+	the throughput with local memory and with the memory of every other
+	node.  The data are large enough not to fit in cache, as in a server
+	processing many channels.
+
+	Copyright (C) 2007 Apple Inc.  All rights reserved.
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "PortableDSP.h"	// Accelerate, or the portable vDSP subset.
+
+#include "Arena.h"
+#include "Benchmark.h"
+#include "Demonstrate.h"
+#include "FFTSetupRegistry.h"
+#include "NUMA.h"
+
+
+/*	Use frames of the one-dimensional FFT demonstration's length, enough
+	of them to fill 16 MiB.
+*/
+#define	Log2FrameLength	10u
+#define	FrameLength		(1u << Log2FrameLength)
+#define	Frames			4096u
+
+
+// Hold the arguments of the frames to be timed.
+typedef struct
+{
+	FFTSetup Setup;
+	DSPSplitComplex Signal;
+} NUMAArguments;
+
+
+// Transform every frame in place.
+static void TimeFrames(void *Context)
+{
+	const NUMAArguments *a = Context;
+	for (vDSP_Length i = 0; i < Frames; ++i)
+	{
+		DSPSplitComplex Frame = { a->Signal.realp + i*FrameLength/2,
+			a->Signal.imagp + i*FrameLength/2 };
+		vDSP_fft_zrip(a->Setup, &Frame, 1, Log2FrameLength, FFT_FORWARD);
+	}
+}
+
+
+void DemonstrateNUMA(void)
+{
+	printf("Begin %s.\n", __func__);
+
+	const unsigned Nodes = NUMANodes();
+	printf("\n\tNUMA support is %s; there %s %u node%s.\n",
+		NUMASupport(), Nodes == 1 ? "is" : "are", Nodes,
+		Nodes == 1 ? "" : "s");
+	if (Nodes == 1)
+		printf("\tAll memory is local, so there is no remote time to "
+			"compare.\n");
+
+	const vDSP_Length Length = (vDSP_Length) FrameLength / 2 * Frames;
+	const double
+		Flops = 2.5 * FrameLength * Log2FrameLength * Frames,
+		Bytes = 2. * FrameLength * Frames * sizeof(float),
+		Elements = (double) FrameLength * Frames;
+
+	printf("\n\t%6s  %6s  %-6s  %12s  %9s\n",
+		"Worker", "Memory", "", "ns/element", "GB/s");
+
+	for (unsigned Memory = 0; Memory < Nodes; ++Memory)
+	{
+		/*	Bind to the memory node while acquiring the setup and
+			creating the arena, so the registry returns (creating if
+			need be) that node's replica of the setup, and the arena's
+			pages are touched, and so placed, there.
+		*/
+		if (!BindThreadToNUMANode(Memory))
+			continue;
+
+		NUMAArguments Arguments;
+		Arguments.Setup = AcquireFFTSetup(Log2FrameLength, FFT_RADIX2);
+		Arena *Work = CreateArena(2 * Length * sizeof(float) + 8192,
+			ArenaFirstTouch);
+		Arguments.Signal = ArenaAllocateSplit(Work, Length);
+		memset(Arguments.Signal.realp, 0, Length * sizeof(float));
+		memset(Arguments.Signal.imagp, 0, Length * sizeof(float));
+
+		// Time a worker on each node with the data on this node.
+		for (unsigned Worker = 0; Worker < Nodes; ++Worker)
+		{
+			if (!BindThreadToNUMANode(Worker))
+				continue;
+
+			char Name[96];
+			snprintf(Name, sizeof Name,
+				"vDSP_fft_zrip 1024 by 4096 on node %u from node %u",
+				Worker, Memory);
+			BenchmarkResult Result = Benchmark(Name, TimeFrames,
+				&Arguments, Flops, Bytes, Elements);
+			RecordBenchmark(&Result);
+
+			printf("\t%6u  %6u  %-6s  %12.3f  %9.3g\n",
+				Worker, Memory, Worker == Memory ? "local" : "remote",
+				Result.Median / Elements * 1e9,
+				Bytes / Result.Median * 1e-9);
+		}
+
+		DestroyArena(Work);
+		ReleaseFFTSetup(Arguments.Setup);
+	}
+
+	BindThreadToNUMANode(AnyNUMANode);
+
+	printf("\nEnd %s.\n\n\n", __func__);
+}
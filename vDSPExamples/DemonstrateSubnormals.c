@@ -0,0 +1,169 @@
+/*	This module measures the cost of subnormal numbers in vDSP_conv and
+	vDSP_fft_zop, in conformant and in fast math mode (see MathMode.h).
+
+	Each routine is timed with ordinary data and with tiny data, just
+	above the least normal number, as in the tail of a decaying signal:
+	the products and many of the sums are subnormal.  In conformant mode,
+	the tiny data may be many times slower, depending on the processor;
+	in fast mode, subnormal results are replaced by zeros and the times
+	match.  The module also checks that the tasks of a thread
+	pool run in the pool's mode.
+
+	Copyright (C) 2007 Apple Inc.  All rights reserved.
+*/
+
+
+#include <math.h>
+#include <stdio.h>
+
+#include "PortableDSP.h"	// Accelerate, or the portable vDSP subset.
+
+#include "Arena.h"
+#include "Benchmark.h"
+#include "Demonstrate.h"
+#include "FFTSetupRegistry.h"
+#include "MathMode.h"
+#include "ThreadPool.h"
+
+
+#define	Log2N			10u
+#define	N				(1u << Log2N)	// Results and FFT length.
+#define	FilterLength	64u
+
+
+// Hold the arguments of the routines to be timed.
+typedef struct
+{
+	FFTSetup Setup;
+	const float *Signal, *Filter;
+	float *Result;
+	DSPSplitComplex Input, Output;
+} SubnormalArguments;
+
+
+static void TimeConv(void *Context)
+{
+	const SubnormalArguments *a = Context;
+	vDSP_conv(a->Signal, 1, a->Filter, 1, a->Result, 1, N, FilterLength);
+}
+
+
+static void TimeZop(void *Context)
+{
+	const SubnormalArguments *a = Context;
+	vDSP_fft_zop(a->Setup, &a->Input, 1, &a->Output, 1, Log2N, FFT_FORWARD);
+}
+
+
+// Record in Context[Index] whether the task ran in fast mode.
+static void RecordMode(void *Context, unsigned long Index)
+{
+	((int *) Context)[Index] = CurrentMathMode() == MathModeFast;
+}
+
+
+// Time Routine in Mode, record the result, and return the median time.
+static double TimeInMode(const char *Name, const char *Data, MathMode Mode,
+	BenchmarkRoutine *Routine, void *Context, double Flops, double Bytes)
+{
+	char FullName[64];
+	snprintf(FullName, sizeof FullName, "%s %s %s", Name, Data,
+		Mode == MathModeFast ? "fast" : "conformant");
+
+	MathModeGuard Guard = EnterMathMode(Mode);
+	BenchmarkResult R = Benchmark(FullName, Routine, Context, Flops, Bytes,
+		N);
+	LeaveMathMode(Guard);
+
+	RecordBenchmark(&R);
+	return R.Median;
+}
+
+
+void DemonstrateSubnormals(void)
+{
+	printf("Begin %s.\n", __func__);
+
+	printf("\n\tMath mode control is %s.\n", MathModeSupport());
+
+	// Check that the default pool applies fast mode to its tasks.
+	{
+		enum { Tasks = 64 };
+		int Fast[Tasks];
+		ThreadPool *Pool = DefaultThreadPool();
+
+		MathModeGuard Guard = EnterMathMode(MathModeConformant);
+		RunThreadPool(Pool, RecordMode, Fast, Tasks);
+		const int CallerMode = CurrentMathMode();
+		LeaveMathMode(Guard);
+
+		int Count = 0;
+		for (int i = 0; i < Tasks; ++i)
+			Count += Fast[i];
+		printf("\tA conformant thread ran %d of %d tasks on a pool of %u "
+			"thread%s in fast mode,\n\tand was left in %s mode.\n",
+			Count, Tasks, ThreadPoolThreads(Pool),
+			ThreadPoolThreads(Pool) == 1 ? "" : "s",
+			CallerMode == MathModeFast ? "fast" : "conformant");
+	}
+
+	FFTSetup Setup = AcquireFFTSetup(Log2N, FFT_RADIX2);
+	Arena *Work = CreateArena((size_t) 1 << 20, 0);
+
+	const vDSP_Length SignalLength = N + FilterLength - 1;
+	float *Signal = ArenaAllocate(Work, SignalLength * sizeof *Signal);
+	float *Filter = ArenaAllocate(Work, FilterLength * sizeof *Filter);
+	float *Result = ArenaAllocate(Work, N * sizeof *Result);
+	SubnormalArguments Arguments = { Setup, Signal, Filter, Result,
+		ArenaAllocateSplit(Work, N), ArenaAllocateSplit(Work, N) };
+
+	// The filter is a decaying window of ordinary magnitudes.
+	for (vDSP_Length i = 0; i < FilterLength; ++i)
+		Filter[i] = expf(-(float) i / FilterLength);
+
+	printf("\n\t%-12s  %-9s  %22s  %16s\n", "Routine", "Data",
+		"Conformant microseconds", "Fast microseconds");
+
+	static const char *const Data[] = { "ordinary", "tiny" };
+	for (int d = 0; d < 2; ++d)
+	{
+		/*	Fill the inputs with values of magnitude up to one, or up to
+			2**-120.  The least normal number is 2**-126, so products of
+			the tiny values with twiddle factors and filter taps, and
+			the differences in the butterflies, underflow to subnormal
+			numbers.  Producing a subnormal result, rather than reading
+			one, is what sends many processors to their slow path.
+		*/
+		const int Exponent = d == 0 ? 0 : -120;
+		for (vDSP_Length i = 0; i < SignalLength; ++i)
+			Signal[i] = ldexpf(sinf(i), Exponent);
+		for (vDSP_Length i = 0; i < N; ++i)
+		{
+			Arguments.Input.realp[i] = ldexpf(cosf(3*i), Exponent);
+			Arguments.Input.imagp[i] = ldexpf(sinf(5*i), Exponent);
+		}
+
+		double Conformant = TimeInMode("vDSP_conv", Data[d],
+			MathModeConformant, TimeConv, &Arguments,
+			2. * N * FilterLength, (SignalLength + N) * sizeof(float));
+		double Fast = TimeInMode("vDSP_conv", Data[d], MathModeFast,
+			TimeConv, &Arguments,
+			2. * N * FilterLength, (SignalLength + N) * sizeof(float));
+		printf("\t%-12s  %-9s  %22.3f  %16.3f\n", "vDSP_conv", Data[d],
+			Conformant * 1e6, Fast * 1e6);
+
+		Conformant = TimeInMode("vDSP_fft_zop", Data[d],
+			MathModeConformant, TimeZop, &Arguments,
+			5. * N * Log2N, 4. * N * sizeof(float));
+		Fast = TimeInMode("vDSP_fft_zop", Data[d], MathModeFast,
+			TimeZop, &Arguments,
+			5. * N * Log2N, 4. * N * sizeof(float));
+		printf("\t%-12s  %-9s  %22.3f  %16.3f\n", "vDSP_fft_zop", Data[d],
+			Conformant * 1e6, Fast * 1e6);
+	}
+
+	DestroyArena(Work);
+	ReleaseFFTSetup(Setup);
+
+	printf("\nEnd %s.\n\n\n", __func__);
+}
@@ -0,0 +1,229 @@
+/*	File: FFTSetupRegistry.c
+
+	Description:
+		A registry of shared FFT setups.
+
+		The registry has a slot for each radix and each base-two
+		logarithm of a length.  A request for 2**Log2N elements is
+		served by the first occupied slot at or above Log2N, which is
+		the smallest setup that supports the length.  Each slot counts
+		the users of its setup, so TrimFFTSetups can destroy setups
+		that no one is using without pulling one out from under a
+		thread.
+
+		On a NUMA machine, the registry keeps a separate set of slots
+		for each node, so each node has its own replica of a setup.  A
+		thread acquiring a setup gets one from the slots of the node it
+		is running on, and a setup created for those slots has its
+		tables allocated on that node by CreateFFTSetupOnNUMANode.  The
+		pages are bound to the node when allocated, rather than left to
+		wherever they are first touched, so threads on every node read
+		the tables from local memory.
+
+		One lock protects the registry.  A setup is created while the
+		lock is held, so two threads asking for the same new setup do
+		not both create it; the second waits and then shares the first's
+		setup.  Creation is rare, so the wait seldom matters, and
+		prewarming removes it entirely for the sizes prewarmed.
+*/
+
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "FFTSetupRegistry.h"
+#include "FFTSetupTables.h"
+#include "NUMA.h"
+
+
+// Greatest base-two logarithm of a length the registry accepts.
+#define	MaximumLog2N	30
+
+// Number of radices, FFT_RADIX2, FFT_RADIX3, and FFT_RADIX5.
+#define	Radices	3
+
+/*	Number of nodes with their own replicas.  Nodes beyond these share
+	replicas, node k using those of node k % MaximumNodes.
+*/
+#define	MaximumNodes	8
+
+
+// Describe one slot of the registry.
+typedef struct
+{
+	FFTSetup Setup;		// Null if the slot is empty.
+	unsigned long Users;	// Number of acquisitions not yet released.
+	int Permanent;		// Prewarmed, so never trimmed.
+} Slot;
+
+static Slot Slots[MaximumNodes][Radices][MaximumLog2N+1];
+static unsigned long Hits, Misses;
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+// Exit with an error message if the arguments are not acceptable.
+static void CheckArguments(vDSP_Length Log2N, FFTRadix Radix)
+{
+	if (Radix < 0 || Radices <= Radix || MaximumLog2N < Log2N)
+	{
+		fprintf(stderr,
+			"Error, no FFT setup for radix %d and 2**%lu elements.\n",
+			Radix, (unsigned long) Log2N);
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+/*	Return the calling thread's node, or AnyNUMANode if the machine has
+	one node, so its setups are allocated normally.
+*/
+static int CurrentNode(void)
+{
+	return NUMANodes() == 1 ? AnyNUMANode : (int) CurrentNUMANode();
+}
+
+
+// Return the index of the replicas for Node.
+static unsigned ReplicaIndex(int Node)
+{
+	return Node == AnyNUMANode ? 0 : Node % MaximumNodes;
+}
+
+
+/*	Create a setup for 2**Log2N elements with Radix, with its tables on
+	Node, or exit with an error message.
+*/
+static FFTSetup CreateSetup(vDSP_Length Log2N, FFTRadix Radix, int Node)
+{
+	FFTSetup Setup = CreateFFTSetupOnNUMANode(Log2N, Radix, Node);
+	if (Setup == NULL)
+	{
+		fprintf(stderr, "Error, CreateFFTSetupOnNUMANode failed.\n");
+		exit(EXIT_FAILURE);
+	}
+	return Setup;
+}
+
+
+/*	Return the slot holding the smallest setup that supports 2**Log2N
+	elements with Radix on the calling thread's node, creating a setup
+	if there is none.  The lock must be held.
+*/
+static Slot *FindSlot(vDSP_Length Log2N, FFTRadix Radix)
+{
+	const int Node = CurrentNode();
+	Slot (*Replica)[MaximumLog2N+1] = Slots[ReplicaIndex(Node)];
+
+	for (vDSP_Length k = Log2N; k <= MaximumLog2N; ++k)
+		if (Replica[Radix][k].Setup)
+		{
+			++Hits;
+			return &Replica[Radix][k];
+		}
+
+	Slot *S = &Replica[Radix][Log2N];
+	S->Setup = CreateSetup(Log2N, Radix, Node);
+	++Misses;
+	return S;
+}
+
+
+FFTSetup AcquireFFTSetup(vDSP_Length Log2N, FFTRadix Radix)
+{
+	CheckArguments(Log2N, Radix);
+
+	pthread_mutex_lock(&Lock);
+	Slot *S = FindSlot(Log2N, Radix);
+	++S->Users;
+	FFTSetup Setup = S->Setup;
+	pthread_mutex_unlock(&Lock);
+
+	return Setup;
+}
+
+
+void ReleaseFFTSetup(FFTSetup Setup)
+{
+	pthread_mutex_lock(&Lock);
+
+	// Search the slots of every node, as the caller may have moved.
+	Slot *S = &Slots[0][0][0], *End = S + sizeof Slots / sizeof *S;
+	for (; S < End; ++S)
+		if (S->Setup == Setup && 0 < S->Users)
+		{
+			--S->Users;
+			pthread_mutex_unlock(&Lock);
+			return;
+		}
+
+	pthread_mutex_unlock(&Lock);
+
+	fprintf(stderr, "Error, released an FFT setup not acquired.\n");
+	exit(EXIT_FAILURE);
+}
+
+
+void PrewarmFFTSetup(vDSP_Length Log2N, FFTRadix Radix)
+{
+	CheckArguments(Log2N, Radix);
+
+	/*	Mark the exact size permanent, even if a larger setup could
+		serve it, so the setups a program prewarms are the ones it
+		keeps.  Only the calling thread's node gets the setup; threads
+		on other nodes create their replicas when they first ask.
+	*/
+	pthread_mutex_lock(&Lock);
+	const int Node = CurrentNode();
+	Slot *S = &Slots[ReplicaIndex(Node)][Radix][Log2N];
+	if (S->Setup == NULL)
+		S->Setup = CreateSetup(Log2N, Radix, Node);
+	S->Permanent = 1;
+	pthread_mutex_unlock(&Lock);
+}
+
+
+unsigned TrimFFTSetups(void)
+{
+	unsigned Destroyed = 0;
+
+	pthread_mutex_lock(&Lock);
+	Slot *S = &Slots[0][0][0], *End = S + sizeof Slots / sizeof *S;
+	for (; S < End; ++S)
+		if (S->Setup && S->Users == 0 && !S->Permanent)
+		{
+			vDSP_destroy_fftsetup(S->Setup);
+			S->Setup = NULL;
+			++Destroyed;
+		}
+	pthread_mutex_unlock(&Lock);
+
+	return Destroyed;
+}
+
+
+FFTSetupStatistics GetFFTSetupStatistics(void)
+{
+	FFTSetupStatistics Statistics = { 0, 0, 0, 0, 0 };
+
+	pthread_mutex_lock(&Lock);
+	Statistics.Hits = Hits;
+	Statistics.Misses = Misses;
+	for (int n = 0; n < MaximumNodes; ++n)
+	{
+		const unsigned Resident = Statistics.Resident;
+		for (int r = 0; r < Radices; ++r)
+			for (int k = 0; k <= MaximumLog2N; ++k)
+				if (Slots[n][r][k].Setup)
+				{
+					++Statistics.Resident;
+					Statistics.TwiddleBytes +=
+						FFTSetupBytes(Slots[n][r][k].Setup, k, r);
+				}
+		if (Resident < Statistics.Resident)
+			++Statistics.Nodes;
+	}
+	pthread_mutex_unlock(&Lock);
+
+	return Statistics;
+}
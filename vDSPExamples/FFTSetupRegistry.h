@@ -0,0 +1,83 @@
+/*	File: FFTSetupRegistry.h
+
+	Description:
+		Declarations for a registry that shares FFT setups among all
+		the code in a process.
+*/
+#ifndef __FFTSETUPREGISTRY__
+#define __FFTSETUPREGISTRY__
+
+
+#include <stddef.h>
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	Creating a setup computes its twiddle factors, which takes time
+	proportional to the FFT length, so code that creates a setup each
+	time it needs one pays that cost again and again, and at
+	unpredictable moments.  Instead, code may acquire a setup from the
+	registry, which creates each setup once and shares it.  A setup
+	supports every length up to the one it was created for, so the
+	registry returns the smallest setup it holds that is large enough,
+	creating one of exactly the requested size only if there is none.
+
+	A setup is only read once created, so a shared setup may be used by
+	any number of threads at once.  The registry routines may be called
+	from any thread.  On a NUMA machine, each node has its own replica
+	of each setup, in its own memory, and a thread receives the replica
+	for the node it is running on (see NUMA.h).
+*/
+
+
+/*	Return a setup that supports FFTs of 2**Log2N elements with Radix,
+	or exit with an error message if one cannot be created.  The caller
+	must pass the setup to ReleaseFFTSetup when it is done with it, and
+	must not destroy it.
+*/
+FFTSetup AcquireFFTSetup(vDSP_Length Log2N, FFTRadix Radix);
+
+/*	Release a setup obtained from AcquireFFTSetup.  The registry keeps
+	the setup for later requests even when nothing is using it, until
+	TrimFFTSetups is called.
+*/
+void ReleaseFFTSetup(FFTSetup Setup);
+
+/*	Create, if necessary, a setup for 2**Log2N elements with Radix, and
+	keep it for the life of the process.  Calling this at startup moves
+	the cost of creating the setup out of the first request for it.  On
+	a NUMA machine, this prewarms the replica for the calling thread's
+	node only.
+*/
+void PrewarmFFTSetup(vDSP_Length Log2N, FFTRadix Radix);
+
+/*	Destroy the setups that are neither in use nor prewarmed, and return
+	the number destroyed.
+*/
+unsigned TrimFFTSetups(void);
+
+
+// Describe the registry's activity.
+typedef struct
+{
+	unsigned long Hits;	// Requests served by an existing setup.
+	unsigned long Misses;	// Requests that created a setup.
+	unsigned Resident;	// Setups held.
+	size_t TwiddleBytes;	// Memory in the tables of the setups held.
+	unsigned Nodes;		// NUMA nodes with setups.
+} FFTSetupStatistics;
+
+FFTSetupStatistics GetFFTSetupStatistics(void);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
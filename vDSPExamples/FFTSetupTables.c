@@ -0,0 +1,44 @@
+/*	File: FFTSetupTables.c
+
+	Description:
+		Placing and measuring the tables of FFT setups, for Mac OS X.
+
+		Accelerate's setups are private, so their tables can be neither
+		placed nor measured.  Mac OS X machines have one memory node
+		anyway, so CreateFFTSetupOnNUMANode creates an ordinary setup,
+		and FFTSetupBytes estimates the size.  On other systems, the
+		portable FFT implementation in PortableFFT.c provides these
+		routines, and this file is empty.
+*/
+
+
+#if defined __APPLE__
+
+
+#include <stdint.h>
+
+#include "FFTSetupTables.h"
+
+
+FFTSetup CreateFFTSetupOnNUMANode(vDSP_Length Log2N, FFTRadix Radix,
+	int Node)
+{
+	(void) Node;
+	return vDSP_create_fftsetup(Log2N, Radix);
+}
+
+
+/*	Estimate a cosine and a sine for each element and each factor of
+	the radix, and a bit-reversal index for each element.
+*/
+size_t FFTSetupBytes(FFTSetup Setup, vDSP_Length Log2N, FFTRadix Radix)
+{
+	(void) Setup;
+	const size_t Factor =
+		Radix == FFT_RADIX5 ? 5 : Radix == FFT_RADIX3 ? 3 : 1;
+	return ((size_t) 1 << Log2N)
+		* (2 * Factor * sizeof(float) + sizeof(uint32_t));
+}
+
+
+#endif	// defined __APPLE__
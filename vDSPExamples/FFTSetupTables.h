@@ -0,0 +1,52 @@
+/*	File: FFTSetupTables.h
+
+	Description:
+		Declarations for placing the tables of FFT setups on NUMA nodes
+		and measuring them.
+*/
+#ifndef __FFTSETUPTABLES__
+#define __FFTSETUPTABLES__
+
+
+#include <stddef.h>
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	A setup's tables are read by every transform that uses it, so on a
+	NUMA machine, threads on each node should read a replica in their
+	own node's memory.  This routine creates a setup as
+	vDSP_create_fftsetup does, except that, with the portable vDSP
+	routines, the tables are allocated with AllocateOnNUMANode (see
+	NUMA.h), so they are placed on Node however the memory is reused
+	and whichever thread fills it.  With Accelerate, whose setups are
+	private, and whose machines have one node, it is simply
+	vDSP_create_fftsetup.
+
+	Node may be AnyNUMANode.  The setup is destroyed with
+	vDSP_destroy_fftsetup as usual.
+*/
+FFTSetup CreateFFTSetupOnNUMANode(vDSP_Length Log2N, FFTRadix Radix,
+	int Node);
+
+/*	Return the bytes in the tables of Setup, which was created for
+	2**Log2N elements with Radix.  With the portable vDSP routines, this
+	is the size the setup itself records, including the radix-3 and
+	radix-5 factors.  Accelerate's setups are private, so with
+	Accelerate it is an estimate from Log2N and Radix, assuming tables
+	like the portable routines'.
+*/
+size_t FFTSetupBytes(FFTSetup Setup, vDSP_Length Log2N, FFTRadix Radix);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
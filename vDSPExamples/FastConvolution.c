@@ -0,0 +1,376 @@
+/*	File: FastConvolution.c
+
+	Description:
+		Convolution by FFT, using the overlap-save method, and a
+		routine that chooses between it and the direct vDSP_conv.
+
+		vDSP_conv computes each result element as a sum over the whole
+		filter, so its time is proportional to ResultLength times
+		FilterLength.  Overlap-save cuts the signal into overlapping
+		blocks of L elements, multiplies the spectrum of each block by
+		the conjugate of the filter's spectrum (which is correlation,
+		the same operation vDSP_conv performs with a positive filter
+		stride), and keeps the L-P+1 results of each block that are not
+		affected by wrap-around.  Its time per result is proportional
+		to log2(L), so for long filters it is much faster.
+
+		FFTConvolution may be called from many threads at once, for
+		example on chunks of one long signal.  Each thread keeps its own
+		work buffers and FFT setups, so after a thread's first call with
+		a block length, the routine neither allocates memory nor takes
+		the FFT setup registry's lock.
+
+		Only the vDSP interfaces are used, so this works with both
+		Accelerate and the portable routines.
+*/
+
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "FastConvolution.h"
+#include "Arena.h"
+#include "Demonstrate.h"
+#include "FFTSetupRegistry.h"
+
+
+// Greatest base-two logarithm of a block length.
+#define	MaximumLog2L	24
+
+
+/*	Choose the block length L = 2**Log2L.  L must be at least P+1 so
+	each block yields at least one result; larger blocks waste less of
+	each transform on overlap but cost more per element.  We estimate
+	the cost of each candidate as the number of blocks times L*log2(L)
+	and take the cheapest.  There is no point in a block larger than
+	needed to do all the results at once.
+*/
+static vDSP_Length ChooseLog2L(vDSP_Length N, vDSP_Length P)
+{
+	vDSP_Length Log2L = 1;
+	while (((vDSP_Length) 1 << Log2L) < 2*P)
+		++Log2L;
+
+	vDSP_Length Best = Log2L;
+	double BestCost = -1;
+
+	for (; Log2L <= MaximumLog2L; ++Log2L)
+	{
+		const vDSP_Length L = (vDSP_Length) 1 << Log2L;
+		const vDSP_Length B = L - P + 1;
+		const double Cost = (double) ((N + B - 1) / B) * L * (Log2L + 1);
+		if (BestCost < 0 || Cost < BestCost)
+		{
+			Best = Log2L;
+			BestCost = Cost;
+		}
+		if (N + P - 1 <= L)
+			break;
+	}
+
+	return Best;
+}
+
+
+/*	Hold a thread's work arena, from which the filter and block buffers
+	are taken on each call, and the setups it has acquired, indexed by
+	the base-two logarithm of the block length.  The setups are
+	released when the thread exits.
+*/
+typedef struct
+{
+	Arena *Work;
+	FFTSetup Setups[MaximumLog2L+1];
+} ThreadState;
+
+static pthread_key_t StateKey;
+static pthread_once_t StateOnce = PTHREAD_ONCE_INIT;
+
+
+// Release a thread's state when the thread exits.
+static void FreeState(void *p)
+{
+	ThreadState *S = p;
+	for (int k = 0; k <= MaximumLog2L; ++k)
+		if (S->Setups[k])
+			ReleaseFFTSetup(S->Setups[k]);
+	DestroyArena(S->Work);
+	free(S);
+}
+
+
+static void CreateStateKey(void)
+{
+	if (pthread_key_create(&StateKey, FreeState) != 0)
+	{
+		fprintf(stderr, "Error, failed to create a thread key.\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+// Return the calling thread's state, creating it on the first call.
+static ThreadState *GetState(void)
+{
+	pthread_once(&StateOnce, CreateStateKey);
+
+	ThreadState *S = pthread_getspecific(StateKey);
+	if (S == NULL)
+	{
+		S = calloc(1, sizeof *S);
+		if (S == NULL)
+		{
+			fprintf(stderr, "Error, failed to allocate memory.\n");
+			exit(EXIT_FAILURE);
+		}
+		S->Work = CreateArena((size_t) 1 << 16, 0);
+		pthread_setspecific(StateKey, S);
+	}
+
+	return S;
+}
+
+
+/*	Multiply a packed real-to-complex spectrum by the conjugate of
+	another.  Element 0 holds two real numbers (the DC and Nyquist
+	terms), which are multiplied separately.
+*/
+static void MultiplyConjugate(const DSPSplitComplex *X,
+	const DSPSplitComplex *H, vDSP_Length Length)
+{
+	X->realp[0] *= H->realp[0];
+	X->imagp[0] *= H->imagp[0];
+
+	for (vDSP_Length i = 1; i < Length; ++i)
+	{
+		float xr = X->realp[i], xi = X->imagp[i];
+		float hr = H->realp[i], hi = H->imagp[i];
+		X->realp[i] = xr*hr + xi*hi;
+		X->imagp[i] = xi*hr - xr*hi;
+	}
+}
+
+
+void FFTConvolution(const float *A, vDSP_Stride IA,
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,
+	vDSP_Length N, vDSP_Length P)
+{
+	vDSP_Length i;
+
+	if (N == 0)
+		return;
+
+	if (P == 0)
+	{
+		for (i = 0; i < N; ++i)
+			C[i*IC] = 0;
+		return;
+	}
+
+	// Filters too long for the largest supported block are done directly.
+	if (((vDSP_Length) 1 << MaximumLog2L) < 2*P)
+	{
+		vDSP_conv(A, IA, F, IF, C, IC, N, P);
+		return;
+	}
+
+	const vDSP_Length Log2L = ChooseLog2L(N, P);
+	const vDSP_Length L = (vDSP_Length) 1 << Log2L;
+	const vDSP_Length B = L - P + 1;	// Results per block.
+
+	/*	Get the setup from the registry on the thread's first call with
+		this block length, so each block length's twiddle factors are
+		computed once per process, and keep it for later calls.
+	*/
+	ThreadState *State = GetState();
+	if (State->Setups[Log2L] == NULL)
+		State->Setups[Log2L] = AcquireFFTSetup(Log2L, FFT_RADIX2);
+	FFTSetup Setup = State->Setups[Log2L];
+
+	ResetArena(State->Work);
+	DSPSplitComplex Filter = ArenaAllocateSplit(State->Work, L/2);
+	DSPSplitComplex Buffer = ArenaAllocateSplit(State->Work, L/2);
+
+	/*	Transform the filter, padded with zeroes to L elements and
+		split into even and odd elements as vDSP_fft_zrip expects.
+	*/
+	for (i = 0; i < L/2; ++i)
+	{
+		Filter.realp[i] = 2*i   < P ? F[(2*i  ) * IF] : 0;
+		Filter.imagp[i] = 2*i+1 < P ? F[(2*i+1) * IF] : 0;
+	}
+	vDSP_fft_zrip(Setup, &Filter, 1, Log2L, FFT_FORWARD);
+
+	/*	The forward transforms of the filter and the signal each scale
+		by two, and the inverse transform scales by L, so scale the
+		filter spectrum by 1/(4L) to get unscaled results.
+	*/
+	const float Scale = 1.f / (4*L);
+	for (i = 0; i < L/2; ++i)
+	{
+		Filter.realp[i] *= Scale;
+		Filter.imagp[i] *= Scale;
+	}
+
+	for (vDSP_Length n0 = 0; n0 < N; n0 += B)
+	{
+		/*	Load L signal elements starting at A[n0*IA].  Only
+			N+P-1 elements of A may be read, so pad with zeroes past
+			them; the results affected are not used.
+		*/
+		const vDSP_Length Available = N + P - 1 - n0;
+		if (IA == 1 && L <= Available)
+			vDSP_ctoz((const DSPComplex *) (A + n0), 2, &Buffer, 1, L/2);
+		else
+			for (i = 0; i < L/2; ++i)
+			{
+				Buffer.realp[i] = 2*i   < Available
+					? A[(n0 + 2*i  ) * IA] : 0;
+				Buffer.imagp[i] = 2*i+1 < Available
+					? A[(n0 + 2*i+1) * IA] : 0;
+			}
+
+		vDSP_fft_zrip(Setup, &Buffer, 1, Log2L, FFT_FORWARD);
+		MultiplyConjugate(&Buffer, &Filter, L/2);
+		vDSP_fft_zrip(Setup, &Buffer, 1, Log2L, FFT_INVERSE);
+
+		/*	The first B elements of the circular correlation are the
+			results.  Even elements are in realp and odd in imagp.
+		*/
+		const vDSP_Length Count = B < N - n0 ? B : N - n0;
+		for (i = 0; i < Count; ++i)
+			C[(n0 + i) * IC] = i & 1 ? Buffer.imagp[i/2] : Buffer.realp[i/2];
+	}
+}
+
+
+/*	The FFT's advantage depends on the number of results as well as on
+	the filter length:  each call transforms the filter once, and each
+	block of results costs two transforms however few of its results
+	are wanted, so with few results the FFT needs a longer filter to pay
+	off.  So the crossover filter length is measured separately for
+	result lengths 64, 256, 1024, 4096, 16384, and 65536, and a call uses
+	the crossover measured for the largest of these not above its own
+	result length.  Calls with fewer than 64 results always use
+	vDSP_conv.
+*/
+enum { CrossoverSizes = 6 };
+
+// Return the result length at which crossover k is measured.
+static vDSP_Length CrossoverN(int k)
+{
+	return (vDSP_Length) 64 << 2*k;
+}
+
+/*	The crossover filter lengths, measured once.  Until they are
+	measured, they are zero.
+*/
+static vDSP_Length Crossovers[CrossoverSizes];
+static pthread_once_t CrossoverOnce = PTHREAD_ONCE_INIT;
+
+
+/*	Return the shortest time, in clock ticks, of a few calls to Routine.
+	Taking the minimum discards interruptions by other processes.  An
+	untimed call first gets the thread's buffers and setup for
+	FFTConvolution, so they are not counted.
+*/
+typedef void ConvolutionRoutine(const float *A, vDSP_Stride IA,
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,
+	vDSP_Length N, vDSP_Length P);
+
+static ClockData TimeRoutine(ConvolutionRoutine *Routine,
+	const float *A, const float *F, float *C, vDSP_Length N, vDSP_Length P)
+{
+	Routine(A, 1, F, 1, C, 1, N, P);
+
+	ClockData Best = 0;
+	for (int i = 0; i < 7; ++i)
+	{
+		ClockData t0 = Clock();
+		Routine(A, 1, F, 1, C, 1, N, P);
+		ClockData t1 = Clock();
+		if (i == 0 || t1 - t0 < Best)
+			Best = t1 - t0;
+	}
+	return Best;
+}
+
+
+/*	For each result length, time vDSP_conv and FFTConvolution on filters
+	of increasing length and record the first length at which the FFT
+	is faster.  If it is not faster for any filter measured, record
+	twice the longest, as the FFT's cost grows more slowly.
+*/
+static void MeasureCrossover(void)
+{
+	const vDSP_Length MaximumN = CrossoverN(CrossoverSizes-1),
+		MaximumP = 4096;
+
+	float *A = malloc((MaximumN + MaximumP) * sizeof *A);
+	float *F = malloc(MaximumP * sizeof *F);
+	float *C = malloc(MaximumN * sizeof *C);
+	if (A == NULL || F == NULL || C == NULL)
+	{
+		fprintf(stderr, "Error, failed to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (vDSP_Length i = 0; i < MaximumN + MaximumP; ++i)
+		A[i] = 1;
+	for (vDSP_Length i = 0; i < MaximumP; ++i)
+		F[i] = 1;
+
+	for (int k = 0; k < CrossoverSizes; ++k)
+	{
+		const vDSP_Length N = CrossoverN(k);
+		vDSP_Length P;
+		for (P = 8; P <= MaximumP; P *= 2)
+			if (TimeRoutine(FFTConvolution, A, F, C, N, P)
+				< TimeRoutine(vDSP_conv, A, F, C, N, P))
+				break;
+		Crossovers[k] = P;
+	}
+
+	free(C);
+	free(F);
+	free(A);
+}
+
+
+void InitializeFastConvolution(void)
+{
+	pthread_once(&CrossoverOnce, MeasureCrossover);
+}
+
+
+vDSP_Length FastConvolutionCrossover(vDSP_Length N)
+{
+	InitializeFastConvolution();
+
+	if (N < CrossoverN(0))
+		return 0;
+
+	int k = 0;
+	while (k+1 < CrossoverSizes && CrossoverN(k+1) <= N)
+		++k;
+	return Crossovers[k];
+}
+
+
+int FastConvolutionUsesFFT(vDSP_Length N, vDSP_Length P)
+{
+	const vDSP_Length Crossover = FastConvolutionCrossover(N);
+	return Crossover != 0 && Crossover <= P;
+}
+
+
+void FastConvolution(const float *A, vDSP_Stride IA,
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,
+	vDSP_Length N, vDSP_Length P)
+{
+	if (FastConvolutionUsesFFT(N, P))
+		FFTConvolution(A, IA, F, IF, C, IC, N, P);
+	else
+		vDSP_conv(A, IA, F, IF, C, IC, N, P);
+}
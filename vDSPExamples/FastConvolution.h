@@ -0,0 +1,63 @@
+/*	File: FastConvolution.h
+
+	Description:
+		Declarations for convolution by FFT (overlap-save), with
+		automatic selection between it and the direct vDSP_conv.
+*/
+#ifndef __FASTCONVOLUTION__
+#define __FASTCONVOLUTION__
+
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	FFTConvolution computes exactly what vDSP_conv computes, with the
+	same arguments, but uses overlap-save with vDSP_fft_zrip.  Its cost
+	grows with the logarithm of the filter length instead of linearly,
+	so it is faster for long filters.  Results differ from vDSP_conv by
+	rounding error.
+*/
+void FFTConvolution(const float *A, vDSP_Stride IA,
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,
+	vDSP_Length N, vDSP_Length P);
+
+
+/*	FastConvolution takes the vDSP_conv arguments and calls either
+	vDSP_conv or FFTConvolution, whichever is expected to be faster.
+
+	The choice uses crossover filter lengths measured by
+	InitializeFastConvolution for several result lengths:  the FFT is
+	used when the filter is at least as long as the crossover for the
+	nearest result length measured at or below N.  (With few results,
+	the FFT's block overhead is paid back only by a longer filter, and
+	with fewer than 64 results, the FFT is not used.)  If
+	InitializeFastConvolution has not been called, the first call to
+	FastConvolution calls it.
+*/
+void FastConvolution(const float *A, vDSP_Stride IA,
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,
+	vDSP_Length N, vDSP_Length P);
+
+// Time both methods and record the crossover filter lengths.
+void InitializeFastConvolution(void);
+
+/*	Return the shortest filter length for which FastConvolution uses the
+	FFT for N results, or zero if it never does.
+*/
+vDSP_Length FastConvolutionCrossover(vDSP_Length N);
+
+// Return whether FastConvolution would use the FFT for N results and P taps.
+int FastConvolutionUsesFFT(vDSP_Length N, vDSP_Length P);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -0,0 +1,214 @@
+/*	File: Goertzel.c
+
+	Description:
+		A bank of Goertzel filters.
+
+		The Goertzel algorithm computes a single DFT term with the
+		recurrence
+
+			s[n] = x[n] + 2*cos(w) * s[n-1] - s[n-2],
+
+		and after N samples, |X(w)|**2 = s1*s1 + s2*s2 - 2*cos(w)*s1*s2,
+		where s1 and s2 are the last two values of s.  It costs one
+		multiply-add per sample per frequency and needs no buffering of
+		the signal, so when only a few frequencies are wanted (DTMF
+		detection reads eight) it is much cheaper than a full FFT, and
+		it can process samples as they arrive.
+
+		The eight frequencies of a bank fit in one AVX vector, so the
+		filters for all eight advance together.  Each step depends on
+		the previous one, so a single channel would leave the processor
+		waiting on that dependence; instead, four channels are run at
+		once, each in its own registers, which keeps several independent
+		multiply-adds in flight.
+
+		The AVX2 kernel is used when the processor supports it (on
+		systems using the portable vDSP routines).  Otherwise, a plain C
+		loop over the eight frequencies is used, which compilers
+		vectorize with the vector unit available.
+*/
+
+
+#include <math.h>
+#include <stddef.h>
+
+#if !defined __APPLE__ && (defined __i386__ || defined __x86_64__)
+	#include <immintrin.h>
+	#define	HasIntelVectors	1
+#endif
+
+#include "CPUFeatures.h"
+#include "Goertzel.h"
+
+
+static const double TwoPi = 0x3.243f6a8885a308d313198a2e03707344ap1;
+
+
+void InitializeGoertzelBank(GoertzelBank *Bank,
+	const float Frequencies[GoertzelTones], float SamplingFrequency)
+{
+	for (int t = 0; t < GoertzelTones; ++t)
+		Bank->Coefficients[t] =
+			2 * cos(TwoPi * Frequencies[t] / SamplingFrequency);
+}
+
+
+void ResetGoertzelStates(GoertzelState *States, vDSP_Length Channels)
+{
+	for (vDSP_Length c = 0; c < Channels; ++c)
+		for (int t = 0; t < GoertzelTones; ++t)
+			States[c].s1[t] = States[c].s2[t] = 0;
+}
+
+
+// An update kernel has the UpdateGoertzelStates interface.
+typedef void UpdateKernel(const GoertzelBank *Bank, GoertzelState *States,
+	const float *Samples, vDSP_Stride ChannelStride,
+	vDSP_Length Channels, vDSP_Length Length);
+
+
+// Update the filters one channel at a time.
+static void UpdateScalar(const GoertzelBank *Bank, GoertzelState *States,
+	const float *Samples, vDSP_Stride ChannelStride,
+	vDSP_Length Channels, vDSP_Length Length)
+{
+	const float *k = Bank->Coefficients;
+
+	for (vDSP_Length c = 0; c < Channels; ++c)
+	{
+		const float *x = Samples + c*ChannelStride;
+		float s1[GoertzelTones], s2[GoertzelTones];
+
+		for (int t = 0; t < GoertzelTones; ++t)
+		{
+			s1[t] = States[c].s1[t];
+			s2[t] = States[c].s2[t];
+		}
+
+		for (vDSP_Length n = 0; n < Length; ++n)
+			for (int t = 0; t < GoertzelTones; ++t)
+			{
+				float s = x[n] + k[t] * s1[t] - s2[t];
+				s2[t] = s1[t];
+				s1[t] = s;
+			}
+
+		for (int t = 0; t < GoertzelTones; ++t)
+		{
+			States[c].s1[t] = s1[t];
+			States[c].s2[t] = s2[t];
+		}
+	}
+}
+
+
+#if defined HasIntelVectors
+
+
+#define	AVX2	__attribute__((__target__("avx2,fma")))
+
+
+/*	Update the filters of Channels channels at once, with Channels a
+	compile-time constant so the states stay in registers.
+*/
+#define	DefineBlock(Channels)						\
+AVX2 static inline void UpdateBlock##Channels(const __m256 k,		\
+	GoertzelState *States, const float *Samples,			\
+	vDSP_Stride ChannelStride, vDSP_Length Length)			\
+{									\
+	__m256 s1[Channels], s2[Channels];				\
+	for (int c = 0; c < Channels; ++c)				\
+	{								\
+		s1[c] = _mm256_loadu_ps(States[c].s1);			\
+		s2[c] = _mm256_loadu_ps(States[c].s2);			\
+	}								\
+									\
+	for (vDSP_Length n = 0; n < Length; ++n)			\
+		for (int c = 0; c < Channels; ++c)			\
+		{							\
+			const __m256 x =				\
+				_mm256_broadcast_ss(Samples + c*ChannelStride + n); \
+			const __m256 s =				\
+				_mm256_fmadd_ps(k, s1[c], _mm256_sub_ps(x, s2[c])); \
+			s2[c] = s1[c];					\
+			s1[c] = s;					\
+		}							\
+									\
+	for (int c = 0; c < Channels; ++c)				\
+	{								\
+		_mm256_storeu_ps(States[c].s1, s1[c]);			\
+		_mm256_storeu_ps(States[c].s2, s2[c]);			\
+	}								\
+}
+
+DefineBlock(4)
+DefineBlock(1)
+
+#undef	DefineBlock
+
+
+// Update the filters four channels at a time with AVX2 and FMA.
+AVX2 static void UpdateAVX2(const GoertzelBank *Bank, GoertzelState *States,
+	const float *Samples, vDSP_Stride ChannelStride,
+	vDSP_Length Channels, vDSP_Length Length)
+{
+	const __m256 k = _mm256_loadu_ps(Bank->Coefficients);
+	vDSP_Length c = 0;
+
+	for (; c + 4 <= Channels; c += 4)
+		UpdateBlock4(k, States + c, Samples + c*ChannelStride,
+			ChannelStride, Length);
+
+	for (; c < Channels; ++c)
+		UpdateBlock1(k, States + c, Samples + c*ChannelStride,
+			ChannelStride, Length);
+}
+
+
+#endif	// defined HasIntelVectors
+
+
+// Choose the best kernel the processor supports.
+static UpdateKernel *ChooseKernel(void)
+{
+	#if defined HasIntelVectors
+		const unsigned Features = CPUFeatures();
+		if ((Features & CPUAVX2) && (Features & CPUFMA))
+		{
+			NoteKernelVariant("Goertzel filters", "AVX2");
+			return UpdateAVX2;
+		}
+	#endif
+
+	NoteKernelVariant("Goertzel filters", "scalar");
+	return UpdateScalar;
+}
+
+
+void UpdateGoertzelStates(const GoertzelBank *Bank, GoertzelState *States,
+	const float *Samples, vDSP_Stride ChannelStride,
+	vDSP_Length Channels, vDSP_Length Length)
+{
+	/*	The choice is made on the first call.  If two threads race to
+		make it, they store the same value, so no lock is needed.
+	*/
+	static UpdateKernel *Kernel;
+	if (Kernel == NULL)
+		Kernel = ChooseKernel();
+
+	Kernel(Bank, States, Samples, ChannelStride, Channels, Length);
+}
+
+
+void GoertzelPower(const GoertzelBank *Bank, const GoertzelState *States,
+	vDSP_Length Channels, float *Power)
+{
+	const float *k = Bank->Coefficients;
+
+	for (vDSP_Length c = 0; c < Channels; ++c)
+		for (int t = 0; t < GoertzelTones; ++t)
+		{
+			const float s1 = States[c].s1[t], s2 = States[c].s2[t];
+			Power[c*GoertzelTones + t] = s1*s1 + s2*s2 - k[t]*s1*s2;
+		}
+}
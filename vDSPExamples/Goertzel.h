@@ -0,0 +1,75 @@
+/*	File: Goertzel.h
+
+	Description:
+		Declarations for a bank of Goertzel filters that measures the
+		power of eight fixed frequencies, such as the DTMF tones, in
+		many channels at once.
+*/
+#ifndef __GOERTZEL__
+#define __GOERTZEL__
+
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+// Number of frequencies in a bank.
+#define	GoertzelTones	8
+
+
+/*	A bank holds the filter coefficient for each frequency.  It is only
+	read after it is initialized, so one bank may serve many channels
+	and threads.
+*/
+typedef struct
+{
+	float Coefficients[GoertzelTones];	// 2*cos(2*pi*f/fs).
+} GoertzelBank;
+
+
+/*	A state holds the two most recent filter outputs for each frequency
+	in one channel.  A state must be reset before the first sample of
+	each block.
+*/
+typedef struct
+{
+	float s1[GoertzelTones], s2[GoertzelTones];
+} GoertzelState;
+
+
+/*	Initialize Bank for Frequencies, in Hz, of a signal sampled at
+	SamplingFrequency Hz.
+*/
+void InitializeGoertzelBank(GoertzelBank *Bank,
+	const float Frequencies[GoertzelTones], float SamplingFrequency);
+
+// Reset the states of Channels channels to start a new block.
+void ResetGoertzelStates(GoertzelState *States, vDSP_Length Channels);
+
+/*	Run Length samples of each of Channels channels through the filters.
+	Channel c uses States[c] and has its samples contiguous starting at
+	Samples + c*ChannelStride.  A block may be fed in any number of
+	pieces.
+*/
+void UpdateGoertzelStates(const GoertzelBank *Bank, GoertzelState *States,
+	const float *Samples, vDSP_Stride ChannelStride,
+	vDSP_Length Channels, vDSP_Length Length);
+
+/*	Write the power at each frequency for the samples fed since the
+	last reset:  Power[c*GoertzelTones + t] is the squared magnitude of
+	the DFT of channel c's block at frequency t.
+*/
+void GoertzelPower(const GoertzelBank *Bank, const GoertzelState *States,
+	vDSP_Length Channels, float *Power);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -0,0 +1,67 @@
+/*	File: InterleavedFFT.c
+
+	Description:
+		Interleaved-data FFTs for Mac OS X, built from Accelerate's
+		routines.
+
+		Accelerate's FFTs take only separated-data vectors, so these
+		routines convert to a scratch buffer with vDSP_ctoz, transform
+		it, and convert back with vDSP_ztoc.  On other systems, the
+		portable FFT implementation in PortableFFT.c provides these
+		routines with the conversions folded into the transform, and
+		this file is empty.
+*/
+
+
+#if defined __APPLE__
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "InterleavedFFT.h"
+
+
+/*	Convert N elements of A to a scratch buffer, perform Transform on it,
+	and convert the result to C.
+*/
+static void Convert(FFTSetup Setup, const DSPComplex *A, DSPComplex *C,
+	vDSP_Length N, vDSP_Length Log2N, FFTDirection Direction,
+	void Transform(FFTSetup, const DSPSplitComplex *, vDSP_Stride,
+		vDSP_Length, FFTDirection))
+{
+	float *Memory = malloc(2 * N * sizeof *Memory);
+	if (Memory == NULL)
+	{
+		fprintf(stderr, "Error, failed to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+	DSPSplitComplex Buffer = { Memory, Memory + N };
+
+	vDSP_ctoz(A, 2, &Buffer, 1, N);
+	Transform(Setup, &Buffer, 1, Log2N, Direction);
+	vDSP_ztoc(&Buffer, 1, C, 2, N);
+
+	free(Memory);
+}
+
+
+void InterleavedFFT_zop(FFTSetup Setup, const DSPComplex *A, DSPComplex *C,
+	vDSP_Length Log2N, FFTDirection Direction)
+{
+	Convert(Setup, A, C, (vDSP_Length) 1 << Log2N, Log2N, Direction,
+		vDSP_fft_zip);
+}
+
+
+void InterleavedFFT_zrop(FFTSetup Setup, const DSPComplex *A, DSPComplex *C,
+	vDSP_Length Log2N, FFTDirection Direction)
+{
+	if (Log2N == 0)
+		return;
+	Convert(Setup, A, C, (vDSP_Length) 1 << (Log2N-1), Log2N, Direction,
+		vDSP_fft_zrip);
+}
+
+
+#endif	// defined __APPLE__
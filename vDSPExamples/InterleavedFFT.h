@@ -0,0 +1,54 @@
+/*	File: InterleavedFFT.h
+
+	Description:
+		Declarations for FFTs of interleaved-data complex vectors.
+*/
+#ifndef __INTERLEAVEDFFT__
+#define __INTERLEAVEDFFT__
+
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	The vDSP FFTs take separated-data (split) complex vectors, so data
+	that arrive with real and imaginary parts interleaved must be moved
+	with vDSP_ctoz before an FFT and with vDSP_ztoc after it.  These
+	routines take interleaved vectors (with unit stride) directly and
+	produce the same results as that sequence.  With the portable vDSP
+	routines, the conversions are folded into the first and last steps
+	of the transform, saving two passes through memory; with Accelerate,
+	they are done with vDSP_ctoz and vDSP_ztoc.
+
+	A and C may be the same array.  The setup must support 2**Log2N
+	elements, as for vDSP_fft_zop or vDSP_fft_zrop.
+*/
+
+/*	Complex FFT of 2**Log2N elements, as vDSP_fft_zop would compute it,
+	from A to C.
+*/
+void InterleavedFFT_zop(FFTSetup Setup, const DSPComplex *A, DSPComplex *C,
+	vDSP_Length Log2N, FFTDirection Direction);
+
+/*	Real-to-complex FFT of 2**Log2N real elements, as vDSP_fft_zrop would
+	compute it, from A to C.  For a forward transform, A is the real
+	signal, viewed as 2**Log2N / 2 complex elements (which is how
+	vDSP_ctoz views it), and C receives the packed spectrum that
+	vDSP_ztoc would produce from vDSP_fft_zrop's result.  An inverse
+	transform takes such a spectrum and produces the real signal (scaled
+	as vDSP_fft_zrop scales it).
+*/
+void InterleavedFFT_zrop(FFTSetup Setup, const DSPComplex *A, DSPComplex *C,
+	vDSP_Length Log2N, FFTDirection Direction);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
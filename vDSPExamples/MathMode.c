@@ -0,0 +1,111 @@
+/*	File: MathMode.c
+
+	Description:
+		Control of the handling of subnormal numbers, through the
+		floating-point control register of each processor family.
+
+		A guard saves the control register when it is entered and
+		restores the subnormal bits from it when it is left, so nested
+		scopes unwind correctly.  Other bits, such as the rounding mode
+		and the exception flags raised inside the scope, are left alone.
+		Since the control register belongs to the thread, no locking is
+		needed.
+*/
+
+
+#include "MathMode.h"
+
+
+#if defined __i386__ || defined __x86_64__
+
+	#include <xmmintrin.h>
+
+	/*	The FTZ and DAZ bits of the MXCSR.  (DAZ is missing from the
+		very first processors with SSE, which no longer matter.)
+	*/
+	static const unsigned long FastBits = 0x8000 | 0x0040;
+
+	static const char Support[] = "MXCSR FTZ and DAZ";
+
+	static unsigned long GetControl(void)
+	{
+		return _mm_getcsr();
+	}
+
+	static void SetControl(unsigned long Control)
+	{
+		_mm_setcsr((unsigned int) Control);
+	}
+
+#elif defined __aarch64__
+
+	// The FZ bit of the FPCR.
+	static const unsigned long FastBits = 1ul << 24;
+
+	static const char Support[] = "FPCR FZ";
+
+	static unsigned long GetControl(void)
+	{
+		unsigned long Control;
+		__asm__ __volatile__("mrs %0, fpcr" : "=r" (Control));
+		return Control;
+	}
+
+	static void SetControl(unsigned long Control)
+	{
+		__asm__ __volatile__("msr fpcr, %0" : : "r" (Control));
+	}
+
+#else
+
+	// Without a known control register, there is nothing to set.
+	static const unsigned long FastBits = 0;
+
+	static const char Support[] = "none";
+
+	static unsigned long GetControl(void)
+	{
+		return 0;
+	}
+
+	static void SetControl(unsigned long Control)
+	{
+	}
+
+#endif
+
+
+MathModeGuard EnterMathMode(MathMode Mode)
+{
+	MathModeGuard Guard = { GetControl() };
+
+	const unsigned long Control = Mode == MathModeFast
+		? Guard.Saved | FastBits : Guard.Saved & ~FastBits;
+	if (Control != Guard.Saved)
+		SetControl(Control);
+
+	return Guard;
+}
+
+
+void LeaveMathMode(MathModeGuard Guard)
+{
+	const unsigned long Current = GetControl();
+	const unsigned long Control
+		= (Current & ~FastBits) | (Guard.Saved & FastBits);
+	if (Control != Current)
+		SetControl(Control);
+}
+
+
+MathMode CurrentMathMode(void)
+{
+	return FastBits != 0 && (GetControl() & FastBits) == FastBits
+		? MathModeFast : MathModeConformant;
+}
+
+
+const char *MathModeSupport(void)
+{
+	return Support;
+}
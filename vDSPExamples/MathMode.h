@@ -0,0 +1,71 @@
+/*	File: MathMode.h
+
+	Description:
+		Declarations for setting how the processor handles subnormal
+		floating-point numbers, for the calling thread, in scopes that
+		nest.
+*/
+#ifndef __MATHMODE__
+#define __MATHMODE__
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	Subnormal numbers are those with magnitudes below the least normal
+	number, about 1.2e-38 in single precision.  Many processors take a
+	slow path, sometimes a hundred times slower, for each arithmetic
+	instruction that reads or produces one, and they appear in ordinary
+	DSP work:  the tail of a decaying filter or reverberation passes
+	through them on its way to zero.
+
+	In fast mode, subnormal inputs are read as zero and subnormal results
+	are replaced by zero.  On Intel processors, this sets the FTZ
+	(flush-to-zero) and DAZ (denormals-are-zero) bits of the MXCSR; on
+	64-bit ARM processors, it sets the FZ bit of the FPCR, which does
+	both.  In conformant mode, subnormals are handled as IEEE 754
+	specifies.  On other processors, these routines do nothing.
+
+	The mode is part of each thread's registers, so setting it affects
+	only the calling thread; the thread pools in ThreadPool.h set it on
+	their workers.
+*/
+typedef enum { MathModeConformant, MathModeFast } MathMode;
+
+
+/*	A guard records the mode to restore at the end of a scope.  Guards
+	nest, as long as they are left in the reverse of the order they are
+	entered:
+
+		MathModeGuard Guard = EnterMathMode(MathModeFast);
+		...		// Code run in fast mode.
+		LeaveMathMode(Guard);
+
+	Each guard holds its own saved state, on the caller's stack, so any
+	number of threads may use guards at once.
+*/
+typedef struct { unsigned long Saved; } MathModeGuard;
+
+// Set Mode for the calling thread and return a guard to restore the old one.
+MathModeGuard EnterMathMode(MathMode Mode);
+
+// Restore the mode in effect when Guard was entered.
+void LeaveMathMode(MathModeGuard Guard);
+
+// Return the calling thread's mode.
+MathMode CurrentMathMode(void);
+
+/*	Describe the control used, such as "MXCSR FTZ and DAZ", or return
+	"none" if the processor's mode cannot be set.
+*/
+const char *MathModeSupport(void);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -0,0 +1,334 @@
+/*	File: MultichannelConvolution.c
+
+	Description:
+		A convolution of many channels with one filter.
+
+		Calling vDSP_conv once per channel steps through the whole
+		filter for each channel.  When each channel has only a short
+		block of results, as in audio processed a tick at a time, each
+		call has too few results to fill its registers with independent
+		sums, so it waits on the latency of the multiply-adds, and the
+		filter is read again for every channel.
+
+		Here the loops are arranged filter-major:  a block of results
+		from several channels is computed together, and each filter tap
+		is loaded and broadcast to a vector once, then multiplied into
+		the accumulators of every channel in the block.  With four
+		channels of two vectors each, eight independent accumulators
+		share each broadcast, which keeps both multiply-add units busy
+		even for short blocks.
+
+		There are kernels for AVX-512 and for AVX2, both with fused
+		multiply-add, used when the processor supports them (on systems
+		using the portable vDSP routines) and the signal stride is one.
+		The AVX-512 kernel computes the results left over after its
+		blocks with masks.  Otherwise, vDSP_conv is called for each
+		channel.
+*/
+
+
+#include <stddef.h>
+
+#if !defined __APPLE__ && (defined __i386__ || defined __x86_64__)
+	#include <immintrin.h>
+	#define	HasIntelVectors	1
+#endif
+
+#include "CPUFeatures.h"
+#include "MultichannelConvolution.h"
+
+
+// A kernel has the MultichannelConvolution interface.
+typedef void ConvolutionKernel(const float *A, vDSP_Stride IA,
+	vDSP_Stride IMA, const float *F, vDSP_Stride IF, float *C,
+	vDSP_Stride IC, vDSP_Stride IMC, vDSP_Length N, vDSP_Length P,
+	vDSP_Length M);
+
+
+// Convolve each channel with a separate call to vDSP_conv.
+static void ConvolveEachChannel(const float *A, vDSP_Stride IA,
+	vDSP_Stride IMA, const float *F, vDSP_Stride IF, float *C,
+	vDSP_Stride IC, vDSP_Stride IMC, vDSP_Length N, vDSP_Length P,
+	vDSP_Length M)
+{
+	for (vDSP_Length m = 0; m < M; ++m)
+		vDSP_conv(A + m*IMA, IA, F, IF, C + m*IMC, IC, N, P);
+}
+
+
+#if defined HasIntelVectors
+
+
+/*	Compute N results, fewer than a vector holds, for each of Channels
+	channels with unit signal stride.
+*/
+static void ConvolveScalar(const float *A, vDSP_Stride IMA,
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,
+	vDSP_Stride IMC, vDSP_Length N, vDSP_Length P, vDSP_Length Channels)
+{
+	for (vDSP_Length c = 0; c < Channels; ++c)
+		for (vDSP_Length n = 0; n < N; ++n)
+		{
+			const float *a = A + c*IMA + n;
+			float Sum = 0;
+			for (vDSP_Length p = 0; p < P; ++p)
+				Sum += a[p] * F[p*IF];
+			C[c*IMC + n*IC] = Sum;
+		}
+}
+
+
+#define	AVX2	__attribute__((__target__("avx2,fma")))
+
+
+/*	Store a vector of results to C with stride IC.  Unit strides are
+	stored directly; other strides go through a small buffer.
+*/
+AVX2 static inline void StoreAVX2(float *C, vDSP_Stride IC, __m256 v)
+{
+	if (IC == 1)
+		_mm256_storeu_ps(C, v);
+	else
+	{
+		float Buffer[8];
+		_mm256_storeu_ps(Buffer, v);
+		for (int i = 0; i < 8; ++i)
+			C[i*IC] = Buffer[i];
+	}
+}
+
+
+/*	Compute Vectors*8 results for each of Channels channels, with both
+	compile-time constants so the Channels*Vectors accumulators stay in
+	registers.  Each tap is broadcast once for all of them.
+*/
+#define	DefineBlock(Channels, Vectors)					\
+AVX2 static inline void BlockAVX2_##Channels##x##Vectors(		\
+	const float *A, vDSP_Stride IMA, const float *F, vDSP_Stride IF,\
+	float *C, vDSP_Stride IC, vDSP_Stride IMC, vDSP_Length P)	\
+{									\
+	__m256 Sum[Channels][Vectors];					\
+	for (int c = 0; c < Channels; ++c)				\
+		for (int v = 0; v < Vectors; ++v)			\
+			Sum[c][v] = _mm256_setzero_ps();		\
+									\
+	for (vDSP_Length p = 0; p < P; ++p, F += IF)			\
+	{								\
+		const __m256 f = _mm256_broadcast_ss(F);		\
+		for (int c = 0; c < Channels; ++c)			\
+			for (int v = 0; v < Vectors; ++v)		\
+				Sum[c][v] = _mm256_fmadd_ps(		\
+					_mm256_loadu_ps(A + c*IMA + p + 8*v), \
+					f, Sum[c][v]);			\
+	}								\
+									\
+	for (int c = 0; c < Channels; ++c)				\
+		for (int v = 0; v < Vectors; ++v)			\
+			StoreAVX2(C + c*IMC + 8*v*IC, IC, Sum[c][v]);	\
+}
+
+DefineBlock(4, 2)
+DefineBlock(4, 1)
+DefineBlock(1, 2)
+DefineBlock(1, 1)
+
+#undef	DefineBlock
+
+
+/*	Convolve with AVX2 and FMA, four channels at a time and then one at
+	a time.  Within a group of channels, results are done sixteen at a
+	time, then eight, and then one at a time.
+*/
+AVX2 static void ConvolveAVX2(const float *A, vDSP_Stride IA,
+	vDSP_Stride IMA, const float *F, vDSP_Stride IF, float *C,
+	vDSP_Stride IC, vDSP_Stride IMC, vDSP_Length N, vDSP_Length P,
+	vDSP_Length M)
+{
+	vDSP_Length m = 0;
+
+	for (; m + 4 <= M; m += 4)
+	{
+		const float *a = A + m*IMA;
+		float *c = C + m*IMC;
+		vDSP_Length n = 0;
+		for (; n + 16 <= N; n += 16)
+			BlockAVX2_4x2(a + n, IMA, F, IF, c + n*IC, IC, IMC, P);
+		for (; n + 8 <= N; n += 8)
+			BlockAVX2_4x1(a + n, IMA, F, IF, c + n*IC, IC, IMC, P);
+		ConvolveScalar(a + n, IMA, F, IF, c + n*IC, IC, IMC, N - n, P, 4);
+	}
+
+	for (; m < M; ++m)
+	{
+		const float *a = A + m*IMA;
+		float *c = C + m*IMC;
+		vDSP_Length n = 0;
+		for (; n + 16 <= N; n += 16)
+			BlockAVX2_1x2(a + n, IMA, F, IF, c + n*IC, IC, IMC, P);
+		for (; n + 8 <= N; n += 8)
+			BlockAVX2_1x1(a + n, IMA, F, IF, c + n*IC, IC, IMC, P);
+		ConvolveScalar(a + n, IMA, F, IF, c + n*IC, IC, IMC, N - n, P, 1);
+	}
+}
+
+
+#define	AVX512	__attribute__((__target__("avx512f,fma")))
+
+
+/*	Store the elements of v selected by Mask to C with stride IC.  Unit
+	strides use a masked store; other strides go through a small buffer.
+*/
+AVX512 static inline void StoreAVX512(float *C, vDSP_Stride IC, __m512 v,
+	__mmask16 Mask)
+{
+	if (IC == 1)
+		_mm512_mask_storeu_ps(C, Mask, v);
+	else
+	{
+		float Buffer[16];
+		_mm512_storeu_ps(Buffer, v);
+		for (int i = 0; i < 16; ++i)
+			if (Mask >> i & 1)
+				C[i*IC] = Buffer[i];
+	}
+}
+
+
+/*	Compute Vectors*16 results for each of Channels channels, as the
+	AVX2 blocks do.  In each channel's last vector, only the results
+	selected by Mask are computed and stored; the signal is not read
+	for the others.
+*/
+#define	DefineBlock(Channels, Vectors)					\
+AVX512 static inline void BlockAVX512_##Channels##x##Vectors(		\
+	const float *A, vDSP_Stride IMA, const float *F, vDSP_Stride IF,\
+	float *C, vDSP_Stride IC, vDSP_Stride IMC, vDSP_Length P,	\
+	__mmask16 Mask)							\
+{									\
+	__m512 Sum[Channels][Vectors];					\
+	for (int c = 0; c < Channels; ++c)				\
+		for (int v = 0; v < Vectors; ++v)			\
+			Sum[c][v] = _mm512_setzero_ps();		\
+									\
+	for (vDSP_Length p = 0; p < P; ++p, F += IF)			\
+	{								\
+		const __m512 f = _mm512_set1_ps(*F);			\
+		for (int c = 0; c < Channels; ++c)			\
+		{							\
+			const float *a = A + c*IMA + p;			\
+			for (int v = 0; v < Vectors-1; ++v)		\
+				Sum[c][v] = _mm512_fmadd_ps(		\
+					_mm512_loadu_ps(a + 16*v), f, Sum[c][v]); \
+			Sum[c][Vectors-1] = _mm512_fmadd_ps(		\
+				_mm512_maskz_loadu_ps(Mask, a + 16*(Vectors-1)), \
+				f, Sum[c][Vectors-1]);			\
+		}							\
+	}								\
+									\
+	for (int c = 0; c < Channels; ++c)				\
+	{								\
+		float *r = C + c*IMC;					\
+		for (int v = 0; v < Vectors-1; ++v)			\
+			StoreAVX512(r + 16*v*IC, IC, Sum[c][v], 0xffff); \
+		StoreAVX512(r + 16*(Vectors-1)*IC, IC, Sum[c][Vectors-1], \
+			Mask);						\
+	}								\
+}
+
+DefineBlock(4, 2)
+DefineBlock(4, 1)
+DefineBlock(1, 2)
+DefineBlock(1, 1)
+
+#undef	DefineBlock
+
+
+/*	Convolve with AVX-512 and FMA, four channels at a time and then one
+	at a time.  Within a group of channels, results are done 32 at a
+	time, then sixteen, and the last 1 to 15 with a mask.
+*/
+AVX512 static void ConvolveAVX512(const float *A, vDSP_Stride IA,
+	vDSP_Stride IMA, const float *F, vDSP_Stride IF, float *C,
+	vDSP_Stride IC, vDSP_Stride IMC, vDSP_Length N, vDSP_Length P,
+	vDSP_Length M)
+{
+	// Select the results left after the whole vectors.
+	const __mmask16 Tail = (__mmask16) ((1u << N % 16) - 1);
+
+	vDSP_Length m = 0;
+
+	for (; m + 4 <= M; m += 4)
+	{
+		const float *a = A + m*IMA;
+		float *c = C + m*IMC;
+		vDSP_Length n = 0;
+		for (; n + 32 <= N; n += 32)
+			BlockAVX512_4x2(a + n, IMA, F, IF, c + n*IC, IC, IMC, P,
+				0xffff);
+		for (; n + 16 <= N; n += 16)
+			BlockAVX512_4x1(a + n, IMA, F, IF, c + n*IC, IC, IMC, P,
+				0xffff);
+		if (n < N)
+			BlockAVX512_4x1(a + n, IMA, F, IF, c + n*IC, IC, IMC, P,
+				Tail);
+	}
+
+	for (; m < M; ++m)
+	{
+		const float *a = A + m*IMA;
+		float *c = C + m*IMC;
+		vDSP_Length n = 0;
+		for (; n + 32 <= N; n += 32)
+			BlockAVX512_1x2(a + n, IMA, F, IF, c + n*IC, IC, IMC, P,
+				0xffff);
+		for (; n + 16 <= N; n += 16)
+			BlockAVX512_1x1(a + n, IMA, F, IF, c + n*IC, IC, IMC, P,
+				0xffff);
+		if (n < N)
+			BlockAVX512_1x1(a + n, IMA, F, IF, c + n*IC, IC, IMC, P,
+				Tail);
+	}
+}
+
+
+#endif	// defined HasIntelVectors
+
+
+// Choose the best kernel the processor supports.
+static ConvolutionKernel *ChooseKernel(void)
+{
+	#if defined HasIntelVectors
+		const unsigned Features = CPUFeatures();
+		if ((Features & CPUAVX512) && (Features & CPUFMA))
+		{
+			NoteKernelVariant("MultichannelConvolution", "AVX-512");
+			return ConvolveAVX512;
+		}
+		if ((Features & CPUAVX2) && (Features & CPUFMA))
+		{
+			NoteKernelVariant("MultichannelConvolution", "AVX2");
+			return ConvolveAVX2;
+		}
+	#endif
+
+	NoteKernelVariant("MultichannelConvolution", "vDSP_conv per channel");
+	return ConvolveEachChannel;
+}
+
+
+void MultichannelConvolution(const float *A, vDSP_Stride IA, vDSP_Stride IMA,
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,
+	vDSP_Stride IMC, vDSP_Length N, vDSP_Length P, vDSP_Length M)
+{
+	/*	The choice is made on the first call.  If two threads race to
+		make it, they store the same value, so no lock is needed.
+	*/
+	static ConvolutionKernel *Kernel;
+	if (Kernel == NULL)
+		Kernel = ChooseKernel();
+
+	if (IA == 1)
+		Kernel(A, IA, IMA, F, IF, C, IC, IMC, N, P, M);
+	else
+		ConvolveEachChannel(A, IA, IMA, F, IF, C, IC, IMC, N, P, M);
+}
@@ -0,0 +1,39 @@
+/*	File: MultichannelConvolution.h
+
+	Description:
+		Declaration for a convolution that applies one filter to many
+		channels at once.
+*/
+#ifndef __MULTICHANNELCONVOLUTION__
+#define __MULTICHANNELCONVOLUTION__
+
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	Perform M convolutions with the same filter, as vDSP_conv does for
+	one:  for each channel m from 0 to M-1, this computes
+
+		vDSP_conv(A + m*IMA, IA, F, IF, C + m*IMC, IC, N, P).
+
+	IMA and IMC are the strides, in elements, from one channel's signal
+	and result to the next, as in vDSP_fftm_zop.  The results agree with
+	vDSP_conv's to within rounding; each result sums its products in
+	order of increasing filter index.
+*/
+void MultichannelConvolution(const float *A, vDSP_Stride IA, vDSP_Stride IMA,
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,
+	vDSP_Stride IMC, vDSP_Length N, vDSP_Length P, vDSP_Length M);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -0,0 +1,184 @@
+/*	File: NUMA.c
+
+	Description:
+		Thread and memory placement on NUMA machines, using libnuma
+		when it is available.  See NUMA.h.
+
+		libnuma is opened with dlopen rather than linked, so the
+		programs do not depend on it being installed.  If it cannot be
+		opened, lacks a routine used here, or reports that the kernel
+		has no NUMA support, the machine is treated as one node.
+*/
+
+
+#if defined __linux__
+	#define	_GNU_SOURCE
+	#include <dlfcn.h>
+	#include <sched.h>
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "NUMA.h"
+
+
+#if defined __linux__
+
+
+// The libnuma routines used, or null pointers if libnuma is not in use.
+static struct
+{
+	int (*numa_available)(void);
+	int (*numa_max_node)(void);
+	int (*numa_node_of_cpu)(int);
+	int (*numa_run_on_node)(int);
+	void (*numa_set_preferred)(int);
+	void (*numa_set_localalloc)(void);
+	void *(*numa_alloc_onnode)(size_t, int);
+	void (*numa_free)(void *, size_t);
+} Library;
+
+static int Loaded;
+static pthread_once_t LoadOnce = PTHREAD_ONCE_INIT;
+
+
+static void LoadLibrary(void)
+{
+	void *Handle = dlopen("libnuma.so.1", RTLD_NOW | RTLD_LOCAL);
+	if (Handle == NULL)
+		return;
+
+	// Assigning through a void ** is the POSIX idiom for dlsym.
+	#define	Load(Name)	(*(void **) &Library.Name = dlsym(Handle, #Name))
+	if (!Load(numa_available) || !Load(numa_max_node)
+		|| !Load(numa_node_of_cpu) || !Load(numa_run_on_node)
+		|| !Load(numa_set_preferred) || !Load(numa_set_localalloc)
+		|| !Load(numa_alloc_onnode) || !Load(numa_free)
+		|| Library.numa_available() < 0)
+	{
+		dlclose(Handle);
+		return;
+	}
+	#undef	Load
+
+	Loaded = 1;
+}
+
+
+static int UseLibrary(void)
+{
+	pthread_once(&LoadOnce, LoadLibrary);
+	return Loaded;
+}
+
+
+const char *NUMASupport(void)
+{
+	return UseLibrary() ? "libnuma" : "none";
+}
+
+
+unsigned NUMANodes(void)
+{
+	return UseLibrary() ? Library.numa_max_node() + 1 : 1;
+}
+
+
+unsigned CurrentNUMANode(void)
+{
+	if (!UseLibrary())
+		return 0;
+
+	const int CPU = sched_getcpu();
+	const int Node = CPU < 0 ? -1 : Library.numa_node_of_cpu(CPU);
+	return Node < 0 ? 0 : Node;
+}
+
+
+int BindThreadToNUMANode(int Node)
+{
+	if (!UseLibrary())
+		return Node == 0 || Node == AnyNUMANode;
+
+	if (Node == AnyNUMANode)
+	{
+		Library.numa_set_localalloc();
+		return Library.numa_run_on_node(-1) == 0;
+	}
+
+	if (Library.numa_run_on_node(Node) != 0)
+		return 0;
+	Library.numa_set_preferred(Node);
+	return 1;
+}
+
+
+/*	numa_alloc_onnode maps fresh pages and binds them to the node, so
+	where they are placed does not depend on which thread touches them
+	first or on what malloc reuses.
+*/
+void *AllocateOnNUMANode(size_t Size, int Node)
+{
+	if (Node == AnyNUMANode || !UseLibrary())
+		return malloc(Size);
+
+	return Library.numa_alloc_onnode(Size, Node);
+}
+
+
+void FreeOnNUMANode(void *Memory, size_t Size, int Node)
+{
+	if (Memory == NULL)
+		return;
+
+	if (Node == AnyNUMANode || !UseLibrary())
+		free(Memory);
+	else
+		Library.numa_free(Memory, Size);
+}
+
+
+#else	// defined __linux__
+
+
+const char *NUMASupport(void)
+{
+	return "none";
+}
+
+
+unsigned NUMANodes(void)
+{
+	return 1;
+}
+
+
+unsigned CurrentNUMANode(void)
+{
+	return 0;
+}
+
+
+int BindThreadToNUMANode(int Node)
+{
+	return Node == 0 || Node == AnyNUMANode;
+}
+
+
+void *AllocateOnNUMANode(size_t Size, int Node)
+{
+	(void) Node;
+	return malloc(Size);
+}
+
+
+void FreeOnNUMANode(void *Memory, size_t Size, int Node)
+{
+	(void) Size;
+	(void) Node;
+	free(Memory);
+}
+
+
+#endif	// defined __linux__
@@ -0,0 +1,71 @@
+/*	File: NUMA.h
+
+	Description:
+		Declarations for placing threads and memory on the nodes of a
+		non-uniform memory access (NUMA) machine.
+*/
+#ifndef __NUMA__
+#define __NUMA__
+
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	On a machine with several processor sockets, each socket has its own
+	memory, and a processor reads memory attached to another socket more
+	slowly than its own.  Linux places each page of memory on the node
+	of the thread that first touches it, so data prepared by one thread
+	and read by threads on other nodes are read remotely.
+
+	These routines use libnuma, loaded when first needed, so the
+	programs build and run without it.  Without libnuma, or on systems
+	other than Linux, the machine is treated as a single node and the
+	routines do nothing.
+*/
+
+
+// Pass this to BindThreadToNUMANode to remove a binding.
+enum { AnyNUMANode = -1 };
+
+
+// Return "libnuma" if libnuma is in use, or "none".
+const char *NUMASupport(void);
+
+// Return the number of nodes, which is 1 without libnuma.
+unsigned NUMANodes(void);
+
+// Return the node of the processor running the calling thread.
+unsigned CurrentNUMANode(void);
+
+/*	Run the calling thread only on the processors of Node and allocate
+	its new pages on Node where possible, or, with AnyNUMANode, run it
+	anywhere and allocate its pages on the node it runs on.  Return
+	nonzero if the binding took effect (or, without libnuma, if Node is
+	0 or AnyNUMANode).
+*/
+int BindThreadToNUMANode(int Node);
+
+/*	Allocate Size bytes whose pages are placed on Node, whichever thread
+	touches them first, or return NULL if the memory cannot be
+	allocated.  With AnyNUMANode, or without libnuma, this is malloc.
+	With libnuma, the memory is whole pages, so it suits large blocks.
+*/
+void *AllocateOnNUMANode(size_t Size, int Node);
+
+/*	Free memory from AllocateOnNUMANode, given the same Size and Node.
+	Memory may be NULL.
+*/
+void FreeOnNUMANode(void *Memory, size_t Size, int Node);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -0,0 +1,389 @@
+/*	File: Oscillator.c
+
+	Description:
+		A bank of sine oscillators, and a vectorized sine routine.
+
+		Each oscillator is a complex rotator:  it keeps z = exp(i*p),
+		where p is the current phase, and multiplies z by the constant
+		step exp(i*w) for each sample, so sin(p) is available as the
+		imaginary part of z at the cost of one complex multiplication
+		per sample, with no calls to sin.  The rounding errors of the
+		multiplications let the magnitude of z wander from one, slowly
+		but without bound, so every RenormalizationPeriod samples z is
+		multiplied by (3 - |z|**2) / 2, a Newton step toward 1/|z| that
+		restores the magnitude to within rounding error.  The phase is
+		not corrected; it drifts only by the rounding error in the step,
+		about 1e-7 radians per sample.
+
+		Each sample depends on the previous one, so one oscillator
+		would leave the processor waiting on that dependence.  The AVX2
+		kernel runs 32 oscillators at once, in four vectors of eight,
+		which keeps enough independent operations in flight to use the
+		vector units fully.  The other kernel is plain C whose inner
+		loop runs across oscillators, which compilers vectorize with the
+		vector unit available.
+
+		PolynomialSine is for phases that do not advance steadily, where
+		a rotator cannot be used.  It reduces each phase to a quarter
+		cycle around zero, using the symmetries of sine, and evaluates a
+		polynomial there.  The reduction and the polynomial use only
+		operations available in vector instructions, so the AVX2 kernel
+		computes eight sines at a time.  It uses fused multiply-adds, so
+		its results may differ from the plain C kernel's in the last
+		place.
+*/
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined __APPLE__ && (defined __i386__ || defined __x86_64__)
+	#include <immintrin.h>
+	#define	HasIntelVectors	1
+#endif
+
+#include "CPUFeatures.h"
+#include "Oscillator.h"
+
+
+static const double TwoPi = 0x3.243f6a8885a308d313198a2e03707344ap1;
+
+
+// Number of samples between renormalizations of each oscillator.
+#define	RenormalizationPeriod	256
+
+
+struct OscillatorBank
+{
+	vDSP_Length Count;
+
+	/*	For each oscillator, the current value of z, the step it is
+		multiplied by each sample, and the amplitude.  Each array has
+		room for a multiple of eight oscillators.
+	*/
+	float *Memory, *zr, *zi, *wr, *wi, *Amplitude;
+};
+
+
+OscillatorBank *CreateOscillatorBank(vDSP_Length Count)
+{
+	const vDSP_Length Padded = (Count + 7) & ~(vDSP_Length) 7;
+
+	OscillatorBank *Bank = malloc(sizeof *Bank);
+	float *Memory = calloc(5 * Padded, sizeof *Memory);
+	if (Bank == NULL || Memory == NULL)
+	{
+		fprintf(stderr, "Error, unable to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	Bank->Count     = Count;
+	Bank->Memory    = Memory;
+	Bank->zr        = Memory + 0*Padded;
+	Bank->zi        = Memory + 1*Padded;
+	Bank->wr        = Memory + 2*Padded;
+	Bank->wi        = Memory + 3*Padded;
+	Bank->Amplitude = Memory + 4*Padded;
+
+	// Start each oscillator at zero frequency and zero amplitude.
+	for (vDSP_Length i = 0; i < Count; ++i)
+		Bank->zr[i] = Bank->wr[i] = 1;
+
+	return Bank;
+}
+
+
+void DestroyOscillatorBank(OscillatorBank *Bank)
+{
+	free(Bank->Memory);
+	free(Bank);
+}
+
+
+void SetOscillator(OscillatorBank *Bank, vDSP_Length Index,
+	double Frequency, double Phase, float Amplitude)
+{
+	/*	Reduce the phase to a fraction of a cycle before multiplying
+		by 2*pi, so the argument of cos and sin stays small.
+	*/
+	Phase -= floor(Phase);
+
+	Bank->zr[Index]        = cos(TwoPi * Phase);
+	Bank->zi[Index]        = sin(TwoPi * Phase);
+	Bank->wr[Index]        = cos(TwoPi * Frequency);
+	Bank->wi[Index]        = sin(TwoPi * Frequency);
+	Bank->Amplitude[Index] = Amplitude;
+}
+
+
+/*	A run kernel advances oscillators First to First+N-1 by Length
+	samples, adding oscillator First+j's sample t to Output[t*Columns +
+	j].
+*/
+typedef void RunKernel(OscillatorBank *Bank, vDSP_Length First,
+	vDSP_Length N, float *Output, vDSP_Length Columns, vDSP_Length Length);
+
+// A sine kernel has the PolynomialSine interface.
+typedef void SineKernel(const float *Phase, float *Result, vDSP_Length N);
+
+typedef struct
+{
+	const char *Name;
+	RunKernel *Run;
+	SineKernel *Sine;
+} Kernels;
+
+
+// Run the oscillators with plain C, looping across oscillators.
+static void RunScalar(OscillatorBank *Bank, vDSP_Length First,
+	vDSP_Length N, float *Output, vDSP_Length Columns, vDSP_Length Length)
+{
+	float
+		* restrict zr = Bank->zr + First,
+		* restrict zi = Bank->zi + First;
+	const float
+		* restrict wr = Bank->wr + First,
+		* restrict wi = Bank->wi + First,
+		* restrict A  = Bank->Amplitude + First;
+
+	for (vDSP_Length t0 = 0; t0 < Length; t0 += RenormalizationPeriod)
+	{
+		vDSP_Length t1 = t0 + RenormalizationPeriod;
+		if (Length < t1)
+			t1 = Length;
+
+		for (vDSP_Length t = t0; t < t1; ++t)
+		{
+			float * restrict o = Output + t*Columns;
+			for (vDSP_Length j = 0; j < N; ++j)
+			{
+				o[j] += A[j] * zi[j];
+				const float r = zr[j] * wr[j] - zi[j] * wi[j];
+				const float i = zr[j] * wi[j] + zi[j] * wr[j];
+				zr[j] = r;
+				zi[j] = i;
+			}
+		}
+
+		for (vDSP_Length j = 0; j < N; ++j)
+		{
+			const float g = 1.5f - .5f * (zr[j]*zr[j] + zi[j]*zi[j]);
+			zr[j] *= g;
+			zi[j] *= g;
+		}
+	}
+}
+
+
+/*	Set Result[i] to sin(2*pi*Phase[i]).
+
+	r = Phase - rint(Phase) is in [-1/2, 1/2], and sin(2*pi*r) is
+	unchanged by replacing |r| with 1/2 - |r|, so taking the lesser of
+	the two puts r in [-1/4, 1/4].  There, the Taylor series of sine
+	through the x**11 term has error below 6e-8.
+*/
+static void SineScalar(const float *Phase, float *Result, vDSP_Length N)
+{
+	for (vDSP_Length i = 0; i < N; ++i)
+	{
+		float r = Phase[i] - rintf(Phase[i]);
+		const float a = fabsf(r), b = .5f - a;
+		r = copysignf(a < b ? a : b, r);
+
+		const float x = r * (float) TwoPi, x2 = x*x;
+		Result[i] = x + x * x2 * (-1.f/6 + x2 * (1.f/120 + x2 * (-1.f/5040
+			+ x2 * (1.f/362880 + x2 * (-1.f/39916800)))));
+	}
+}
+
+
+static const Kernels ScalarKernels = { "scalar", RunScalar, SineScalar };
+
+
+#if defined HasIntelVectors
+
+
+#define	AVX2	__attribute__((__target__("avx2,fma")))
+
+
+/*	Run Vectors vectors of eight oscillators, with Vectors a
+	compile-time constant so the oscillators stay in registers.
+*/
+#define	DefineBlock(Vectors)						\
+AVX2 static inline void RunBlock##Vectors(OscillatorBank *Bank,	\
+	vDSP_Length First, float *Output, vDSP_Length Columns,		\
+	vDSP_Length Length)						\
+{									\
+	__m256 zr[Vectors], zi[Vectors], wr[Vectors], wi[Vectors],	\
+		A[Vectors];						\
+	for (int v = 0; v < Vectors; ++v)				\
+	{								\
+		zr[v] = _mm256_loadu_ps(Bank->zr + First + 8*v);	\
+		zi[v] = _mm256_loadu_ps(Bank->zi + First + 8*v);	\
+		wr[v] = _mm256_loadu_ps(Bank->wr + First + 8*v);	\
+		wi[v] = _mm256_loadu_ps(Bank->wi + First + 8*v);	\
+		A [v] = _mm256_loadu_ps(Bank->Amplitude + First + 8*v); \
+	}								\
+									\
+	const __m256 Half = _mm256_set1_ps(.5f),			\
+		ThreeHalves = _mm256_set1_ps(1.5f);			\
+									\
+	for (vDSP_Length t0 = 0; t0 < Length; t0 += RenormalizationPeriod) \
+	{								\
+		vDSP_Length t1 = t0 + RenormalizationPeriod;		\
+		if (Length < t1)					\
+			t1 = Length;					\
+									\
+		for (vDSP_Length t = t0; t < t1; ++t)			\
+			for (int v = 0; v < Vectors; ++v)		\
+			{						\
+				float *o = Output + t*Columns + 8*v;	\
+				_mm256_storeu_ps(o,			\
+					_mm256_fmadd_ps(A[v], zi[v], _mm256_loadu_ps(o))); \
+				const __m256 r = _mm256_fmsub_ps(zr[v], wr[v], \
+					_mm256_mul_ps(zi[v], wi[v]));	\
+				const __m256 i = _mm256_fmadd_ps(zr[v], wi[v], \
+					_mm256_mul_ps(zi[v], wr[v]));	\
+				zr[v] = r;				\
+				zi[v] = i;				\
+			}						\
+									\
+		for (int v = 0; v < Vectors; ++v)			\
+		{							\
+			const __m256 m = _mm256_fmadd_ps(zr[v], zr[v],	\
+				_mm256_mul_ps(zi[v], zi[v]));		\
+			const __m256 g = _mm256_fnmadd_ps(Half, m, ThreeHalves); \
+			zr[v] = _mm256_mul_ps(zr[v], g);		\
+			zi[v] = _mm256_mul_ps(zi[v], g);		\
+		}							\
+	}								\
+									\
+	for (int v = 0; v < Vectors; ++v)				\
+	{								\
+		_mm256_storeu_ps(Bank->zr + First + 8*v, zr[v]);	\
+		_mm256_storeu_ps(Bank->zi + First + 8*v, zi[v]);	\
+	}								\
+}
+
+DefineBlock(4)
+DefineBlock(1)
+
+#undef	DefineBlock
+
+
+/*	Run the oscillators 32 at a time with AVX2 and FMA, then eight at a
+	time, and finish any remainder with plain C.
+*/
+AVX2 static void RunAVX2(OscillatorBank *Bank, vDSP_Length First,
+	vDSP_Length N, float *Output, vDSP_Length Columns, vDSP_Length Length)
+{
+	vDSP_Length j = 0;
+
+	for (; j + 32 <= N; j += 32)
+		RunBlock4(Bank, First + j, Output + j, Columns, Length);
+
+	for (; j + 8 <= N; j += 8)
+		RunBlock1(Bank, First + j, Output + j, Columns, Length);
+
+	if (j < N)
+		RunScalar(Bank, First + j, N - j, Output + j, Columns, Length);
+}
+
+
+// Compute eight sines at a time, as SineScalar does.
+AVX2 static void SineAVX2(const float *Phase, float *Result, vDSP_Length N)
+{
+	const __m256
+		SignBit    = _mm256_set1_ps(-0.f),
+		Half       = _mm256_set1_ps(.5f),
+		Scale      = _mm256_set1_ps((float) TwoPi),
+		c3         = _mm256_set1_ps(-1.f/6),
+		c5         = _mm256_set1_ps(1.f/120),
+		c7         = _mm256_set1_ps(-1.f/5040),
+		c9         = _mm256_set1_ps(1.f/362880),
+		c11        = _mm256_set1_ps(-1.f/39916800);
+
+	vDSP_Length i = 0;
+	for (; i + 8 <= N; i += 8)
+	{
+		const __m256 p = _mm256_loadu_ps(Phase + i);
+		__m256 r = _mm256_sub_ps(p, _mm256_round_ps(p,
+			_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+		const __m256
+			s = _mm256_and_ps(SignBit, r),
+			a = _mm256_andnot_ps(SignBit, r),
+			b = _mm256_sub_ps(Half, a);
+		r = _mm256_or_ps(s, _mm256_min_ps(a, b));
+
+		const __m256 x = _mm256_mul_ps(r, Scale), x2 = _mm256_mul_ps(x, x);
+		__m256 q = _mm256_fmadd_ps(x2, c11, c9);
+		q = _mm256_fmadd_ps(x2, q, c7);
+		q = _mm256_fmadd_ps(x2, q, c5);
+		q = _mm256_fmadd_ps(x2, q, c3);
+		_mm256_storeu_ps(Result + i,
+			_mm256_fmadd_ps(_mm256_mul_ps(x, x2), q, x));
+	}
+
+	if (i < N)
+		SineScalar(Phase + i, Result + i, N - i);
+}
+
+
+static const Kernels AVX2Kernels = { "AVX2", RunAVX2, SineAVX2 };
+
+
+#endif	// defined HasIntelVectors
+
+
+// Choose the best kernels the processor supports.
+static const Kernels *ChooseKernels(void)
+{
+	const Kernels *K = &ScalarKernels;
+
+	#if defined HasIntelVectors
+		const unsigned Features = CPUFeatures();
+		if ((Features & CPUAVX2) && (Features & CPUFMA))
+			K = &AVX2Kernels;
+	#endif
+
+	NoteKernelVariant("Oscillators", K->Name);
+	return K;
+}
+
+
+/*	Return the kernels to use.  The choice is made on the first call.
+	If two threads race to make it, they store the same value, so no
+	lock is needed.
+*/
+static const Kernels *GetKernels(void)
+{
+	static const Kernels *K;
+	if (K == NULL)
+		K = ChooseKernels();
+	return K;
+}
+
+
+void RunOscillators(OscillatorBank *Bank, float *Output,
+	vDSP_Length Columns, vDSP_Length Length)
+{
+	const Kernels *K = GetKernels();
+
+	/*	Oscillators are taken a row of Columns at a time, since within
+		a row consecutive oscillators add to consecutive elements.
+	*/
+	for (vDSP_Length First = 0; First < Bank->Count; First += Columns)
+	{
+		vDSP_Length N = Bank->Count - First;
+		if (Columns < N)
+			N = Columns;
+		K->Run(Bank, First, N, Output, Columns, Length);
+	}
+}
+
+
+void PolynomialSine(const float *Phase, float *Result, vDSP_Length N)
+{
+	GetKernels()->Sine(Phase, Result, N);
+}
@@ -0,0 +1,56 @@
+/*	File: Oscillator.h
+
+	Description:
+		Declarations for a bank of sine oscillators that generate tones
+		for many channels at once, and for a vectorized sine routine.
+*/
+#ifndef __OSCILLATOR__
+#define __OSCILLATOR__
+
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+typedef struct OscillatorBank OscillatorBank;
+
+
+/*	Create a bank of Count oscillators, all silent, or release one.
+	All memory a bank needs is allocated when it is created.
+*/
+OscillatorBank *CreateOscillatorBank(vDSP_Length Count);
+void DestroyOscillatorBank(OscillatorBank *Bank);
+
+/*	Set oscillator Index to produce Amplitude * sin(2*pi*(Frequency*t +
+	Phase)) at sample t, counting from the next sample it generates.
+	Frequency is in cycles per sample and Phase in cycles.
+*/
+void SetOscillator(OscillatorBank *Bank, vDSP_Length Index,
+	double Frequency, double Phase, float Amplitude);
+
+/*	Add the next Length samples of every oscillator to Output, a
+	Length*Columns array in row-major order:  oscillator i adds its
+	sample t to Output[t*Columns + i%Columns].  With Columns channels
+	interleaved in Output, oscillators c and c+Columns both add to
+	channel c, which suits generating a pair of tones per channel.
+*/
+void RunOscillators(OscillatorBank *Bank, float *Output,
+	vDSP_Length Columns, vDSP_Length Length);
+
+/*	Set Result[i] to sin(2*pi*Phase[i]) for 0 <= i < N, with Phase in
+	cycles.  The error is a few units in the last place for any phase
+	whose fraction is represented accurately.
+*/
+void PolynomialSine(const float *Phase, float *Result, vDSP_Length N);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
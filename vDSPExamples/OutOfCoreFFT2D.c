@@ -0,0 +1,257 @@
+/*	File: OutOfCoreFFT2D.c
+
+	Description:
+		A two-dimensional FFT of an array in a file, working through
+		memory mappings of the files.  See OutOfCoreFFT2D.h.
+
+		The rows and columns are processed in blocks of B, a power of
+		two chosen so that a panel of B rows, and a strip of B columns,
+		each fit in the memory allowed.  The scratch file holds the
+		array cut into B*B tiles, with the tiles of each strip of
+		columns together, so a strip is one contiguous B-column array in
+		row-major order:  element (r, c) of the array is at
+		(c - c%B) * NR + r*B + c%B.  Writing a panel's tiles writes
+		NC/B blocks of B*B elements, reading or writing a strip is
+		sequential, and gathering the tiles of a panel back into rows
+		again reads NC/B blocks.
+
+		While each block is processed, the system is advised that the
+		next block will be needed soon, so it reads it ahead, and that
+		the previous one is not needed, so its pages may be reclaimed
+		(changes to them are kept, since the mappings are shared).
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "OutOfCoreFFT2D.h"
+
+
+// Describe a file mapped into memory.
+typedef struct
+{
+	int Descriptor;
+	size_t Size;
+	float *Memory;
+	DSPSplitComplex Planes;	// The real and imaginary planes.
+} MappedFile;
+
+
+// Report a failed operation on a file and exit.
+static void Fail(const char *Operation, const char *Name)
+{
+	fprintf(stderr, "Error, unable to %s %s (%s).\n",
+		Operation, Name, strerror(errno));
+	exit(EXIT_FAILURE);
+}
+
+
+/*	Map the file Name, of Size bytes, for reading, or, if Create is
+	nonzero, create it with that size and map it for reading and writing.
+*/
+static MappedFile MapFile(const char *Name, size_t Size, int Create)
+{
+	MappedFile F;
+
+	F.Descriptor = Create
+		? open(Name, O_RDWR | O_CREAT | O_TRUNC, 0666)
+		: open(Name, O_RDONLY);
+	if (F.Descriptor < 0)
+		Fail("open", Name);
+
+	if (Create)
+	{
+		if (ftruncate(F.Descriptor, Size) != 0)
+			Fail("set the size of", Name);
+	}
+	else
+	{
+		struct stat Status;
+		if (fstat(F.Descriptor, &Status) != 0)
+			Fail("get the size of", Name);
+		if ((size_t) Status.st_size < Size)
+		{
+			fprintf(stderr, "Error, %s is smaller than the array.\n", Name);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	F.Memory = mmap(NULL, Size, Create ? PROT_READ | PROT_WRITE : PROT_READ,
+		MAP_SHARED, F.Descriptor, 0);
+	if (F.Memory == MAP_FAILED)
+		Fail("map", Name);
+
+	F.Size = Size;
+	F.Planes.realp = F.Memory;
+	F.Planes.imagp = F.Memory + Size / 2 / sizeof *F.Memory;
+
+	return F;
+}
+
+
+static void UnmapFile(MappedFile *F)
+{
+	munmap(F->Memory, F->Size);
+	close(F->Descriptor);
+}
+
+
+/*	Advise the system about elements Start to Start+Length-1 of both
+	planes of a file.  Advice is only a hint, so failures are ignored.
+*/
+static void Advise(const MappedFile *F, size_t Start, size_t Length,
+	int Advice)
+{
+	const uintptr_t Page = sysconf(_SC_PAGESIZE);
+	const float *Planes[] = { F->Planes.realp, F->Planes.imagp };
+
+	for (int i = 0; i < 2; ++i)
+	{
+		const uintptr_t
+			Begin = (uintptr_t) (Planes[i] + Start) & -Page,
+			End   = (uintptr_t) (Planes[i] + Start + Length);
+		madvise((void *) Begin, End - Begin, Advice);
+	}
+}
+
+
+void OutOfCoreFFT2D_zop(FFTSetup Setup, const char *Input,
+	const char *Scratch, const char *Output, vDSP_Length Log2N0,
+	vDSP_Length Log2N1, FFTDirection Direction, size_t Memory)
+{
+	const vDSP_Length NC = (vDSP_Length) 1 << Log2N0;	// Columns.
+	const vDSP_Length NR = (vDSP_Length) 1 << Log2N1;	// Rows.
+	const size_t Size = 2 * NR * NC * sizeof(float);
+
+	/*	Choose the block size, the greatest power of two no greater than
+		either dimension for which a panel or strip fits in Memory.
+	*/
+	const vDSP_Length Longer = NR < NC ? NC : NR;
+	vDSP_Length B = NR < NC ? NR : NC;
+	while (1 < B && Memory < 2 * B * Longer * sizeof(float))
+		B /= 2;
+
+	MappedFile
+		In    = MapFile(Input,   Size, 0),
+		Tiles = MapFile(Scratch, Size, 1),
+		Out   = MapFile(Output,  Size, 1);
+
+	// Allocate a buffer for a panel of rows or a strip of columns.
+	float *BufferMemory = malloc(2 * B * Longer * sizeof *BufferMemory);
+	if (BufferMemory == NULL)
+	{
+		fprintf(stderr, "Error, failed to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+	const DSPSplitComplex Buffer =
+		{ BufferMemory, BufferMemory + B * Longer };
+
+	const size_t PanelBytes = B * NC * sizeof(float);
+	vDSP_Length p, s, r, c;
+
+	/*	Transform the rows a panel at a time, and write each panel's
+		tiles to the scratch file.
+	*/
+	madvise(In.Memory, In.Size, MADV_SEQUENTIAL);
+	for (p = 0; p < NR; p += B)
+	{
+		if (p + B < NR)
+			Advise(&In, (p+B) * NC, B * NC, MADV_WILLNEED);
+
+		memcpy(Buffer.realp, In.Planes.realp + p*NC, PanelBytes);
+		memcpy(Buffer.imagp, In.Planes.imagp + p*NC, PanelBytes);
+		Advise(&In, p * NC, B * NC, MADV_DONTNEED);
+
+		for (r = 0; r < B; ++r)
+		{
+			DSPSplitComplex Row =
+				{ Buffer.realp + r*NC, Buffer.imagp + r*NC };
+			vDSP_fft_zip(Setup, &Row, 1, Log2N0, Direction);
+		}
+
+		for (s = 0; s < NC; s += B)
+			for (r = 0; r < B; ++r)
+			{
+				const size_t To = s*NR + (p+r)*B, From = r*NC + s;
+				memcpy(Tiles.Planes.realp + To, Buffer.realp + From,
+					B * sizeof(float));
+				memcpy(Tiles.Planes.imagp + To, Buffer.imagp + From,
+					B * sizeof(float));
+			}
+	}
+
+	/*	Transform the columns a strip at a time.  Each strip is
+		transposed into the buffer, so the columns are contiguous,
+		transformed, and transposed back.
+	*/
+	madvise(Tiles.Memory, Tiles.Size, MADV_SEQUENTIAL);
+	for (s = 0; s < NC; s += B)
+	{
+		if (s + B < NC)
+			Advise(&Tiles, (s+B) * NR, B * NR, MADV_WILLNEED);
+
+		const DSPSplitComplex Strip =
+			{ Tiles.Planes.realp + s*NR, Tiles.Planes.imagp + s*NR };
+
+		for (r = 0; r < NR; ++r)
+			for (c = 0; c < B; ++c)
+			{
+				Buffer.realp[c*NR + r] = Strip.realp[r*B + c];
+				Buffer.imagp[c*NR + r] = Strip.imagp[r*B + c];
+			}
+
+		for (c = 0; c < B; ++c)
+		{
+			DSPSplitComplex Column =
+				{ Buffer.realp + c*NR, Buffer.imagp + c*NR };
+			vDSP_fft_zip(Setup, &Column, 1, Log2N1, Direction);
+		}
+
+		for (r = 0; r < NR; ++r)
+			for (c = 0; c < B; ++c)
+			{
+				Strip.realp[r*B + c] = Buffer.realp[c*NR + r];
+				Strip.imagp[r*B + c] = Buffer.imagp[c*NR + r];
+			}
+	}
+
+	/*	Gather the tiles of each panel back into rows and write them to
+		the output file.
+	*/
+	madvise(Tiles.Memory, Tiles.Size, MADV_NORMAL);
+	madvise(Out.Memory, Out.Size, MADV_SEQUENTIAL);
+	for (p = 0; p < NR; p += B)
+	{
+		for (s = 0; s < NC; s += B)
+		{
+			if (p + B < NR)
+				Advise(&Tiles, s*NR + (p+B)*B, B * B, MADV_WILLNEED);
+
+			for (r = 0; r < B; ++r)
+			{
+				const size_t To = (p+r)*NC + s, From = s*NR + (p+r)*B;
+				memcpy(Out.Planes.realp + To, Tiles.Planes.realp + From,
+					B * sizeof(float));
+				memcpy(Out.Planes.imagp + To, Tiles.Planes.imagp + From,
+					B * sizeof(float));
+			}
+
+			Advise(&Tiles, s*NR + p*B, B * B, MADV_DONTNEED);
+		}
+
+		Advise(&Out, p * NC, B * NC, MADV_DONTNEED);
+	}
+
+	free(BufferMemory);
+	UnmapFile(&Out);
+	UnmapFile(&Tiles);
+	UnmapFile(&In);
+}
@@ -0,0 +1,66 @@
+/*	File: OutOfCoreFFT2D.h
+
+	Description:
+		Declarations for a two-dimensional FFT of an array stored in a
+		file, for arrays larger than memory.
+*/
+#ifndef __OUTOFCOREFFT2D__
+#define __OUTOFCOREFFT2D__
+
+
+#include <stddef.h>
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	vDSP_fft2d_zip needs the whole array in memory.  A 65536 by 65536
+	complex image is 32 GiB, so this routine instead works on an array in
+	a file, through memory mappings, keeping only a limited part of it in
+	memory at a time:
+
+		The rows are transformed a panel of rows at a time, and each
+		panel is written to a scratch file cut into tiles.  The tiles
+		are arranged so that each strip of columns is contiguous in the
+		scratch file.
+
+		The columns are transformed a strip at a time, in place in the
+		scratch file.
+
+		The tiles are gathered back into rows and written to the
+		output file.
+
+	Each pass reads and writes its files in large blocks, mostly in
+	order, and tells the system which parts it will need next, so the
+	system can read ahead.  In all, the routine reads and writes six
+	times the size of the array.
+
+	A file holds an array of 2**Log2N1 rows of 2**Log2N0 complex
+	elements as two planes of floats, the real parts followed by the
+	imaginary parts, each in row-major order (so the file has the layout
+	of a DSPSplitComplex whose imaginary part follows its real part).
+	The results are those of vDSP_fft2d_zop with unit strides.
+
+	Input is the name of the input file.  Scratch and Output are the
+	names of files to create, or to replace if they exist; Scratch may
+	be removed afterward.  Memory is a bound on the bytes of the array
+	to work on at once (the files' pages remain in the system's cache
+	as the system allows).  The setup must support transforms of
+	2**max(Log2N0, Log2N1) elements.  Any error ends the program with
+	a message.
+*/
+void OutOfCoreFFT2D_zop(FFTSetup Setup, const char *Input,
+	const char *Scratch, const char *Output, vDSP_Length Log2N0,
+	vDSP_Length Log2N1, FFTDirection Direction, size_t Memory);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -0,0 +1,105 @@
+/*	File: ParallelConvolution.c
+
+	Description:
+		A convolution of one long signal that uses several threads.
+
+		Each result of a convolution depends only on the signal and the
+		filter, not on other results, so the range of results divides
+		among threads with no communication.  Chunk k computes results
+		k*Chunk to (k+1)*Chunk-1 by calling vDSP_conv with the signal
+		and result pointers advanced by k*Chunk elements.
+
+		The chunk size balances two needs.  A chunk reads Chunk+P-1
+		signal elements and all P filter elements for every result; if
+		those stay in the second-level cache, each is fetched from
+		memory once rather than once per filter tap.  And there should
+		be several chunks per thread, so that a thread slowed by an
+		interrupt or a busy core does not hold up the rest.
+
+		Chunks start at multiples of Block results.  The vector kernels
+		of the portable vDSP_conv work in blocks of up to Block results
+		counted from the first result, and each block's results are
+		accumulated in the same order wherever the block starts, so
+		every result is computed by the same instructions as in a single
+		call, and the results are bit-identical.
+
+		Only vDSP_conv is called, so this works with both Accelerate and
+		the portable routines.
+*/
+
+
+#include <stddef.h>
+
+#include "ParallelConvolution.h"
+
+
+/*	Bytes of signal and filter one chunk should keep in cache, half of
+	the smallest second-level cache in common use, leaving room for the
+	results and for other data.
+*/
+#define	CacheBytes	(128 * 1024)
+
+// Results in the largest block of the portable vDSP_conv kernels.
+#define	Block		128
+
+// Least number of chunks to give each thread.
+#define	ChunksPerThread	4
+
+
+// Describe a convolution divided into chunks.
+typedef struct
+{
+	const float *A, *F;
+	vDSP_Stride IA, IF, IC;
+	float *C;
+	vDSP_Length N, P;
+	vDSP_Length Chunk;		// Results per chunk.
+	MathMode Mode;			// The caller's math mode.
+} Convolution;
+
+
+// Compute chunk Index of the results.
+static void ConvolutionTask(void *Context, unsigned long Index)
+{
+	const Convolution *c = Context;
+	const vDSP_Length n = Index * c->Chunk;
+	const vDSP_Length Length = n + c->Chunk < c->N ? c->Chunk : c->N - n;
+
+	MathModeGuard Guard = EnterMathMode(c->Mode);
+	vDSP_conv(c->A + n*c->IA, c->IA, c->F, c->IF, c->C + n*c->IC, c->IC,
+		Length, c->P);
+	LeaveMathMode(Guard);
+}
+
+
+void ParallelConvolution(ThreadPool *Pool,
+	const float *A, vDSP_Stride IA, const float *F, vDSP_Stride IF,
+	float *C, vDSP_Stride IC, vDSP_Length N, vDSP_Length P)
+{
+	if (Pool == NULL)
+		Pool = DefaultThreadPool();
+
+	const vDSP_Length Threads = ThreadPoolThreads(Pool);
+
+	/*	Size chunks to fit in cache, but make enough of them for every
+		thread to have several, and round to a multiple of Block.
+	*/
+	const vDSP_Length Fit = CacheBytes / sizeof *A;
+	vDSP_Length Chunk = P < Fit ? Fit - P : 0;
+	const vDSP_Length Share = N / (ChunksPerThread * Threads);
+	if (Share < Chunk)
+		Chunk = Share;
+	Chunk = Chunk / Block * Block;
+	if (Chunk < Block)
+		Chunk = Block;
+
+	// Do the whole convolution in one call if it would not be shared.
+	if (Threads == 1 || N <= Chunk)
+	{
+		vDSP_conv(A, IA, F, IF, C, IC, N, P);
+		return;
+	}
+
+	Convolution c = { A, F, IA, IF, IC, C, N, P, Chunk, CurrentMathMode() };
+	RunThreadPool(Pool, ConvolutionTask, &c, (N + Chunk - 1) / Chunk);
+}
@@ -0,0 +1,47 @@
+/*	File: ParallelConvolution.h
+
+	Description:
+		Declaration for a convolution of one long signal that divides
+		its results among the threads of a ThreadPool.
+*/
+#ifndef __PARALLELCONVOLUTION__
+#define __PARALLELCONVOLUTION__
+
+
+#include "PortableDSP.h"
+#include "ThreadPool.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	This routine takes the same arguments as vDSP_conv, plus a pool of
+	threads to use (NULL selects DefaultThreadPool()), and produces the
+	same results as vDSP_conv called by the same thread.  With the
+	portable vDSP_conv, they are the same bit for bit (see
+	ParallelConvolution.c).
+
+	The N results are divided into chunks, each computed by one call to
+	vDSP_conv on one of the pool's threads.  A chunk is sized so that the
+	part of the signal it reads and the filter fit in a processor's
+	second-level cache, but there are at least a few chunks per thread,
+	so threads that finish early can take more.  Each task runs in the
+	caller's math mode rather than the pool's, so subnormals are handled
+	as the serial routine would handle them.
+
+	When N is too small to give each thread a chunk, vDSP_conv is called
+	directly.
+*/
+void ParallelConvolution(ThreadPool *Pool,
+	const float *A, vDSP_Stride IA, const float *F, vDSP_Stride IF,
+	float *C, vDSP_Stride IC, vDSP_Length N, vDSP_Length P);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -0,0 +1,334 @@
+/*	File: ParallelFFT2D.c
+
+	Description:
+		Two-dimensional FFTs that use several threads.
+
+		A two-dimensional FFT is a one-dimensional FFT of every row
+		followed by a one-dimensional FFT of every column.  The rows are
+		independent of each other, and so are the columns, so each pass
+		divides evenly among threads.  The rows are contiguous in memory,
+		but the elements of a column are a whole row apart, and reading
+		them directly touches a different cache line (and often a
+		different page) for every element.  So between the passes the
+		array is transposed, making the columns contiguous, and after the
+		column pass it is transposed back.
+
+		The transposes are cache-blocked:  they move Tile*Tile squares,
+		small enough that the source and destination lines of a square
+		stay in the first-level cache while it is moved.  The transposes
+		are parallel too, one band of Tile rows per task.
+
+		The transposed array is as large as the original, so allocating
+		it on each call would fault in fresh pages every time, and the
+		kernel handles page faults largely one at a time, however many
+		threads take them.  Instead, each calling thread keeps its
+		buffer, enlarged as needed, and repeated transforms of the same
+		size allocate nothing after the first.
+
+		Only the one-dimensional vDSP routines are called, so this works
+		with both Accelerate and the portable routines.
+*/
+
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ParallelFFT2D.h"
+
+
+// Side of the squares moved by the cache-blocked transpose.
+#define	Tile	32
+
+
+// Describe a pass of one-dimensional FFTs over the rows of an array.
+typedef struct
+{
+	FFTSetup Setup;
+	DSPSplitComplex Data;		// Start of row 0.
+	vDSP_Stride RowStride;		// Elements from one row to the next.
+	vDSP_Length Log2N;		// Base-two logarithm of the row length.
+	FFTDirection Direction;
+
+	/*	Working space for RealColumnTask, 2**Log2N floats, or NULL.
+		Only the task for row 0 uses it, so one buffer serves the pass.
+	*/
+	float *Work;
+} RowPass;
+
+
+// Perform a complex FFT on row Index.
+static void ComplexRowTask(void *Context, unsigned long Index)
+{
+	const RowPass *P = Context;
+	DSPSplitComplex Row =
+	{
+		P->Data.realp + Index * P->RowStride,
+		P->Data.imagp + Index * P->RowStride
+	};
+	vDSP_fft_zip(P->Setup, &Row, 1, P->Log2N, P->Direction);
+}
+
+
+// Perform a real-to-complex FFT on row Index.
+static void RealRowTask(void *Context, unsigned long Index)
+{
+	const RowPass *P = Context;
+	DSPSplitComplex Row =
+	{
+		P->Data.realp + Index * P->RowStride,
+		P->Data.imagp + Index * P->RowStride
+	};
+	vDSP_fft_zrip(P->Setup, &Row, 1, P->Log2N, P->Direction);
+}
+
+
+/*	Transform a real signal of 2**Log2N elements stored contiguously,
+	leaving the packed result interleaved in place (real and imaginary
+	parts alternating, as vDSP_ztoc arranges them).  This is the layout
+	of column 0 of the vDSP two-dimensional real-to-complex FFT, which
+	after the row pass holds the DC terms of the rows in realp and the
+	Nyquist terms in imagp.  Memory provides 2**Log2N floats of working
+	space.
+*/
+static void RealColumn(FFTSetup Setup, float *Signal, vDSP_Length Log2N,
+	FFTDirection Direction, float *Memory)
+{
+	const vDSP_Length N = (vDSP_Length) 1 << Log2N;
+
+	DSPSplitComplex Buffer = { Memory, Memory + N/2 };
+
+	vDSP_ctoz((const DSPComplex *) Signal, 2, &Buffer, 1, N/2);
+	vDSP_fft_zrip(Setup, &Buffer, 1, Log2N, Direction);
+
+	/*	The forward real-to-complex FFT scales by two, but the rows were
+		already scaled, so remove the extra factor here.
+	*/
+	if (Direction == FFT_FORWARD)
+		for (vDSP_Length i = 0; i < N; ++i)
+			Memory[i] *= .5f;
+
+	vDSP_ztoc(&Buffer, 1, (DSPComplex *) Signal, 2, N/2);
+}
+
+
+/*	Perform the column pass of a real-to-complex FFT on row Index of the
+	transposed array.  Row 0 is column 0 of the original array and holds
+	two real signals; the other rows are ordinary complex columns.
+*/
+static void RealColumnTask(void *Context, unsigned long Index)
+{
+	const RowPass *P = Context;
+	if (Index == 0)
+	{
+		RealColumn(P->Setup, P->Data.realp, P->Log2N, P->Direction,
+			P->Work);
+		RealColumn(P->Setup, P->Data.imagp, P->Log2N, P->Direction,
+			P->Work);
+	}
+	else
+		ComplexRowTask(Context, Index);
+}
+
+
+/*	Describe a transpose of a Rows*Columns split-complex array From, with
+	rows FromStride elements apart, into To, with rows ToStride apart.
+*/
+typedef struct
+{
+	DSPSplitComplex From, To;
+	vDSP_Stride FromStride, ToStride;
+	vDSP_Length Rows, Columns;
+} Transpose;
+
+
+// Transpose one plane of a band of up to Tile rows, a tile at a time.
+static void TransposeBand(const float *From, vDSP_Stride FromStride,
+	float *To, vDSP_Stride ToStride,
+	vDSP_Length r0, vDSP_Length r1, vDSP_Length Columns)
+{
+	for (vDSP_Length c0 = 0; c0 < Columns; c0 += Tile)
+	{
+		const vDSP_Length c1 = c0 + Tile < Columns ? c0 + Tile : Columns;
+		for (vDSP_Length r = r0; r < r1; ++r)
+			for (vDSP_Length c = c0; c < c1; ++c)
+				To[c*ToStride + r] = From[r*FromStride + c];
+	}
+}
+
+
+// Transpose band Index, rows Index*Tile to Index*Tile+Tile-1.
+static void TransposeTask(void *Context, unsigned long Index)
+{
+	const Transpose *T = Context;
+	const vDSP_Length r0 = Index * Tile;
+	const vDSP_Length r1 = r0 + Tile < T->Rows ? r0 + Tile : T->Rows;
+
+	TransposeBand(T->From.realp, T->FromStride, T->To.realp, T->ToStride,
+		r0, r1, T->Columns);
+	TransposeBand(T->From.imagp, T->FromStride, T->To.imagp, T->ToStride,
+		r0, r1, T->Columns);
+}
+
+
+// Transpose in parallel.
+static void RunTranspose(ThreadPool *Pool, const DSPSplitComplex *From,
+	vDSP_Stride FromStride, const DSPSplitComplex *To, vDSP_Stride ToStride,
+	vDSP_Length Rows, vDSP_Length Columns)
+{
+	Transpose T = { *From, *To, FromStride, ToStride, Rows, Columns };
+	RunThreadPool(Pool, TransposeTask, &T, (Rows + Tile - 1) / Tile);
+}
+
+
+/*	Each thread that calls these routines keeps one buffer for the
+	transposed array, enlarged as needed.  The pool's threads work in the
+	buffer of the thread that called RunThreadPool, which does not return
+	until they are done with it.
+*/
+typedef struct { float *Memory; size_t Size; } Buffer;
+
+static pthread_key_t BufferKey;
+static pthread_once_t BufferOnce = PTHREAD_ONCE_INIT;
+
+
+// Release a thread's buffer when the thread exits.
+static void FreeBuffer(void *p)
+{
+	Buffer *B = p;
+	free(B->Memory);
+	free(B);
+}
+
+
+static void CreateBufferKey(void)
+{
+	if (pthread_key_create(&BufferKey, FreeBuffer) != 0)
+	{
+		fprintf(stderr, "Error, failed to create a thread key.\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+// Return the calling thread's buffer, with room for Size floats.
+static float *GetBuffer(size_t Size)
+{
+	pthread_once(&BufferOnce, CreateBufferKey);
+
+	Buffer *B = pthread_getspecific(BufferKey);
+	if (B == NULL)
+	{
+		B = calloc(1, sizeof *B);
+		if (B == NULL)
+		{
+			fprintf(stderr, "Error, failed to allocate memory.\n");
+			exit(EXIT_FAILURE);
+		}
+		pthread_setspecific(BufferKey, B);
+	}
+
+	if (B->Size < Size)
+	{
+		free(B->Memory);
+		B->Memory = malloc(Size * sizeof *B->Memory);
+		if (B->Memory == NULL)
+		{
+			fprintf(stderr, "Error, failed to allocate memory.\n");
+			exit(EXIT_FAILURE);
+		}
+		B->Size = Size;
+	}
+
+	return B->Memory;
+}
+
+
+/*	Perform the column pass on an array of Rows rows and Columns columns
+	(in complex elements):  transpose it into the calling thread's
+	buffer, run Task on each row of the transposed array, and transpose
+	it back.
+*/
+static void ColumnPass(ThreadPool *Pool, ThreadPoolTask *Task,
+	FFTSetup Setup, const DSPSplitComplex *C, vDSP_Stride IC1,
+	vDSP_Length Rows, vDSP_Length Columns, vDSP_Length Log2Rows,
+	FFTDirection Direction)
+{
+	// Get room for the transposed array and Rows floats for RealColumnTask.
+	float *Memory = GetBuffer((2 * Columns + 1) * Rows);
+	DSPSplitComplex Scratch = { Memory, Memory + Rows * Columns };
+
+	RunTranspose(Pool, C, IC1, &Scratch, Rows, Rows, Columns);
+
+	RowPass P = { Setup, Scratch, Rows, Log2Rows, Direction,
+		Memory + 2 * Rows * Columns };
+	RunThreadPool(Pool, Task, &P, Columns);
+
+	RunTranspose(Pool, &Scratch, Rows, C, IC1, Columns, Rows);
+}
+
+
+void ParallelFFT2D_zip(ThreadPool *Pool, FFTSetup Setup,
+	const DSPSplitComplex *C, vDSP_Stride IC0, vDSP_Stride IC1,
+	vDSP_Length Log2N0, vDSP_Length Log2N1, FFTDirection Direction)
+{
+	if (IC0 != 1)
+	{
+		vDSP_fft2d_zip(Setup, C, IC0, IC1, Log2N0, Log2N1, Direction);
+		return;
+	}
+
+	if (Pool == NULL)
+		Pool = DefaultThreadPool();
+
+	const vDSP_Length NC = (vDSP_Length) 1 << Log2N0;
+	const vDSP_Length NR = (vDSP_Length) 1 << Log2N1;
+
+	if (IC1 == 0)
+		IC1 = NC;
+
+	RowPass P = { Setup, *C, IC1, Log2N0, Direction, NULL };
+	RunThreadPool(Pool, ComplexRowTask, &P, NR);
+
+	if (Log2N1 != 0)
+		ColumnPass(Pool, ComplexRowTask, Setup, C, IC1, NR, NC, Log2N1,
+			Direction);
+}
+
+
+void ParallelFFT2D_zrip(ThreadPool *Pool, FFTSetup Setup,
+	const DSPSplitComplex *C, vDSP_Stride IC0, vDSP_Stride IC1,
+	vDSP_Length Log2N0, vDSP_Length Log2N1, FFTDirection Direction)
+{
+	if (IC0 != 1)
+	{
+		vDSP_fft2d_zrip(Setup, C, IC0, IC1, Log2N0, Log2N1, Direction);
+		return;
+	}
+
+	if (Log2N0 == 0)
+		return;
+
+	if (Pool == NULL)
+		Pool = DefaultThreadPool();
+
+	// Each row of NC real elements is stored as NC/2 complex elements.
+	const vDSP_Length NC = (vDSP_Length) 1 << Log2N0;
+	const vDSP_Length NR = (vDSP_Length) 1 << Log2N1;
+
+	if (IC1 == 0)
+		IC1 = NC/2;
+
+	RowPass P = { Setup, *C, IC1, Log2N0, Direction, NULL };
+
+	// The inverse transform undoes the forward steps in reverse order.
+	if (Direction == FFT_FORWARD)
+		RunThreadPool(Pool, RealRowTask, &P, NR);
+
+	if (Log2N1 != 0)
+		ColumnPass(Pool, RealColumnTask, Setup, C, IC1, NR, NC/2, Log2N1,
+			Direction);
+
+	if (Direction != FFT_FORWARD)
+		RunThreadPool(Pool, RealRowTask, &P, NR);
+}
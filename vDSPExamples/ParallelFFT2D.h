@@ -0,0 +1,51 @@
+/*	File: ParallelFFT2D.h
+
+	Description:
+		Declarations for two-dimensional FFTs that divide their work
+		among the threads of a ThreadPool.
+*/
+#ifndef __PARALLELFFT2D__
+#define __PARALLELFFT2D__
+
+
+#include "PortableDSP.h"
+#include "ThreadPool.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	These routines take the same arguments as vDSP_fft2d_zip and
+	vDSP_fft2d_zrip, plus a pool of threads to use (NULL selects
+	DefaultThreadPool()), and produce the same results, including the
+	packing of the real-to-complex results.
+
+	The rows are transformed in parallel, the array is transposed into
+	a scratch buffer with a cache-blocked transpose, the rows of the
+	transposed array (the original columns) are transformed in parallel,
+	and the array is transposed back.  The scratch buffer is as large as
+	the array.  Each calling thread keeps its own and reuses it, so it
+	is allocated only when a thread first transforms an array that
+	large.
+
+	IC0 must be one for the parallel path; with other element strides,
+	the single-threaded vDSP routine is called instead.  The setup must
+	support transforms of 2**max(Log2N0, Log2N1) elements.
+*/
+void ParallelFFT2D_zip(ThreadPool *Pool, FFTSetup Setup,
+	const DSPSplitComplex *C, vDSP_Stride IC0, vDSP_Stride IC1,
+	vDSP_Length Log2N0, vDSP_Length Log2N1, FFTDirection Direction);
+
+void ParallelFFT2D_zrip(ThreadPool *Pool, FFTSetup Setup,
+	const DSPSplitComplex *C, vDSP_Stride IC0, vDSP_Stride IC1,
+	vDSP_Length Log2N0, vDSP_Length Log2N1, FFTDirection Direction);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -0,0 +1,305 @@
+/*	File: Philox.c
+
+	Description:
+		The Philox4x32-10 counter-based pseudo-random number generator,
+		from John K. Salmon, Mark A. Moraes, Ron O. Dror, and David E.
+		Shaw, "Parallel Random Numbers:  As Easy as 1, 2, 3",
+		Proceedings of the International Conference for High
+		Performance Computing, Networking, Storage and Analysis (2011).
+
+		A conventional generator, such as a linear congruential one,
+		computes each number from the previous one, so numbers must be
+		generated one at a time, in order.  Philox instead scrambles a
+		counter:  ten rounds of multiplications and exclusive-ors turn
+		a 128-bit counter and a 64-bit key into 128 random bits.  The
+		counter here is the block index (64 bits) and the stream number
+		(64 bits), and the key is the seed.  Each block gives four
+		numbers, so number i of a stream is word i%4 of block i/4.
+
+		Since blocks are independent, the AVX2 kernel computes eight in
+		each vector, one in each lane, and works on four vectors at once
+		to hide the latency of the multiplications.  Jumping ahead is
+		just changing the position.  The other kernel is plain C.
+*/
+
+
+#include <stddef.h>
+
+#if !defined __APPLE__ && (defined __i386__ || defined __x86_64__)
+	#include <immintrin.h>
+	#define	HasIntelVectors	1
+#endif
+
+#include "CPUFeatures.h"
+#include "Philox.h"
+
+
+// Multipliers and key increments ("Weyl constants") of Philox4x32.
+#define	M0	0xD2511F53u
+#define	M1	0xCD9E8D57u
+#define	W0	0x9E3779B9u
+#define	W1	0xBB67AE85u
+
+// Number of rounds.
+#define	Rounds	10
+
+
+// Scale to convert the high 24 bits of a word to [0, 1).
+static const float Scale = 1.f/16777216;
+
+
+void InitializePhilox(PhiloxStream *S, uint64_t Seed, uint64_t Stream)
+{
+	S->Key[0]    = (uint32_t) Seed;
+	S->Key[1]    = (uint32_t) (Seed >> 32);
+	S->Stream[0] = (uint32_t) Stream;
+	S->Stream[1] = (uint32_t) (Stream >> 32);
+	S->Position  = 0;
+}
+
+
+void SkipPhilox(PhiloxStream *S, uint64_t Count)
+{
+	S->Position += Count;
+}
+
+
+// Compute the four words of block Block of a stream.
+static void Philox(const PhiloxStream *S, uint64_t Block, uint32_t Word[4])
+{
+	uint32_t
+		c0 = (uint32_t) Block, c1 = (uint32_t) (Block >> 32),
+		c2 = S->Stream[0], c3 = S->Stream[1],
+		k0 = S->Key[0], k1 = S->Key[1];
+
+	for (int r = 0; r < Rounds; ++r)
+	{
+		const uint64_t p0 = (uint64_t) M0 * c0, p1 = (uint64_t) M1 * c2;
+		c0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+		c1 = (uint32_t) p1;
+		c2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+		c3 = (uint32_t) p0;
+		k0 += W0;
+		k1 += W1;
+	}
+
+	Word[0] = c0;
+	Word[1] = c1;
+	Word[2] = c2;
+	Word[3] = c3;
+}
+
+
+/*	A fill kernel sets Buffer[0] to Buffer[4*Blocks-1] to the numbers of
+	blocks Block to Block+Blocks-1 of a stream.
+*/
+typedef void FillKernel(const PhiloxStream *S, uint64_t Block,
+	float *Buffer, vDSP_Length Blocks);
+
+
+// Fill a buffer one block at a time.
+static void FillScalar(const PhiloxStream *S, uint64_t Block,
+	float *Buffer, vDSP_Length Blocks)
+{
+	for (vDSP_Length b = 0; b < Blocks; ++b)
+	{
+		uint32_t Word[4];
+		Philox(S, Block + b, Word);
+		for (int w = 0; w < 4; ++w)
+			Buffer[4*b + w] = (Word[w] >> 8) * Scale;
+	}
+}
+
+
+#if defined HasIntelVectors
+
+
+#define	AVX2	__attribute__((__target__("avx2")))
+
+
+/*	Return the low and high halves of the 64-bit products of the
+	unsigned 32-bit elements of a and m.
+*/
+AVX2 static inline void MultiplyHiLo(__m256i a, __m256i m,
+	__m256i *Lo, __m256i *Hi)
+{
+	// Multiply the even elements, then the odd ones.
+	const __m256i
+		Even = _mm256_mul_epu32(a, m),
+		Odd  = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+	*Lo = _mm256_blend_epi32(Even, _mm256_slli_epi64(Odd, 32), 0xaa);
+	*Hi = _mm256_blend_epi32(_mm256_srli_epi64(Even, 32), Odd, 0xaa);
+}
+
+
+// Convert words to floats in [0, 1).
+AVX2 static inline __m256 ToFloat(__m256i x)
+{
+	return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8)),
+		_mm256_set1_ps(Scale));
+}
+
+
+/*	Fill a buffer with 8*Groups blocks, from block First, with block
+	First+8*g+l in lane l of group g.  Groups is a compile-time constant
+	so the groups stay in registers; each round of a group depends on
+	the previous round, so several groups keep more operations in
+	flight.  The low words of the block indices must not wrap.
+*/
+#define	DefineBlock(Groups)						\
+AVX2 static inline void FillBlock##Groups(const PhiloxStream *S,	\
+	uint64_t First, float *Buffer)					\
+{									\
+	const __m256i							\
+		m0 = _mm256_set1_epi32(M0),				\
+		m1 = _mm256_set1_epi32(M1),				\
+		Lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);	\
+									\
+	__m256i c0[Groups], c1[Groups], c2[Groups], c3[Groups];		\
+	for (int g = 0; g < Groups; ++g)				\
+	{								\
+		c0[g] = _mm256_add_epi32(Lanes,				\
+			_mm256_set1_epi32((uint32_t) First + 8*g));	\
+		c1[g] = _mm256_set1_epi32((uint32_t) (First >> 32));	\
+		c2[g] = _mm256_set1_epi32(S->Stream[0]);		\
+		c3[g] = _mm256_set1_epi32(S->Stream[1]);		\
+	}								\
+									\
+	uint32_t k0 = S->Key[0], k1 = S->Key[1];			\
+	for (int r = 0; r < Rounds; ++r)				\
+	{								\
+		const __m256i						\
+			K0 = _mm256_set1_epi32(k0),			\
+			K1 = _mm256_set1_epi32(k1);			\
+		for (int g = 0; g < Groups; ++g)			\
+		{							\
+			__m256i Lo0, Hi0, Lo1, Hi1;			\
+			MultiplyHiLo(c0[g], m0, &Lo0, &Hi0);		\
+			MultiplyHiLo(c2[g], m1, &Lo1, &Hi1);		\
+			c0[g] = _mm256_xor_si256(_mm256_xor_si256(Hi1, c1[g]), K0); \
+			c1[g] = Lo1;					\
+			c2[g] = _mm256_xor_si256(_mm256_xor_si256(Hi0, c3[g]), K1); \
+			c3[g] = Lo0;					\
+		}							\
+		k0 += W0;						\
+		k1 += W1;						\
+	}								\
+									\
+	for (int g = 0; g < Groups; ++g)				\
+	{								\
+		/*	Transpose so each block's four words are consecutive:  \
+			first pair words within 128-bit halves, then swap	\
+			halves.							\
+		*/							\
+		const __m256i						\
+			t0 = _mm256_unpacklo_epi32(c0[g], c1[g]),	\
+			t1 = _mm256_unpackhi_epi32(c0[g], c1[g]),	\
+			t2 = _mm256_unpacklo_epi32(c2[g], c3[g]),	\
+			t3 = _mm256_unpackhi_epi32(c2[g], c3[g]),	\
+			u0 = _mm256_unpacklo_epi64(t0, t2),	/* Blocks 0, 4. */ \
+			u1 = _mm256_unpackhi_epi64(t0, t2),	/* Blocks 1, 5. */ \
+			u2 = _mm256_unpacklo_epi64(t1, t3),	/* Blocks 2, 6. */ \
+			u3 = _mm256_unpackhi_epi64(t1, t3);	/* Blocks 3, 7. */ \
+									\
+		float *o = Buffer + 32*g;				\
+		_mm256_storeu_ps(o +  0,				\
+			ToFloat(_mm256_permute2x128_si256(u0, u1, 0x20))); \
+		_mm256_storeu_ps(o +  8,				\
+			ToFloat(_mm256_permute2x128_si256(u2, u3, 0x20))); \
+		_mm256_storeu_ps(o + 16,				\
+			ToFloat(_mm256_permute2x128_si256(u0, u1, 0x31))); \
+		_mm256_storeu_ps(o + 24,				\
+			ToFloat(_mm256_permute2x128_si256(u2, u3, 0x31))); \
+	}								\
+}
+
+DefineBlock(4)
+DefineBlock(1)
+
+#undef	DefineBlock
+
+
+/*	Fill a buffer 32 blocks at a time with AVX2, then eight at a time,
+	and finish any remainder with plain C.  A group of blocks whose low
+	index words would wrap is done with plain C too.
+*/
+AVX2 static void FillAVX2(const PhiloxStream *S, uint64_t Block,
+	float *Buffer, vDSP_Length Blocks)
+{
+	vDSP_Length b = 0;
+
+	for (; b + 32 <= Blocks; b += 32)
+		if ((uint32_t) (Block + b) <= UINT32_MAX - 31)
+			FillBlock4(S, Block + b, Buffer + 4*b);
+		else
+			FillScalar(S, Block + b, Buffer + 4*b, 32);
+
+	for (; b + 8 <= Blocks; b += 8)
+		if ((uint32_t) (Block + b) <= UINT32_MAX - 7)
+			FillBlock1(S, Block + b, Buffer + 4*b);
+		else
+			FillScalar(S, Block + b, Buffer + 4*b, 8);
+
+	if (b < Blocks)
+		FillScalar(S, Block + b, Buffer + 4*b, Blocks - b);
+}
+
+
+#endif	// defined HasIntelVectors
+
+
+// Choose the best kernel the processor supports.
+static FillKernel *ChooseKernel(void)
+{
+	#if defined HasIntelVectors
+		if (CPUFeatures() & CPUAVX2)
+		{
+			NoteKernelVariant("Philox", "AVX2");
+			return FillAVX2;
+		}
+	#endif
+
+	NoteKernelVariant("Philox", "scalar");
+	return FillScalar;
+}
+
+
+void FillPhilox(PhiloxStream *S, float *Buffer, vDSP_Length N)
+{
+	/*	The choice is made on the first call.  If two threads race to
+		make it, they store the same value, so no lock is needed.
+	*/
+	static FillKernel *Kernel;
+	if (Kernel == NULL)
+		Kernel = ChooseKernel();
+
+	float Partial[4];
+
+	// Finish a block begun by an earlier call.
+	vDSP_Length w = S->Position % 4;
+	if (w != 0 && 0 < N)
+	{
+		FillScalar(S, S->Position / 4, Partial, 1);
+		for (; w < 4 && 0 < N; ++w, --N)
+		{
+			*Buffer++ = Partial[w];
+			++S->Position;
+		}
+	}
+
+	// Do whole blocks.
+	const vDSP_Length Blocks = N / 4;
+	Kernel(S, S->Position / 4, Buffer, Blocks);
+	Buffer += 4*Blocks;
+	N -= 4*Blocks;
+	S->Position += 4*Blocks;
+
+	// Start a block that a later call will finish.
+	if (0 < N)
+	{
+		FillScalar(S, S->Position / 4, Partial, 1);
+		for (w = 0; w < N; ++w)
+			Buffer[w] = Partial[w];
+		S->Position += N;
+	}
+}
@@ -0,0 +1,54 @@
+/*	File: Philox.h
+
+	Description:
+		Declarations for a counter-based pseudo-random number generator,
+		Philox4x32-10.
+*/
+#ifndef __PHILOX__
+#define __PHILOX__
+
+
+#include <stdint.h>
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	A stream of pseudo-random numbers.  Number i of a stream is a
+	function of only the seed, the stream number, and i, so any part of
+	any stream can be generated independently, in any order, and by any
+	thread, with the same results.
+*/
+typedef struct
+{
+	uint32_t Key[2];	// From the seed.
+	uint32_t Stream[2];	// From the stream number.
+	uint64_t Position;	// Index of the next number.
+} PhiloxStream;
+
+
+/*	Start stream number Stream of the generator seeded with Seed, at
+	its first number.  Distinct stream numbers give independent
+	streams, one for each channel or thread, for example.
+*/
+void InitializePhilox(PhiloxStream *S, uint64_t Seed, uint64_t Stream);
+
+// Skip the next Count numbers of a stream.
+void SkipPhilox(PhiloxStream *S, uint64_t Count);
+
+/*	Fill Buffer with the next N numbers of a stream, each uniformly
+	distributed in [0, 1) with 24 random bits.
+*/
+void FillPhilox(PhiloxStream *S, float *Buffer, vDSP_Length N);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -0,0 +1,275 @@
+/*	File: PortableConvolution.c
+
+	Description:
+		A portable implementation of vDSP_conv, for systems without the
+		Accelerate framework.
+
+		The vector kernel is register-blocked:  it computes a block of
+		result elements at once, keeping several vectors of partial sums
+		in registers, and steps through the filter one tap at a time.
+		Each tap is broadcast to all lanes and multiplied by an
+		unaligned load of the signal, so the filter is only ever read as
+		scalars.  That makes a negative filter stride (convolution)
+		exactly as fast as a positive one (correlation); no gather or
+		reversed copy of the filter is needed.
+
+		There are kernels compiled for AVX-512 and for AVX2, both with
+		fused multiply-add.  The widest one the processor supports is
+		used when the signal stride is one.  Otherwise, a scalar loop is
+		used.  The AVX-512 kernel finishes the results left over after
+		its blocks with masked loads and stores, so it needs no scalar
+		cleanup loop.
+*/
+
+
+#if !defined __APPLE__
+
+
+#include <stddef.h>
+
+#if defined __i386__ || defined __x86_64__
+	#include <immintrin.h>
+	#define	HasIntelVectors	1
+#endif
+
+#include "PortableDSP.h"
+#include "CPUFeatures.h"
+
+
+/*	A convolution kernel has the vDSP_conv interface.  The vector kernels
+	require IA to be one.
+*/
+typedef void ConvolutionKernel(const float *A, vDSP_Stride IA,
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,
+	vDSP_Length N, vDSP_Length P);
+
+
+/*	Compute the correlation (or, with a negative filter stride, the
+	convolution) of A with F.  For each result element, the products are
+	accumulated in order of increasing filter index.
+*/
+static void ConvolutionScalar(const float *A, vDSP_Stride IA,
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,
+	vDSP_Length N, vDSP_Length P)
+{
+	for (vDSP_Length n = 0; n < N; ++n)
+	{
+		const float *a = A + n*IA;
+		float Sum = 0;
+		for (vDSP_Length p = 0; p < P; ++p)
+			Sum += a[p*IA] * F[p*IF];
+		C[n*IC] = Sum;
+	}
+}
+
+
+#if defined HasIntelVectors
+
+
+#define	AVX2	__attribute__((__target__("avx2,fma")))
+
+
+/*	Store a vector of results to C with stride IC.  Unit strides are
+	stored directly; other strides go through a small buffer.
+*/
+AVX2 static inline void StoreResults(float *C, vDSP_Stride IC, __m256 v)
+{
+	if (IC == 1)
+		_mm256_storeu_ps(C, v);
+	else
+	{
+		float Buffer[8];
+		_mm256_storeu_ps(Buffer, v);
+		for (int i = 0; i < 8; ++i)
+			C[i*IC] = Buffer[i];
+	}
+}
+
+
+/*	Compute Blocks*8 results starting at A and C, with Blocks a
+	compile-time constant so the accumulators stay in registers.
+*/
+#define	DefineBlock(Blocks)						\
+AVX2 static inline void ConvolutionBlock##Blocks(const float *A,	\
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,	\
+	vDSP_Length P)							\
+{									\
+	__m256 Sum[Blocks];						\
+	for (int b = 0; b < Blocks; ++b)				\
+		Sum[b] = _mm256_setzero_ps();				\
+									\
+	for (vDSP_Length p = 0; p < P; ++p, F += IF)			\
+	{								\
+		const __m256 f = _mm256_broadcast_ss(F);		\
+		for (int b = 0; b < Blocks; ++b)			\
+			Sum[b] = _mm256_fmadd_ps(			\
+				_mm256_loadu_ps(A + p + 8*b), f, Sum[b]); \
+	}								\
+									\
+	for (int b = 0; b < Blocks; ++b)				\
+		StoreResults(C + 8*b*IC, IC, Sum[b]);			\
+}
+
+DefineBlock(8)
+DefineBlock(1)
+
+#undef	DefineBlock
+
+
+/*	Convolve with AVX2 and FMA.  The main loop produces 64 results at a
+	time with eight accumulators, which keeps both FMA units busy while
+	loads of the signal and the broadcast tap share the load ports.
+	Leftover results are done eight at a time and then one at a time.
+*/
+AVX2 static void ConvolutionAVX2(const float *A, vDSP_Stride IA,
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,
+	vDSP_Length N, vDSP_Length P)
+{
+	vDSP_Length n = 0;
+
+	for (; n + 64 <= N; n += 64)
+		ConvolutionBlock8(A + n, F, IF, C + n*IC, IC, P);
+
+	for (; n + 8 <= N; n += 8)
+		ConvolutionBlock1(A + n, F, IF, C + n*IC, IC, P);
+
+	if (n < N)
+		ConvolutionScalar(A + n, IA, F, IF, C + n*IC, IC, N - n, P);
+}
+
+
+#define	AVX512	__attribute__((__target__("avx512f,fma")))
+
+
+/*	Store the elements of v selected by Mask to C with stride IC.  Unit
+	strides use a masked store; other strides go through a small buffer.
+*/
+AVX512 static inline void StoreResults512(float *C, vDSP_Stride IC,
+	__m512 v, __mmask16 Mask)
+{
+	if (IC == 1)
+		_mm512_mask_storeu_ps(C, Mask, v);
+	else
+	{
+		float Buffer[16];
+		_mm512_storeu_ps(Buffer, v);
+		for (int i = 0; i < 16; ++i)
+			if (Mask >> i & 1)
+				C[i*IC] = Buffer[i];
+	}
+}
+
+
+/*	Compute Blocks*16 results starting at A and C, as DefineBlock does.
+	In the last vector, only the results selected by Mask are computed
+	and stored; masked-off lanes of the signal are not loaded, so they
+	may lie past the end of it.
+*/
+#define	DefineBlock512(Blocks)						\
+AVX512 static inline void ConvolutionBlock512_##Blocks(		\
+	const float *A, const float *F, vDSP_Stride IF, float *C,	\
+	vDSP_Stride IC, vDSP_Length P, __mmask16 Mask)			\
+{									\
+	__m512 Sum[Blocks];						\
+	for (int b = 0; b < Blocks; ++b)				\
+		Sum[b] = _mm512_setzero_ps();				\
+									\
+	for (vDSP_Length p = 0; p < P; ++p, F += IF)			\
+	{								\
+		const __m512 f = _mm512_set1_ps(*F);			\
+		for (int b = 0; b < Blocks-1; ++b)			\
+			Sum[b] = _mm512_fmadd_ps(			\
+				_mm512_loadu_ps(A + p + 16*b), f, Sum[b]); \
+		Sum[Blocks-1] = _mm512_fmadd_ps(			\
+			_mm512_maskz_loadu_ps(Mask, A + p + 16*(Blocks-1)), \
+			f, Sum[Blocks-1]);				\
+	}								\
+									\
+	for (int b = 0; b < Blocks-1; ++b)				\
+		StoreResults512(C + 16*b*IC, IC, Sum[b], 0xffff);	\
+	StoreResults512(C + 16*(Blocks-1)*IC, IC, Sum[Blocks-1], Mask); \
+}
+
+DefineBlock512(8)
+DefineBlock512(1)
+
+#undef	DefineBlock512
+
+
+/*	Convolve with AVX-512 and FMA.  This is ConvolutionAVX2 with vectors
+	twice as wide:  the main loop produces 128 results at a time, and
+	leftover results are done 16 at a time.  The final 1 to 15 results
+	are done with a mask instead of a scalar loop.  Each result is
+	accumulated in the same order as in the other kernels.
+*/
+AVX512 static void ConvolutionAVX512(const float *A, vDSP_Stride IA,
+	const float *F, vDSP_Stride IF, float *C, vDSP_Stride IC,
+	vDSP_Length N, vDSP_Length P)
+{
+	vDSP_Length n = 0;
+
+	for (; n + 128 <= N; n += 128)
+		ConvolutionBlock512_8(A + n, F, IF, C + n*IC, IC, P, 0xffff);
+
+	for (; n + 16 <= N; n += 16)
+		ConvolutionBlock512_1(A + n, F, IF, C + n*IC, IC, P, 0xffff);
+
+	if (n < N)
+		ConvolutionBlock512_1(A + n, F, IF, C + n*IC, IC, P,
+			(__mmask16) ((1u << (N - n)) - 1));
+}
+
+
+#endif	// defined HasIntelVectors
+
+
+// Describe a kernel and the name under which its use is noted.
+typedef struct
+{
+	const char *Name;
+	ConvolutionKernel *Kernel;
+} Variant;
+
+#if defined HasIntelVectors
+	static const Variant AVX512Variant = { "AVX-512", ConvolutionAVX512 };
+	static const Variant AVX2Variant   = { "AVX2",    ConvolutionAVX2 };
+#endif
+static const Variant ScalarVariant = { "scalar", ConvolutionScalar };
+
+
+// Choose the best kernel the processor supports.
+static const Variant *ChooseKernel(unsigned Features)
+{
+	#if defined HasIntelVectors
+		if ((Features & CPUAVX512) && (Features & CPUFMA))
+			return &AVX512Variant;
+		if ((Features & CPUAVX2) && (Features & CPUFMA))
+			return &AVX2Variant;
+	#endif
+
+	return &ScalarVariant;
+}
+
+
+void vDSP_conv(const float *A, vDSP_Stride IA, const float *F, vDSP_Stride IF,
+	float *C, vDSP_Stride IC, vDSP_Length N, vDSP_Length P)
+{
+	/*	The features allowed may change at any time (see
+		LimitCPUFeatures), so the choice is made from one atomic read of
+		them on every call, as GetKernels in PortableFFT.c does, and only
+		the note of the last choice is kept, swapped atomically.
+	*/
+	static const Variant *Noted;
+	const Variant *V = ChooseKernel(CPUFeatures());
+	if (__atomic_load_n(&Noted, __ATOMIC_RELAXED) != V
+			&& __atomic_exchange_n(&Noted, V, __ATOMIC_RELAXED) != V)
+		NoteKernelVariant("vDSP_conv", V->Name);
+
+	if (IA == 1)
+		V->Kernel(A, IA, F, IF, C, IC, N, P);
+	else
+		ConvolutionScalar(A, IA, F, IF, C, IC, N, P);
+}
+
+
+#endif	// !defined __APPLE__
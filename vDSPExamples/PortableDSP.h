@@ -0,0 +1,152 @@
+/*	File: PortableDSP.h
+
+	Description:
+		Declarations that let the vDSP examples build on systems
+		without the Accelerate framework.
+
+		On Mac OS X, this header simply includes Accelerate, and the
+		examples call Apple's vDSP.  Elsewhere (notably Linux on x86-64),
+		it declares the same types and the subset of vDSP routines the
+		examples use, and those routines are supplied by the portable
+		implementations in PortableFFT.c and PortableConvolution.c.
+
+		The portable routines follow the vDSP contracts for the
+		arguments the examples pass:  split-complex data, element
+		strides, the scaling of the real-to-complex FFTs (the forward
+		transform returns twice the mathematical DFT), and the packing
+		of the real-to-complex output (the real part of the Nyquist
+		element is stored in the imaginary part of element 0).
+*/
+#ifndef __PORTABLEDSP__
+#define __PORTABLEDSP__
+
+
+#if defined __APPLE__
+
+	#include <Accelerate/Accelerate.h>
+
+#else	// defined __APPLE__
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+// Types used in vDSP interfaces.
+typedef unsigned long	vDSP_Length;	// Number of elements.
+typedef long		vDSP_Stride;	// Distance between elements.
+
+// Interleaved-data complex number.
+typedef struct DSPComplex { float real, imag; } DSPComplex;
+
+// Separated-data complex vector.
+typedef struct DSPSplitComplex { float *realp, *imagp; } DSPSplitComplex;
+
+/*	An FFTSetup holds the twiddle factors (and other tables) for FFTs
+	up to a maximum size.  Its contents are private to PortableFFT.c.
+	Once created, a setup is only read, so one setup may be used by
+	several threads at the same time.
+*/
+typedef struct OpaqueFFTSetup *FFTSetup;
+
+typedef int FFTDirection;
+typedef int FFTRadix;
+
+enum { FFT_FORWARD = +1, FFT_INVERSE = -1 };
+enum { FFT_RADIX2 = 0, FFT_RADIX3 = 1, FFT_RADIX5 = 2 };
+
+
+/*	Create and destroy FFT setups.  vDSP_create_fftsetup returns NULL
+	if memory cannot be allocated or the radix is not supported.  A
+	setup created with FFT_RADIX3 or FFT_RADIX5 serves the mixed-radix
+	FFTs below as well as the radix-2 FFTs.
+*/
+FFTSetup vDSP_create_fftsetup(vDSP_Length Log2N, FFTRadix Radix);
+void vDSP_destroy_fftsetup(FFTSetup Setup);
+
+
+// Convert between interleaved-data and separated-data complex vectors.
+void vDSP_ctoz(const DSPComplex *C, vDSP_Stride IC,
+	const DSPSplitComplex *Z, vDSP_Stride IZ, vDSP_Length N);
+void vDSP_ztoc(const DSPSplitComplex *Z, vDSP_Stride IZ,
+	DSPComplex *C, vDSP_Stride IC, vDSP_Length N);
+
+
+// One-dimensional complex FFTs, in-place and out-of-place.
+void vDSP_fft_zip(FFTSetup Setup, const DSPSplitComplex *C,
+	vDSP_Stride IC, vDSP_Length Log2N, FFTDirection Direction);
+void vDSP_fft_zop(FFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA,
+	const DSPSplitComplex *C, vDSP_Stride IC,
+	vDSP_Length Log2N, FFTDirection Direction);
+
+/*	One-dimensional complex FFTs of 3 * 2**Log2N and 5 * 2**Log2N
+	elements, out-of-place.  The setup must have been created with
+	FFT_RADIX3 or FFT_RADIX5, respectively, and at least this Log2N.
+*/
+void vDSP_fft3_zop(FFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA,
+	const DSPSplitComplex *C, vDSP_Stride IC,
+	vDSP_Length Log2N, FFTDirection Direction);
+void vDSP_fft5_zop(FFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA,
+	const DSPSplitComplex *C, vDSP_Stride IC,
+	vDSP_Length Log2N, FFTDirection Direction);
+
+// One-dimensional real-to-complex FFTs, in-place and out-of-place.
+void vDSP_fft_zrip(FFTSetup Setup, const DSPSplitComplex *C,
+	vDSP_Stride IC, vDSP_Length Log2N, FFTDirection Direction);
+void vDSP_fft_zrop(FFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA,
+	const DSPSplitComplex *C, vDSP_Stride IC,
+	vDSP_Length Log2N, FFTDirection Direction);
+
+/*	Multiple one-dimensional real-to-complex FFTs, in-place.  M signals
+	are transformed, each as vDSP_fft_zrip would; signal m starts m*IM
+	elements after signal 0.
+*/
+void vDSP_fftm_zrip(FFTSetup Setup, const DSPSplitComplex *C,
+	vDSP_Stride IC, vDSP_Stride IM, vDSP_Length Log2N, vDSP_Length M,
+	FFTDirection Direction);
+
+/*	Two-dimensional FFTs.  IC0 is the stride between elements in a row,
+	and IC1 is the stride between rows (zero means the rows are packed
+	one after another).  Log2N0 is the base-two logarithm of the number
+	of columns and Log2N1 that of the number of rows.
+*/
+void vDSP_fft2d_zip(FFTSetup Setup, const DSPSplitComplex *C,
+	vDSP_Stride IC0, vDSP_Stride IC1,
+	vDSP_Length Log2N0, vDSP_Length Log2N1, FFTDirection Direction);
+void vDSP_fft2d_zop(FFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA0, vDSP_Stride IA1,
+	const DSPSplitComplex *C, vDSP_Stride IC0, vDSP_Stride IC1,
+	vDSP_Length Log2N0, vDSP_Length Log2N1, FFTDirection Direction);
+void vDSP_fft2d_zrip(FFTSetup Setup, const DSPSplitComplex *C,
+	vDSP_Stride IC0, vDSP_Stride IC1,
+	vDSP_Length Log2N0, vDSP_Length Log2N1, FFTDirection Direction);
+void vDSP_fft2d_zrop(FFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA0, vDSP_Stride IA1,
+	const DSPSplitComplex *C, vDSP_Stride IC0, vDSP_Stride IC1,
+	vDSP_Length Log2N0, vDSP_Length Log2N1, FFTDirection Direction);
+
+
+/*	Correlation (or convolution, with a negative filter stride):
+
+		C[n*IC] = sum F[p*IF] * A[(n+p)*IA] for 0 <= p < P,
+
+	for 0 <= n < N.
+*/
+void vDSP_conv(const float *A, vDSP_Stride IA, const float *F, vDSP_Stride IF,
+	float *C, vDSP_Stride IC, vDSP_Length N, vDSP_Length P);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif	// defined __APPLE__
+
+
+#endif
@@ -0,0 +1,2256 @@
+/*	File: PortableFFT.c
+
+	Description:
+		A portable implementation of the vDSP FFT routines used by the
+		examples, for systems without the Accelerate framework.
+
+		The complex FFT is an in-place radix-2 decimation-in-frequency
+		FFT on separated-data (split) complex vectors.  Pairs of
+		radix-2 stages are fused into radix-4 passes where the vector
+		width allows, which halves the number of trips through memory.
+		The last two stages have trivial twiddle factors and are done
+		as a single four-point transform, and a bit-reversal
+		permutation puts the results in natural order.
+
+		The passes, and the unit-stride vDSP_ctoz and vDSP_ztoc, have
+		scalar, SSE2, AVX2, and AVX-512 (both with FMA) implementations.
+		The widest set the processor supports (see CPUFeatures.h) is
+		chosen at run time, so one binary runs on any x86-64 processor.
+
+		The real-to-complex FFTs use the usual trick of treating the N
+		real elements as N/2 complex elements, performing an N/2-point
+		complex FFT, and then separating the spectra of the even and
+		odd elements.  That matches the vDSP data layout exactly, since
+		vDSP already asks the caller to put the even elements in realp
+		and the odd elements in imagp.
+
+		FFTs of 3 * 2**n and 5 * 2**n elements split the input into
+		three or five subsequences, transform each with the radix-2 FFT,
+		and combine the results with radix-3 or radix-5 butterflies.
+
+		This file also implements the interleaved-data FFTs declared in
+		InterleavedFFT.h and the fused power spectrum declared in
+		PowerSpectrum.h, which share the passes above.
+*/
+
+
+#if !defined __APPLE__
+
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined __i386__ || defined __x86_64__
+	#include <immintrin.h>
+	#define	HasIntelVectors	1
+#endif
+
+#include "PortableDSP.h"
+#include "CPUFeatures.h"
+#include "FFTSetupTables.h"
+#include "InterleavedFFT.h"
+#include "NUMA.h"
+#include "PowerSpectrum.h"
+
+
+static const double TwoPi = 0x3.243f6a8885a308d313198a2e03707344ap1;
+
+
+/*	A radix-2 pass performs one decimation-in-frequency stage with half
+	span H on all N/(2*H) blocks of a vector of N elements.  Wr and Wi
+	point to the H twiddle factors for that stage, and Sign is +1 for a
+	forward transform and -1 for an inverse transform.
+
+	A radix-4 pass performs the two stages with half spans 2*Q and Q.
+	Wr2 and Wi2 point to the 2*Q twiddle factors for the first of those
+	stages and Wr1 and Wi1 to the Q twiddle factors for the second.
+*/
+typedef void Radix2Pass(float *re, float *im, vDSP_Length N, vDSP_Length H,
+	const float *Wr, const float *Wi, float Sign);
+typedef void Radix4Pass(float *re, float *im, vDSP_Length N, vDSP_Length Q,
+	const float *Wr2, const float *Wi2, const float *Wr1, const float *Wi1,
+	float Sign);
+
+/*	An interleaved radix-2 pass performs the first stage, with half span
+	N/2, of an FFT of N elements whose input is the interleaved-data
+	complex vector c, writing the results to the separated-data vector
+	re and im.  This folds the work of vDSP_ctoz into the first stage.
+*/
+typedef void InterleavedRadix2Pass(const float *c, float *re, float *im,
+	vDSP_Length N, const float *Wr, const float *Wi, float Sign);
+
+/*	A split pass copies N elements of the interleaved-data vector c to
+	the separated-data vector re and im, as vDSP_ctoz does with unit
+	strides, and a join pass copies them back, as vDSP_ztoc does.
+*/
+typedef void SplitPass(const float *c, float *re, float *im, vDSP_Length N);
+typedef void JoinPass(const float *re, const float *im, float *c,
+	vDSP_Length N);
+
+
+/*	A kernel set is a group of passes for one instruction set.  The
+	butterfly passes require H (or Q) to be a multiple of Width; the
+	split and join passes take any N.  Narrower points to the set to use
+	for stages too small for this one.
+*/
+typedef struct Kernels
+{
+	const char *Name;
+	vDSP_Length Width;
+	Radix2Pass *Radix2;
+	Radix4Pass *Radix4;
+	InterleavedRadix2Pass *InterleavedRadix2;
+	SplitPass *Split;
+	JoinPass *Join;
+	const struct Kernels *Narrower;
+} Kernels;
+
+
+struct OpaqueFFTSetup
+{
+	// Base-two logarithm of the largest complex FFT supported.
+	vDSP_Length Log2N;
+
+	/*	Twiddle factors.  The H factors for the stage with half span
+		H are at index H-1, and factor j is exp(-i*pi*j/H), with the
+		real part in Wr and the imaginary part in Wi.  The table for
+		half span N/2 also provides the factors used to separate the
+		spectra in the real-to-complex FFT of N elements.
+	*/
+	float *Wr, *Wi;
+
+	/*	Bit reversals of indices, as Log2N-bit numbers.  Reversals for
+		smaller transforms are obtained by shifting right.
+	*/
+	uint32_t *BitReverse;
+
+	/*	For a setup created with FFT_RADIX3 or FFT_RADIX5, Factor is 3
+		or 5, and Fr and Fi hold the twiddle factors that combine
+		Factor transforms of 2**Log2N elements into one of Factor *
+		2**Log2N elements:  factor n is exp(-2*pi*i*n / (Factor *
+		2**Log2N)), for 0 <= n < (Factor-1) * 2**Log2N.  For a radix-2
+		setup, Factor is 1 and Fr and Fi are NULL.
+	*/
+	vDSP_Length Factor;
+	float *Fr, *Fi;
+
+	/*	The tables above are one block of Bytes bytes, starting at Wr,
+		allocated by AllocateOnNUMANode for Node.
+	*/
+	size_t Bytes;
+	int Node;
+};
+
+
+/*	Scalar kernels.  These handle any stage size and are used on
+	processors without vector units and for stages narrower than a
+	vector.
+*/
+static void Radix2Scalar(float *re, float *im, vDSP_Length N, vDSP_Length H,
+	const float *Wr, const float *Wi, float Sign)
+{
+	for (vDSP_Length k = 0; k < N; k += 2*H)
+	{
+		float *r0 = re + k, *i0 = im + k, *r1 = r0 + H, *i1 = i0 + H;
+		for (vDSP_Length j = 0; j < H; ++j)
+		{
+			float wr = Wr[j], wi = Sign * Wi[j];
+			float dr = r0[j] - r1[j], di = i0[j] - i1[j];
+			r0[j] += r1[j];
+			i0[j] += i1[j];
+			r1[j] = dr*wr - di*wi;
+			i1[j] = dr*wi + di*wr;
+		}
+	}
+}
+
+
+static void Radix4Scalar(float *re, float *im, vDSP_Length N, vDSP_Length Q,
+	const float *Wr2, const float *Wi2, const float *Wr1, const float *Wi1,
+	float Sign)
+{
+	for (vDSP_Length k = 0; k < N; k += 4*Q)
+	{
+		float *r = re + k, *i = im + k;
+		for (vDSP_Length j = 0; j < Q; ++j)
+		{
+			float
+				ar0 = r[j    ], ai0 = i[j    ],
+				ar1 = r[j+  Q], ai1 = i[j+  Q],
+				ar2 = r[j+2*Q], ai2 = i[j+2*Q],
+				ar3 = r[j+3*Q], ai3 = i[j+3*Q];
+
+			// First stage, half span 2*Q.
+			float wr, wi, dr, di;
+			float br0 = ar0 + ar2, bi0 = ai0 + ai2;
+			float br1 = ar1 + ar3, bi1 = ai1 + ai3;
+			wr = Wr2[j]; wi = Sign * Wi2[j];
+			dr = ar0 - ar2; di = ai0 - ai2;
+			float br2 = dr*wr - di*wi, bi2 = dr*wi + di*wr;
+			wr = Wr2[j+Q]; wi = Sign * Wi2[j+Q];
+			dr = ar1 - ar3; di = ai1 - ai3;
+			float br3 = dr*wr - di*wi, bi3 = dr*wi + di*wr;
+
+			// Second stage, half span Q.
+			wr = Wr1[j]; wi = Sign * Wi1[j];
+			r[j    ] = br0 + br1; i[j    ] = bi0 + bi1;
+			dr = br0 - br1; di = bi0 - bi1;
+			r[j+  Q] = dr*wr - di*wi; i[j+  Q] = dr*wi + di*wr;
+			r[j+2*Q] = br2 + br3; i[j+2*Q] = bi2 + bi3;
+			dr = br2 - br3; di = bi2 - bi3;
+			r[j+3*Q] = dr*wr - di*wi; i[j+3*Q] = dr*wi + di*wr;
+		}
+	}
+}
+
+
+static void InterleavedRadix2Scalar(const float *c, float *re, float *im,
+	vDSP_Length N, const float *Wr, const float *Wi, float Sign)
+{
+	const vDSP_Length H = N/2;
+	const float *c1 = c + 2*H;
+	for (vDSP_Length j = 0; j < H; ++j)
+	{
+		float ar = c[2*j], ai = c[2*j+1], br = c1[2*j], bi = c1[2*j+1];
+		float wr = Wr[j], wi = Sign * Wi[j];
+		float dr = ar - br, di = ai - bi;
+		re[j] = ar + br;
+		im[j] = ai + bi;
+		re[j+H] = dr*wr - di*wi;
+		im[j+H] = dr*wi + di*wr;
+	}
+}
+
+
+static void SplitScalar(const float *c, float *re, float *im, vDSP_Length N)
+{
+	for (vDSP_Length i = 0; i < N; ++i)
+	{
+		re[i] = c[2*i];
+		im[i] = c[2*i+1];
+	}
+}
+
+
+static void JoinScalar(const float *re, const float *im, float *c,
+	vDSP_Length N)
+{
+	for (vDSP_Length i = 0; i < N; ++i)
+	{
+		c[2*i]   = re[i];
+		c[2*i+1] = im[i];
+	}
+}
+
+
+static const Kernels ScalarKernels =
+	{ "scalar", 1, Radix2Scalar, Radix4Scalar, InterleavedRadix2Scalar,
+		SplitScalar, JoinScalar, NULL };
+
+
+#if defined HasIntelVectors
+
+
+/*	SSE2 kernels, four elements per vector.  Each routine is compiled
+	for SSE2 specifically, so the file does not need special compiler
+	switches; the routines are only called after the processor has
+	been checked.
+*/
+#define	SSE2	__attribute__((__target__("sse2")))
+
+
+// Multiply (dr + i*di) by (wr + i*wi), returning the parts in *pr and *pi.
+SSE2 static inline void MultiplySSE2(__m128 dr, __m128 di,
+	__m128 wr, __m128 wi, __m128 *pr, __m128 *pi)
+{
+	*pr = _mm_sub_ps(_mm_mul_ps(dr, wr), _mm_mul_ps(di, wi));
+	*pi = _mm_add_ps(_mm_mul_ps(dr, wi), _mm_mul_ps(di, wr));
+}
+
+
+SSE2 static void Radix2SSE2(float *re, float *im, vDSP_Length N,
+	vDSP_Length H, const float *Wr, const float *Wi, float Sign)
+{
+	const __m128 S = _mm_set1_ps(Sign);
+	for (vDSP_Length k = 0; k < N; k += 2*H)
+	{
+		float *r0 = re + k, *i0 = im + k, *r1 = r0 + H, *i1 = i0 + H;
+		for (vDSP_Length j = 0; j < H; j += 4)
+		{
+			__m128 ar = _mm_loadu_ps(r0+j), ai = _mm_loadu_ps(i0+j);
+			__m128 br = _mm_loadu_ps(r1+j), bi = _mm_loadu_ps(i1+j);
+			__m128 wr = _mm_loadu_ps(Wr+j);
+			__m128 wi = _mm_mul_ps(S, _mm_loadu_ps(Wi+j));
+			__m128 pr, pi;
+			_mm_storeu_ps(r0+j, _mm_add_ps(ar, br));
+			_mm_storeu_ps(i0+j, _mm_add_ps(ai, bi));
+			MultiplySSE2(_mm_sub_ps(ar, br), _mm_sub_ps(ai, bi),
+				wr, wi, &pr, &pi);
+			_mm_storeu_ps(r1+j, pr);
+			_mm_storeu_ps(i1+j, pi);
+		}
+	}
+}
+
+
+SSE2 static void Radix4SSE2(float *re, float *im, vDSP_Length N,
+	vDSP_Length Q, const float *Wr2, const float *Wi2,
+	const float *Wr1, const float *Wi1, float Sign)
+{
+	const __m128 S = _mm_set1_ps(Sign);
+	for (vDSP_Length k = 0; k < N; k += 4*Q)
+	{
+		float *r = re + k, *i = im + k;
+		for (vDSP_Length j = 0; j < Q; j += 4)
+		{
+			__m128
+				ar0 = _mm_loadu_ps(r+j    ), ai0 = _mm_loadu_ps(i+j    ),
+				ar1 = _mm_loadu_ps(r+j+  Q), ai1 = _mm_loadu_ps(i+j+  Q),
+				ar2 = _mm_loadu_ps(r+j+2*Q), ai2 = _mm_loadu_ps(i+j+2*Q),
+				ar3 = _mm_loadu_ps(r+j+3*Q), ai3 = _mm_loadu_ps(i+j+3*Q);
+			__m128 br0, bi0, br1, bi1, br2, bi2, br3, bi3, pr, pi;
+
+			// First stage, half span 2*Q.
+			br0 = _mm_add_ps(ar0, ar2); bi0 = _mm_add_ps(ai0, ai2);
+			br1 = _mm_add_ps(ar1, ar3); bi1 = _mm_add_ps(ai1, ai3);
+			MultiplySSE2(_mm_sub_ps(ar0, ar2), _mm_sub_ps(ai0, ai2),
+				_mm_loadu_ps(Wr2+j),
+				_mm_mul_ps(S, _mm_loadu_ps(Wi2+j)), &br2, &bi2);
+			MultiplySSE2(_mm_sub_ps(ar1, ar3), _mm_sub_ps(ai1, ai3),
+				_mm_loadu_ps(Wr2+j+Q),
+				_mm_mul_ps(S, _mm_loadu_ps(Wi2+j+Q)), &br3, &bi3);
+
+			// Second stage, half span Q.
+			__m128 wr = _mm_loadu_ps(Wr1+j);
+			__m128 wi = _mm_mul_ps(S, _mm_loadu_ps(Wi1+j));
+			_mm_storeu_ps(r+j    , _mm_add_ps(br0, br1));
+			_mm_storeu_ps(i+j    , _mm_add_ps(bi0, bi1));
+			MultiplySSE2(_mm_sub_ps(br0, br1), _mm_sub_ps(bi0, bi1),
+				wr, wi, &pr, &pi);
+			_mm_storeu_ps(r+j+  Q, pr);
+			_mm_storeu_ps(i+j+  Q, pi);
+			_mm_storeu_ps(r+j+2*Q, _mm_add_ps(br2, br3));
+			_mm_storeu_ps(i+j+2*Q, _mm_add_ps(bi2, bi3));
+			MultiplySSE2(_mm_sub_ps(br2, br3), _mm_sub_ps(bi2, bi3),
+				wr, wi, &pr, &pi);
+			_mm_storeu_ps(r+j+3*Q, pr);
+			_mm_storeu_ps(i+j+3*Q, pi);
+		}
+	}
+}
+
+
+/*	Each pair of vectors loaded holds four interleaved complex elements;
+	shuffling the even and odd floats out of the pair separates them.
+*/
+SSE2 static void InterleavedRadix2SSE2(const float *c, float *re, float *im,
+	vDSP_Length N, const float *Wr, const float *Wi, float Sign)
+{
+	const vDSP_Length H = N/2;
+	const float *c1 = c + 2*H;
+	const __m128 S = _mm_set1_ps(Sign);
+	for (vDSP_Length j = 0; j < H; j += 4)
+	{
+		__m128 a0 = _mm_loadu_ps(c +2*j), a1 = _mm_loadu_ps(c +2*j+4);
+		__m128 b0 = _mm_loadu_ps(c1+2*j), b1 = _mm_loadu_ps(c1+2*j+4);
+		__m128 ar = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 ai = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+		__m128 br = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 bi = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+		__m128 wr = _mm_loadu_ps(Wr+j);
+		__m128 wi = _mm_mul_ps(S, _mm_loadu_ps(Wi+j));
+		__m128 pr, pi;
+		_mm_storeu_ps(re+j, _mm_add_ps(ar, br));
+		_mm_storeu_ps(im+j, _mm_add_ps(ai, bi));
+		MultiplySSE2(_mm_sub_ps(ar, br), _mm_sub_ps(ai, bi),
+			wr, wi, &pr, &pi);
+		_mm_storeu_ps(re+j+H, pr);
+		_mm_storeu_ps(im+j+H, pi);
+	}
+}
+
+
+SSE2 static void SplitSSE2(const float *c, float *re, float *im,
+	vDSP_Length N)
+{
+	vDSP_Length i = 0;
+	for (; i + 4 <= N; i += 4)
+	{
+		__m128 c0 = _mm_loadu_ps(c + 2*i), c1 = _mm_loadu_ps(c + 2*i + 4);
+		_mm_storeu_ps(re+i, _mm_shuffle_ps(c0, c1, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(im+i, _mm_shuffle_ps(c0, c1, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+	SplitScalar(c + 2*i, re + i, im + i, N - i);
+}
+
+
+SSE2 static void JoinSSE2(const float *re, const float *im, float *c,
+	vDSP_Length N)
+{
+	vDSP_Length i = 0;
+	for (; i + 4 <= N; i += 4)
+	{
+		__m128 r = _mm_loadu_ps(re+i), m = _mm_loadu_ps(im+i);
+		_mm_storeu_ps(c + 2*i,     _mm_unpacklo_ps(r, m));
+		_mm_storeu_ps(c + 2*i + 4, _mm_unpackhi_ps(r, m));
+	}
+	JoinScalar(re + i, im + i, c + 2*i, N - i);
+}
+
+
+static const Kernels SSE2Kernels =
+	{ "SSE2", 4, Radix2SSE2, Radix4SSE2, InterleavedRadix2SSE2,
+		SplitSSE2, JoinSSE2, &ScalarKernels };
+
+
+// AVX2 kernels, eight elements per vector, using fused multiply-add.
+#define	AVX2	__attribute__((__target__("avx2,fma")))
+
+
+AVX2 static inline void MultiplyAVX2(__m256 dr, __m256 di,
+	__m256 wr, __m256 wi, __m256 *pr, __m256 *pi)
+{
+	*pr = _mm256_fmsub_ps(dr, wr, _mm256_mul_ps(di, wi));
+	*pi = _mm256_fmadd_ps(dr, wi, _mm256_mul_ps(di, wr));
+}
+
+
+AVX2 static void Radix2AVX2(float *re, float *im, vDSP_Length N,
+	vDSP_Length H, const float *Wr, const float *Wi, float Sign)
+{
+	const __m256 S = _mm256_set1_ps(Sign);
+	for (vDSP_Length k = 0; k < N; k += 2*H)
+	{
+		float *r0 = re + k, *i0 = im + k, *r1 = r0 + H, *i1 = i0 + H;
+		for (vDSP_Length j = 0; j < H; j += 8)
+		{
+			__m256 ar = _mm256_loadu_ps(r0+j);
+			__m256 ai = _mm256_loadu_ps(i0+j);
+			__m256 br = _mm256_loadu_ps(r1+j);
+			__m256 bi = _mm256_loadu_ps(i1+j);
+			__m256 wr = _mm256_loadu_ps(Wr+j);
+			__m256 wi = _mm256_mul_ps(S, _mm256_loadu_ps(Wi+j));
+			__m256 pr, pi;
+			_mm256_storeu_ps(r0+j, _mm256_add_ps(ar, br));
+			_mm256_storeu_ps(i0+j, _mm256_add_ps(ai, bi));
+			MultiplyAVX2(_mm256_sub_ps(ar, br), _mm256_sub_ps(ai, bi),
+				wr, wi, &pr, &pi);
+			_mm256_storeu_ps(r1+j, pr);
+			_mm256_storeu_ps(i1+j, pi);
+		}
+	}
+}
+
+
+AVX2 static void Radix4AVX2(float *re, float *im, vDSP_Length N,
+	vDSP_Length Q, const float *Wr2, const float *Wi2,
+	const float *Wr1, const float *Wi1, float Sign)
+{
+	const __m256 S = _mm256_set1_ps(Sign);
+	for (vDSP_Length k = 0; k < N; k += 4*Q)
+	{
+		float *r = re + k, *i = im + k;
+		for (vDSP_Length j = 0; j < Q; j += 8)
+		{
+			__m256
+				ar0 = _mm256_loadu_ps(r+j    ),
+				ai0 = _mm256_loadu_ps(i+j    ),
+				ar1 = _mm256_loadu_ps(r+j+  Q),
+				ai1 = _mm256_loadu_ps(i+j+  Q),
+				ar2 = _mm256_loadu_ps(r+j+2*Q),
+				ai2 = _mm256_loadu_ps(i+j+2*Q),
+				ar3 = _mm256_loadu_ps(r+j+3*Q),
+				ai3 = _mm256_loadu_ps(i+j+3*Q);
+			__m256 br0, bi0, br1, bi1, br2, bi2, br3, bi3, pr, pi;
+
+			// First stage, half span 2*Q.
+			br0 = _mm256_add_ps(ar0, ar2);
+			bi0 = _mm256_add_ps(ai0, ai2);
+			br1 = _mm256_add_ps(ar1, ar3);
+			bi1 = _mm256_add_ps(ai1, ai3);
+			MultiplyAVX2(
+				_mm256_sub_ps(ar0, ar2), _mm256_sub_ps(ai0, ai2),
+				_mm256_loadu_ps(Wr2+j),
+				_mm256_mul_ps(S, _mm256_loadu_ps(Wi2+j)),
+				&br2, &bi2);
+			MultiplyAVX2(
+				_mm256_sub_ps(ar1, ar3), _mm256_sub_ps(ai1, ai3),
+				_mm256_loadu_ps(Wr2+j+Q),
+				_mm256_mul_ps(S, _mm256_loadu_ps(Wi2+j+Q)),
+				&br3, &bi3);
+
+			// Second stage, half span Q.
+			__m256 wr = _mm256_loadu_ps(Wr1+j);
+			__m256 wi = _mm256_mul_ps(S, _mm256_loadu_ps(Wi1+j));
+			_mm256_storeu_ps(r+j    , _mm256_add_ps(br0, br1));
+			_mm256_storeu_ps(i+j    , _mm256_add_ps(bi0, bi1));
+			MultiplyAVX2(
+				_mm256_sub_ps(br0, br1), _mm256_sub_ps(bi0, bi1),
+				wr, wi, &pr, &pi);
+			_mm256_storeu_ps(r+j+  Q, pr);
+			_mm256_storeu_ps(i+j+  Q, pi);
+			_mm256_storeu_ps(r+j+2*Q, _mm256_add_ps(br2, br3));
+			_mm256_storeu_ps(i+j+2*Q, _mm256_add_ps(bi2, bi3));
+			MultiplyAVX2(
+				_mm256_sub_ps(br2, br3), _mm256_sub_ps(bi2, bi3),
+				wr, wi, &pr, &pi);
+			_mm256_storeu_ps(r+j+3*Q, pr);
+			_mm256_storeu_ps(i+j+3*Q, pi);
+		}
+	}
+}
+
+
+/*	Separate the real and imaginary parts of eight interleaved complex
+	elements held in two vectors.  The shuffle works within 128-bit
+	lanes, so it leaves the elements in the order 0, 1, 4, 5, 2, 3, 6, 7,
+	and a permutation of 64-bit pairs restores the order.
+*/
+AVX2 static inline void DeinterleaveAVX2(const float *c, __m256 *r, __m256 *i)
+{
+	__m256 v0 = _mm256_loadu_ps(c), v1 = _mm256_loadu_ps(c+8);
+	__m256 e = _mm256_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+	__m256 o = _mm256_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+	*r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(e),
+		_MM_SHUFFLE(3, 1, 2, 0)));
+	*i = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(o),
+		_MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+
+AVX2 static void InterleavedRadix2AVX2(const float *c, float *re, float *im,
+	vDSP_Length N, const float *Wr, const float *Wi, float Sign)
+{
+	const vDSP_Length H = N/2;
+	const float *c1 = c + 2*H;
+	const __m256 S = _mm256_set1_ps(Sign);
+	for (vDSP_Length j = 0; j < H; j += 8)
+	{
+		__m256 ar, ai, br, bi, pr, pi;
+		DeinterleaveAVX2(c +2*j, &ar, &ai);
+		DeinterleaveAVX2(c1+2*j, &br, &bi);
+		__m256 wr = _mm256_loadu_ps(Wr+j);
+		__m256 wi = _mm256_mul_ps(S, _mm256_loadu_ps(Wi+j));
+		_mm256_storeu_ps(re+j, _mm256_add_ps(ar, br));
+		_mm256_storeu_ps(im+j, _mm256_add_ps(ai, bi));
+		MultiplyAVX2(_mm256_sub_ps(ar, br), _mm256_sub_ps(ai, bi),
+			wr, wi, &pr, &pi);
+		_mm256_storeu_ps(re+j+H, pr);
+		_mm256_storeu_ps(im+j+H, pi);
+	}
+}
+
+
+/*	The shuffles work within 128-bit lanes, so the split gathers the
+	even (or odd) elements of each lane and then puts the 64-bit pieces
+	in order, and the join does the reverse.
+*/
+AVX2 static void SplitAVX2(const float *c, float *re, float *im,
+	vDSP_Length N)
+{
+	vDSP_Length i = 0;
+	for (; i + 8 <= N; i += 8)
+	{
+		__m256 c0 = _mm256_loadu_ps(c + 2*i);
+		__m256 c1 = _mm256_loadu_ps(c + 2*i + 8);
+		__m256 r = _mm256_shuffle_ps(c0, c1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 m = _mm256_shuffle_ps(c0, c1, _MM_SHUFFLE(3, 1, 3, 1));
+		_mm256_storeu_ps(re+i, _mm256_castpd_ps(_mm256_permute4x64_pd(
+			_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0))));
+		_mm256_storeu_ps(im+i, _mm256_castpd_ps(_mm256_permute4x64_pd(
+			_mm256_castps_pd(m), _MM_SHUFFLE(3, 1, 2, 0))));
+	}
+	SplitSSE2(c + 2*i, re + i, im + i, N - i);
+}
+
+
+AVX2 static void JoinAVX2(const float *re, const float *im, float *c,
+	vDSP_Length N)
+{
+	vDSP_Length i = 0;
+	for (; i + 8 <= N; i += 8)
+	{
+		__m256 r = _mm256_loadu_ps(re+i), m = _mm256_loadu_ps(im+i);
+		__m256 Low = _mm256_unpacklo_ps(r, m), High = _mm256_unpackhi_ps(r, m);
+		_mm256_storeu_ps(c + 2*i,     _mm256_permute2f128_ps(Low, High, 0x20));
+		_mm256_storeu_ps(c + 2*i + 8, _mm256_permute2f128_ps(Low, High, 0x31));
+	}
+	JoinSSE2(re + i, im + i, c + 2*i, N - i);
+}
+
+
+static const Kernels AVX2Kernels =
+	{ "AVX2", 8, Radix2AVX2, Radix4AVX2, InterleavedRadix2AVX2,
+		SplitAVX2, JoinAVX2, &SSE2Kernels };
+
+
+/*	AVX-512 kernels, sixteen elements per vector, using fused
+	multiply-add.  The butterfly passes are the AVX2 ones with wider
+	vectors.  The split and join passes take any N:  the last 1 to 15
+	elements are moved with masked loads and stores instead of being
+	handed to narrower kernels.
+*/
+#define	AVX512	__attribute__((__target__("avx512f,fma")))
+
+
+AVX512 static inline void MultiplyAVX512(__m512 dr, __m512 di,
+	__m512 wr, __m512 wi, __m512 *pr, __m512 *pi)
+{
+	*pr = _mm512_fmsub_ps(dr, wr, _mm512_mul_ps(di, wi));
+	*pi = _mm512_fmadd_ps(dr, wi, _mm512_mul_ps(di, wr));
+}
+
+
+AVX512 static void Radix2AVX512(float *re, float *im, vDSP_Length N,
+	vDSP_Length H, const float *Wr, const float *Wi, float Sign)
+{
+	const __m512 S = _mm512_set1_ps(Sign);
+	for (vDSP_Length k = 0; k < N; k += 2*H)
+	{
+		float *r0 = re + k, *i0 = im + k, *r1 = r0 + H, *i1 = i0 + H;
+		for (vDSP_Length j = 0; j < H; j += 16)
+		{
+			__m512 ar = _mm512_loadu_ps(r0+j);
+			__m512 ai = _mm512_loadu_ps(i0+j);
+			__m512 br = _mm512_loadu_ps(r1+j);
+			__m512 bi = _mm512_loadu_ps(i1+j);
+			__m512 wr = _mm512_loadu_ps(Wr+j);
+			__m512 wi = _mm512_mul_ps(S, _mm512_loadu_ps(Wi+j));
+			__m512 pr, pi;
+			_mm512_storeu_ps(r0+j, _mm512_add_ps(ar, br));
+			_mm512_storeu_ps(i0+j, _mm512_add_ps(ai, bi));
+			MultiplyAVX512(_mm512_sub_ps(ar, br), _mm512_sub_ps(ai, bi),
+				wr, wi, &pr, &pi);
+			_mm512_storeu_ps(r1+j, pr);
+			_mm512_storeu_ps(i1+j, pi);
+		}
+	}
+}
+
+
+AVX512 static void Radix4AVX512(float *re, float *im, vDSP_Length N,
+	vDSP_Length Q, const float *Wr2, const float *Wi2,
+	const float *Wr1, const float *Wi1, float Sign)
+{
+	const __m512 S = _mm512_set1_ps(Sign);
+	for (vDSP_Length k = 0; k < N; k += 4*Q)
+	{
+		float *r = re + k, *i = im + k;
+		for (vDSP_Length j = 0; j < Q; j += 16)
+		{
+			__m512
+				ar0 = _mm512_loadu_ps(r+j    ),
+				ai0 = _mm512_loadu_ps(i+j    ),
+				ar1 = _mm512_loadu_ps(r+j+  Q),
+				ai1 = _mm512_loadu_ps(i+j+  Q),
+				ar2 = _mm512_loadu_ps(r+j+2*Q),
+				ai2 = _mm512_loadu_ps(i+j+2*Q),
+				ar3 = _mm512_loadu_ps(r+j+3*Q),
+				ai3 = _mm512_loadu_ps(i+j+3*Q);
+			__m512 br0, bi0, br1, bi1, br2, bi2, br3, bi3, pr, pi;
+
+			// First stage, half span 2*Q.
+			br0 = _mm512_add_ps(ar0, ar2);
+			bi0 = _mm512_add_ps(ai0, ai2);
+			br1 = _mm512_add_ps(ar1, ar3);
+			bi1 = _mm512_add_ps(ai1, ai3);
+			MultiplyAVX512(
+				_mm512_sub_ps(ar0, ar2), _mm512_sub_ps(ai0, ai2),
+				_mm512_loadu_ps(Wr2+j),
+				_mm512_mul_ps(S, _mm512_loadu_ps(Wi2+j)),
+				&br2, &bi2);
+			MultiplyAVX512(
+				_mm512_sub_ps(ar1, ar3), _mm512_sub_ps(ai1, ai3),
+				_mm512_loadu_ps(Wr2+j+Q),
+				_mm512_mul_ps(S, _mm512_loadu_ps(Wi2+j+Q)),
+				&br3, &bi3);
+
+			// Second stage, half span Q.
+			__m512 wr = _mm512_loadu_ps(Wr1+j);
+			__m512 wi = _mm512_mul_ps(S, _mm512_loadu_ps(Wi1+j));
+			_mm512_storeu_ps(r+j    , _mm512_add_ps(br0, br1));
+			_mm512_storeu_ps(i+j    , _mm512_add_ps(bi0, bi1));
+			MultiplyAVX512(
+				_mm512_sub_ps(br0, br1), _mm512_sub_ps(bi0, bi1),
+				wr, wi, &pr, &pi);
+			_mm512_storeu_ps(r+j+  Q, pr);
+			_mm512_storeu_ps(i+j+  Q, pi);
+			_mm512_storeu_ps(r+j+2*Q, _mm512_add_ps(br2, br3));
+			_mm512_storeu_ps(i+j+2*Q, _mm512_add_ps(bi2, bi3));
+			MultiplyAVX512(
+				_mm512_sub_ps(br2, br3), _mm512_sub_ps(bi2, bi3),
+				wr, wi, &pr, &pi);
+			_mm512_storeu_ps(r+j+3*Q, pr);
+			_mm512_storeu_ps(i+j+3*Q, pi);
+		}
+	}
+}
+
+
+/*	Separate the real and imaginary parts of N interleaved complex
+	elements, 0 < N <= 16, at c.  Unlike the AVX2 shuffles, the two-source
+	permutation crosses the whole vector, so the elements come out in
+	order.  Lanes past N are zero, and memory past the N elements is
+	not read.
+*/
+AVX512 static inline void DeinterleaveAVX512(const float *c, vDSP_Length N,
+	__m512 *r, __m512 *i)
+{
+	const __m512i Even = _mm512_setr_epi32(
+		0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+	const __m512i Odd = _mm512_add_epi32(Even, _mm512_set1_epi32(1));
+	__m512 v0, v1;
+	if (N == 16)
+	{
+		v0 = _mm512_loadu_ps(c);
+		v1 = _mm512_loadu_ps(c+16);
+	}
+	else
+	{
+		const uint32_t Mask = (uint32_t) (((uint64_t) 1 << 2*N) - 1);
+		v0 = _mm512_maskz_loadu_ps((__mmask16) Mask, c);
+		v1 = _mm512_maskz_loadu_ps((__mmask16) (Mask >> 16), c+16);
+	}
+	*r = _mm512_permutex2var_ps(v0, Even, v1);
+	*i = _mm512_permutex2var_ps(v0, Odd, v1);
+}
+
+
+AVX512 static void InterleavedRadix2AVX512(const float *c, float *re,
+	float *im, vDSP_Length N, const float *Wr, const float *Wi, float Sign)
+{
+	const vDSP_Length H = N/2;
+	const float *c1 = c + 2*H;
+	const __m512 S = _mm512_set1_ps(Sign);
+	for (vDSP_Length j = 0; j < H; j += 16)
+	{
+		__m512 ar, ai, br, bi, pr, pi;
+		DeinterleaveAVX512(c +2*j, 16, &ar, &ai);
+		DeinterleaveAVX512(c1+2*j, 16, &br, &bi);
+		__m512 wr = _mm512_loadu_ps(Wr+j);
+		__m512 wi = _mm512_mul_ps(S, _mm512_loadu_ps(Wi+j));
+		_mm512_storeu_ps(re+j, _mm512_add_ps(ar, br));
+		_mm512_storeu_ps(im+j, _mm512_add_ps(ai, bi));
+		MultiplyAVX512(_mm512_sub_ps(ar, br), _mm512_sub_ps(ai, bi),
+			wr, wi, &pr, &pi);
+		_mm512_storeu_ps(re+j+H, pr);
+		_mm512_storeu_ps(im+j+H, pi);
+	}
+}
+
+
+AVX512 static void SplitAVX512(const float *c, float *re, float *im,
+	vDSP_Length N)
+{
+	vDSP_Length i = 0;
+	for (; i + 16 <= N; i += 16)
+	{
+		__m512 r, m;
+		DeinterleaveAVX512(c + 2*i, 16, &r, &m);
+		_mm512_storeu_ps(re+i, r);
+		_mm512_storeu_ps(im+i, m);
+	}
+	if (i < N)
+	{
+		const __mmask16 Mask = (__mmask16) ((1u << (N - i)) - 1);
+		__m512 r, m;
+		DeinterleaveAVX512(c + 2*i, N - i, &r, &m);
+		_mm512_mask_storeu_ps(re+i, Mask, r);
+		_mm512_mask_storeu_ps(im+i, Mask, m);
+	}
+}
+
+
+AVX512 static void JoinAVX512(const float *re, const float *im, float *c,
+	vDSP_Length N)
+{
+	const __m512i Low = _mm512_setr_epi32(
+		0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+	const __m512i High = _mm512_add_epi32(Low, _mm512_set1_epi32(8));
+	vDSP_Length i = 0;
+	for (; i + 16 <= N; i += 16)
+	{
+		__m512 r = _mm512_loadu_ps(re+i), m = _mm512_loadu_ps(im+i);
+		_mm512_storeu_ps(c + 2*i,      _mm512_permutex2var_ps(r, Low,  m));
+		_mm512_storeu_ps(c + 2*i + 16, _mm512_permutex2var_ps(r, High, m));
+	}
+	if (i < N)
+	{
+		const uint32_t Mask = (uint32_t) (((uint64_t) 1 << 2*(N - i)) - 1);
+		const __mmask16 Half = (__mmask16) ((1u << (N - i)) - 1);
+		__m512 r = _mm512_maskz_loadu_ps(Half, re+i);
+		__m512 m = _mm512_maskz_loadu_ps(Half, im+i);
+		_mm512_mask_storeu_ps(c + 2*i, (__mmask16) Mask,
+			_mm512_permutex2var_ps(r, Low, m));
+		_mm512_mask_storeu_ps(c + 2*i + 16, (__mmask16) (Mask >> 16),
+			_mm512_permutex2var_ps(r, High, m));
+	}
+}
+
+
+static const Kernels AVX512Kernels =
+	{ "AVX-512", 16, Radix2AVX512, Radix4AVX512, InterleavedRadix2AVX512,
+		SplitAVX512, JoinAVX512, &AVX2Kernels };
+
+
+#endif	// defined HasIntelVectors
+
+
+// Choose the widest kernels the processor supports.
+static const Kernels *ChooseKernels(unsigned Features)
+{
+	#if defined HasIntelVectors
+		if ((Features & CPUAVX512) && (Features & CPUAVX2)
+				&& (Features & CPUFMA))
+			return &AVX512Kernels;
+		if ((Features & CPUAVX2) && (Features & CPUFMA))
+			return &AVX2Kernels;
+		if (Features & CPUSSE2)
+			return &SSE2Kernels;
+	#endif
+
+	return &ScalarKernels;
+}
+
+
+/*	Return the kernels to use for the features allowed now (see
+	LimitCPUFeatures), which another thread may change at any time.
+	Choosing takes a few tests of one atomic read of the features, so
+	it is done on every call, and nothing but the note of the choice is
+	kept between calls.  The last kernels noted are swapped atomically,
+	so the note is made once for each change, whichever thread sees it.
+*/
+static const Kernels *GetKernels(void)
+{
+	static const Kernels *Noted;
+	const Kernels *K = ChooseKernels(CPUFeatures());
+	if (__atomic_load_n(&Noted, __ATOMIC_RELAXED) != K
+			&& __atomic_exchange_n(&Noted, K, __ATOMIC_RELAXED) != K)
+		NoteKernelVariant("FFT, vDSP_ctoz, and vDSP_ztoc", K->Name);
+	return K;
+}
+
+
+/*	Perform the last two stages (half spans 2 and 1) on every block of
+	four elements.  Their twiddle factors are 1 and -i*Sign, so no
+	multiplications are needed.
+*/
+static void FourPointLast(float *re, float *im, vDSP_Length N, float Sign)
+{
+	for (vDSP_Length k = 0; k < N; k += 4)
+	{
+		float *r = re + k, *i = im + k;
+		float br0 = r[0] + r[2], bi0 = i[0] + i[2];
+		float br1 = r[1] + r[3], bi1 = i[1] + i[3];
+		float br2 = r[0] - r[2], bi2 = i[0] - i[2];
+
+		// Multiply r[1]-r[3] + i*(i[1]-i[3]) by -i*Sign.
+		float br3 = Sign * (i[1] - i[3]), bi3 = Sign * (r[3] - r[1]);
+
+		r[0] = br0 + br1; i[0] = bi0 + bi1;
+		r[1] = br0 - br1; i[1] = bi0 - bi1;
+		r[2] = br2 + br3; i[2] = bi2 + bi3;
+		r[3] = br2 - br3; i[3] = bi2 - bi3;
+	}
+}
+
+
+// Put the elements of a vector of 2**Log2N elements in bit-reversed order.
+static void BitReverse(const FFTSetup Setup, float *re, float *im,
+	vDSP_Length Log2N)
+{
+	const vDSP_Length N = (vDSP_Length) 1 << Log2N;
+	const unsigned Shift = Setup->Log2N - Log2N;
+	const uint32_t *Reverse = Setup->BitReverse;
+
+	for (vDSP_Length i = 0; i < N; ++i)
+	{
+		vDSP_Length j = Reverse[i] >> Shift;
+		if (i < j)
+		{
+			float t;
+			t = re[i]; re[i] = re[j]; re[j] = t;
+			t = im[i]; im[i] = im[j]; im[j] = t;
+		}
+	}
+}
+
+
+/*	Perform the stages of a complex FFT of N elements, starting with
+	the stage with half span H (which is N/2 for a whole FFT), leaving
+	the results in bit-reversed order.  Sign is +1 for forward and -1
+	for inverse.
+*/
+static void ComplexStages(const FFTSetup Setup, float *re, float *im,
+	vDSP_Length N, vDSP_Length H, float Sign)
+{
+	const float *Wr = Setup->Wr, *Wi = Setup->Wi;
+	const Kernels *K = GetKernels();
+
+	// Do pairs of stages while they are wide enough for the vectors.
+	while (4 <= H && K->Width <= H/2)
+	{
+		K->Radix4(re, im, N, H/2,
+			Wr + H - 1, Wi + H - 1, Wr + H/2 - 1, Wi + H/2 - 1, Sign);
+		H /= 4;
+	}
+
+	// Do single stages, using narrower vectors as the stages shrink.
+	while (4 <= H)
+	{
+		while (H < K->Width)
+			K = K->Narrower;
+		K->Radix2(re, im, N, H, Wr + H - 1, Wi + H - 1, Sign);
+		H /= 2;
+	}
+
+	// Finish the last stages.
+	if (H == 2)
+		FourPointLast(re, im, N, Sign);
+	else if (H == 1)
+		Radix2Scalar(re, im, N, 1, Wr, Wi, Sign);
+}
+
+
+/*	Perform an in-place complex FFT of 2**Log2N elements with unit
+	stride.  Sign is +1 for forward and -1 for inverse.
+*/
+static void ComplexFFT(const FFTSetup Setup, float *re, float *im,
+	vDSP_Length Log2N, float Sign)
+{
+	const vDSP_Length N = (vDSP_Length) 1 << Log2N;
+
+	if (N < 2)
+		return;
+
+	ComplexStages(Setup, re, im, N, N/2, Sign);
+	BitReverse(Setup, re, im, Log2N);
+}
+
+
+/*	After a forward complex FFT of the N/2 elements formed from N real
+	elements, separate the spectra of the even and odd elements and
+	combine them into the spectrum of the real signal, in vDSP's packed
+	format and scaled by two.
+*/
+static void RealForwardFinish(const FFTSetup Setup, float *re, float *im,
+	vDSP_Length Log2N)
+{
+	const vDSP_Length H = (vDSP_Length) 1 << (Log2N-1);
+	const float *Wr = Setup->Wr + H - 1, *Wi = Setup->Wi + H - 1;
+
+	// Element 0 holds the DC and Nyquist terms, which are both real.
+	float r0 = re[0], i0 = im[0];
+	re[0] = 2 * (r0 + i0);
+	im[0] = 2 * (r0 - i0);
+
+	for (vDSP_Length k = 1, m = H-1; k <= m; ++k, --m)
+	{
+		// E = Z[k] + conj(Z[m]), and D = Z[k] - conj(Z[m]).
+		float er = re[k] + re[m], ei = im[k] - im[m];
+		float dr = re[k] - re[m], di = im[k] + im[m];
+
+		// O = -i * D * W**k.
+		float qr = di*Wr[k] + dr*Wi[k], qi = di*Wi[k] - dr*Wr[k];
+
+		re[k] = er + qr; im[k] = ei + qi;
+		re[m] = er - qr; im[m] = qi - ei;
+	}
+}
+
+
+/*	Before an inverse complex FFT, undo RealForwardFinish (apart from
+	scaling), so that the inverse complex FFT produces the real signal
+	with even elements in re and odd elements in im.
+*/
+static void RealInverseStart(const FFTSetup Setup, float *re, float *im,
+	vDSP_Length Log2N)
+{
+	const vDSP_Length H = (vDSP_Length) 1 << (Log2N-1);
+	const float *Wr = Setup->Wr + H - 1, *Wi = Setup->Wi + H - 1;
+
+	float r0 = re[0], i0 = im[0];
+	re[0] = r0 + i0;
+	im[0] = r0 - i0;
+
+	for (vDSP_Length k = 1, m = H-1; k <= m; ++k, --m)
+	{
+		// A = Y[k] + conj(Y[m]), and B = Y[k] - conj(Y[m]).
+		float ar = re[k] + re[m], ai = im[k] - im[m];
+		float br = re[k] - re[m], bi = im[k] + im[m];
+
+		// D = i * B * conj(W**k).
+		float dr = br*Wi[k] - bi*Wr[k], di = br*Wr[k] + bi*Wi[k];
+
+		re[k] = ar + dr; im[k] = ai + di;
+		re[m] = ar - dr; im[m] = di - ai;
+	}
+}
+
+
+// Perform an in-place real-to-complex FFT with unit stride.
+static void RealFFT(const FFTSetup Setup, float *re, float *im,
+	vDSP_Length Log2N, FFTDirection Direction)
+{
+	if (Log2N == 0)
+		return;
+
+	if (Direction == FFT_FORWARD)
+	{
+		ComplexFFT(Setup, re, im, Log2N-1, +1);
+		RealForwardFinish(Setup, re, im, Log2N);
+	}
+	else
+	{
+		RealInverseStart(Setup, re, im, Log2N);
+		ComplexFFT(Setup, re, im, Log2N-1, -1);
+	}
+}
+
+
+// Allocate memory or exit with a message.
+static void *Allocate(size_t Size)
+{
+	void *p = malloc(Size);
+	if (p == NULL)
+	{
+		fprintf(stderr, "Error, failed to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+	return p;
+}
+
+
+/*	Each thread keeps one scratch buffer, enlarged as needed, for the
+	routines below that need working space on every call.  Routines
+	called repeatedly with the same lengths, as in a timing loop or a
+	loop over frames, then allocate nothing after the first call.  A
+	routine must be done with the buffer before it calls another routine
+	that uses it.
+*/
+typedef struct { void *Memory; size_t Size; } Scratch;
+
+static pthread_key_t ScratchKey;
+static pthread_once_t ScratchOnce = PTHREAD_ONCE_INIT;
+
+
+// Release a thread's scratch buffer when the thread exits.
+static void FreeScratch(void *p)
+{
+	Scratch *S = p;
+	free(S->Memory);
+	free(S);
+}
+
+
+static void CreateScratchKey(void)
+{
+	if (pthread_key_create(&ScratchKey, FreeScratch) != 0)
+	{
+		fprintf(stderr, "Error, failed to create a thread key.\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+// Return the calling thread's scratch buffer, with room for Size bytes.
+static void *GetScratch(size_t Size)
+{
+	pthread_once(&ScratchOnce, CreateScratchKey);
+
+	Scratch *S = pthread_getspecific(ScratchKey);
+	if (S == NULL)
+	{
+		S = Allocate(sizeof *S);
+		S->Memory = NULL;
+		S->Size = 0;
+		pthread_setspecific(ScratchKey, S);
+	}
+
+	if (S->Size < Size)
+	{
+		free(S->Memory);
+		S->Memory = Allocate(Size);
+		S->Size = Size;
+	}
+
+	return S->Memory;
+}
+
+
+// Copy N elements of a split-complex vector between strided locations.
+static void CopySplit(const DSPSplitComplex *A, vDSP_Stride IA,
+	const DSPSplitComplex *C, vDSP_Stride IC, vDSP_Length N)
+{
+	if (A->realp == C->realp && A->imagp == C->imagp && IA == IC)
+		return;
+
+	for (vDSP_Length i = 0; i < N; ++i)
+	{
+		C->realp[i*IC] = A->realp[i*IA];
+		C->imagp[i*IC] = A->imagp[i*IA];
+	}
+}
+
+
+/*	Perform Transform, a complex or real FFT, on a split-complex vector
+	of N elements with stride IC.  Non-unit strides are handled by
+	copying to and from the calling thread's scratch buffer, so T must
+	not use the scratch buffer itself.
+*/
+typedef void Transform(const FFTSetup Setup, float *re, float *im,
+	vDSP_Length Log2N, FFTDirection Direction);
+
+static void StridedTransform(Transform *T, const FFTSetup Setup,
+	const DSPSplitComplex *C, vDSP_Stride IC, vDSP_Length N,
+	vDSP_Length Log2N, FFTDirection Direction)
+{
+	if (IC == 1)
+	{
+		T(Setup, C->realp, C->imagp, Log2N, Direction);
+		return;
+	}
+
+	float *Memory = GetScratch(2 * N * sizeof *Memory);
+	DSPSplitComplex Buffer = { Memory, Memory + N };
+	CopySplit(C, IC, &Buffer, 1, N);
+	T(Setup, Buffer.realp, Buffer.imagp, Log2N, Direction);
+	CopySplit(&Buffer, 1, C, IC, N);
+}
+
+
+// Adapt ComplexFFT to the Transform type.
+static void ComplexTransform(const FFTSetup Setup, float *re, float *im,
+	vDSP_Length Log2N, FFTDirection Direction)
+{
+	ComplexFFT(Setup, re, im, Log2N, Direction);
+}
+
+
+FFTSetup CreateFFTSetupOnNUMANode(vDSP_Length Log2N, FFTRadix Radix,
+	int Node)
+{
+	vDSP_Length Factor;
+	switch (Radix)
+	{
+		case FFT_RADIX2: Factor = 1; break;
+		case FFT_RADIX3: Factor = 3; break;
+		case FFT_RADIX5: Factor = 5; break;
+		default: return NULL;
+	}
+
+	if (30 < Log2N)
+		return NULL;
+
+	FFTSetup Setup = malloc(sizeof *Setup);
+	if (Setup == NULL)
+		return NULL;
+
+	const vDSP_Length N = (vDSP_Length) 1 << Log2N;
+
+	/*	Allocate the tables as one block:  Wr and Wi, then Fr and Fi,
+		which are empty for radix 2, then BitReverse.
+	*/
+	Setup->Log2N = Log2N;
+	Setup->Factor = Factor;
+	Setup->Node = Node;
+	Setup->Bytes = N * (2 * Factor * sizeof(float) + sizeof(uint32_t));
+	float *Tables = AllocateOnNUMANode(Setup->Bytes, Node);
+	if (Tables == NULL)
+	{
+		free(Setup);
+		return NULL;
+	}
+
+	Setup->Wr = Tables;
+	Setup->Wi = Tables + N;
+	Setup->Fr = NULL;
+	Setup->Fi = NULL;
+	Setup->BitReverse = (uint32_t *) (Tables + 2 * Factor * N);
+
+	if (1 < Factor)
+	{
+		Setup->Fr = Tables + 2 * N;
+		Setup->Fi = Tables + (Factor+1) * N;
+
+		for (vDSP_Length n = 0; n < (Factor-1) * N; ++n)
+		{
+			Setup->Fr[n] =  cos(n * TwoPi / (Factor * N));
+			Setup->Fi[n] = -sin(n * TwoPi / (Factor * N));
+		}
+	}
+
+	// Compute twiddle factors in double precision for accuracy.
+	for (vDSP_Length H = 1; H < N; H *= 2)
+		for (vDSP_Length j = 0; j < H; ++j)
+		{
+			Setup->Wr[H-1+j] =  cos(j * TwoPi / (2*H));
+			Setup->Wi[H-1+j] = -sin(j * TwoPi / (2*H));
+		}
+
+	Setup->BitReverse[0] = 0;
+	for (vDSP_Length i = 1; i < N; ++i)
+		Setup->BitReverse[i] = Setup->BitReverse[i>>1] >> 1
+			| (uint32_t) (i & 1) << (Log2N-1);
+
+	return Setup;
+}
+
+
+FFTSetup vDSP_create_fftsetup(vDSP_Length Log2N, FFTRadix Radix)
+{
+	return CreateFFTSetupOnNUMANode(Log2N, Radix, AnyNUMANode);
+}
+
+
+size_t FFTSetupBytes(FFTSetup Setup, vDSP_Length Log2N, FFTRadix Radix)
+{
+	(void) Log2N;
+	(void) Radix;
+	return Setup->Bytes;
+}
+
+
+void vDSP_destroy_fftsetup(FFTSetup Setup)
+{
+	if (Setup == NULL)
+		return;
+	FreeOnNUMANode(Setup->Wr, Setup->Bytes, Setup->Node);
+	free(Setup);
+}
+
+
+void vDSP_ctoz(const DSPComplex *C, vDSP_Stride IC,
+	const DSPSplitComplex *Z, vDSP_Stride IZ, vDSP_Length N)
+{
+	/*	IC is measured in floats, not in complex elements, following
+		the legacy vDSP convention.
+	*/
+	const float *c = (const float *) C;
+	if (IC == 2 && IZ == 1)
+	{
+		GetKernels()->Split(c, Z->realp, Z->imagp, N);
+		return;
+	}
+
+	for (vDSP_Length i = 0; i < N; ++i)
+	{
+		Z->realp[i*IZ] = c[i*IC    ];
+		Z->imagp[i*IZ] = c[i*IC + 1];
+	}
+}
+
+
+void vDSP_ztoc(const DSPSplitComplex *Z, vDSP_Stride IZ,
+	DSPComplex *C, vDSP_Stride IC, vDSP_Length N)
+{
+	float *c = (float *) C;
+	if (IC == 2 && IZ == 1)
+	{
+		GetKernels()->Join(Z->realp, Z->imagp, c, N);
+		return;
+	}
+
+	for (vDSP_Length i = 0; i < N; ++i)
+	{
+		c[i*IC    ] = Z->realp[i*IZ];
+		c[i*IC + 1] = Z->imagp[i*IZ];
+	}
+}
+
+
+void vDSP_fft_zip(FFTSetup Setup, const DSPSplitComplex *C,
+	vDSP_Stride IC, vDSP_Length Log2N, FFTDirection Direction)
+{
+	StridedTransform(ComplexTransform, Setup, C, IC,
+		(vDSP_Length) 1 << Log2N, Log2N, Direction);
+}
+
+
+void vDSP_fft_zop(FFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA,
+	const DSPSplitComplex *C, vDSP_Stride IC,
+	vDSP_Length Log2N, FFTDirection Direction)
+{
+	CopySplit(A, IA, C, IC, (vDSP_Length) 1 << Log2N);
+	vDSP_fft_zip(Setup, C, IC, Log2N, Direction);
+}
+
+
+void vDSP_fft_zrip(FFTSetup Setup, const DSPSplitComplex *C,
+	vDSP_Stride IC, vDSP_Length Log2N, FFTDirection Direction)
+{
+	if (Log2N == 0)
+		return;
+	StridedTransform(RealFFT, Setup, C, IC,
+		(vDSP_Length) 1 << (Log2N-1), Log2N, Direction);
+}
+
+
+void vDSP_fft_zrop(FFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA,
+	const DSPSplitComplex *C, vDSP_Stride IC,
+	vDSP_Length Log2N, FFTDirection Direction)
+{
+	if (Log2N == 0)
+		return;
+	CopySplit(A, IA, C, IC, (vDSP_Length) 1 << (Log2N-1));
+	vDSP_fft_zrip(Setup, C, IC, Log2N, Direction);
+}
+
+
+/*	Mixed-radix FFTs.
+
+	A transform of N = F * M elements, with F three or five and M a power
+	of two, is done by decimation in time:  the input is split into F
+	subsequences of M elements, x[F*m + j] for 0 <= j < F, each is
+	transformed with the radix-2 FFT, and then, for each k < M, the F
+	spectra Y[j][k] are multiplied by the twiddle factors W**(j*k), where
+	W = exp(-2*pi*i/N), and combined by an F-point transform into the
+	outputs X[k + M*q], 0 <= q < F.
+
+	The F-point transforms are written out with the symmetries of their
+	factors, so, besides the twiddle factors, a radix-3 combination takes
+	4 real multiplications and a radix-5 combination 16, instead of the
+	F*F complex multiplications of a direct F-point transform.
+*/
+
+
+static const float Sin60 = 0.866025403784438647f;
+static const float Cos72 = 0.309016994374947424f, Sin72 = 0.951056516295153572f;
+static const float Cos144 = -0.809016994374947424f,
+	Sin144 = 0.587785252292473129f;
+
+
+/*	Combine the spectra of three subsequences, each of M elements, in
+	re and im (subsequence j at offset j*M), into the output C.  Sign is
+	+1 for forward and -1 for inverse.
+*/
+static void Combine3(const FFTSetup Setup, const float *re, const float *im,
+	const DSPSplitComplex *C, vDSP_Stride IC, vDSP_Length Log2N, float Sign)
+{
+	const vDSP_Length M = (vDSP_Length) 1 << Log2N;
+	const unsigned Shift = Setup->Log2N - Log2N;
+	const float *Fr = Setup->Fr, *Fi = Setup->Fi;
+	const float S = Sign * Sin60;
+
+	for (vDSP_Length k = 0; k < M; ++k)
+	{
+		// Apply the twiddle factors W**(j*k) to subsequences 1 and 2.
+		const vDSP_Length n1 = k << Shift, n2 = 2*k << Shift;
+		const float w1r = Fr[n1], w1i = Sign * Fi[n1];
+		const float w2r = Fr[n2], w2i = Sign * Fi[n2];
+
+		const float t0r = re[k], t0i = im[k];
+		const float t1r = re[M+k] * w1r - im[M+k] * w1i;
+		const float t1i = re[M+k] * w1i + im[M+k] * w1r;
+		const float t2r = re[2*M+k] * w2r - im[2*M+k] * w2i;
+		const float t2i = re[2*M+k] * w2i + im[2*M+k] * w2r;
+
+		const float sr = t1r + t2r, si = t1i + t2i;
+		const float dr = t1r - t2r, di = t1i - t2i;
+		const float mr = t0r - .5f * sr, mi = t0i - .5f * si;
+
+		C->realp[ k      *IC] = t0r + sr;
+		C->imagp[ k      *IC] = t0i + si;
+		C->realp[(k+  M)*IC] = mr + S * di;
+		C->imagp[(k+  M)*IC] = mi - S * dr;
+		C->realp[(k+2*M)*IC] = mr - S * di;
+		C->imagp[(k+2*M)*IC] = mi + S * dr;
+	}
+}
+
+
+// Combine the spectra of five subsequences, as Combine3 does for three.
+static void Combine5(const FFTSetup Setup, const float *re, const float *im,
+	const DSPSplitComplex *C, vDSP_Stride IC, vDSP_Length Log2N, float Sign)
+{
+	const vDSP_Length M = (vDSP_Length) 1 << Log2N;
+	const unsigned Shift = Setup->Log2N - Log2N;
+	const float *Fr = Setup->Fr, *Fi = Setup->Fi;
+	const float S1 = Sign * Sin72, S2 = Sign * Sin144;
+
+	for (vDSP_Length k = 0; k < M; ++k)
+	{
+		float tr[5], ti[5];
+		tr[0] = re[k];
+		ti[0] = im[k];
+		for (vDSP_Length j = 1; j < 5; ++j)
+		{
+			const vDSP_Length n = j*k << Shift;
+			const float wr = Fr[n], wi = Sign * Fi[n];
+			const float xr = re[j*M+k], xi = im[j*M+k];
+			tr[j] = xr * wr - xi * wi;
+			ti[j] = xr * wi + xi * wr;
+		}
+
+		// Sums and differences of the elements with conjugate factors.
+		const float a1r = tr[1] + tr[4], a1i = ti[1] + ti[4];
+		const float b1r = tr[1] - tr[4], b1i = ti[1] - ti[4];
+		const float a2r = tr[2] + tr[3], a2i = ti[2] + ti[3];
+		const float b2r = tr[2] - tr[3], b2i = ti[2] - ti[3];
+
+		const float m1r = tr[0] + Cos72 * a1r + Cos144 * a2r;
+		const float m1i = ti[0] + Cos72 * a1i + Cos144 * a2i;
+		const float m2r = tr[0] + Cos144 * a1r + Cos72 * a2r;
+		const float m2i = ti[0] + Cos144 * a1i + Cos72 * a2i;
+
+		// Outputs 1 and 4 add and subtract -i * (S1*b1 + S2*b2).
+		const float n1r = S1 * b1i + S2 * b2i;
+		const float n1i = -(S1 * b1r + S2 * b2r);
+		// Outputs 2 and 3 add and subtract -i * (S2*b1 - S1*b2).
+		const float n2r = S2 * b1i - S1 * b2i;
+		const float n2i = -(S2 * b1r - S1 * b2r);
+
+		C->realp[ k      *IC] = tr[0] + a1r + a2r;
+		C->imagp[ k      *IC] = ti[0] + a1i + a2i;
+		C->realp[(k+  M)*IC] = m1r + n1r;
+		C->imagp[(k+  M)*IC] = m1i + n1i;
+		C->realp[(k+2*M)*IC] = m2r + n2r;
+		C->imagp[(k+2*M)*IC] = m2i + n2i;
+		C->realp[(k+3*M)*IC] = m2r - n2r;
+		C->imagp[(k+3*M)*IC] = m2i - n2i;
+		C->realp[(k+4*M)*IC] = m1r - n1r;
+		C->imagp[(k+4*M)*IC] = m1i - n1i;
+	}
+}
+
+
+/*	Perform a complex FFT of Factor * 2**Log2N elements from A to C.
+	The subsequences are gathered into the calling thread's scratch
+	buffer and transformed there, so A and C may be the same vector.
+*/
+static void MixedRadixFFT(const FFTSetup Setup, vDSP_Length Factor,
+	const DSPSplitComplex *A, vDSP_Stride IA,
+	const DSPSplitComplex *C, vDSP_Stride IC,
+	vDSP_Length Log2N, FFTDirection Direction)
+{
+	if (Setup->Factor != Factor || Setup->Log2N < Log2N)
+	{
+		fprintf(stderr,
+			"Error, FFT setup does not support %lu * 2**%lu elements.\n",
+			(unsigned long) Factor, (unsigned long) Log2N);
+		exit(EXIT_FAILURE);
+	}
+
+	const vDSP_Length M = (vDSP_Length) 1 << Log2N;
+
+	float *Memory = GetScratch(2 * Factor * M * sizeof *Memory);
+	float *re = Memory, *im = Memory + Factor * M;
+
+	for (vDSP_Length j = 0; j < Factor; ++j)
+	{
+		for (vDSP_Length m = 0; m < M; ++m)
+		{
+			re[j*M + m] = A->realp[(Factor*m + j) * IA];
+			im[j*M + m] = A->imagp[(Factor*m + j) * IA];
+		}
+		ComplexFFT(Setup, re + j*M, im + j*M, Log2N, Direction);
+	}
+
+	// The combining butterflies take the direction as a sign.
+	const float Sign = Direction;
+	if (Factor == 3)
+		Combine3(Setup, re, im, C, IC, Log2N, Sign);
+	else
+		Combine5(Setup, re, im, C, IC, Log2N, Sign);
+}
+
+
+void vDSP_fft3_zop(FFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA,
+	const DSPSplitComplex *C, vDSP_Stride IC,
+	vDSP_Length Log2N, FFTDirection Direction)
+{
+	MixedRadixFFT(Setup, 3, A, IA, C, IC, Log2N, Direction);
+}
+
+
+void vDSP_fft5_zop(FFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA,
+	const DSPSplitComplex *C, vDSP_Stride IC,
+	vDSP_Length Log2N, FFTDirection Direction)
+{
+	MixedRadixFFT(Setup, 5, A, IA, C, IC, Log2N, Direction);
+}
+
+
+/*	Interleaved-data FFTs.
+
+	The split-complex routines need interleaved data converted with
+	vDSP_ctoz before the transform and converted back with vDSP_ztoc
+	after it, each a full pass through memory.  These routines instead
+	read the interleaved input in the first step of the transform and
+	write the interleaved output in the last:  the first butterfly stage
+	(or, for the inverse real FFT, the step that combines the spectra)
+	reads interleaved elements directly, and the bit-reversal
+	permutation (or, for the forward real FFT, the step that separates
+	the spectra) writes interleaved elements directly.  In between, the
+	usual split-complex passes run on a scratch buffer, which also lets
+	the input and output be the same array.
+*/
+
+
+/*	Copy a vector of 2**Log2N separated-data elements in bit-reversed
+	order to the interleaved-data vector c in natural order.
+*/
+static void BitReverseToInterleaved(const FFTSetup Setup,
+	const float *re, const float *im, float *c, vDSP_Length Log2N)
+{
+	const vDSP_Length N = (vDSP_Length) 1 << Log2N;
+	const unsigned Shift = Setup->Log2N - Log2N;
+	const uint32_t *Reverse = Setup->BitReverse;
+
+	for (vDSP_Length i = 0; i < N; ++i)
+	{
+		vDSP_Length j = Reverse[i] >> Shift;
+		c[2*i  ] = re[j];
+		c[2*i+1] = im[j];
+	}
+}
+
+
+/*	RealForwardFinish, reading the complex FFT's results in bit-reversed
+	order from re and im and writing the spectrum to the interleaved-data
+	vector c.
+*/
+static void RealForwardFinishToInterleaved(const FFTSetup Setup,
+	const float *re, const float *im, float *c, vDSP_Length Log2N)
+{
+	const vDSP_Length H = (vDSP_Length) 1 << (Log2N-1);
+	const float *Wr = Setup->Wr + H - 1, *Wi = Setup->Wi + H - 1;
+	const unsigned Shift = Setup->Log2N - (Log2N-1);
+	const uint32_t *Reverse = Setup->BitReverse;
+
+	// Element 0 is in place, since zero reversed is zero.
+	float r0 = re[0], i0 = im[0];
+	c[0] = 2 * (r0 + i0);
+	c[1] = 2 * (r0 - i0);
+
+	for (vDSP_Length k = 1, m = H-1; k <= m; ++k, --m)
+	{
+		const vDSP_Length rk = Reverse[k] >> Shift, rm = Reverse[m] >> Shift;
+
+		// E = Z[k] + conj(Z[m]), and D = Z[k] - conj(Z[m]).
+		float er = re[rk] + re[rm], ei = im[rk] - im[rm];
+		float dr = re[rk] - re[rm], di = im[rk] + im[rm];
+
+		// O = -i * D * W**k.
+		float qr = di*Wr[k] + dr*Wi[k], qi = di*Wi[k] - dr*Wr[k];
+
+		c[2*k] = er + qr; c[2*k+1] = ei + qi;
+		c[2*m] = er - qr; c[2*m+1] = qi - ei;
+	}
+}
+
+
+/*	RealInverseStart, reading the spectrum from the interleaved-data
+	vector c and writing the separated-data vector re and im.
+*/
+static void RealInverseStartFromInterleaved(const FFTSetup Setup,
+	const float *c, float *re, float *im, vDSP_Length Log2N)
+{
+	const vDSP_Length H = (vDSP_Length) 1 << (Log2N-1);
+	const float *Wr = Setup->Wr + H - 1, *Wi = Setup->Wi + H - 1;
+
+	float r0 = c[0], i0 = c[1];
+	re[0] = r0 + i0;
+	im[0] = r0 - i0;
+
+	for (vDSP_Length k = 1, m = H-1; k <= m; ++k, --m)
+	{
+		// A = Y[k] + conj(Y[m]), and B = Y[k] - conj(Y[m]).
+		float ar = c[2*k] + c[2*m], ai = c[2*k+1] - c[2*m+1];
+		float br = c[2*k] - c[2*m], bi = c[2*k+1] + c[2*m+1];
+
+		// D = i * B * conj(W**k).
+		float dr = br*Wi[k] - bi*Wr[k], di = br*Wr[k] + bi*Wi[k];
+
+		re[k] = ar + dr; im[k] = ai + di;
+		re[m] = ar - dr; im[m] = di - ai;
+	}
+}
+
+
+/*	Perform the first stage of a complex FFT of N elements from the
+	interleaved-data vector c to re and im, and then the remaining
+	stages, leaving the results in bit-reversed order.
+*/
+static void InterleavedStages(const FFTSetup Setup, const float *c,
+	float *re, float *im, vDSP_Length N, float Sign)
+{
+	if (N < 2)
+	{
+		re[0] = c[0];
+		im[0] = c[1];
+		return;
+	}
+
+	const Kernels *K = GetKernels();
+	while (N/2 < K->Width)
+		K = K->Narrower;
+	K->InterleavedRadix2(c, re, im, N,
+		Setup->Wr + N/2 - 1, Setup->Wi + N/2 - 1, Sign);
+
+	ComplexStages(Setup, re, im, N, N/4, Sign);
+}
+
+
+void InterleavedFFT_zop(FFTSetup Setup, const DSPComplex *A, DSPComplex *C,
+	vDSP_Length Log2N, FFTDirection Direction)
+{
+	const vDSP_Length N = (vDSP_Length) 1 << Log2N;
+
+	float *Memory = GetScratch(2 * N * sizeof *Memory);
+	float *re = Memory, *im = Memory + N;
+
+	InterleavedStages(Setup, (const float *) A, re, im, N, Direction);
+	BitReverseToInterleaved(Setup, re, im, (float *) C, Log2N);
+}
+
+
+void InterleavedFFT_zrop(FFTSetup Setup, const DSPComplex *A, DSPComplex *C,
+	vDSP_Length Log2N, FFTDirection Direction)
+{
+	if (Log2N == 0)
+		return;
+
+	// The N real elements are treated as N/2 complex elements.
+	const vDSP_Length H = (vDSP_Length) 1 << (Log2N-1);
+
+	float *Memory = GetScratch(2 * H * sizeof *Memory);
+	float *re = Memory, *im = Memory + H;
+
+	if (Direction == FFT_FORWARD)
+	{
+		InterleavedStages(Setup, (const float *) A, re, im, H, +1);
+		RealForwardFinishToInterleaved(Setup, re, im, (float *) C, Log2N);
+	}
+	else
+	{
+		RealInverseStartFromInterleaved(Setup, (const float *) A, re, im,
+			Log2N);
+		ComplexStages(Setup, re, im, H, H/2, -1);
+		BitReverseToInterleaved(Setup, re, im, (float *) C, Log2N-1);
+	}
+}
+
+
+/*	Fused power spectrum.
+
+	RealPowerSpectrum starts like InterleavedFFT_zrop, reading the real
+	signal as interleaved complex elements in the first butterfly stage.
+	In place of the step that separates the spectra of the even and odd
+	elements, it computes each requested bin alone, squares its
+	magnitude, and tracks the greatest, so neither the complex spectrum
+	nor the bit-reversal permutation is written out.  The arithmetic is
+	the same as RealForwardFinish's, so the powers match those computed
+	from vDSP_fft_zrip's results exactly.
+*/
+vDSP_Length RealPowerSpectrum(FFTSetup Setup, const float *Signal,
+	const DSPSplitComplex *Buffer, vDSP_Length Log2N,
+	const vDSP_Length *Bins, float *Power, vDSP_Length Count)
+{
+	const vDSP_Length H = (vDSP_Length) 1 << (Log2N-1);
+	const float *Wr = Setup->Wr + H - 1, *Wi = Setup->Wi + H - 1;
+	const unsigned Shift = Setup->Log2N - (Log2N-1);
+	const uint32_t *Reverse = Setup->BitReverse;
+	float *re = Buffer->realp, *im = Buffer->imagp;
+
+	InterleavedStages(Setup, Signal, re, im, H, +1);
+
+	float MaximumValue = -1;
+	vDSP_Length MaximumIndex = 0;
+
+	for (vDSP_Length i = 0; i < Count; ++i)
+	{
+		const vDSP_Length b = Bins ? Bins[i] : i;
+		float r, s;
+
+		if (b == 0)
+		{
+			// Bin 0 holds the DC and Nyquist terms.
+			r = 2 * (re[0] + im[0]);
+			s = 2 * (re[0] - im[0]);
+		}
+		else
+		{
+			/*	RealForwardFinish computes bins k and m = H-k together,
+				with k < m, and writes bin m last when they coincide.
+			*/
+			const vDSP_Length k = b < H-b ? b : H-b, m = H-k;
+			const vDSP_Length rk = Reverse[k] >> Shift;
+			const vDSP_Length rm = Reverse[m] >> Shift;
+
+			float er = re[rk] + re[rm], ei = im[rk] - im[rm];
+			float dr = re[rk] - re[rm], di = im[rk] + im[rm];
+			float qr = di*Wr[k] + dr*Wi[k], qi = di*Wi[k] - dr*Wr[k];
+
+			if (b == k && k != m)
+			{
+				r = er + qr; s = ei + qi;
+			}
+			else
+			{
+				r = er - qr; s = qi - ei;
+			}
+		}
+
+		const float Value = r*r + s*s;
+		Power[i] = Value;
+		if (MaximumValue < Value)
+		{
+			MaximumValue = Value;
+			MaximumIndex = i;
+		}
+	}
+
+	return MaximumIndex;
+}
+
+
+/*	Batched real-to-complex FFTs.
+
+	For small transforms, much of the time in vDSP_fft_zrip goes to
+	things other than full-width arithmetic:  the call itself, the
+	stages narrower than a vector, the bit reversal, and the scalar loop
+	that separates the spectra of the even and odd elements.  When many
+	signals of the same length are transformed, eight of them can
+	instead be processed together, one signal in each lane of an AVX2
+	vector.  Each element of the transform is then a whole vector, so
+	every stage and every step runs at full width however short the
+	signal is, and each twiddle factor is loaded once for all eight
+	signals.
+
+	In a batch buffer, element k of the signal in lane l is at
+	index k*8 + l.
+*/
+#if defined HasIntelVectors
+
+
+/*	Perform a complex FFT of 2**Log2N elements in each of eight lanes.
+	Pairs of stages are fused into radix-4 passes, as in ComplexFFT,
+	and a radix-2 stage finishes odd numbers of stages.
+*/
+AVX2 static void BatchComplexFFT(const FFTSetup Setup, float *re, float *im,
+	vDSP_Length Log2N, float Sign)
+{
+	const vDSP_Length N = (vDSP_Length) 1 << Log2N;
+	const __m256 S = _mm256_set1_ps(Sign);
+
+	vDSP_Length H = N/2;
+
+	for (; 2 <= H; H /= 4)
+	{
+		const vDSP_Length Q = H/2;
+		const float *Wr2 = Setup->Wr + H - 1, *Wi2 = Setup->Wi + H - 1;
+		const float *Wr1 = Setup->Wr + Q - 1, *Wi1 = Setup->Wi + Q - 1;
+		for (vDSP_Length j = 0; j < Q; ++j)
+		{
+			const __m256
+				wr2a = _mm256_broadcast_ss(Wr2 + j),
+				wi2a = _mm256_mul_ps(S, _mm256_broadcast_ss(Wi2 + j)),
+				wr2b = _mm256_broadcast_ss(Wr2 + j + Q),
+				wi2b = _mm256_mul_ps(S, _mm256_broadcast_ss(Wi2 + j + Q)),
+				wr1  = _mm256_broadcast_ss(Wr1 + j),
+				wi1  = _mm256_mul_ps(S, _mm256_broadcast_ss(Wi1 + j));
+			for (vDSP_Length k = j; k < N; k += 4*Q)
+			{
+				float *r = re + 8*k, *i = im + 8*k;
+				__m256
+					ar0 = _mm256_loadu_ps(r        ),
+					ai0 = _mm256_loadu_ps(i        ),
+					ar1 = _mm256_loadu_ps(r +  8*Q),
+					ai1 = _mm256_loadu_ps(i +  8*Q),
+					ar2 = _mm256_loadu_ps(r + 16*Q),
+					ai2 = _mm256_loadu_ps(i + 16*Q),
+					ar3 = _mm256_loadu_ps(r + 24*Q),
+					ai3 = _mm256_loadu_ps(i + 24*Q);
+				__m256 br0, bi0, br1, bi1, br2, bi2, br3, bi3, pr, pi;
+
+				// First stage, half span 2*Q.
+				br0 = _mm256_add_ps(ar0, ar2);
+				bi0 = _mm256_add_ps(ai0, ai2);
+				br1 = _mm256_add_ps(ar1, ar3);
+				bi1 = _mm256_add_ps(ai1, ai3);
+				MultiplyAVX2(
+					_mm256_sub_ps(ar0, ar2), _mm256_sub_ps(ai0, ai2),
+					wr2a, wi2a, &br2, &bi2);
+				MultiplyAVX2(
+					_mm256_sub_ps(ar1, ar3), _mm256_sub_ps(ai1, ai3),
+					wr2b, wi2b, &br3, &bi3);
+
+				// Second stage, half span Q.
+				_mm256_storeu_ps(r        , _mm256_add_ps(br0, br1));
+				_mm256_storeu_ps(i        , _mm256_add_ps(bi0, bi1));
+				MultiplyAVX2(
+					_mm256_sub_ps(br0, br1), _mm256_sub_ps(bi0, bi1),
+					wr1, wi1, &pr, &pi);
+				_mm256_storeu_ps(r +  8*Q, pr);
+				_mm256_storeu_ps(i +  8*Q, pi);
+				_mm256_storeu_ps(r + 16*Q, _mm256_add_ps(br2, br3));
+				_mm256_storeu_ps(i + 16*Q, _mm256_add_ps(bi2, bi3));
+				MultiplyAVX2(
+					_mm256_sub_ps(br2, br3), _mm256_sub_ps(bi2, bi3),
+					wr1, wi1, &pr, &pi);
+				_mm256_storeu_ps(r + 24*Q, pr);
+				_mm256_storeu_ps(i + 24*Q, pi);
+			}
+		}
+	}
+
+	// A last radix-2 stage has only the trivial twiddle factor one.
+	if (H == 1)
+		for (vDSP_Length k = 0; k < N; k += 2)
+		{
+			float *r = re + 8*k, *i = im + 8*k;
+			__m256 ar = _mm256_loadu_ps(r), br = _mm256_loadu_ps(r + 8);
+			__m256 ai = _mm256_loadu_ps(i), bi = _mm256_loadu_ps(i + 8);
+			_mm256_storeu_ps(r,     _mm256_add_ps(ar, br));
+			_mm256_storeu_ps(r + 8, _mm256_sub_ps(ar, br));
+			_mm256_storeu_ps(i,     _mm256_add_ps(ai, bi));
+			_mm256_storeu_ps(i + 8, _mm256_sub_ps(ai, bi));
+		}
+
+	// Put the vectors in bit-reversed order.
+	const unsigned Shift = Setup->Log2N - Log2N;
+	for (vDSP_Length i = 0; i < N; ++i)
+	{
+		vDSP_Length j = Setup->BitReverse[i] >> Shift;
+		if (i < j)
+		{
+			__m256 t;
+			t = _mm256_loadu_ps(re + 8*i);
+			_mm256_storeu_ps(re + 8*i, _mm256_loadu_ps(re + 8*j));
+			_mm256_storeu_ps(re + 8*j, t);
+			t = _mm256_loadu_ps(im + 8*i);
+			_mm256_storeu_ps(im + 8*i, _mm256_loadu_ps(im + 8*j));
+			_mm256_storeu_ps(im + 8*j, t);
+		}
+	}
+}
+
+
+// RealForwardFinish in each of eight lanes.
+AVX2 static void BatchRealForwardFinish(const FFTSetup Setup,
+	float *re, float *im, vDSP_Length Log2N)
+{
+	const vDSP_Length H = (vDSP_Length) 1 << (Log2N-1);
+	const float *Wr = Setup->Wr + H - 1, *Wi = Setup->Wi + H - 1;
+	const __m256 Two = _mm256_set1_ps(2);
+
+	__m256 r0 = _mm256_loadu_ps(re), i0 = _mm256_loadu_ps(im);
+	_mm256_storeu_ps(re, _mm256_mul_ps(Two, _mm256_add_ps(r0, i0)));
+	_mm256_storeu_ps(im, _mm256_mul_ps(Two, _mm256_sub_ps(r0, i0)));
+
+	for (vDSP_Length k = 1, m = H-1; k <= m; ++k, --m)
+	{
+		__m256 rk = _mm256_loadu_ps(re + 8*k), ik = _mm256_loadu_ps(im + 8*k);
+		__m256 rm = _mm256_loadu_ps(re + 8*m), im_ = _mm256_loadu_ps(im + 8*m);
+		__m256 wr = _mm256_broadcast_ss(Wr + k), wi = _mm256_broadcast_ss(Wi + k);
+
+		__m256 er = _mm256_add_ps(rk, rm), ei = _mm256_sub_ps(ik, im_);
+		__m256 dr = _mm256_sub_ps(rk, rm), di = _mm256_add_ps(ik, im_);
+
+		__m256 qr = _mm256_fmadd_ps(di, wr, _mm256_mul_ps(dr, wi));
+		__m256 qi = _mm256_fmsub_ps(di, wi, _mm256_mul_ps(dr, wr));
+
+		_mm256_storeu_ps(re + 8*k, _mm256_add_ps(er, qr));
+		_mm256_storeu_ps(im + 8*k, _mm256_add_ps(ei, qi));
+		_mm256_storeu_ps(re + 8*m, _mm256_sub_ps(er, qr));
+		_mm256_storeu_ps(im + 8*m, _mm256_sub_ps(qi, ei));
+	}
+}
+
+
+// RealInverseStart in each of eight lanes.
+AVX2 static void BatchRealInverseStart(const FFTSetup Setup,
+	float *re, float *im, vDSP_Length Log2N)
+{
+	const vDSP_Length H = (vDSP_Length) 1 << (Log2N-1);
+	const float *Wr = Setup->Wr + H - 1, *Wi = Setup->Wi + H - 1;
+
+	__m256 r0 = _mm256_loadu_ps(re), i0 = _mm256_loadu_ps(im);
+	_mm256_storeu_ps(re, _mm256_add_ps(r0, i0));
+	_mm256_storeu_ps(im, _mm256_sub_ps(r0, i0));
+
+	for (vDSP_Length k = 1, m = H-1; k <= m; ++k, --m)
+	{
+		__m256 rk = _mm256_loadu_ps(re + 8*k), ik = _mm256_loadu_ps(im + 8*k);
+		__m256 rm = _mm256_loadu_ps(re + 8*m), im_ = _mm256_loadu_ps(im + 8*m);
+		__m256 wr = _mm256_broadcast_ss(Wr + k), wi = _mm256_broadcast_ss(Wi + k);
+
+		__m256 ar = _mm256_add_ps(rk, rm), ai = _mm256_sub_ps(ik, im_);
+		__m256 br = _mm256_sub_ps(rk, rm), bi = _mm256_add_ps(ik, im_);
+
+		__m256 dr = _mm256_fmsub_ps(br, wi, _mm256_mul_ps(bi, wr));
+		__m256 di = _mm256_fmadd_ps(br, wr, _mm256_mul_ps(bi, wi));
+
+		_mm256_storeu_ps(re + 8*k, _mm256_add_ps(ar, dr));
+		_mm256_storeu_ps(im + 8*k, _mm256_add_ps(ai, di));
+		_mm256_storeu_ps(re + 8*m, _mm256_sub_ps(ar, dr));
+		_mm256_storeu_ps(im + 8*m, _mm256_sub_ps(di, ai));
+	}
+}
+
+
+// Transpose an 8*8 matrix held in eight vectors.
+AVX2 static inline void Transpose8(__m256 *v)
+{
+	__m256 t0 = _mm256_unpacklo_ps(v[0], v[1]);
+	__m256 t1 = _mm256_unpackhi_ps(v[0], v[1]);
+	__m256 t2 = _mm256_unpacklo_ps(v[2], v[3]);
+	__m256 t3 = _mm256_unpackhi_ps(v[2], v[3]);
+	__m256 t4 = _mm256_unpacklo_ps(v[4], v[5]);
+	__m256 t5 = _mm256_unpackhi_ps(v[4], v[5]);
+	__m256 t6 = _mm256_unpacklo_ps(v[6], v[7]);
+	__m256 t7 = _mm256_unpackhi_ps(v[6], v[7]);
+	__m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+	v[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+	v[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+	v[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+	v[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+	v[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+	v[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+	v[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+	v[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+
+/*	Move eight signals of N elements with stride IC, each IM after the
+	previous, between their own memory and a batch buffer.  Unit-stride
+	signals are moved eight elements at a time with a register
+	transpose; others are moved element by element.
+*/
+AVX2 static void ToBatch(const float *From, vDSP_Stride IC, vDSP_Stride IM,
+	float *To, vDSP_Length N)
+{
+	vDSP_Length k = 0;
+	if (IC == 1)
+		for (; k + 8 <= N; k += 8)
+		{
+			__m256 v[8];
+			for (int l = 0; l < 8; ++l)
+				v[l] = _mm256_loadu_ps(From + l*IM + k);
+			Transpose8(v);
+			for (int l = 0; l < 8; ++l)
+				_mm256_storeu_ps(To + 8*(k+l), v[l]);
+		}
+	for (; k < N; ++k)
+		for (int l = 0; l < 8; ++l)
+			To[8*k + l] = From[l*IM + k*IC];
+}
+
+
+AVX2 static void FromBatch(const float *From, float *To,
+	vDSP_Stride IC, vDSP_Stride IM, vDSP_Length N)
+{
+	vDSP_Length k = 0;
+	if (IC == 1)
+		for (; k + 8 <= N; k += 8)
+		{
+			__m256 v[8];
+			for (int l = 0; l < 8; ++l)
+				v[l] = _mm256_loadu_ps(From + 8*(k+l));
+			Transpose8(v);
+			for (int l = 0; l < 8; ++l)
+				_mm256_storeu_ps(To + l*IM + k, v[l]);
+		}
+	for (; k < N; ++k)
+		for (int l = 0; l < 8; ++l)
+			To[l*IM + k*IC] = From[8*k + l];
+}
+
+
+/*	Perform real-to-complex FFTs on eight signals of 2**Log2N real
+	elements (2**Log2N / 2 complex elements), with element stride IC and
+	signal stride IM.  Memory must have room for two batch buffers.
+*/
+AVX2 static void BatchRealFFT(const FFTSetup Setup, const DSPSplitComplex *C,
+	vDSP_Stride IC, vDSP_Stride IM, vDSP_Length Log2N,
+	FFTDirection Direction, float *Memory)
+{
+	const vDSP_Length N = (vDSP_Length) 1 << (Log2N-1);
+	float *re = Memory, *im = Memory + 8*N;
+
+	ToBatch(C->realp, IC, IM, re, N);
+	ToBatch(C->imagp, IC, IM, im, N);
+
+	if (Direction == FFT_FORWARD)
+	{
+		BatchComplexFFT(Setup, re, im, Log2N-1, +1);
+		BatchRealForwardFinish(Setup, re, im, Log2N);
+	}
+	else
+	{
+		BatchRealInverseStart(Setup, re, im, Log2N);
+		BatchComplexFFT(Setup, re, im, Log2N-1, -1);
+	}
+
+	FromBatch(re, C->realp, IC, IM, N);
+	FromBatch(im, C->imagp, IC, IM, N);
+}
+
+
+#endif	// defined HasIntelVectors
+
+
+void vDSP_fftm_zrip(FFTSetup Setup, const DSPSplitComplex *C,
+	vDSP_Stride IC, vDSP_Stride IM, vDSP_Length Log2N, vDSP_Length M,
+	FFTDirection Direction)
+{
+	vDSP_Length m = 0;
+
+	if (Log2N == 0)
+		return;
+
+	/*	Transform groups of eight signals together when AVX2 is
+		available, which it is whenever kernels at least eight wide are
+		chosen.
+	*/
+	#if defined HasIntelVectors
+		if (8 <= GetKernels()->Width && 8 <= M)
+		{
+			const vDSP_Length N = (vDSP_Length) 1 << (Log2N-1);
+			float *Memory = GetScratch(2 * 8 * N * sizeof *Memory);
+			for (; m + 8 <= M; m += 8)
+			{
+				DSPSplitComplex Signals =
+					{ C->realp + m*IM, C->imagp + m*IM };
+				BatchRealFFT(Setup, &Signals, IC, IM, Log2N, Direction,
+					Memory);
+			}
+		}
+	#endif
+
+	// Transform any remaining signals one at a time.
+	for (; m < M; ++m)
+	{
+		DSPSplitComplex Signal = { C->realp + m*IM, C->imagp + m*IM };
+		vDSP_fft_zrip(Setup, &Signal, IC, Log2N, Direction);
+	}
+}
+
+
+// Number of columns ColumnFFTs moves together, a cache line of floats.
+#define	ColumnTile	16
+
+
+/*	Perform complex FFTs on columns FirstColumn to NC-1, each of NR
+	elements, where columns start IC0 apart and elements in a column are
+	IC1 apart.
+
+	Copying one column at a time would read a different cache line for
+	every element, using only one float of it.  Instead, ColumnTile
+	columns are copied together into contiguous columns of the scratch
+	buffer, so each line of the array read (with unit IC0) is used
+	entirely, then transformed, and copied back the same way.
+*/
+static void ColumnFFTs(const FFTSetup Setup, const DSPSplitComplex *C,
+	vDSP_Stride IC0, vDSP_Stride IC1, vDSP_Length FirstColumn,
+	vDSP_Length NC, vDSP_Length Log2NR, FFTDirection Direction)
+{
+	const vDSP_Length NR = (vDSP_Length) 1 << Log2NR;
+
+	float *Memory = GetScratch(2 * ColumnTile * NR * sizeof *Memory);
+	float *re = Memory, *im = Memory + ColumnTile * NR;
+
+	for (vDSP_Length c0 = FirstColumn; c0 < NC; c0 += ColumnTile)
+	{
+		const vDSP_Length Width =
+			NC - c0 < ColumnTile ? NC - c0 : ColumnTile;
+		float *Cr = C->realp + c0*IC0, *Ci = C->imagp + c0*IC0;
+
+		for (vDSP_Length r = 0; r < NR; ++r)
+			for (vDSP_Length c = 0; c < Width; ++c)
+			{
+				re[c*NR + r] = Cr[r*IC1 + c*IC0];
+				im[c*NR + r] = Ci[r*IC1 + c*IC0];
+			}
+
+		for (vDSP_Length c = 0; c < Width; ++c)
+			ComplexFFT(Setup, re + c*NR, im + c*NR, Log2NR, Direction);
+
+		for (vDSP_Length r = 0; r < NR; ++r)
+			for (vDSP_Length c = 0; c < Width; ++c)
+			{
+				Cr[r*IC1 + c*IC0] = re[c*NR + r];
+				Ci[r*IC1 + c*IC0] = im[c*NR + r];
+			}
+	}
+}
+
+
+void vDSP_fft2d_zip(FFTSetup Setup, const DSPSplitComplex *C,
+	vDSP_Stride IC0, vDSP_Stride IC1,
+	vDSP_Length Log2N0, vDSP_Length Log2N1, FFTDirection Direction)
+{
+	const vDSP_Length NC = (vDSP_Length) 1 << Log2N0;
+	const vDSP_Length NR = (vDSP_Length) 1 << Log2N1;
+
+	if (IC1 == 0)
+		IC1 = IC0 * NC;
+
+	// Transform the rows.
+	for (vDSP_Length r = 0; r < NR; ++r)
+	{
+		DSPSplitComplex Row = { C->realp + r*IC1, C->imagp + r*IC1 };
+		vDSP_fft_zip(Setup, &Row, IC0, Log2N0, Direction);
+	}
+
+	// Transform the columns.
+	ColumnFFTs(Setup, C, IC0, IC1, 0, NC, Log2N1, Direction);
+}
+
+
+void vDSP_fft2d_zop(FFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA0, vDSP_Stride IA1,
+	const DSPSplitComplex *C, vDSP_Stride IC0, vDSP_Stride IC1,
+	vDSP_Length Log2N0, vDSP_Length Log2N1, FFTDirection Direction)
+{
+	const vDSP_Length NC = (vDSP_Length) 1 << Log2N0;
+	const vDSP_Length NR = (vDSP_Length) 1 << Log2N1;
+
+	if (IA1 == 0)
+		IA1 = IA0 * NC;
+	if (IC1 == 0)
+		IC1 = IC0 * NC;
+
+	for (vDSP_Length r = 0; r < NR; ++r)
+	{
+		DSPSplitComplex
+			In  = { A->realp + r*IA1, A->imagp + r*IA1 },
+			Out = { C->realp + r*IC1, C->imagp + r*IC1 };
+		CopySplit(&In, IA0, &Out, IC0, NC);
+	}
+
+	vDSP_fft2d_zip(Setup, C, IC0, IC1, Log2N0, Log2N1, Direction);
+}
+
+
+/*	Column 0 of a two-dimensional real-to-complex FFT holds two real
+	signals after the row transforms:  the DC terms of the rows in realp
+	and the Nyquist terms in imagp.  Each is given a real-to-complex FFT
+	of its own, and the packed result is stored down the column with
+	real and imaginary parts in alternate rows, as vDSP_ztoc would
+	arrange it.  (This layout of column 0 is a convention of this
+	implementation; other elements use the vDSP layout.)
+*/
+static void RealColumnFFT(const FFTSetup Setup, float *Column,
+	vDSP_Stride IC1, vDSP_Length Log2NR, FFTDirection Direction,
+	float *Memory)
+{
+	const vDSP_Length NR = (vDSP_Length) 1 << Log2NR;
+	float *re = Memory, *im = Memory + NR/2;
+
+	for (vDSP_Length i = 0; i < NR/2; ++i)
+	{
+		re[i] = Column[(2*i  ) * IC1];
+		im[i] = Column[(2*i+1) * IC1];
+	}
+
+	RealFFT(Setup, re, im, Log2NR, Direction);
+
+	/*	The forward real-to-complex FFT scales by two, but the rows
+		were already scaled, so remove the extra factor here.
+	*/
+	const float Scale = Direction == FFT_FORWARD ? .5f : 1;
+
+	for (vDSP_Length i = 0; i < NR/2; ++i)
+	{
+		Column[(2*i  ) * IC1] = Scale * re[i];
+		Column[(2*i+1) * IC1] = Scale * im[i];
+	}
+}
+
+
+void vDSP_fft2d_zrip(FFTSetup Setup, const DSPSplitComplex *C,
+	vDSP_Stride IC0, vDSP_Stride IC1,
+	vDSP_Length Log2N0, vDSP_Length Log2N1, FFTDirection Direction)
+{
+	// Each row of NC real elements is stored as NC/2 complex elements.
+	const vDSP_Length NC = (vDSP_Length) 1 << Log2N0;
+	const vDSP_Length NR = (vDSP_Length) 1 << Log2N1;
+
+	if (Log2N0 == 0)
+		return;
+
+	if (IC1 == 0)
+		IC1 = IC0 * (NC/2);
+
+	/*	The row transforms (when IC0 is not one) and ColumnFFTs use the
+		scratch buffer too, so it is fetched for the real columns only
+		when they are about to be transformed.
+	*/
+	float *Memory;
+
+	if (Direction == FFT_FORWARD)
+	{
+		for (vDSP_Length r = 0; r < NR; ++r)
+		{
+			DSPSplitComplex Row = { C->realp + r*IC1, C->imagp + r*IC1 };
+			vDSP_fft_zrip(Setup, &Row, IC0, Log2N0, Direction);
+		}
+		ColumnFFTs(Setup, C, IC0, IC1, 1, NC/2, Log2N1, Direction);
+		if (Log2N1 != 0)
+		{
+			Memory = GetScratch(NR * sizeof *Memory);
+			RealColumnFFT(Setup, C->realp, IC1, Log2N1, Direction, Memory);
+			RealColumnFFT(Setup, C->imagp, IC1, Log2N1, Direction, Memory);
+		}
+	}
+	else
+	{
+		if (Log2N1 != 0)
+		{
+			Memory = GetScratch(NR * sizeof *Memory);
+			RealColumnFFT(Setup, C->realp, IC1, Log2N1, Direction, Memory);
+			RealColumnFFT(Setup, C->imagp, IC1, Log2N1, Direction, Memory);
+		}
+		ColumnFFTs(Setup, C, IC0, IC1, 1, NC/2, Log2N1, Direction);
+		for (vDSP_Length r = 0; r < NR; ++r)
+		{
+			DSPSplitComplex Row = { C->realp + r*IC1, C->imagp + r*IC1 };
+			vDSP_fft_zrip(Setup, &Row, IC0, Log2N0, Direction);
+		}
+	}
+}
+
+
+void vDSP_fft2d_zrop(FFTSetup Setup,
+	const DSPSplitComplex *A, vDSP_Stride IA0, vDSP_Stride IA1,
+	const DSPSplitComplex *C, vDSP_Stride IC0, vDSP_Stride IC1,
+	vDSP_Length Log2N0, vDSP_Length Log2N1, FFTDirection Direction)
+{
+	const vDSP_Length NC = (vDSP_Length) 1 << Log2N0;
+	const vDSP_Length NR = (vDSP_Length) 1 << Log2N1;
+
+	if (IA1 == 0)
+		IA1 = IA0 * (NC/2);
+	if (IC1 == 0)
+		IC1 = IC0 * (NC/2);
+
+	for (vDSP_Length r = 0; r < NR; ++r)
+	{
+		DSPSplitComplex
+			In  = { A->realp + r*IA1, A->imagp + r*IA1 },
+			Out = { C->realp + r*IC1, C->imagp + r*IC1 };
+		CopySplit(&In, IA0, &Out, IC0, NC/2);
+	}
+
+	vDSP_fft2d_zrip(Setup, C, IC0, IC1, Log2N0, Log2N1, Direction);
+}
+
+
+#endif	// !defined __APPLE__
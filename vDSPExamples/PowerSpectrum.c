@@ -0,0 +1,51 @@
+/*	File: PowerSpectrum.c
+
+	Description:
+		The fused power spectrum for Mac OS X, built from Accelerate's
+		routines.
+
+		Accelerate's FFTs do not offer a way to fold other work into
+		them, so this routine calls vDSP_ctoz and vDSP_fft_zrip and
+		then computes the powers of the bins requested.  On other
+		systems, the portable FFT implementation in PortableFFT.c
+		provides this routine with the work fused into the transform,
+		and this file is empty.
+*/
+
+
+#if defined __APPLE__
+
+
+#include "PowerSpectrum.h"
+
+
+vDSP_Length RealPowerSpectrum(FFTSetup Setup, const float *Signal,
+	const DSPSplitComplex *Buffer, vDSP_Length Log2N,
+	const vDSP_Length *Bins, float *Power, vDSP_Length Count)
+{
+	vDSP_ctoz((const DSPComplex *) Signal, 2, Buffer, 1,
+		(vDSP_Length) 1 << (Log2N-1));
+	vDSP_fft_zrip(Setup, Buffer, 1, Log2N, FFT_FORWARD);
+
+	float MaximumValue = -1;
+	vDSP_Length MaximumIndex = 0;
+
+	for (vDSP_Length i = 0; i < Count; ++i)
+	{
+		const vDSP_Length b = Bins ? Bins[i] : i;
+		const float re = Buffer->realp[b], im = Buffer->imagp[b];
+		const float Value = re*re + im*im;
+
+		Power[i] = Value;
+		if (MaximumValue < Value)
+		{
+			MaximumValue = Value;
+			MaximumIndex = i;
+		}
+	}
+
+	return MaximumIndex;
+}
+
+
+#endif	// defined __APPLE__
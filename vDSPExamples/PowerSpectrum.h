@@ -0,0 +1,52 @@
+/*	File: PowerSpectrum.h
+
+	Description:
+		Declaration for a fused real-to-complex FFT and power spectrum.
+*/
+#ifndef __POWERSPECTRUM__
+#define __POWERSPECTRUM__
+
+
+#include "PortableDSP.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+/*	Finding the power at some frequencies of a real signal usually takes
+	three passes through memory:  vDSP_ctoz to split the signal into
+	even and odd elements, vDSP_fft_zrip to transform it, and a loop
+	that squares the magnitudes of the bins wanted.  This routine does
+	all three in one call.  With the portable vDSP routines, the split is
+	folded into the first butterfly stage and the last step of the
+	transform computes squared magnitudes directly, for just the bins
+	requested, so the complex spectrum is never written out; with
+	Accelerate, the three steps are done in turn.
+
+	Signal is 2**Log2N real elements, with 1 <= Log2N.  Buffer is a
+	workspace with room for 2**Log2N / 2 elements in each of its real
+	and imaginary arrays; its contents are destroyed.
+
+	For 0 <= i < Count, Power[i] is set to re*re + im*im, where re and im
+	are element Bins[i] of the spectrum vDSP_fft_zrip produces from the
+	signal.  (So, as with vDSP_fft_zrip, the values are scaled by four,
+	and bin 0 combines the DC and Nyquist terms.)  Each bin must be less
+	than 2**Log2N / 2.  If Bins is NULL, bin i is used, so Count may be up
+	to 2**Log2N / 2 to get the whole spectrum.
+
+	The return value is the index i of the greatest Power[i], the first
+	such if there are ties.
+*/
+vDSP_Length RealPowerSpectrum(FFTSetup Setup, const float *Signal,
+	const DSPSplitComplex *Buffer, vDSP_Length Log2N,
+	const vDSP_Length *Bins, float *Power, vDSP_Length Count);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -0,0 +1,236 @@
+/*	File: ThreadPool.c
+
+	Description:
+		A persistent pool of POSIX threads.  Starting threads for each
+		parallel loop costs tens of microseconds, which is as long as a
+		small FFT, so the threads are started once and then wait on a
+		condition variable for work.
+
+		Work is described by a task routine and a count.  The calling
+		thread and the workers take indices from a shared counter with
+		an atomic increment until the count is reached, so no thread
+		sits idle while another has a long list of work assigned to it.
+
+		Every thread, the caller included, runs its share of a job in
+		the pool's math mode (see MathMode.h), entered when it starts
+		the job and left when it finishes.  So the workers get fast
+		mode without their tasks doing anything, and all threads
+		compute with the same handling of subnormals.
+*/
+
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "MathMode.h"
+#include "ThreadPool.h"
+
+
+struct ThreadPool
+{
+	unsigned Threads;		// Number of threads, counting the caller.
+	pthread_t *Workers;		// The Threads-1 started threads.
+
+	pthread_mutex_t RunLock;	// Serializes callers of RunThreadPool.
+	MathMode Mode;			// Math mode to run tasks in.
+
+	pthread_mutex_t Lock;		// Protects the fields below.
+	pthread_cond_t Start;		// Signaled when a job is posted.
+	pthread_cond_t Finish;		// Signaled when the last worker is done.
+	unsigned long Generation;	// Incremented for each job.
+	unsigned Busy;			// Workers still working on the job.
+	int Exiting;			// Set when the pool is destroyed.
+
+	// The current job.
+	ThreadPoolTask *Task;
+	void *Context;
+	unsigned long Count;
+	unsigned long Next;		// Next index to hand out.
+	MathMode JobMode;		// Math mode for the current job.
+};
+
+
+/*	Run tasks from the current job, in the job's math mode, until there
+	are none left.
+*/
+static void Work(ThreadPool *Pool)
+{
+	MathModeGuard Guard = EnterMathMode(Pool->JobMode);
+
+	for (;;)
+	{
+		const unsigned long i = __sync_fetch_and_add(&Pool->Next, 1);
+		if (Pool->Count <= i)
+			break;
+		Pool->Task(Pool->Context, i);
+	}
+
+	LeaveMathMode(Guard);
+}
+
+
+// Wait for jobs and work on them until the pool is destroyed.
+static void *Worker(void *Argument)
+{
+	ThreadPool *Pool = Argument;
+	unsigned long Seen = 0;
+
+	pthread_mutex_lock(&Pool->Lock);
+	for (;;)
+	{
+		while (Pool->Generation == Seen && !Pool->Exiting)
+			pthread_cond_wait(&Pool->Start, &Pool->Lock);
+		if (Pool->Exiting)
+			break;
+		Seen = Pool->Generation;
+		pthread_mutex_unlock(&Pool->Lock);
+
+		Work(Pool);
+
+		pthread_mutex_lock(&Pool->Lock);
+		if (--Pool->Busy == 0)
+			pthread_cond_signal(&Pool->Finish);
+	}
+	pthread_mutex_unlock(&Pool->Lock);
+
+	return NULL;
+}
+
+
+ThreadPool *CreateThreadPool(unsigned Threads)
+{
+	if (Threads == 0)
+		Threads = 1;
+
+	ThreadPool *Pool = malloc(sizeof *Pool);
+	pthread_t *Workers = malloc((Threads-1) * sizeof *Workers + 1);
+	if (Pool == NULL || Workers == NULL)
+	{
+		fprintf(stderr, "Error, failed to allocate memory.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	Pool->Threads    = Threads;
+	Pool->Workers    = Workers;
+	Pool->Mode       = MathModeFast;
+	Pool->Generation = 0;
+	Pool->Busy       = 0;
+	Pool->Exiting    = 0;
+	Pool->Task       = NULL;
+	Pool->Context    = NULL;
+	Pool->Count      = 0;
+	Pool->Next       = 0;
+	Pool->JobMode    = MathModeFast;
+
+	pthread_mutex_init(&Pool->RunLock, NULL);
+	pthread_mutex_init(&Pool->Lock, NULL);
+	pthread_cond_init(&Pool->Start, NULL);
+	pthread_cond_init(&Pool->Finish, NULL);
+
+	for (unsigned t = 0; t < Threads-1; ++t)
+		if (pthread_create(&Workers[t], NULL, Worker, Pool) != 0)
+		{
+			fprintf(stderr, "Error, pthread_create failed.\n");
+			exit(EXIT_FAILURE);
+		}
+
+	return Pool;
+}
+
+
+void DestroyThreadPool(ThreadPool *Pool)
+{
+	pthread_mutex_lock(&Pool->Lock);
+	Pool->Exiting = 1;
+	pthread_cond_broadcast(&Pool->Start);
+	pthread_mutex_unlock(&Pool->Lock);
+
+	for (unsigned t = 0; t < Pool->Threads-1; ++t)
+		pthread_join(Pool->Workers[t], NULL);
+
+	pthread_cond_destroy(&Pool->Finish);
+	pthread_cond_destroy(&Pool->Start);
+	pthread_mutex_destroy(&Pool->Lock);
+	pthread_mutex_destroy(&Pool->RunLock);
+
+	free(Pool->Workers);
+	free(Pool);
+}
+
+
+unsigned ThreadPoolThreads(const ThreadPool *Pool)
+{
+	return Pool->Threads;
+}
+
+
+void SetThreadPoolMathMode(ThreadPool *Pool, MathMode Mode)
+{
+	pthread_mutex_lock(&Pool->RunLock);
+	Pool->Mode = Mode;
+	pthread_mutex_unlock(&Pool->RunLock);
+}
+
+
+MathMode ThreadPoolMathMode(const ThreadPool *Pool)
+{
+	return Pool->Mode;
+}
+
+
+static ThreadPool *Default;
+static pthread_once_t DefaultOnce = PTHREAD_ONCE_INIT;
+
+
+static void CreateDefault(void)
+{
+	long Processors = sysconf(_SC_NPROCESSORS_ONLN);
+	Default = CreateThreadPool(Processors < 1 ? 1 : (unsigned) Processors);
+}
+
+
+ThreadPool *DefaultThreadPool(void)
+{
+	pthread_once(&DefaultOnce, CreateDefault);
+	return Default;
+}
+
+
+void RunThreadPool(ThreadPool *Pool,
+	ThreadPoolTask *Task, void *Context, unsigned long Count)
+{
+	// With one thread or one task, there is nothing to share.
+	if (Pool->Threads == 1 || Count <= 1)
+	{
+		MathModeGuard Guard = EnterMathMode(Pool->Mode);
+		for (unsigned long i = 0; i < Count; ++i)
+			Task(Context, i);
+		LeaveMathMode(Guard);
+		return;
+	}
+
+	pthread_mutex_lock(&Pool->RunLock);
+
+	pthread_mutex_lock(&Pool->Lock);
+	Pool->Task    = Task;
+	Pool->Context = Context;
+	Pool->Count   = Count;
+	Pool->Next    = 0;
+	Pool->JobMode = Pool->Mode;
+	Pool->Busy    = Pool->Threads-1;
+	++Pool->Generation;
+	pthread_cond_broadcast(&Pool->Start);
+	pthread_mutex_unlock(&Pool->Lock);
+
+	// The calling thread works too.
+	Work(Pool);
+
+	pthread_mutex_lock(&Pool->Lock);
+	while (Pool->Busy != 0)
+		pthread_cond_wait(&Pool->Finish, &Pool->Lock);
+	pthread_mutex_unlock(&Pool->Lock);
+
+	pthread_mutex_unlock(&Pool->RunLock);
+}
@@ -0,0 +1,73 @@
+/*	File: ThreadPool.h
+
+	Description:
+		Declarations for a simple persistent pool of threads that
+		divide a loop of independent tasks among themselves.
+*/
+#ifndef __THREADPOOL__
+#define __THREADPOOL__
+
+
+#include "MathMode.h"
+
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+
+typedef struct ThreadPool ThreadPool;
+
+/*	A task is called once for each index from 0 to Count-1.  Calls with
+	different indices may run at the same time on different threads, in
+	any order.
+*/
+typedef void ThreadPoolTask(void *Context, unsigned long Index);
+
+
+/*	Create a pool that runs tasks on Threads threads, counting the thread
+	that calls RunThreadPool (so Threads-1 threads are started).  The
+	threads wait, without using processor time, until there is work.
+	The pool runs tasks in fast math mode until told otherwise.
+*/
+ThreadPool *CreateThreadPool(unsigned Threads);
+
+// Stop the pool's threads and release the pool.
+void DestroyThreadPool(ThreadPool *Pool);
+
+// Return the number of threads a pool uses, counting the caller.
+unsigned ThreadPoolThreads(const ThreadPool *Pool);
+
+/*	Set or return the math mode (see MathMode.h) in which a pool runs
+	tasks.  Every thread, including the one calling RunThreadPool, enters
+	the mode for the job and restores its own mode afterward, so tasks
+	never need to set it themselves.  Setting the mode waits for any
+	job in progress to finish.
+*/
+void SetThreadPoolMathMode(ThreadPool *Pool, MathMode Mode);
+MathMode ThreadPoolMathMode(const ThreadPool *Pool);
+
+/*	Return a pool shared by the whole program, with one thread for each
+	online processor.  It is created on first use and never destroyed.
+*/
+ThreadPool *DefaultThreadPool(void);
+
+/*	Call Task(Context, i) for each i from 0 to Count-1, spreading the
+	calls over the pool's threads, and return when all have finished.
+	Indices are handed out one at a time as threads become free, so
+	tasks of unequal length still balance.
+
+	Several threads may call RunThreadPool on the same pool; the calls
+	are run one after another.  A task must not call RunThreadPool on
+	the pool that is running it.
+*/
+void RunThreadPool(ThreadPool *Pool,
+	ThreadPoolTask *Task, void *Context, unsigned long Count);
+
+
+#ifdef __cplusplus
+	}
+#endif
+
+
+#endif
@@ -64,28 +64,76 @@
 #include "javamode.h"
 #include <CoreServices/CoreServices.h>
 #include <Accelerate/Accelerate.h>
+#include <pthread.h>
+#include <stdlib.h>
 
 #if defined(__VEC__)
 
-static vector unsigned long gOldJavaMode;
+	/* Each thread keeps its own stack of saved VSCR values, so that calls
+	may nest and several threads may toggle their own modes at once.  (The
+	VSCR belongs to the thread, so one global saved value would let one
+	thread restore another thread's mode.)  Beyond kMaximumDepth levels,
+	the inner levels are counted but not saved, and restoring them leaves
+	the mode alone. */
+enum { kMaximumDepth = 16 };
+
+typedef struct {
+	int depth;
+	vector unsigned long saved[kMaximumDepth];
+} SavedJavaModes;
+
+static pthread_key_t gSavedJavaModesKey;
+static pthread_once_t gSavedJavaModesOnce = PTHREAD_ONCE_INIT;
+
+
+static void CreateSavedJavaModesKey(void) {
+	pthread_key_create(&gSavedJavaModesKey, free);
+}
+
+
+static SavedJavaModes *GetSavedJavaModes(void) {
+
+	SavedJavaModes *modes;
+
+	pthread_once(&gSavedJavaModesOnce, CreateSavedJavaModesKey);
+	modes = pthread_getspecific(gSavedJavaModesKey);
+	if (modes == NULL) {
+		modes = calloc(1, sizeof *modes);
+		pthread_setspecific(gSavedJavaModesKey, modes);
+	}
+	return modes;
+}
 
 
 
 void TurnJavaModeOff(void) {
 
 	vector unsigned long javaOffMask = ( vector unsigned long ) ( 0x00010000 );
+	vector unsigned long oldJavaMode = ( vector unsigned long ) vec_mfvscr ( );
 	vector unsigned long java;
+	SavedJavaModes *modes = GetSavedJavaModes ( );
 
-	gOldJavaMode = ( vector unsigned long ) vec_mfvscr ( );
+	if ( modes != NULL ) {
+		if ( modes->depth < kMaximumDepth )
+			modes->saved[modes->depth] = oldJavaMode;
+		++modes->depth;
+	}
 
-	java = vec_or ( gOldJavaMode, javaOffMask );
+	java = vec_or ( oldJavaMode, javaOffMask );
 	vec_mtvscr ( java );
 
 }
 
 
 void RestoreJavaMode(void) {
-      vec_mtvscr( gOldJavaMode );
+
+	SavedJavaModes *modes = GetSavedJavaModes ( );
+
+	if ( modes == NULL || modes->depth == 0 )
+		return;
+	--modes->depth;
+	if ( modes->depth < kMaximumDepth )
+		vec_mtvscr( modes->saved[modes->depth] );
 }
 
-#endif
\ No newline at end of file
+#endif
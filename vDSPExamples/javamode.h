@@ -78,15 +78,18 @@ extern "C" {
 
 	/* TurnJavaModeOff turns off the AltiVec Java compatibility mode
 	by setting the NJ bit in the AltiVec Vector Status and Control Register (VSCR).
-	Before doing so, the current state of the VSCR is saved in a global variable.
-	TurnJavaModeOff must be followed by a call to RestoreJavaMode.  These calls
-	cannot be nested.  */
+	Before doing so, the current state of the VSCR is saved for the calling
+	thread.  TurnJavaModeOff must be followed by a call to RestoreJavaMode on
+	the same thread.  Pairs of calls may be nested, and different threads may
+	make them at the same time.  (For new code, MathMode.h provides the same
+	control for Intel and ARM processors, with the saved state kept by the
+	caller.)  */
 void TurnJavaModeOff(void);
 
 
 	/* RestoreJavaMode restores the AltiVec Java compatibility mode by
-	restoring the contents of the VSCR that were stored in the previous call
-	to TurnJavaModeOff. */
+	restoring the contents of the VSCR that were stored by the matching call
+	to TurnJavaModeOff on this thread. */
 void RestoreJavaMode(void);
 
 #endif
@@ -58,6 +58,7 @@
 
 #include "main.h"
 #include "javamode.h"
+#include "Clock.h"
 #include <stdio.h>
 
 #if defined(__VEC__)
@@ -88,20 +89,19 @@ void RestoreJavaModeOnG4(void)  {
 
 
 	/* globals used for caching the time */
-static UnsignedWide startTime, endTime;
+static ClockData startTime, endTime;
 
 void StartClock ( void ) {
-      Microseconds( &startTime );
+      startTime = Clock();
 }
 
 
 void StopClock( float *call_time ) {
-      Microseconds( &endTime );
-      
-      if ( endTime.hi == startTime.hi )
-            *call_time = ( float ) ( endTime.lo - startTime.lo );
-      else
-            *call_time = -1.0f;
+      endTime = Clock();
+
+      /* Time with the same clock as the rest of the examples (see
+      Clock.h), reporting microseconds as before. */
+      *call_time = ( float ) ( ClockToSeconds( endTime, startTime ) * 1e6 );
 }
 
 
@@ -110,6 +110,8 @@ void StopClock( float *call_time ) {
 
 int main(void) {
 
+    InitializeClock();
+
     printf("\n\n  BEGIN RunConvolutionSample() defined in Convolution.c\n\n");
     RunConvolutionSample();
     printf("\n\n  END RunConvolutionSample()\n\n\n");
@@ -79,8 +79,7 @@ void RestoreJavaModeOnG4(void);
 
 	/* routines used for timing.  To start the timer, call Start_Clock,
 	and to stop the timer call Stop_Clock.  Stop_Clock will return
-	the number of microseconds since Start_Clock was called, or
-	-1.0f if that number cannot be calculated. */
+	the number of microseconds since Start_Clock was called. */
 void StartClock( void );
 void StopClock( float *call_time );
 